@@ -60,3 +60,9 @@ bool AlwaysSomethingNode::anyIsAlwaysTrue() const
 {
     return AlwaysSomethingNode::isAlwaysTrue();
 }
+
+
+bool AlwaysSomethingNode::isLiteralSensitive() const
+{
+    return passwordCheckIsLiteralSensitive();
+}
@@ -66,6 +66,12 @@ public:
      */
     virtual bool anyIsAlwaysTrue() const WARN_UNUSED_RESULT;
 
+    /**
+     * Determines if the password check depends on the values of literals.
+     * Overridden from ConditionalNode.
+     */
+    virtual bool isLiteralSensitive() const WARN_UNUSED_RESULT;
+
 private:
     const bool always_;
 
@@ -0,0 +1,165 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AstArena.hpp"
+#include "AstNode.hpp"
+#include "nullptr.hpp"
+
+#include <boost/cstdint.hpp>
+#include <cassert>
+#include <cstddef>
+#include <new>
+
+const size_t AstArena::DEFAULT_BLOCK_SIZE;
+
+/**
+ * Everything that is handed out is aligned to this, which is enough for
+ * anything that the parser creates.
+ */
+static const size_t ALIGNMENT = 2 * sizeof(void*);
+
+/**
+ * Rounds a size up to the next multiple of ALIGNMENT.
+ */
+static size_t align(size_t bytes);
+
+
+AstArena::AstArena(const size_t blockSize) :
+    blockSize_(blockSize),
+    blocks_(nullptr),
+    current_(nullptr),
+    end_(nullptr),
+    finalizers_(nullptr),
+    bytesUsed_(0),
+    blocksAllocated_(0)
+{
+}
+
+
+AstArena::~AstArena()
+{
+    destroyAll();
+    while (nullptr != blocks_)
+    {
+        Block* const next = blocks_->next;
+        ::operator delete(blocks_);
+        blocks_ = next;
+    }
+}
+
+
+void* AstArena::allocate(const size_t bytes)
+{
+    const size_t alignedBytes = align(bytes);
+    if (static_cast<size_t>(end_ - current_) < alignedBytes)
+    {
+        addBlock(alignedBytes);
+    }
+    void* const memory = current_;
+    current_ += alignedBytes;
+    bytesUsed_ += alignedBytes;
+    return memory;
+}
+
+
+void AstArena::reset()
+{
+    destroyAll();
+    if (nullptr == blocks_)
+    {
+        return;
+    }
+
+    // Keep the oldest block, which is at the end of the list, because it's
+    // the one that every parse needs
+    while (nullptr != blocks_->next)
+    {
+        Block* const next = blocks_->next;
+        ::operator delete(blocks_);
+        blocks_ = next;
+    }
+    current_ = reinterpret_cast<char*>(blocks_) + align(sizeof(Block));
+    end_ = reinterpret_cast<char*>(blocks_) + blocks_->size;
+    bytesUsed_ = 0;
+}
+
+
+uint64_t AstArena::getBlocksAllocated() const
+{
+    return blocksAllocated_;
+}
+
+
+size_t AstArena::getBytesUsed() const
+{
+    return bytesUsed_;
+}
+
+
+void* AstArena::allocateObject(const size_t bytes, Finalizer** const finalizer)
+{
+    assert(nullptr != finalizer);
+    char* const memory = static_cast<char*>(
+        allocate(align(sizeof(Finalizer)) + bytes)
+    );
+    *finalizer = reinterpret_cast<Finalizer*>(memory);
+    return memory + align(sizeof(Finalizer));
+}
+
+
+void AstArena::adopt(AstNode* const node)
+{
+    assert(nullptr == node->arena_ && "AstNode is already in an arena");
+    node->arena_ = this;
+}
+
+
+void AstArena::destroyAll()
+{
+    while (nullptr != finalizers_)
+    {
+        Finalizer* const finalizer = finalizers_;
+        finalizers_ = finalizer->next;
+        finalizer->destroy(finalizer->object);
+    }
+}
+
+
+void AstArena::addBlock(const size_t minimumBytes)
+{
+    const size_t headerBytes = align(sizeof(Block));
+    const size_t size = (minimumBytes + headerBytes > blockSize_
+        ? minimumBytes + headerBytes
+        : blockSize_);
+    Block* const block = static_cast<Block*>(::operator new(size));
+    block->next = blocks_;
+    block->size = size;
+    blocks_ = block;
+    ++blocksAllocated_;
+
+    current_ = reinterpret_cast<char*>(block) + headerBytes;
+    end_ = reinterpret_cast<char*>(block) + size;
+}
+
+
+size_t align(const size_t bytes)
+{
+    return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
@@ -0,0 +1,206 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_ASTARENA_HPP_
+#define SRC_ASTARENA_HPP_
+
+#include <boost/cstdint.hpp>
+#include <cstddef>
+#include <new>
+
+class AstNode;
+
+/**
+ * Bump allocator for the nodes that the parser builds while parsing a query.
+ * Memory is handed out from large blocks and is never freed one piece at a
+ * time; instead, reset() destroys every object that was created in the arena
+ * and makes the memory available again in one step. The first block is kept
+ * across resets, so a parser that is reused doesn't need to allocate again.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class AstArena
+{
+public:
+    /**
+     * Default constructor.
+     * @param blockSize How many bytes to get from the heap at a time. Larger
+     *  allocations get a block of their own.
+     */
+    explicit AstArena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+    /**
+     * Destructor. Destroys everything in the arena.
+     */
+    ~AstArena();
+
+    /**
+     * Creates an object in the arena. The object is destroyed when the arena
+     * is reset or destroyed, and must not be deleted. AstNodes that are
+     * created here allocate their children from the arena too, and don't
+     * delete them.
+     */
+    ///@{
+    template <typename T>
+    T* create();
+    template <typename T, typename A1>
+    T* create(const A1& a1);
+    template <typename T, typename A1, typename A2>
+    T* create(const A1& a1, const A2& a2);
+    ///@}
+
+    /**
+     * Gets uninitialized memory that lasts until the arena is reset.
+     * @param bytes How many bytes are needed.
+     */
+    void* allocate(size_t bytes);
+
+    /**
+     * Destroys everything in the arena and releases all of the blocks except
+     * for the first one.
+     */
+    void reset();
+
+    /**
+     * How many blocks have been taken from the heap since the arena was
+     * created.
+     */
+    uint64_t getBlocksAllocated() const;
+
+    /**
+     * How many bytes have been handed out since the last reset.
+     */
+    size_t getBytesUsed() const;
+
+    static const size_t DEFAULT_BLOCK_SIZE = 8192;
+
+private:
+    /**
+     * Header at the start of each block.
+     */
+    struct Block
+    {
+        Block* next;
+        size_t size;
+    };
+
+    /**
+     * Destroys an object when the arena is reset. These are kept in the
+     * arena too, newest first, so objects are destroyed in reverse order.
+     */
+    struct Finalizer
+    {
+        void (*destroy)(void*);
+        void* object;
+        Finalizer* next;
+    };
+
+    template <typename T>
+    static void destroy(void* object);
+
+    /**
+     * Gets memory for an object along with the Finalizer that will destroy
+     * it, so that nothing is left half registered if the constructor throws.
+     * @param bytes The size of the object.
+     * @param finalizer Set to the Finalizer.
+     * @return Where to construct the object.
+     */
+    void* allocateObject(size_t bytes, Finalizer** finalizer);
+
+    /**
+     * Arranges for a newly constructed object to be destroyed when the
+     * arena is reset.
+     */
+    template <typename T>
+    T* manage(Finalizer* finalizer, T* object);
+
+    /**
+     * Sets an AstNode's arena. Overloaded so that other types can be
+     * created in the arena too.
+     */
+    ///@{
+    void adopt(AstNode* node);
+    void adopt(void*) {}
+    ///@}
+
+    void destroyAll();
+    void addBlock(size_t minimumBytes);
+
+    const size_t blockSize_;
+    Block* blocks_;
+    char* current_;
+    char* end_;
+    Finalizer* finalizers_;
+    size_t bytesUsed_;
+    uint64_t blocksAllocated_;
+
+    // Hidden methods
+    AstArena(const AstArena& rhs);
+    AstArena& operator=(const AstArena& rhs);
+};
+
+
+template <typename T>
+T* AstArena::create()
+{
+    Finalizer* finalizer;
+    void* const memory = allocateObject(sizeof(T), &finalizer);
+    return manage(finalizer, new(memory) T());
+}
+
+
+template <typename T, typename A1>
+T* AstArena::create(const A1& a1)
+{
+    Finalizer* finalizer;
+    void* const memory = allocateObject(sizeof(T), &finalizer);
+    return manage(finalizer, new(memory) T(a1));
+}
+
+
+template <typename T, typename A1, typename A2>
+T* AstArena::create(const A1& a1, const A2& a2)
+{
+    Finalizer* finalizer;
+    void* const memory = allocateObject(sizeof(T), &finalizer);
+    return manage(finalizer, new(memory) T(a1, a2));
+}
+
+
+template <typename T>
+void AstArena::destroy(void* const object)
+{
+    static_cast<T*>(object)->~T();
+}
+
+
+template <typename T>
+T* AstArena::manage(Finalizer* const finalizer, T* const object)
+{
+    finalizer->destroy = &AstArena::destroy<T>;
+    finalizer->object = object;
+    finalizer->next = finalizers_;
+    finalizers_ = finalizer;
+    adopt(object);
+    return object;
+}
+
+#endif  // SRC_ASTARENA_HPP_
@@ -18,53 +18,66 @@
  * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "nullptr.hpp"
+#include "AstArena.hpp"
 #include "AstNode.hpp"
+#include "nullptr.hpp"
 
-#include <vector>
+#include <cstddef>
 #include <string>
 #include <cassert>
 #include <ostream>
 
-using std::vector;
+using std::size_t;
 using std::string;
 using std::ostream;
 
+/**
+ * How many children to make room for when a node gets its first child.
+ * Most nodes have two or three.
+ */
+static const size_t INITIAL_CHILDREN_CAPACITY = 4;
+
 
 AstNode::AstNode(const string& name) :
     name_(name),
-    children_()
+    arena_(nullptr),
+    children_(nullptr),
+    childrenCount_(0),
+    childrenCapacity_(0)
 {
 }
 
 
 AstNode::AstNode(const AstNode& rhs) :
     name_(rhs.name_),
-    children_()
+    arena_(nullptr),
+    children_(nullptr),
+    childrenCount_(0),
+    childrenCapacity_(0)
 {
 }
 
 
 AstNode::~AstNode()
 {
-    const vector<const AstNode*>::const_iterator end(children_.end());
-    for(vector<const AstNode*>::const_iterator i(children_.begin());
-        i != end;
-        ++i)
+    // The arena destroys its own nodes and frees their memory all at once
+    if (nullptr != arena_)
+    {
+        return;
+    }
+    for (size_t i = 0; i < childrenCount_; ++i)
     {
-        delete *i;
+        delete children_[i];
     }
+    delete [] children_;
 }
 
 
 void AstNode::addCopyOfChildren(AstNode* additive) const
 {
-    const vector<const AstNode*>::const_iterator end = children_.end();
-    for (vector<const AstNode*>::const_iterator i = children_.begin();
-        i != end;
-        ++i)
+    for (size_t i = 0; i < childrenCount_; ++i)
     {
-        additive->addChild((*i)->copy());
+        additive->addChild(children_[i]->copy());
     }
 }
 
@@ -73,24 +86,71 @@ void AstNode::addChild(const AstNode* child)
 {
     assert(nullptr != child && "Attempted to add nullptr to AstNode children");
     assert(this != child && "Attempted to add this to AstNode children");
-    children_.push_back(child);
+    assert(
+        (nullptr == arena_ || child->arena_ == arena_)
+        && "Attempted to add a node from outside of the arena"
+    );
+
+    if (childrenCount_ == childrenCapacity_)
+    {
+        const size_t capacity = (
+            0 == childrenCapacity_
+            ? INITIAL_CHILDREN_CAPACITY
+            : 2 * childrenCapacity_
+        );
+        const AstNode** const children = (
+            nullptr == arena_
+            ? new const AstNode*[capacity]
+            : static_cast<const AstNode**>(
+                arena_->allocate(capacity * sizeof(const AstNode*))
+            )
+        );
+        for (size_t i = 0; i < childrenCount_; ++i)
+        {
+            children[i] = children_[i];
+        }
+        if (nullptr == arena_)
+        {
+            delete [] children_;
+        }
+        children_ = children;
+        childrenCapacity_ = capacity;
+    }
+    children_[childrenCount_] = child;
+    ++childrenCount_;
 }
 
 
 AstNode* AstNode::copy() const
 {
     AstNode* temp = new AstNode(*this);
-    const vector<const AstNode*>::const_iterator end(children_.end());
-    for(vector<const AstNode*>::const_iterator i(children_.begin());
-        i != end;
-        ++i)
+    for (size_t i = 0; i < childrenCount_; ++i)
     {
-        temp->addChild((*i)->copy());
+        temp->addChild(children_[i]->copy());
     }
     return temp;
 }
 
 
+const AstNode* AstNode::getChild(const size_t index) const
+{
+    assert(index < childrenCount_ && "AstNode child index out of range");
+    return children_[index];
+}
+
+
+size_t AstNode::getChildrenCount() const
+{
+    return childrenCount_;
+}
+
+
+bool AstNode::isInArena() const
+{
+    return nullptr != arena_;
+}
+
+
 const string& AstNode::getName() const
 {
     return name_;
@@ -118,12 +178,9 @@ void AstNode::printChildren(
     const char indent
 ) const
 {
-    const vector<const AstNode*>::const_iterator end(children_.end());
-    for (vector<const AstNode*>::const_iterator i(children_.begin());
-        end != i;
-        ++i)
+    for (size_t i = 0; i < childrenCount_; ++i)
     {
-        (*i)->print(out, depth, indent);
+        children_[i]->print(out, depth, indent);
     }
 }
 
@@ -21,14 +21,19 @@
 #ifndef SRC_ASTNODE_HPP_
 #define SRC_ASTNODE_HPP_
 
-#include <vector>
+#include <cstddef>
 #include <string>
 #include <iosfwd>
 
 #include "warnUnusedResult.h"
 
+class AstArena;
+
 /**
- * Abstract syntax tree nodes generated by the parser.
+ * Abstract syntax tree nodes generated by the parser. Nodes that are created
+ * with AstArena::create() belong to the arena, along with their children, so
+ * they are never deleted; nodes that are created with new own their children
+ * and delete them.
  * @author Brandon Skari
  * @date December 9 2010
  **/
@@ -45,7 +50,8 @@ public:
     virtual ~AstNode();
 
     /**
-     * Adds a child to this AstNode.
+     * Adds a child to this AstNode. Children of nodes in an arena must be in
+     * the same arena.
      */
     void addChild(const AstNode* child);
 
@@ -84,10 +90,35 @@ protected:
      * @param node The node to add the copies of the children to
      */
     void addCopyOfChildren(AstNode* node) const;
+
+    /**
+     * Returns one of this node's children.
+     * @param index Which child, starting from 0, in the order they were
+     *  added.
+     */
+    const AstNode* getChild(size_t index) const WARN_UNUSED_RESULT;
+
+    /**
+     * Returns how many children this node has.
+     */
+    size_t getChildrenCount() const WARN_UNUSED_RESULT;
+
+    /**
+     * Returns true if this node was created in an AstArena.
+     */
+    bool isInArena() const WARN_UNUSED_RESULT;
+
     std::string name_;
-    std::vector<const AstNode*> children_;
 
 private:
+    friend class AstArena;
+
+    // The arena that this node and its children were allocated from, if any
+    AstArena* arena_;
+    const AstNode** children_;
+    size_t childrenCount_;
+    size_t childrenCapacity_;
+
     // Prevent compiler warnings; shouldn't be calling this anyway
     AstNode& operator=(const AstNode& rhs);
     AstNode(const AstNode& rhs);
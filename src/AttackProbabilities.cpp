@@ -19,7 +19,82 @@
  */
 
 #include "AttackProbabilities.hpp"
+#include "nullptr.hpp"
+#include "QueryRisk.hpp"
+
+#include <cassert>
+
 
 AttackProbabilities::~AttackProbabilities()
 {
 }
+
+
+void AttackProbabilities::scoreAll(
+    const QueryRisk& qr,
+    AttackScores* const scores
+)
+{
+    assert(nullptr != scores);
+    setApplicable(qr, scores);
+    double* const probabilities = scores->probabilities;
+    if (scores->applicable[AttackScores::BYPASS_AUTHENTICATION])
+    {
+        probabilities[AttackScores::BYPASS_AUTHENTICATION] =
+            getProbabilityOfBypassAttack(qr);
+    }
+    if (scores->applicable[AttackScores::DATA_ACCESS])
+    {
+        probabilities[AttackScores::DATA_ACCESS] =
+            getProbabilityOfAccessAttack(qr);
+    }
+    if (scores->applicable[AttackScores::DATA_MODIFICATION])
+    {
+        probabilities[AttackScores::DATA_MODIFICATION] =
+            getProbabilityOfModificationAttack(qr);
+    }
+    if (scores->applicable[AttackScores::FINGERPRINTING])
+    {
+        probabilities[AttackScores::FINGERPRINTING] =
+            getProbabilityOfFingerprintingAttack(qr);
+    }
+    if (scores->applicable[AttackScores::SCHEMA])
+    {
+        probabilities[AttackScores::SCHEMA] =
+            getProbabilityOfSchemaAttack(qr);
+    }
+    if (scores->applicable[AttackScores::DENIAL_OF_SERVICE])
+    {
+        probabilities[AttackScores::DENIAL_OF_SERVICE] =
+            getProbabilityOfDenialAttack(qr);
+    }
+}
+
+
+void AttackProbabilities::setApplicable(
+    const QueryRisk& qr,
+    AttackScores* const scores
+)
+{
+    assert(nullptr != scores);
+    const bool select = (QueryRisk::TYPE_SELECT == qr.queryType);
+    const bool modification = (
+        QueryRisk::TYPE_UPDATE == qr.queryType
+        || QueryRisk::TYPE_INSERT == qr.queryType
+        || QueryRisk::TYPE_DELETE == qr.queryType
+    );
+
+    scores->applicable[AttackScores::BYPASS_AUTHENTICATION] =
+        select && qr.userTable;
+    scores->applicable[AttackScores::DATA_ACCESS] = select;
+    scores->applicable[AttackScores::DATA_MODIFICATION] = modification;
+    // Fingerprinting and schema attacks can come from select or data mods!
+    scores->applicable[AttackScores::FINGERPRINTING] = select || modification;
+    scores->applicable[AttackScores::SCHEMA] = select || modification;
+    scores->applicable[AttackScores::DENIAL_OF_SERVICE] = select;
+
+    for (int i = 0; i < AttackScores::ATTACKS_COUNT; ++i)
+    {
+        scores->probabilities[i] = 0.0;
+    }
+}
@@ -23,6 +23,32 @@
 
 #include "QueryRisk.hpp"
 
+/**
+ * The probabilities of every type of attack for one query.
+ * @author Brandon Skari
+ * @date October 17 2026
+ */
+struct AttackScores
+{
+    enum ATTACK
+    {
+        BYPASS_AUTHENTICATION,
+        DATA_ACCESS,
+        DATA_MODIFICATION,
+        FINGERPRINTING,
+        SCHEMA,
+        DENIAL_OF_SERVICE,
+        ATTACKS_COUNT
+    };
+
+    /**
+     * Which attacks can be made with the type of query. The probabilities of
+     * the others are 0.
+     */
+    bool applicable[ATTACKS_COUNT];
+    double probabilities[ATTACKS_COUNT];
+};
+
 /**
  * Class interface with pure virtual methods to compute the probability of
  * attack given a particular query risk assessment.
@@ -47,6 +73,22 @@ public:
     virtual double getProbabilityOfDenialAttack(const QueryRisk& qr) = 0;
     ///@}
 
+    /**
+     * Computes the probability of every type of attack that applies to the
+     * type of query. This calls the methods above one at a time; subclasses
+     * can do better by working out the evidence that they share only once.
+     * @param qr The analyzed riskiness of a query.
+     * @param scores Will be set to the probabilities.
+     */
+    virtual void scoreAll(const QueryRisk& qr, AttackScores* scores);
+
     virtual ~AttackProbabilities();
+
+protected:
+    /**
+     * Sets which attacks apply to the type of query, and sets the
+     * probabilities to 0.
+     */
+    static void setApplicable(const QueryRisk& qr, AttackScores* scores);
 };
 #endif  // SRC_ATTACKPROBABILITIES_HPP_
@@ -126,7 +126,9 @@ Type& AutoPtrWithOperatorParens<Type>::operator=(
 template <class Type>
 Type* AutoPtrWithOperatorParens<Type>::release() throw()
 {
+    Type* const object = object_;
     object_ = nullptr;
+    return object;
 }
 
 
@@ -0,0 +1,83 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_BAYESNETDESCRIPTION_HPP_
+#define SRC_BAYESNETDESCRIPTION_HPP_
+
+/**
+ * The structure and conditional probability tables of a Bayesian network,
+ * as constant arrays that huginToCpp.py generates from a Hugin net file at
+ * build time. Nodes are numbered in the order that they are in the file.
+ * @author Brandon Skari
+ * @date October 17 2026
+ */
+struct BayesNetDescription
+{
+    /// The name of the file that the network was generated from.
+    const char* fileName;
+    int nodesCount;
+    const char* const* nodeNames;
+    const unsigned int* statesCounts;
+    /**
+     * The parents of node n are parents[parentsOffsets[n]] up to
+     * parents[parentsOffsets[n + 1]].
+     */
+    ///@{
+    const int* parentsOffsets;
+    const int* parents;
+    ///@}
+    /**
+     * The probabilities of node n are probabilities[probabilitiesOffsets[n]]
+     * up to probabilities[probabilitiesOffsets[n + 1]]. They are nested by
+     * the states of the parents, in the order that the parents are listed,
+     * and then by the states of the node, just like in the Hugin file.
+     */
+    ///@{
+    const int* probabilitiesOffsets;
+    const double* probabilities;
+    ///@}
+};
+
+/**
+ * The probability of a state of a root node of a network for every
+ * combination of evidence that a query can have. huginToCpp.py works them
+ * out from the network at build time, so they are only looked up here.
+ */
+struct BayesTableDescription
+{
+    /// The node and state that the probability is of.
+    ///@{
+    int node;
+    int state;
+    ///@}
+    /// The nodes that are evidence.
+    ///@{
+    int evidenceCount;
+    const int* evidence;
+    ///@}
+    /**
+     * Looks the probability up.
+     * @param states The states of the nodes of the network, by node number.
+     *  Only the evidence is looked at.
+     */
+    double (*getProbability)(const int states[]);
+};
+
+#endif  // SRC_BAYESNETDESCRIPTION_HPP_
@@ -59,12 +59,12 @@ AstNode* ComparisonNode::copy() const
 
 bool ComparisonNode::isAlwaysTrue() const
 {
-    assert(2 == children_.size() && "ComparisonNode should have 2 children");
+    assert(2 == getChildrenCount() && "ComparisonNode should have 2 children");
 
     const ExpressionNode* const expr1 = dynamic_cast<const ExpressionNode*>(
-        children_.at(0));
+        getChild(0));
     const ExpressionNode* const expr2 = dynamic_cast<const ExpressionNode*>(
-        children_.at(1));
+        getChild(1));
     assert(nullptr != expr1 && nullptr != expr2 &&
         "ComparisonNode should only have ExpressionNode children");
 
@@ -140,13 +140,13 @@ bool ComparisonNode::anyIsAlwaysTrue() const
 
 QueryRisk::EmptyPassword ComparisonNode::emptyPassword() const
 {
-    assert(2 == children_.size() && "ComparisonNode should have 2 children");
+    assert(2 == getChildrenCount() && "ComparisonNode should have 2 children");
 
     const ExpressionNode* const expr1 = dynamic_cast<const ExpressionNode*>(
-        children_.at(0)
+        getChild(0)
     );
     const ExpressionNode* const expr2 = dynamic_cast<const ExpressionNode*>(
-        children_.at(1)
+        getChild(1)
     );
     assert(
         nullptr != expr1 && nullptr != expr2 &&
@@ -170,6 +170,49 @@ QueryRisk::EmptyPassword ComparisonNode::emptyPassword() const
 }
 
 
+bool ComparisonNode::isLiteralSensitive() const
+{
+    assert(2 == getChildrenCount() && "ComparisonNode should have 2 children");
+
+    const ExpressionNode* const expr1 = dynamic_cast<const ExpressionNode*>(
+        getChild(0)
+    );
+    const ExpressionNode* const expr2 = dynamic_cast<const ExpressionNode*>(
+        getChild(1)
+    );
+    assert(
+        nullptr != expr1 && nullptr != expr2 &&
+        "ComparisonNode should only have ExpressionNode children"
+    );
+
+    // isAlwaysTrue() only compares values when neither side is a field
+    if (!expr1->isIdentifier() && !expr2->isIdentifier())
+    {
+        return true;
+    }
+    return passwordCheckIsLiteralSensitive();
+}
+
+
+bool ComparisonNode::passwordCheckIsLiteralSensitive() const
+{
+    assert(2 == getChildrenCount() && "ComparisonNode should have 2 children");
+
+    const ExpressionNode* const expr1 = dynamic_cast<const ExpressionNode*>(
+        getChild(0)
+    );
+    assert(
+        nullptr != expr1 &&
+        "ComparisonNode should only have ExpressionNode children"
+    );
+
+    // emptyPassword() checks whether the left side names a password field,
+    // which is only fixed by the tokens if it's an identifier. Whether the
+    // right side is empty is already part of a literal's shape.
+    return "=" == compareType_ && !expr1->isIdentifier();
+}
+
+
 void ComparisonNode::print(
     std::ostream& out,
     const int depth,
@@ -68,6 +68,12 @@ public:
      */
     virtual QueryRisk::EmptyPassword emptyPassword() const WARN_UNUSED_RESULT;
 
+    /**
+     * Determines if the results depend on the values of literals.
+     * Overridden from ConditionalNode.
+     */
+    virtual bool isLiteralSensitive() const WARN_UNUSED_RESULT;
+
     /**
      * Overridden from AstNode.
      */
@@ -80,6 +86,11 @@ public:
 protected:
     std::string compareType_;
 
+    /**
+     * Determines if emptyPassword() depends on the values of literals.
+     */
+    bool passwordCheckIsLiteralSensitive() const WARN_UNUSED_RESULT;
+
 private:
     ComparisonNode(const ComparisonNode& rhs);
     ComparisonNode& operator=(ComparisonNode& rhs);
@@ -0,0 +1,576 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_CONCURRENTCACHE_HPP_
+#define SRC_CONCURRENTCACHE_HPP_
+
+#include "nullptr.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <cassert>
+#include <pthread.h>
+#include <vector>
+
+/**
+ * A cache that lots of threads can use at once. Keys are spread over shards
+ * that each have their own reader-writer lock, and lookups only take the
+ * lock for reading, so hits in the same shard don't wait for each other.
+ * The lock is a pthread one rather than boost::shared_mutex, which takes an
+ * internal mutex for every reader. Values are handed out as shared pointers
+ * so that a hit doesn't copy the value and it stays valid after it's
+ * evicted.
+ *
+ * Entries are evicted with the CLOCK algorithm instead of least recently
+ * used, because moving an entry to the front of a list on every hit needs
+ * the write lock. A hit only sets the entry's referenced bit; when a shard
+ * is over its share of the memory, its hand sweeps over the entries, clears
+ * the bits that are set and evicts the first entry that hasn't been used
+ * since the hand last passed it.
+ * @author Brandon Skari
+ * @date October 17 2026
+ */
+
+template <typename KeyType, typename ValueType>
+class ConcurrentCache
+{
+public:
+    /**
+     * Constructor.
+     * @param maxBytes Roughly the most memory that the entries can use.
+     * @param shardsCount How many separately locked parts to split the
+     *  cache into.
+     */
+    explicit ConcurrentCache(
+        size_t maxBytes,
+        int shardsCount = DEFAULT_SHARDS_COUNT
+    );
+
+    ~ConcurrentCache();
+
+    /**
+     * Looks up the value for a key.
+     * @return The value, or a null pointer if the key isn't cached.
+     */
+    boost::shared_ptr<const ValueType> find(const KeyType& key);
+
+    /**
+     * Saves the value for a key, replacing the old value if the key is
+     * already cached, and evicting entries if the cache is full. Values that
+     * are too big to ever fit aren't saved.
+     * @param key The key.
+     * @param value The value.
+     * @param valueBytes How much memory the value uses outside of the
+     *  object itself, e.g. the characters of a string.
+     * @return The saved value.
+     */
+    boost::shared_ptr<const ValueType> insert(
+        const KeyType& key,
+        const ValueType& value,
+        size_t valueBytes = 0
+    );
+
+    /**
+     * Forgets the value for a key.
+     * @return False if the key wasn't cached.
+     */
+    bool erase(const KeyType& key);
+
+    /**
+     * Forgets every value.
+     */
+    void clear();
+
+    /**
+     * Statistics, summed over the shards.
+     */
+    ///@{
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+    uint64_t getEvictions() const;
+    size_t size() const;
+    size_t getBytes() const;
+    ///@}
+
+    /**
+     * Roughly how much memory an entry uses, including the bookkeeping.
+     * @param valueBytes How much memory the value uses outside of the
+     *  object itself.
+     */
+    static size_t getEntryBytes(size_t valueBytes);
+
+    static const int DEFAULT_SHARDS_COUNT = 16;
+
+private:
+    /**
+     * The value lives in the entry so that saving it only takes one
+     * allocation; the pointers that are handed out share the entry's count.
+     */
+    struct Entry
+    {
+        const KeyType key;
+        const ValueType value;
+        const size_t bytes;
+        /// Where the entry is in the shard's clock
+        size_t slot;
+        /// Set by hits while holding the read lock
+        bool referenced;
+        Entry(
+            const KeyType& entryKey,
+            const ValueType& entryValue,
+            size_t entryBytes
+        );
+    };
+    typedef boost::unordered_map<KeyType, Entry*> Index;
+
+    struct Shard
+    {
+        mutable pthread_rwlock_t lock;
+        Index index;
+        /// The clock; the slots of evicted entries are null until reused
+        std::vector<boost::shared_ptr<Entry> > clock;
+        std::vector<size_t> freeSlots;
+        size_t hand;
+        size_t bytes;
+        // Hits and misses are counted while holding the read lock
+        volatile uint64_t hits;
+        volatile uint64_t misses;
+        uint64_t evictions;
+        Shard();
+        ~Shard();
+
+    private:
+        // ***** Hidden methods *****
+        Shard(const Shard& rhs);
+        Shard& operator=(const Shard& rhs);
+    };
+
+    /**
+     * Holds a shard's lock for reading until it goes out of scope.
+     */
+    class ReadLock
+    {
+    public:
+        explicit ReadLock(const Shard& shard);
+        ~ReadLock();
+    private:
+        pthread_rwlock_t* const lock_;
+        // ***** Hidden methods *****
+        ReadLock(const ReadLock& rhs);
+        ReadLock& operator=(const ReadLock& rhs);
+    };
+
+    /**
+     * Holds a shard's lock for writing until it goes out of scope.
+     */
+    class WriteLock
+    {
+    public:
+        explicit WriteLock(Shard& shard);
+        ~WriteLock();
+    private:
+        pthread_rwlock_t* const lock_;
+        // ***** Hidden methods *****
+        WriteLock(const WriteLock& rhs);
+        WriteLock& operator=(const WriteLock& rhs);
+    };
+
+    Shard& getShard(const KeyType& key) const;
+
+    /**
+     * Evicts the entry under the hand, or the first one after it that
+     * hasn't been used since the hand last passed it. The shard needs to be
+     * locked for writing and not be empty.
+     */
+    static void evictOne(Shard* shard);
+
+    /**
+     * Removes an entry from a shard that is locked for writing.
+     */
+    static void remove(Shard* shard, Entry* entry);
+
+    /**
+     * Removes every entry from a shard that is locked for writing.
+     */
+    static void removeAll(Shard* shard);
+
+    const size_t shardMaxBytes_;
+    const int shardsCount_;
+    Shard* const shards_;
+
+    // ***** Hidden methods *****
+    ConcurrentCache(const ConcurrentCache& rhs);
+    ConcurrentCache& operator=(const ConcurrentCache& rhs);
+};
+
+
+template <typename KeyType, typename ValueType>
+const int ConcurrentCache<KeyType, ValueType>::DEFAULT_SHARDS_COUNT;
+
+
+template <typename KeyType, typename ValueType>
+ConcurrentCache<KeyType, ValueType>::Entry::Entry(
+    const KeyType& entryKey,
+    const ValueType& entryValue,
+    const size_t entryBytes
+) :
+    key(entryKey),
+    value(entryValue),
+    bytes(entryBytes),
+    slot(0),
+    referenced(false)
+{
+}
+
+
+template <typename KeyType, typename ValueType>
+ConcurrentCache<KeyType, ValueType>::Shard::Shard() :
+    lock(),
+    index(),
+    clock(),
+    freeSlots(),
+    hand(0),
+    bytes(0),
+    hits(0),
+    misses(0),
+    evictions(0)
+{
+    // Preferring writers would make every reader wait behind an insert that
+    // is waiting for a reader that was descheduled, and the read side is
+    // short enough that inserts don't wait long anyway
+    pthread_rwlock_init(&lock, nullptr);
+}
+
+
+template <typename KeyType, typename ValueType>
+ConcurrentCache<KeyType, ValueType>::Shard::~Shard()
+{
+    pthread_rwlock_destroy(&lock);
+}
+
+
+template <typename KeyType, typename ValueType>
+ConcurrentCache<KeyType, ValueType>::ReadLock::ReadLock(const Shard& shard) :
+    lock_(&shard.lock)
+{
+    pthread_rwlock_rdlock(lock_);
+}
+
+
+template <typename KeyType, typename ValueType>
+ConcurrentCache<KeyType, ValueType>::ReadLock::~ReadLock()
+{
+    pthread_rwlock_unlock(lock_);
+}
+
+
+template <typename KeyType, typename ValueType>
+ConcurrentCache<KeyType, ValueType>::WriteLock::WriteLock(Shard& shard) :
+    lock_(&shard.lock)
+{
+    pthread_rwlock_wrlock(lock_);
+}
+
+
+template <typename KeyType, typename ValueType>
+ConcurrentCache<KeyType, ValueType>::WriteLock::~WriteLock()
+{
+    pthread_rwlock_unlock(lock_);
+}
+
+
+template <typename KeyType, typename ValueType>
+ConcurrentCache<KeyType, ValueType>::ConcurrentCache(
+    const size_t maxBytes,
+    const int shardsCount
+) :
+    shardMaxBytes_(maxBytes / shardsCount),
+    shardsCount_(shardsCount),
+    shards_(new Shard[shardsCount])
+{
+    assert(shardsCount > 0);
+}
+
+
+template <typename KeyType, typename ValueType>
+ConcurrentCache<KeyType, ValueType>::~ConcurrentCache()
+{
+    delete [] shards_;
+}
+
+
+template <typename KeyType, typename ValueType>
+boost::shared_ptr<const ValueType> ConcurrentCache<KeyType, ValueType>::find(
+    const KeyType& key
+)
+{
+    Shard& shard = getShard(key);
+    ReadLock lock(shard);
+
+    const typename Index::const_iterator found(shard.index.find(key));
+    if (shard.index.end() == found)
+    {
+        __sync_fetch_and_add(&shard.misses, 1);
+        return boost::shared_ptr<const ValueType>();
+    }
+
+    Entry* const entry = found->second;
+    // Only write the bit when it changes so that hits on the same entry
+    // don't keep taking its cache line from each other
+    if (!__atomic_load_n(&entry->referenced, __ATOMIC_RELAXED))
+    {
+        __atomic_store_n(&entry->referenced, true, __ATOMIC_RELAXED);
+    }
+    __sync_fetch_and_add(&shard.hits, 1);
+    return boost::shared_ptr<const ValueType>(
+        shard.clock[entry->slot],
+        &entry->value
+    );
+}
+
+
+template <typename KeyType, typename ValueType>
+boost::shared_ptr<const ValueType> ConcurrentCache<KeyType, ValueType>::insert(
+    const KeyType& key,
+    const ValueType& value,
+    const size_t valueBytes
+)
+{
+    const size_t bytes = getEntryBytes(valueBytes);
+    const boost::shared_ptr<Entry> shared(
+        boost::make_shared<Entry>(key, value, bytes)
+    );
+    Entry* const entry = shared.get();
+    if (bytes > shardMaxBytes_)
+    {
+        // Don't keep handing out the old value
+        erase(key);
+        return boost::shared_ptr<const ValueType>(shared, &entry->value);
+    }
+
+    Shard& shard = getShard(key);
+    WriteLock lock(shard);
+
+    // Another thread might have just saved the same key
+    const typename Index::iterator found(shard.index.find(key));
+    if (shard.index.end() != found)
+    {
+        remove(&shard, found->second);
+    }
+
+    while (shard.bytes + bytes > shardMaxBytes_)
+    {
+        evictOne(&shard);
+    }
+
+    // Reuse the slot that was freed last, which is usually the one just
+    // behind the hand, so that the new entry gets a full sweep to be used
+    if (shard.freeSlots.empty())
+    {
+        entry->slot = shard.clock.size();
+        shard.clock.push_back(shared);
+    }
+    else
+    {
+        entry->slot = shard.freeSlots.back();
+        shard.freeSlots.pop_back();
+        shard.clock[entry->slot] = shared;
+    }
+    shard.index[key] = entry;
+    shard.bytes += bytes;
+    return boost::shared_ptr<const ValueType>(shared, &entry->value);
+}
+
+
+template <typename KeyType, typename ValueType>
+bool ConcurrentCache<KeyType, ValueType>::erase(const KeyType& key)
+{
+    Shard& shard = getShard(key);
+    WriteLock lock(shard);
+
+    const typename Index::iterator found(shard.index.find(key));
+    if (shard.index.end() == found)
+    {
+        return false;
+    }
+    remove(&shard, found->second);
+    return true;
+}
+
+
+template <typename KeyType, typename ValueType>
+void ConcurrentCache<KeyType, ValueType>::clear()
+{
+    for (int i = 0; i < shardsCount_; ++i)
+    {
+        WriteLock lock(shards_[i]);
+        removeAll(&shards_[i]);
+    }
+}
+
+
+template <typename KeyType, typename ValueType>
+uint64_t ConcurrentCache<KeyType, ValueType>::getHits() const
+{
+    uint64_t hits = 0;
+    for (int i = 0; i < shardsCount_; ++i)
+    {
+        hits += shards_[i].hits;
+    }
+    return hits;
+}
+
+
+template <typename KeyType, typename ValueType>
+uint64_t ConcurrentCache<KeyType, ValueType>::getMisses() const
+{
+    uint64_t misses = 0;
+    for (int i = 0; i < shardsCount_; ++i)
+    {
+        misses += shards_[i].misses;
+    }
+    return misses;
+}
+
+
+template <typename KeyType, typename ValueType>
+uint64_t ConcurrentCache<KeyType, ValueType>::getEvictions() const
+{
+    uint64_t evictions = 0;
+    for (int i = 0; i < shardsCount_; ++i)
+    {
+        ReadLock lock(shards_[i]);
+        evictions += shards_[i].evictions;
+    }
+    return evictions;
+}
+
+
+template <typename KeyType, typename ValueType>
+size_t ConcurrentCache<KeyType, ValueType>::size() const
+{
+    size_t entries = 0;
+    for (int i = 0; i < shardsCount_; ++i)
+    {
+        ReadLock lock(shards_[i]);
+        entries += shards_[i].index.size();
+    }
+    return entries;
+}
+
+
+template <typename KeyType, typename ValueType>
+size_t ConcurrentCache<KeyType, ValueType>::getBytes() const
+{
+    size_t bytes = 0;
+    for (int i = 0; i < shardsCount_; ++i)
+    {
+        ReadLock lock(shards_[i]);
+        bytes += shards_[i].bytes;
+    }
+    return bytes;
+}
+
+
+template <typename KeyType, typename ValueType>
+size_t ConcurrentCache<KeyType, ValueType>::getEntryBytes(
+    const size_t valueBytes
+)
+{
+    // The entry and its shared count, the index's node and bucket, and the
+    // clock's slot
+    return sizeof(Entry) + 4 * sizeof(void*)
+        + sizeof(KeyType) + 3 * sizeof(void*)
+        + sizeof(boost::shared_ptr<Entry>)
+        + valueBytes;
+}
+
+
+template <typename KeyType, typename ValueType>
+typename ConcurrentCache<KeyType, ValueType>::Shard&
+ConcurrentCache<KeyType, ValueType>::getShard(const KeyType& key) const
+{
+    // The index uses the low bits of the same hash, so mix the high bits in
+    // before picking the shard
+    size_t hash = boost::hash<KeyType>()(key);
+    hash ^= hash >> 17;
+    hash *= 0x9e3779b1u;
+    hash ^= hash >> 15;
+    return shards_[hash % shardsCount_];
+}
+
+
+template <typename KeyType, typename ValueType>
+void ConcurrentCache<KeyType, ValueType>::evictOne(Shard* const shard)
+{
+    assert(!shard->index.empty());
+    // Every bit is clear after one full sweep, so this ends in two
+    for (;;)
+    {
+        if (shard->hand >= shard->clock.size())
+        {
+            shard->hand = 0;
+        }
+        Entry* const entry = shard->clock[shard->hand].get();
+        ++shard->hand;
+        if (nullptr == entry)
+        {
+            continue;
+        }
+        if (entry->referenced)
+        {
+            entry->referenced = false;
+            continue;
+        }
+        remove(shard, entry);
+        ++shard->evictions;
+        return;
+    }
+}
+
+
+template <typename KeyType, typename ValueType>
+void ConcurrentCache<KeyType, ValueType>::remove(
+    Shard* const shard,
+    Entry* const entry
+)
+{
+    shard->index.erase(entry->key);
+    shard->bytes -= entry->bytes;
+    shard->freeSlots.push_back(entry->slot);
+    // This might delete the entry
+    shard->clock[entry->slot].reset();
+}
+
+
+template <typename KeyType, typename ValueType>
+void ConcurrentCache<KeyType, ValueType>::removeAll(Shard* const shard)
+{
+    shard->index.clear();
+    shard->clock.clear();
+    shard->freeSlots.clear();
+    shard->hand = 0;
+    shard->bytes = 0;
+}
+
+#endif  // SRC_CONCURRENTCACHE_HPP_
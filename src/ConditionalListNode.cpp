@@ -52,14 +52,14 @@ AstNode* ConditionalListNode::copy() const
 
 bool ConditionalListNode::isAlwaysTrue() const
 {
-    assert(2 == children_.size() &&
+    assert(2 == getChildrenCount() &&
         "ConditionalList should have 2 children");
 
     const ConditionalNode* cond1 =
-        dynamic_cast<const ConditionalNode*>(children_.at(0));
+        dynamic_cast<const ConditionalNode*>(getChild(0));
     assert(nullptr != cond1 && "ConditionalList has non-Conditional child");
     const ConditionalNode* cond2 =
-        dynamic_cast<const ConditionalNode*>(children_.at(1));
+        dynamic_cast<const ConditionalNode*>(getChild(1));
     assert(nullptr != cond2 && "ConditionalList has non-Conditional child");
 
     if ('&' == logicalOp_)
@@ -87,14 +87,14 @@ bool ConditionalListNode::isAlwaysTrue() const
 
 bool ConditionalListNode::anyIsAlwaysTrue() const
 {
-    assert(2 == children_.size() &&
+    assert(2 == getChildrenCount() &&
         "ConditionalList should have 2 children");
 
     const ConditionalNode* cond1 =
-        dynamic_cast<const ConditionalNode*>(children_.at(0));
+        dynamic_cast<const ConditionalNode*>(getChild(0));
     assert(nullptr != cond1 && "ConditionalList has non-Conditional child");
     const ConditionalNode* cond2 =
-        dynamic_cast<const ConditionalNode*>(children_.at(1));
+        dynamic_cast<const ConditionalNode*>(getChild(1));
     assert(nullptr != cond2 && "ConditionalList has non-Conditional child");
 
     return cond1->anyIsAlwaysTrue() || cond2->anyIsAlwaysTrue();
@@ -103,14 +103,14 @@ bool ConditionalListNode::anyIsAlwaysTrue() const
 
 QueryRisk::EmptyPassword ConditionalListNode::emptyPassword() const
 {
-    assert(2 == children_.size() &&
+    assert(2 == getChildrenCount() &&
         "ConditionalList should have 2 children");
 
     const ConditionalNode* cond1 =
-        dynamic_cast<const ConditionalNode*>(children_.at(0));
+        dynamic_cast<const ConditionalNode*>(getChild(0));
     assert(nullptr != cond1 && "ConditionalList has non-Conditional child");
     const ConditionalNode* cond2 =
-        dynamic_cast<const ConditionalNode*>(children_.at(1));
+        dynamic_cast<const ConditionalNode*>(getChild(1));
     assert(nullptr != cond2 && "ConditionalList has non-Conditional child");
 
     QueryRisk::EmptyPassword empty1 = cond1->emptyPassword();
@@ -133,6 +133,22 @@ QueryRisk::EmptyPassword ConditionalListNode::emptyPassword() const
 }
 
 
+bool ConditionalListNode::isLiteralSensitive() const
+{
+    assert(2 == getChildrenCount() &&
+        "ConditionalList should have 2 children");
+
+    const ConditionalNode* cond1 =
+        dynamic_cast<const ConditionalNode*>(getChild(0));
+    assert(nullptr != cond1 && "ConditionalList has non-Conditional child");
+    const ConditionalNode* cond2 =
+        dynamic_cast<const ConditionalNode*>(getChild(1));
+    assert(nullptr != cond2 && "ConditionalList has non-Conditional child");
+
+    return cond1->isLiteralSensitive() || cond2->isLiteralSensitive();
+}
+
+
 void ConditionalListNode::print(
     ostream& out,
     const int depth,
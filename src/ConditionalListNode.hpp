@@ -70,6 +70,12 @@ public:
      */
     virtual QueryRisk::EmptyPassword emptyPassword() const WARN_UNUSED_RESULT;
 
+    /**
+     * Determines if the results depend on the values of literals.
+     * Overridden from ConditionalNode.
+     */
+    virtual bool isLiteralSensitive() const WARN_UNUSED_RESULT;
+
     /**
      * Overridden from AstNode.
      */
@@ -29,7 +29,7 @@
 /**
  * Pure virtual parse tree node that represents some kind of conditional
  * statement. Derived classes must implement isAlwaysTrue(), anyIsAlwaysTrue(),
- * copy() and emptyPassword().
+ * copy(), emptyPassword() and isLiteralSensitive().
  * @author Brandon Skari
  * @date December 9 2010
  */
@@ -65,6 +65,13 @@ public:
      */
     virtual QueryRisk::EmptyPassword emptyPassword() const = 0;
 
+    /**
+     * Determines if isAlwaysTrue(), anyIsAlwaysTrue() or emptyPassword()
+     * could change if the query's literals changed, but its tokens and
+     * identifiers stayed the same.
+     */
+    virtual bool isLiteralSensitive() const = 0;
+
 private:
     ConditionalNode(const ConditionalNode& rhs);
     ConditionalNode& operator=(const ConditionalNode& rhs);
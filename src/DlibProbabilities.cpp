@@ -19,830 +19,732 @@
  */
 
 #include "AttackProbabilities.hpp"
-#include "clearStack.hpp"
-#include "BayesException.hpp"
+#include "BayesNetDescription.hpp"
+#include "bayesNets.hpp"
 #include "DlibProbabilities.hpp"
-#include "huginParser.tab.hpp"
-#include "huginScanner.yy.hpp"
 #include "Logger.hpp"
 #include "nullptr.hpp"
 #include "QueryRisk.hpp"
 
-#include <boost/bind.hpp>
+#include <boost/static_assert.hpp>
+#include <algorithm>
 #include <boost/thread/mutex.hpp>
-#include <boost/function.hpp>
 #include <cassert>
+#include <cmath>
 #include "dlib/dlib/bayes_utils.h"
 #include "dlib/dlib/graph_utils.h"
 #include "dlib/dlib/graph.h"
 #include "dlib/dlib/directed_graph.h"
-#include <exception>
-#include <fstream>
-#include <stack>
-#include <string>
+#include <vector>
 
-using boost::bind;
-using boost::function;
 using boost::lock_guard;
 using boost::mutex;
+using dlib::assignment;
+using dlib::bayes_node_utils::set_node_num_values;
+using dlib::bayes_node_utils::set_node_probability;
 using dlib::bayes_node_utils::set_node_value;
 using dlib::bayes_node_utils::set_node_as_evidence;
+using dlib::bayes_node_utils::set_node_as_nonevidence;
 using dlib::bayesian_network_join_tree;
-using std::bad_alloc;
-using std::ifstream;
-using std::stack;
-using std::string;
-
-// Stuff from the parser
-extern int hugin_parse(
-    DlibProbabilities::bayes_net* network,
-    bool firstTime,
-    void* scanner
-);
-extern stack<string> hugin_identifiers;
-extern stack<string> hugin_numbers;
+using std::fill;
+using std::vector;
 
 // Constants
-static const int CACHE_SIZE = 5;
-
-// Parameters used for computing values for LruCache.
-// The LruCache is designed so that, if a variable is not stored in the cache,
-// it will call a function to compute value then store it. The cache assumes
-// that the only thing that's necessary to compute the value is the key, which
-// isn't true in this case. To facilitate sending these extra parameters to
-// the compute function, I'm going to put them in this class. This is not great,
-// and I'm sorry.
-struct ComputeEvidenceParameters
+/**
+ * The state of nodes that aren't evidence, so that missing evidence is
+ * caught when the tables are looked up.
+ */
+static const int NO_STATE = -1;
+
+/**
+ * Probabilities that differ by more than this fail verification.
+ */
+static const double VERIFY_TOLERANCE = 1e-9;
+
+// The evidence for each network is computed from a QueryRisk by hand, so
+// these are checked against the networks that are generated from the net
+// files, along with the states of the nodes that have more than two
+BOOST_STATIC_ASSERT(19 == DataAccessNet::NODES_COUNT);
+BOOST_STATIC_ASSERT(15 == BypassAuthenticationNet::NODES_COUNT);
+BOOST_STATIC_ASSERT(14 == DataModificationNet::NODES_COUNT);
+BOOST_STATIC_ASSERT(24 == FingerprintingNet::NODES_COUNT);
+BOOST_STATIC_ASSERT(21 == SchemaNet::NODES_COUNT);
+BOOST_STATIC_ASSERT(7 == DenialOfServiceNet::NODES_COUNT);
+
+/**
+ * The networks, in the order of ATTACK_TYPE.
+ */
+static const BayesNetDescription* const DESCRIPTIONS[] = {
+    &DataAccessNet::description,
+    &BypassAuthenticationNet::description,
+    &DataModificationNet::description,
+    &FingerprintingNet::description,
+    &SchemaNet::description,
+    &DenialOfServiceNet::description
+};
+
+// Static variables
+vector<DlibProbabilities::InferenceScratch*> DlibProbabilities::freeScratch_;
+mutex DlibProbabilities::scratchMutex_;
+
+
+struct DlibProbabilities::InferenceScratch
 {
-    int attackType_;
-    int node_;
-    int state_;
-    const int* evidenceNodes_;
-    const int* evidenceStates_;
-    int evidenceSize_;
-    boost::mutex computeMutex_;
+    bayes_net bayesNets[numAttackTypes];
+    join_tree_type joinTrees[numAttackTypes];
+    bool built[numAttackTypes];
+
+    InferenceScratch();
+
+private:
+    // ***** Hidden methods *****
+    InferenceScratch(const InferenceScratch&);
+    InferenceScratch& operator=(const InferenceScratch&);
 };
 
 
-DlibProbabilities::DlibProbabilities()
-    : cep_(new ComputeEvidenceParameters)
+class DlibProbabilities::BorrowedScratch
 {
-    const char* netFileNames[numAttackTypes] = {
-        "dataAccess.net",
-        "bypassAuthentication.net",
-        "dataModification.net",
-        "fingerprinting.net",
-        "schema.net",
-        "denialOfService.net"
-    };
-    const string netFolder("nets/");
-    const size_t expectedNodes[numAttackTypes] = {19, 15, 14, 24, 21, 7};
+public:
+    BorrowedScratch();
+    ~BorrowedScratch();
+    InferenceScratch* operator->() const;
+
+private:
+    InferenceScratch* const scratch_;
 
+    static InferenceScratch* borrow();
+
+    // ***** Hidden methods *****
+    BorrowedScratch(const BorrowedScratch&);
+    BorrowedScratch& operator=(const BorrowedScratch&);
+};
+
+
+DlibProbabilities::InferenceScratch::InferenceScratch()
+{
     for (int i = 0; i < numAttackTypes; ++i)
     {
-        function<double (const Evidence&)> f = bind(
-            &DlibProbabilities::computeEvidence,
-            this,
-            _1
-        );
-        caches_[i] = new EvidenceCache(f, CACHE_SIZE);
+        built[i] = false;
     }
+}
 
-    for (int i = 0; i < numAttackTypes; ++i)
-    {
-        const string netFileName(netFolder + netFileNames[i]);
-        if (0 != loadNetwork(netFileName, &bayesNets_[i]))
-        {
-            throw BayesException(
-                string("Unable to load Bayesian network file: ") + netFileName
-            );
-        }
 
-        // Populate the join_tree with data from the Bayesian network
-        create_moral_graph(bayesNets_[i], joinTrees_[i]);
+DlibProbabilities::BorrowedScratch::BorrowedScratch() :
+    scratch_(borrow())
+{
+}
 
-        // This needs to be checked before calling create_join_tree because the
-        // expectedNodes has the total number of nodes, but calling
-        // number_of_nodes after create_join_tree returns the number of
-        // non-internal nodes
-        if (expectedNodes[i] != joinTrees_[i].number_of_nodes())
-        {
-            throw BayesException(
-                string(netFileNames[i]) + " has an incorrect number of nodes"
-            );
-        }
 
-        create_join_tree(joinTrees_[i], joinTrees_[i]);
-    }
+DlibProbabilities::BorrowedScratch::~BorrowedScratch()
+{
+    lock_guard<mutex> lg(scratchMutex_);
+    freeScratch_.push_back(scratch_);
 }
 
 
-DlibProbabilities::~DlibProbabilities()
+DlibProbabilities::InferenceScratch*
+DlibProbabilities::BorrowedScratch::operator->() const
+{
+    return scratch_;
+}
+
+
+DlibProbabilities::InferenceScratch*
+DlibProbabilities::BorrowedScratch::borrow()
 {
-    for (int i = 0; i < numAttackTypes; ++i)
     {
-        delete caches_[i];
+        lock_guard<mutex> lg(scratchMutex_);
+        if (!freeScratch_.empty())
+        {
+            InferenceScratch* const scratch = freeScratch_.back();
+            freeScratch_.pop_back();
+            return scratch;
+        }
     }
-    delete cep_;
+    // Every other thread is using one, so this one needs its own. The
+    // networks in it are built as they're needed, without the lock.
+    return new InferenceScratch;
 }
 
 
-double DlibProbabilities::getProbabilityOfAccessAttack(const QueryRisk& qr)
+DlibProbabilities::DlibProbabilities()
 {
-    // This should be the order of the nodes in the Hugin net file
-    enum NODE_TYPES
-    {
-        GlobalVariables,
-        IfStmts,
-        StringManipulation,
-        HexStrings,
-        OrAlwaysTrue,
-        ConditionalModification, // Non-evidence node
-        CommentedConditionals,
-        DetectionEvasion, // Non-evidence node
-        StringStmts,
-        BruteForce,
-        ConditionalStmts, // Non-evidence node
-        UnionStmts,
-        BenchmarkStmts,
-        CommentedQuotes,
-        AlwaysTrueConditional,
-        DataAccess, // Non-evidence node
-        SensitiveTables,
-        UnionAllStmts,
-        OrStmts
-    };
-    assert(
-        static_cast<int>(OrStmts) + 1 ==
-        bayesNets_[ATTACK_DATA_ACCESS].number_of_nodes()
-        && "The number of nodes loaded from file and the number of states in "
-        && "the nodes enum should match"
+    BOOST_STATIC_ASSERT(
+        sizeof(DESCRIPTIONS) / sizeof(DESCRIPTIONS[0]) == numAttackTypes
     );
+}
 
-    int states[static_cast<int>(OrStmts) + 1];
 
-    states[GlobalVariables] = qr.globalVariables ? 0 : 1;
-    states[IfStmts] = qr.ifStatements ? 0 : 1;
-    states[StringManipulation] = (qr.stringManipulationStatements <= 3)
-        ? qr.stringManipulationStatements : 4;
-    states[HexStrings] = qr.hexStrings ? 0 : 1;
-    states[OrAlwaysTrue] =
-        (qr.orStatements && qr.alwaysTrue && qr.alwaysTrueConditional) ? 0 : 1;
-    states[CommentedConditionals] = qr.commentedConditionals ? 0 : 1;
-    states[StringStmts] = (qr.userStatements || qr.fingerprintingStatements
-        || qr.globalVariables) ? 0 : 1;
-    states[BruteForce] = qr.bruteForceCommands ? 0 : 1;
-    states[UnionStmts] = qr.unionStatements ? 0 : 1;
-    states[BenchmarkStmts] = qr.benchmarkStatements ? 0 : 1;
-    states[CommentedQuotes] = qr.commentedQuotes ? 0 : 1;
-    states[AlwaysTrueConditional] = qr.alwaysTrueConditional ? 0 : 1;
-    states[SensitiveTables] = qr.sensitiveTables ? 0 : 1;
-    states[UnionAllStmts] = qr.unionAllStatements ? 0 : 1;
-    states[OrStmts] = qr.orStatements ? 0 : 1;
-
-    const int evidenceNodeNumbers[] = {
-        GlobalVariables,
-        IfStmts,
-        StringManipulation,
-        HexStrings,
-        OrAlwaysTrue,
-        // ConditionalModification, // Non-evidence node
-        CommentedConditionals,
-        // DetectionEvasion, // Non-evidence node
-        StringStmts,
-        BruteForce,
-        // ConditionalStmts, // Non-evidence node
-        UnionStmts,
-        BenchmarkStmts,
-        CommentedQuotes,
-        AlwaysTrueConditional,
-        // DataAccess, // Non-evidence node
-        SensitiveTables,
-        UnionAllStmts,
-        OrStmts
-    };
-
-    const int SIZE =
-        sizeof(evidenceNodeNumbers) / sizeof(evidenceNodeNumbers[0]);
-    const int ATTACK_STATE = 0;
-    return computeProbabilityOfState(
-        ATTACK_DATA_ACCESS,
-        DataAccess,
-        ATTACK_STATE,
-        evidenceNodeNumbers,
-        states,
-        SIZE
-    );
+DlibProbabilities::~DlibProbabilities()
+{
+}
+
+
+double DlibProbabilities::getProbabilityOfAccessAttack(const QueryRisk& qr)
+{
+    Features features;
+    extractFeatures(qr, &features);
+    return scoreAccess(features, nullptr);
 }
 
 
 double DlibProbabilities::getProbabilityOfBypassAttack(const QueryRisk& qr)
 {
-    // This should be the order of the nodes in the Hugin net file
-    enum NODE_TYPES
+    Features features;
+    extractFeatures(qr, &features);
+    return scoreBypass(features, nullptr);
+}
+
+
+double DlibProbabilities::getProbabilityOfModificationAttack(
+    const QueryRisk& qr
+)
+{
+    Features features;
+    extractFeatures(qr, &features);
+    return scoreModification(features, nullptr);
+}
+
+
+double DlibProbabilities::getProbabilityOfFingerprintingAttack(
+    const QueryRisk& qr
+)
+{
+    Features features;
+    extractFeatures(qr, &features);
+    return scoreFingerprinting(features, nullptr);
+}
+
+
+double DlibProbabilities::getProbabilityOfSchemaAttack(const QueryRisk& qr)
+{
+    Features features;
+    extractFeatures(qr, &features);
+    return scoreSchema(features, nullptr);
+}
+
+
+double DlibProbabilities::getProbabilityOfDenialAttack(const QueryRisk& qr)
+{
+    Features features;
+    extractFeatures(qr, &features);
+    return scoreDenial(features, nullptr);
+}
+
+
+void DlibProbabilities::scoreAll(
+    const QueryRisk& qr,
+    AttackScores* const scores
+)
+{
+    assert(nullptr != scores);
+    setApplicable(qr, scores);
+    Features features;
+    extractFeatures(qr, &features);
+
+    double* const probabilities = scores->probabilities;
+    if (scores->applicable[AttackScores::BYPASS_AUTHENTICATION])
     {
-        OrAlwaysTrue,
-        BypassAuthentication, // Non-evidence node
-        HexStrings,
-        BruteForce,
-        DetectionEvasion, // Non-evidence node
-        CommentedQuotes,
-        StringStmts,
-        GlobalVariables,
-        UnionStmts,
-        AlwaysTrueConditional,
-        OrStmts,
-        StringManipulation,
-        EmptyPassword,
-        ConditionalModification, // Non-evidence node
-        CommentedConditionals
-    };
-    assert(
-        static_cast<int>(CommentedConditionals) + 1 ==
-        bayesNets_[ATTACK_BYPASS_AUTHENTICATION].number_of_nodes()
-        && "The number of nodes loaded from file and the number of states in "
-        && "the nodes enum should match"
-    );
+        probabilities[AttackScores::BYPASS_AUTHENTICATION] =
+            scoreBypass(features, nullptr);
+    }
+    if (scores->applicable[AttackScores::DATA_ACCESS])
+    {
+        probabilities[AttackScores::DATA_ACCESS] =
+            scoreAccess(features, nullptr);
+    }
+    if (scores->applicable[AttackScores::DATA_MODIFICATION])
+    {
+        probabilities[AttackScores::DATA_MODIFICATION] =
+            scoreModification(features, nullptr);
+    }
+    if (scores->applicable[AttackScores::FINGERPRINTING])
+    {
+        probabilities[AttackScores::FINGERPRINTING] =
+            scoreFingerprinting(features, nullptr);
+    }
+    if (scores->applicable[AttackScores::SCHEMA])
+    {
+        probabilities[AttackScores::SCHEMA] = scoreSchema(features, nullptr);
+    }
+    if (scores->applicable[AttackScores::DENIAL_OF_SERVICE])
+    {
+        probabilities[AttackScores::DENIAL_OF_SERVICE] =
+            scoreDenial(features, nullptr);
+    }
+}
 
-    int states[static_cast<int>(CommentedConditionals) + 1];
 
-    states[OrAlwaysTrue] =
-        (qr.alwaysTrue && qr.orStatements && qr.alwaysTrueConditional);
-    states[HexStrings] = qr.hexStrings ? 0 : 1;
-    states[BruteForce] = qr.bruteForceCommands ? 0 : 1;
-    states[CommentedQuotes] = qr.commentedQuotes ? 0 : 1;
-    states[StringStmts] = (qr.userStatements || qr.fingerprintingStatements
+void DlibProbabilities::extractFeatures(
+    const QueryRisk& qr,
+    Features* const features
+)
+{
+    assert(nullptr != features);
+    Features& f = *features;
+
+    f.select = (QueryRisk::TYPE_SELECT == qr.queryType) ? 0 : 1;
+    f.insert = (QueryRisk::TYPE_INSERT == qr.queryType) ? 0 : 1;
+    f.mySqlComments = qr.mySqlComments ? 0 : 1;
+    f.mySqlVersionComments = qr.mySqlVersionedComments ? 0 : 1;
+    f.sensitiveTables = qr.sensitiveTables ? 0 : 1;
+    f.orStmts = qr.orStatements ? 0 : 1;
+    f.unionStmts = qr.unionStatements ? 0 : 1;
+    f.unionAllStmts = qr.unionAllStatements ? 0 : 1;
+    f.anyUnionStmts =
+        (qr.unionStatements || qr.unionAllStatements) ? 0 : 1;
+    f.bruteForce = qr.bruteForceCommands ? 0 : 1;
+    f.ifStmts = qr.ifStatements ? 0 : 1;
+    f.hexStrings = qr.hexStrings ? 0 : 1;
+    f.benchmarkStmts = qr.benchmarkStatements ? 0 : 1;
+    f.userStmts = qr.userStatements ? 0 : 1;
+    f.fingerprintingStmts = qr.fingerprintingStatements ? 0 : 1;
+    f.stringStmts = (qr.userStatements || qr.fingerprintingStatements
         || qr.globalVariables) ? 0 : 1;
-    states[GlobalVariables] = qr.globalVariables ? 0 : 1;
-    states[UnionStmts] = (qr.unionStatements || qr.unionAllStatements) ? 0 : 1;
-    states[AlwaysTrueConditional] = qr.alwaysTrueConditional ? 0 : 1;
-    states[OrStmts] = qr.orStatements ? 0 : 1;
-    states[StringManipulation] = (qr.stringManipulationStatements <= 3)
+    f.mySqlStringConcat = qr.mySqlStringConcat ? 0 : 1;
+    f.stringManipulation = (qr.stringManipulationStatements <= 3)
         ? qr.stringManipulationStatements : 4;
+    f.alwaysTrueConditional = qr.alwaysTrueConditional ? 0 : 1;
+    f.commentedConditionals = qr.commentedConditionals ? 0 : 1;
+    f.commentedQuotes = qr.commentedQuotes ? 0 : 1;
+    f.globalVariables = qr.globalVariables ? 0 : 1;
+    f.joins = (qr.joinStatements <= 4 ? qr.joinStatements : 5);
+    f.regexLength = (qr.regexLength / 5 < 5) ? (qr.regexLength / 5) : 5;
+    f.slowRegex = qr.slowRegexes ? 0 : 1;
+    f.alwaysTrue = qr.alwaysTrue ? 0 : 1;
+    f.orAlwaysTrue =
+        (qr.orStatements && qr.alwaysTrue && qr.alwaysTrueConditional) ? 0 : 1;
+    f.informationSchema = qr.informationSchema ? 0 : 1;
+    f.orderByNumber = qr.orderByNumber ? 0 : 1;
 
+    f.passwordUsed = true;
     switch (qr.emptyPassword)
     {
     case QueryRisk::PASSWORD_EMPTY:
-        states[EmptyPassword] = 0;
+        f.emptyPassword = 0;
         break;
     case QueryRisk::PASSWORD_NOT_EMPTY:
-        states[EmptyPassword] = 1;
+        f.emptyPassword = 1;
         break;
     case QueryRisk::PASSWORD_NOT_USED:
-        // Don't set the state at all - it will be ignored and not set
+        f.emptyPassword = 0;
+        f.passwordUsed = false;
         break;
     default:
         Logger::log(Logger::ERROR)
             << "Unexpected value of qr.emptyPassword "
             << qr.emptyPassword;
         assert(false);
-        const_cast<QueryRisk&>(qr).emptyPassword =
-            QueryRisk::PASSWORD_NOT_USED;
+        f.emptyPassword = 0;
+        f.passwordUsed = false;
     }
+}
 
-    states[CommentedConditionals] = qr.commentedConditionals ? 0 : 1;
-
-    const int evidenceNodeNumbersWithPassword[] = {
-        // OrAlwaysTrue, // Non-evidence node
-        // BypassAuthentication, // Non-evidence node
-        HexStrings,
-        BruteForce,
-        // DetectionEvasion, // Non-evidence node
-        CommentedQuotes,
-        StringStmts,
-        GlobalVariables,
-        UnionStmts,
-        AlwaysTrueConditional,
-        OrStmts,
-        StringManipulation,
-        EmptyPassword,
-        // ConditionalModification, // Non-evidence node
-        CommentedConditionals
-    };
-    const int evidenceNodeNumbersWithoutPassword[] = {
-        // OrAlwaysTrue, // Non-evidence node
-        // BypassAuthentication, // Non-evidence node
-        HexStrings,
-        BruteForce,
-        // DetectionEvasion, // Non-evidence node
-        CommentedQuotes,
-        StringStmts,
-        GlobalVariables,
-        UnionStmts,
-        AlwaysTrueConditional,
-        OrStmts,
-        StringManipulation,
-        // ConditionalModification, // Non-evidence node
-        CommentedConditionals
-    };
-
-    assert(
-        sizeof(evidenceNodeNumbersWithPassword)
-            - sizeof(evidenceNodeNumbersWithoutPassword)
-                == sizeof(evidenceNodeNumbersWithPassword[0])
-        && "Evidence node numbers with and without password should differ by"
-        && "only one element"
-    );
-
-    int SIZE;
-    const int* evidenceNodeNumbers;
-    if (QueryRisk::PASSWORD_NOT_USED == qr.emptyPassword)
-    {
-        SIZE = sizeof(evidenceNodeNumbersWithoutPassword)
-            / sizeof(evidenceNodeNumbersWithoutPassword[0]);
-        evidenceNodeNumbers = evidenceNodeNumbersWithoutPassword;
-    }
-    else
-    {
-        SIZE = sizeof(evidenceNodeNumbersWithPassword)
-            / sizeof(evidenceNodeNumbersWithPassword[0]);
-        evidenceNodeNumbers = evidenceNodeNumbersWithPassword;
-    }
 
-    const int ATTACK_STATE = 0;
-    return computeProbabilityOfState(
-        ATTACK_BYPASS_AUTHENTICATION,
-        BypassAuthentication,
-        ATTACK_STATE,
-        evidenceNodeNumbers,
+double DlibProbabilities::scoreAccess(
+    const Features& features,
+    Verification* const verification
+)
+{
+    // The nodes come from the generated network, so that they are checked
+    // against its net file when this is compiled
+    typedef DataAccessNet Net;
+    int states[Net::NODES_COUNT];
+    fill(states, states + Net::NODES_COUNT, NO_STATE);
+
+    states[Net::GlobalVariables] = features.globalVariables;
+    states[Net::IfStmts] = features.ifStmts;
+    BOOST_STATIC_ASSERT(5 == Net::StringManipulationStates);
+    states[Net::StringManipulation] = features.stringManipulation;
+    states[Net::HexStrings] = features.hexStrings;
+    states[Net::OrAlwaysTrue] = features.orAlwaysTrue;
+    states[Net::CommentedConditionals] = features.commentedConditionals;
+    states[Net::StringStmts] = features.stringStmts;
+    states[Net::BruteForce] = features.bruteForce;
+    states[Net::UnionStmts] = features.unionStmts;
+    states[Net::BenchmarkStmts] = features.benchmarkStmts;
+    states[Net::CommentedQuotes] = features.commentedQuotes;
+    states[Net::AlwaysTrueConditional] = features.alwaysTrueConditional;
+    states[Net::SensitiveTables] = features.sensitiveTables;
+    states[Net::UnionAllStmts] = features.unionAllStmts;
+    states[Net::OrStmts] = features.orStmts;
+
+    return lookUpProbability(
+        ATTACK_DATA_ACCESS,
+        Net::table,
         states,
-        SIZE
+        verification
     );
 }
 
 
-double DlibProbabilities::getProbabilityOfModificationAttack(
-    const QueryRisk& qr
+double DlibProbabilities::scoreBypass(
+    const Features& features,
+    Verification* const verification
 )
 {
-    // This should be the order of the nodes in the Hugin net file
-    enum NODE_TYPES
+    // The nodes come from the generated network, so that they are checked
+    // against its net file when this is compiled
+    typedef BypassAuthenticationNet Net;
+    int states[Net::NODES_COUNT];
+    fill(states, states + Net::NODES_COUNT, NO_STATE);
+
+    states[Net::HexStrings] = features.hexStrings;
+    states[Net::BruteForce] = features.bruteForce;
+    states[Net::CommentedQuotes] = features.commentedQuotes;
+    states[Net::StringStmts] = features.stringStmts;
+    states[Net::GlobalVariables] = features.globalVariables;
+    states[Net::UnionStmts] = features.anyUnionStmts;
+    states[Net::AlwaysTrueConditional] = features.alwaysTrueConditional;
+    states[Net::OrStmts] = features.orStmts;
+    BOOST_STATIC_ASSERT(5 == Net::StringManipulationStates);
+    states[Net::StringManipulation] = features.stringManipulation;
+    states[Net::CommentedConditionals] = features.commentedConditionals;
+
+    // The password is only evidence if the query compares one
+    if (!features.passwordUsed)
     {
-        DetectionEvasion, // Non-evidence node
-        HexStrings,
-        StringStmts,
-        DataModification, // Non-evidence node
-        Insert,
-        ConditionalModification, // Non-evidence node
-        GlobalVariables,
-        BruteForce,
-        OrStmts,
-        AlwaysTrue,
-        StringManipulation,
-        CommentedConditionals,
-        CommentedQuotes,
-        SensitiveTables
-    };
-    assert(
-        static_cast<int>(SensitiveTables) + 1 ==
-            bayesNets_[ATTACK_DATA_MODIFICATION].number_of_nodes()
-        && "The number of nodes loaded from file and the number of states in "
-        && "the nodes enum should match"
+        return lookUpProbability(
+            ATTACK_BYPASS_AUTHENTICATION,
+            Net::tableWithoutPassword,
+            states,
+            verification
+        );
+    }
+    states[Net::EmptyPassword] = features.emptyPassword;
+    return lookUpProbability(
+        ATTACK_BYPASS_AUTHENTICATION,
+        Net::table,
+        states,
+        verification
     );
+}
 
-    int states[static_cast<int>(SensitiveTables) + 1];
 
-    states[HexStrings] = qr.hexStrings ? 0 : 1;
-    states[StringStmts] = (qr.userStatements || qr.fingerprintingStatements
-        || qr.globalVariables) ? 0 : 1;
-    states[Insert] = (QueryRisk::TYPE_INSERT == qr.queryType) ? 0 : 1;
-    states[GlobalVariables] = qr.globalVariables ? 0 : 1;
-    states[BruteForce] = qr.bruteForceCommands ? 0 : 1;
-    states[OrStmts] = qr.orStatements ? 0 : 1;
-    states[AlwaysTrue] = qr.alwaysTrue ? 0 : 1;
-    states[StringManipulation] = (qr.stringManipulationStatements <= 3)
-        ? qr.stringManipulationStatements : 4;
-    states[CommentedConditionals] = qr.commentedConditionals ? 0 : 1;
-    states[CommentedQuotes] = qr.commentedQuotes ? 0 : 1;
-    states[SensitiveTables] = qr.sensitiveTables ? 0 : 1;
-
-    const int evidenceNodeNumbers[] = {
-        // DetectionEvasion, // Non-evidence node
-        HexStrings,
-        StringStmts,
-        // DataModification, // Non-evidence node
-        Insert,
-        // ConditionalModification, // Non-evidence node
-        GlobalVariables,
-        BruteForce,
-        OrStmts,
-        AlwaysTrue,
-        StringManipulation,
-        CommentedConditionals,
-        CommentedQuotes,
-        SensitiveTables
-    };
-
-    const int SIZE =
-        sizeof(evidenceNodeNumbers) / sizeof(evidenceNodeNumbers[0]);
-    const int ATTACK_STATE = 0;
-    return computeProbabilityOfState(
+double DlibProbabilities::scoreModification(
+    const Features& features,
+    Verification* const verification
+)
+{
+    // The nodes come from the generated network, so that they are checked
+    // against its net file when this is compiled
+    typedef DataModificationNet Net;
+    int states[Net::NODES_COUNT];
+    fill(states, states + Net::NODES_COUNT, NO_STATE);
+
+    states[Net::HexStrings] = features.hexStrings;
+    states[Net::StringStmts] = features.stringStmts;
+    states[Net::Insert] = features.insert;
+    states[Net::GlobalVariables] = features.globalVariables;
+    states[Net::BruteForce] = features.bruteForce;
+    states[Net::OrStmts] = features.orStmts;
+    states[Net::AlwaysTrue] = features.alwaysTrue;
+    BOOST_STATIC_ASSERT(5 == Net::StringManipulationStates);
+    states[Net::StringManipulation] = features.stringManipulation;
+    states[Net::CommentedConditionals] = features.commentedConditionals;
+    states[Net::CommentedQuotes] = features.commentedQuotes;
+    states[Net::SensitiveTables] = features.sensitiveTables;
+
+    return lookUpProbability(
         ATTACK_DATA_MODIFICATION,
-        DataModification,
-        ATTACK_STATE,
-        evidenceNodeNumbers,
+        Net::table,
         states,
-        SIZE
+        verification
     );
 }
 
 
-double DlibProbabilities::getProbabilityOfFingerprintingAttack(
-    const QueryRisk& qr
+double DlibProbabilities::scoreFingerprinting(
+    const Features& features,
+    Verification* const verification
 )
 {
-    // This should be the order of the nodes in the Hugin net file
-    enum NODE_TYPES
-    {
-        MySqlComments,
-        MySqlStringConcat,
-        DataAccess, // Non-evidence node
-        GlobalVariables,
-        Select,
-        StringManipulation,
-        OrStmts,
-        ConditionalModification, // Non-evidence node
-        IfStmts,
-        CommentedQuotes,
-        Fingerprinting, // Non-evidence node
-        BruteForce,
-        CommentedConditionals,
-        ConditionalStmts, // Non-evidence node
-        HexStrings,
-        UnionStmts,
-        MySqlVersionComments,
-        DetectionEvasion, // Non-evidence node
-        FingerprintingStmts,
-        UserStmts,
-        AlwaysTrueConditional,
-        BenchmarkStmts,
-        StringStmts,
-        OrAlwaysTrue
-    };
-    assert(
-        static_cast<int>(OrAlwaysTrue) + 1 ==
-            bayesNets_[ATTACK_FINGERPRINTING].number_of_nodes()
-        && "The number of nodes loaded from file and the number of states in "
-        && "the nodes enum should match"
-    );
-
-    int states[static_cast<int>(OrAlwaysTrue) + 1];
-
-    states[MySqlComments] = qr.mySqlComments ? 0 : 1;
-    states[MySqlStringConcat] = qr.mySqlStringConcat ? 0 : 1;
-    states[GlobalVariables] = qr.globalVariables ? 0 : 1;
-    states[Select] = (QueryRisk::TYPE_SELECT == qr.queryType) ? 0 : 1;
-    states[StringManipulation] =  (qr.stringManipulationStatements <= 3)
-        ? qr.stringManipulationStatements : 4;
-    states[OrStmts] = qr.orStatements ? 0 : 1;
-    states[IfStmts] = qr.ifStatements ? 0 : 1;
-    states[CommentedQuotes] = qr.commentedQuotes ? 0 : 1;
-    states[FingerprintingStmts] = qr.fingerprintingStatements ? 0 : 1;
-    states[BruteForce] = qr.bruteForceCommands ? 0 : 1;
-    states[CommentedConditionals] = qr.commentedConditionals ? 0 : 1;
-    states[HexStrings] = qr.hexStrings ? 0 : 1;
-    states[UnionStmts] = (qr.unionStatements || qr.unionAllStatements) ? 0 : 1;
-    states[MySqlVersionComments] = qr.mySqlVersionedComments ? 0 : 1;
-    states[UserStmts] = qr.userStatements ? 0 : 1;
-    states[AlwaysTrueConditional] = qr.alwaysTrueConditional ? 0 : 1;
-    states[BenchmarkStmts] = qr.benchmarkStatements ? 0 : 1;
-    states[StringStmts] =
-        (qr.userStatements || qr.fingerprintingStatements
-            || qr.globalVariables) ? 0 : 1;
-    states[OrAlwaysTrue] =
-        (qr.alwaysTrue && qr.orStatements && qr.alwaysTrueConditional) ? 0 : 1;
-
-    const int evidenceNodeNumbers[] = {
-        MySqlComments,
-        MySqlStringConcat,
-        // DataAccess, // Non-evidence node
-        GlobalVariables,
-        Select,
-        StringManipulation,
-        OrStmts,
-        // ConditionalModification, // Non-evidence node
-        IfStmts,
-        CommentedQuotes,
-        // Fingerprinting, // Non-evidence node
-        BruteForce,
-        CommentedConditionals,
-        // ConditionalStmts, // Non-evidence node
-        HexStrings,
-        UnionStmts,
-        MySqlVersionComments,
-        // DetectionEvasion, // Non-evidence node
-        FingerprintingStmts,
-        UserStmts,
-        AlwaysTrueConditional,
-        BenchmarkStmts,
-        StringStmts,
-        OrAlwaysTrue
-    };
-
-    const int SIZE =
-        sizeof(evidenceNodeNumbers) / sizeof(evidenceNodeNumbers[0]);
-    const int ATTACK_STATE = 0;
-    return computeProbabilityOfState(
+    // The nodes come from the generated network, so that they are checked
+    // against its net file when this is compiled
+    typedef FingerprintingNet Net;
+    int states[Net::NODES_COUNT];
+    fill(states, states + Net::NODES_COUNT, NO_STATE);
+
+    states[Net::MySqlComments] = features.mySqlComments;
+    states[Net::MySqlStringConcat] = features.mySqlStringConcat;
+    states[Net::GlobalVariables] = features.globalVariables;
+    states[Net::Select] = features.select;
+    BOOST_STATIC_ASSERT(5 == Net::StringManipulationStates);
+    states[Net::StringManipulation] = features.stringManipulation;
+    states[Net::OrStmts] = features.orStmts;
+    states[Net::IfStmts] = features.ifStmts;
+    states[Net::CommentedQuotes] = features.commentedQuotes;
+    states[Net::FingerprintingStmts] = features.fingerprintingStmts;
+    states[Net::BruteForce] = features.bruteForce;
+    states[Net::CommentedConditionals] = features.commentedConditionals;
+    states[Net::HexStrings] = features.hexStrings;
+    states[Net::UnionStmts] = features.anyUnionStmts;
+    states[Net::MySqlVersionComments] = features.mySqlVersionComments;
+    states[Net::UserStmts] = features.userStmts;
+    states[Net::AlwaysTrueConditional] = features.alwaysTrueConditional;
+    states[Net::BenchmarkStmts] = features.benchmarkStmts;
+    states[Net::StringStmts] = features.stringStmts;
+    states[Net::OrAlwaysTrue] = features.orAlwaysTrue;
+
+    return lookUpProbability(
         ATTACK_FINGERPRINTING,
-        Fingerprinting,
-        ATTACK_STATE,
-        evidenceNodeNumbers,
+        Net::table,
         states,
-        SIZE
+        verification
     );
 }
 
 
-double DlibProbabilities::getProbabilityOfSchemaAttack(const QueryRisk& qr)
+double DlibProbabilities::scoreSchema(
+    const Features& features,
+    Verification* const verification
+)
 {
-    // This should be the order of the nodes in the Hugin net file
-    enum NODE_TYPES
-    {
-        OrStmts,
-        OrderByNumber,
-        GlobalVariables,
-        BruteForce,
-        CommentedQuotes,
-        IfStmts,
-        StringStmts,
-        DataAccess, // Non-evidence node
-        InformationSchema,
-        HexStrings,
-        ConditionalModification, // Non-evidence node
-        DetectionEvasion, // Non-evidence node
-        Schema, // Non-evidence node
-        UnionStmts,
-        CommentedConditionals,
-        ConditionalStmts, // Non-evidence node
-        BenchmarkStmts,
-        OrAlwaysTrue,
-        AlwaysTrueConditional,
-        StringManipulation,
-        Select
-    };
-    assert(
-        static_cast<int>(Select) + 1 ==
-            bayesNets_[ATTACK_SCHEMA].number_of_nodes()
-            && "The number of nodes loaded from file and the number of "
-            && "states in the nodes enum should match"
-    );
-
-    int states[static_cast<int>(Select) + 1];
-
-    states[OrStmts] = qr.orStatements ? 0 : 1;
-    states[OrderByNumber] = qr.orderByNumber ? 0 : 1;
-    states[GlobalVariables] = qr.globalVariables ? 0 : 1;
-    states[BruteForce] = qr.bruteForceCommands ? 0 : 1;
-    states[CommentedQuotes] = qr.commentedQuotes ? 0 : 1;
-    states[IfStmts] = qr.ifStatements ? 0 : 1;
-    states[StringStmts] =
-        ((qr.userStatements || qr.fingerprintingStatements
-            || qr.globalVariables) ? 0 : 1);
-    states[InformationSchema] = qr.informationSchema ? 0 : 1;
-    states[HexStrings] = qr.hexStrings ? 0 : 1;
-    states[UnionStmts] = (qr.unionStatements || qr.unionAllStatements) ? 0 : 1;
-    states[CommentedConditionals] = qr.commentedConditionals ? 0 : 1;
-    states[BenchmarkStmts] = qr.benchmarkStatements ? 0 : 1;
-    states[OrAlwaysTrue] =
-        (qr.alwaysTrue && qr.orStatements && qr.alwaysTrueConditional ? 0 : 1);
-    states[AlwaysTrueConditional] = qr.alwaysTrueConditional ? 0 : 1;
-    states[StringManipulation] = (
-        qr.stringManipulationStatements <= 3
-        ? qr.stringManipulationStatements
-        : 4
-    );
-    states[Select] = (QueryRisk::TYPE_SELECT == qr.queryType) ? 0 : 1;
-
-    const int evidenceNodeNumbers[] = {
-        OrStmts,
-        OrderByNumber,
-        GlobalVariables,
-        BruteForce,
-        CommentedQuotes,
-        IfStmts,
-        StringStmts,
-        // DataAccess, // Non-evidence node
-        InformationSchema,
-        HexStrings,
-        // ConditionalModification, // Non-evidence node
-        // DetectionEvasion, // Non-evidence node
-        // Schema, // Non-evidence node
-        UnionStmts,
-        CommentedConditionals,
-        // ConditionalStmts, // Non-evidence node
-        BenchmarkStmts,
-        OrAlwaysTrue,
-        AlwaysTrueConditional,
-        StringManipulation,
-        Select
-    };
-
-    const int SIZE =
-        sizeof(evidenceNodeNumbers) / sizeof(evidenceNodeNumbers[0]);
-    const int ATTACK_STATE = 0;
-    return computeProbabilityOfState(
+    // The nodes come from the generated network, so that they are checked
+    // against its net file when this is compiled
+    typedef SchemaNet Net;
+    int states[Net::NODES_COUNT];
+    fill(states, states + Net::NODES_COUNT, NO_STATE);
+
+    states[Net::OrStmts] = features.orStmts;
+    states[Net::OrderByNumber] = features.orderByNumber;
+    states[Net::GlobalVariables] = features.globalVariables;
+    states[Net::BruteForce] = features.bruteForce;
+    states[Net::CommentedQuotes] = features.commentedQuotes;
+    states[Net::IfStmts] = features.ifStmts;
+    states[Net::StringStmts] = features.stringStmts;
+    states[Net::InformationSchema] = features.informationSchema;
+    states[Net::HexStrings] = features.hexStrings;
+    states[Net::UnionStmts] = features.anyUnionStmts;
+    states[Net::CommentedConditionals] = features.commentedConditionals;
+    states[Net::BenchmarkStmts] = features.benchmarkStmts;
+    states[Net::OrAlwaysTrue] = features.orAlwaysTrue;
+    states[Net::AlwaysTrueConditional] = features.alwaysTrueConditional;
+    BOOST_STATIC_ASSERT(5 == Net::StringManipulationStates);
+    states[Net::StringManipulation] = features.stringManipulation;
+    states[Net::Select] = features.select;
+
+    return lookUpProbability(
         ATTACK_SCHEMA,
-        Schema,
-        ATTACK_STATE,
-        evidenceNodeNumbers,
+        Net::table,
         states,
-        SIZE
+        verification
     );
 }
 
 
-double DlibProbabilities::getProbabilityOfDenialAttack(const QueryRisk& qr)
+double DlibProbabilities::scoreDenial(
+    const Features& features,
+    Verification* const verification
+)
 {
-    // This should be the order of the nodes in the Hugin net file
-    enum NODE_TYPES
-    {
-        AlwaysTrue,
-        SlowRegex,
-        Benchmark,
-        Joins,
-        DenialOfService, // Non-evidence node
-        CrossJoin,
-        RegexLength
-    };
-    assert(
-        static_cast<int>(RegexLength) + 1 ==
-            bayesNets_[ATTACK_DENIAL_OF_SERVICE].number_of_nodes()
-        && "The number of nodes loaded from file and the number of states in "
-        && "the nodes enum should match"
-    );
-
-    int states[static_cast<int>(RegexLength) + 1];
-
-    states[AlwaysTrue] = qr.alwaysTrue ? 0 : 1;
-    states[SlowRegex] = qr.slowRegexes ? 0 : 1;
-    states[Benchmark] = qr.benchmarkStatements ? 0 : 1;
-    states[Joins] = (qr.joinStatements <= 4 ? qr.joinStatements : 5);
-    states[CrossJoin] = qr.globalVariables ? 0 : 1;
-    states[RegexLength] = (qr.regexLength / 5 < 5) ? (qr.regexLength / 5) : 5;
-
-    const int evidenceNodeNumbers[] = {
-        AlwaysTrue,
-        SlowRegex,
-        Benchmark,
-        Joins,
-        // DenialOfService, // Non-evidence node
-        CrossJoin,
-        RegexLength
-    };
-
-    const int SIZE =
-        sizeof(evidenceNodeNumbers) / sizeof(evidenceNodeNumbers[0]);
-    const int ATTACK_STATE = 0;
-    return computeProbabilityOfState(
+    // The nodes come from the generated network, so that they are checked
+    // against its net file when this is compiled
+    typedef DenialOfServiceNet Net;
+    int states[Net::NODES_COUNT];
+    fill(states, states + Net::NODES_COUNT, NO_STATE);
+
+    states[Net::AlwaysTrue] = features.alwaysTrue;
+    states[Net::SlowRegex] = features.slowRegex;
+    states[Net::Benchmark] = features.benchmarkStmts;
+    BOOST_STATIC_ASSERT(6 == Net::JoinsStates);
+    states[Net::Joins] = features.joins;
+    states[Net::CrossJoin] = features.globalVariables;
+    BOOST_STATIC_ASSERT(6 == Net::RegexLengthStates);
+    states[Net::RegexLength] = features.regexLength;
+
+    return lookUpProbability(
         ATTACK_DENIAL_OF_SERVICE,
-        DenialOfService,
-        ATTACK_STATE,
-        evidenceNodeNumbers,
+        Net::table,
         states,
-        SIZE
+        verification
     );
 }
 
 
-int DlibProbabilities::loadNetwork(
-    const string& fileName,
-    bayes_net* network
+void DlibProbabilities::buildNetwork(
+    const BayesNetDescription& description,
+    bayes_net* const network
 )
 {
     assert(nullptr != network);
 
-    ifstream fin(fileName.c_str());
-    if (!fin)
+    // The edges have to be added before the numbers of states are set, and
+    // those before the probabilities
+    network->set_number_of_nodes(description.nodesCount);
+    for (int node = 0; node < description.nodesCount; ++node)
     {
-        return 1;
+        for (
+            int i = description.parentsOffsets[node];
+            i < description.parentsOffsets[node + 1];
+            ++i
+        )
+        {
+            network->add_edge(description.parents[i], node);
+        }
     }
-
-    string file;
-    string line;
-    while (getline(fin, line))
+    for (int node = 0; node < description.nodesCount; ++node)
     {
-        file += line + "\n";
+        set_node_num_values(
+            *network,
+            node,
+            description.statesCounts[node]
+        );
     }
-    fin.close();
 
-    // We have to call the parsing twice - once to build the network's
-    // structure, and once to set the probabilities
-    for (int i = 0; i < 2; ++i)
+    for (int node = 0; node < description.nodesCount; ++node)
     {
-        // Parse the file
-        yyscan_t scanner;
-        if (0 != hugin_lex_init(&scanner))
+        const int firstParent = description.parentsOffsets[node];
+        const int endParent = description.parentsOffsets[node + 1];
+        assignment parentStates;
+        for (int i = firstParent; i < endParent; ++i)
         {
-            throw bad_alloc();
+            parentStates.add(description.parents[i], 0);
         }
-        YY_BUFFER_STATE bufferState;
-        bufferState = hugin__scan_string(file.c_str(), scanner);
-        if (nullptr == bufferState)
+
+        // The probabilities are nested by the states of the parents with the
+        // last parent innermost, so count through the parents' states like
+        // the digits of a number
+        const unsigned int states = description.statesCounts[node];
+        const double* probability =
+            &description.probabilities[description.probabilitiesOffsets[node]];
+        const double* const end =
+            &description.probabilities[
+                description.probabilitiesOffsets[node + 1]
+            ];
+        while (probability != end)
         {
-            throw bad_alloc();
-        }
-        const bool firstTime = (i == 0);
-        const int status = hugin_parse(network, firstTime, scanner);
-
-        // Cleanup
-        hugin__delete_buffer(bufferState, scanner);
-        hugin_lex_destroy(scanner);
-        #ifndef NDEBUG
-            if (0 == status)
+            for (unsigned int state = 0; state < states; ++state)
             {
-                assert(
-                    hugin_identifiers.empty()
-                    && hugin_numbers.empty()
-                    && "After parsing a Hugins network file, "
-                    && "stacks should be empty"
+                set_node_probability(
+                    *network,
+                    node,
+                    state,
+                    parentStates,
+                    *probability
                 );
+                ++probability;
+            }
+            for (int i = endParent - 1; i >= firstParent; --i)
+            {
+                const int parent = description.parents[i];
+                if (++parentStates[parent] < description.statesCounts[parent])
+                {
+                    break;
+                }
+                parentStates[parent] = 0;
             }
-        #endif
-        clearStack(&hugin_identifiers);
-        clearStack(&hugin_numbers);
-
-        // Quit early if parsing failed
-        if (0 != status)
-        {
-            return status;
         }
     }
-    // If we got here, then status must be okay
-    return 0;
-}
-
-double DlibProbabilities::computeProbabilityOfState(
-    const ATTACK_TYPE type,
-    const int node,
-    const int state,
-    const int evidenceNodes[],
-    const int evidenceStates[],
-    const int evidenceSize
-)
-{
-    assert(type >= 0 && type < numAttackTypes && "Invalid attack type");
-    const Evidence encodedEvidence =
-        encodeEvidence(evidenceNodes, evidenceStates, evidenceSize);
-
-    // Set some static variables so that we can compute the probability if
-    // necessary
-    lock_guard<mutex> lg(cep_->computeMutex_);
-    cep_->attackType_ = type;
-    cep_->node_ = node;
-    cep_->state_ = state;
-    cep_->evidenceNodes_ = evidenceNodes;
-    cep_->evidenceStates_ = evidenceStates;
-    cep_->evidenceSize_ = evidenceSize;
-
-    EvidenceCache& evidenceCache = *caches_[type];
-    return evidenceCache(encodedEvidence);
 }
 
 
-DlibProbabilities::Evidence DlibProbabilities::encodeEvidence(
-    const int nodeNumbers[],
+double DlibProbabilities::lookUpProbability(
+    const ATTACK_TYPE type,
+    const BayesTableDescription& table,
     const int states[],
-    const int size
+    Verification* const verification
 )
 {
-    // Use 3 bits for each value
-    assert(
-        static_cast<unsigned int>(size) < ((sizeof(Evidence) * 8) / 3) &&
-        "Not enough bits in Evidence type to encode the evidence nodes"
-    );
-    Evidence e = 0;
-
-    for (int i = 0; i < size; ++i)
+    assert(type >= 0 && type < numAttackTypes && "Invalid attack type");
+#ifndef NDEBUG
+    for (int i = 0; i < table.evidenceCount; ++i)
     {
-        const int NODE_NUMBER = nodeNumbers[i];
+        const int node = table.evidence[i];
         assert(
-            states[NODE_NUMBER] < 8 &&
-            "Encoding uses 3 bits, but provided evidence has value >= 8"
+            states[node] >= 0
+            && states[node] < static_cast<int>(
+                DESCRIPTIONS[type]->statesCounts[node]
+            )
+            && "Every evidence node of the table should have a state"
         );
-        e = (e << 3) | (states[NODE_NUMBER]);
     }
-    return e;
+#endif
+
+    const double probability = table.getProbability(states);
+    if (nullptr != verification)
+    {
+        const double inferred = inferProbabilityOfState(
+            type,
+            table.node,
+            table.state,
+            table.evidence,
+            states,
+            table.evidenceCount
+        );
+        ++verification->checked;
+        if (fabs(inferred - probability) > VERIFY_TOLERANCE)
+        {
+            ++verification->mismatched;
+            Logger::log(Logger::ERROR)
+                << "Probability of attack type " << type << " is "
+                << probability << " but the network gives " << inferred;
+        }
+    }
+    return probability;
 }
 
 
-double DlibProbabilities::computeEvidence(const Evidence&)
+double DlibProbabilities::inferProbabilityOfState(
+    const ATTACK_TYPE type,
+    const int node,
+    const int state,
+    const int evidenceNodes[],
+    const int evidenceStates[],
+    const int evidenceSize
+)
 {
-    bayes_net& net = bayesNets_[cep_->attackType_];
-    join_tree_type& joinTree = joinTrees_[cep_->attackType_];
+    const BorrowedScratch scratch;
+    bayes_net& net = scratch->bayesNets[type];
+    join_tree_type& joinTree = scratch->joinTrees[type];
+    if (!scratch->built[type])
+    {
+        buildNetwork(*DESCRIPTIONS[type], &net);
+        create_moral_graph(net, joinTree);
+        create_join_tree(joinTree, joinTree);
+        scratch->built[type] = true;
+    }
 
-    for (int i = 0; i < cep_->evidenceSize_; ++i)
+    // Nodes that were evidence for an earlier probability, like the
+    // password, might not be this time
+    for (size_t i = 0; i < net.number_of_nodes(); ++i)
     {
-        const int NODE_NUMBER = cep_->evidenceNodes_[i];
-        set_node_value(
-            net,
-            NODE_NUMBER,
-            cep_->evidenceStates_[NODE_NUMBER]
-        );
+        set_node_as_nonevidence(net, i);
+    }
+    for (int i = 0; i < evidenceSize; ++i)
+    {
+        const int NODE_NUMBER = evidenceNodes[i];
+        set_node_value(net, NODE_NUMBER, evidenceStates[NODE_NUMBER]);
         set_node_as_evidence(net, NODE_NUMBER);
     }
 
     // Compute the probabilities of the nodes given what we know
     bayesian_network_join_tree computed(net, joinTree);
 
-    return computed.probability(cep_->node_)(cep_->state_);
+    return computed.probability(node)(state);
+}
+
+
+void DlibProbabilities::verifyProbabilities(
+    const QueryRisk& qr,
+    size_t* const checked,
+    size_t* const mismatched
+)
+{
+    assert(nullptr != checked);
+    assert(nullptr != mismatched);
+    Features features;
+    extractFeatures(qr, &features);
+
+    Verification verification = {0, 0};
+    // The probabilities are only needed to check them
+    scoreAccess(features, &verification);
+    scoreBypass(features, &verification);
+    scoreModification(features, &verification);
+    scoreFingerprinting(features, &verification);
+    scoreSchema(features, &verification);
+    scoreDenial(features, &verification);
+    *checked = verification.checked;
+    *mismatched = verification.mismatched;
 }
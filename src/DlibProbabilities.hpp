@@ -22,21 +22,26 @@
 #define SRC_DLIBPROBABILITIES_HPP_
 
 #include "AttackProbabilities.hpp"
-class ComputeEvidenceParameters;
-#include "LruCache.hpp"
 #include "QueryRisk.hpp"
 #include "warnUnusedResult.h"
+struct BayesNetDescription;
+struct BayesTableDescription;
 
-#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <cstddef>
 #include "dlib/dlib/bayes_utils.h"
 #include "dlib/dlib/graph.h"
 #include "dlib/dlib/graph_utils.h"
 #include "dlib/dlib/directed_graph.h"
-#include <string>
+#include <vector>
 
 /**
  * Implementation of AttackProbabilities that uses Bayesian networks and the
- * dlib library.
+ * dlib library. The probabilities are looked up in tables that huginToCpp.py
+ * works out from the networks at build time, so nothing is computed while
+ * SQLassie runs; the networks are only built to verify the tables. A thread
+ * that verifies borrows a copy of the networks to set the evidence on, so one
+ * instance can be used by any number of threads at once.
  * @author Brandon Skari
  * @date May 8 2011
  */
@@ -47,7 +52,6 @@ class DlibProbabilities : public AttackProbabilities
 public:
     /**
      * Default constructor.
-     * @throw BayesException A network was not loaded correctly from file.
      */
     DlibProbabilities();
 
@@ -79,19 +83,38 @@ public:
     ) WARN_UNUSED_RESULT;
     ///@}
 
+    /**
+     * Computes the probability of every type of attack that applies to the
+     * type of query, working the evidence out from the QueryRisk only once.
+     * Implemented from AttackProbabilities.
+     */
+    void scoreAll(const QueryRisk& qr, AttackScores* scores);
+
     typedef dlib::directed_graph<dlib::bayes_node>::kernel_1a_c bayes_net;
 
-    typedef uint64_t Evidence;
-    typedef LruCache<Evidence, double> EvidenceCache;
+    /**
+     * Looks up the probability of every type of attack for a query and
+     * compares each one with the probability that the network gives.
+     * @param qr The query to check the probabilities of.
+     * @param checked Will be set to how many probabilities were checked.
+     * @param mismatched Will be set to how many of those didn't match.
+     */
+    void verifyProbabilities(
+        const QueryRisk& qr,
+        size_t* checked,
+        size_t* mismatched
+    );
 
 protected:
     /**
-     * Loads a Bayesian network from a Hugin net file.
-     * @param fileName The name of the Hugin net file.
-     * @param network The network to encode the information from the file.
-     * @return 0 on success.
+     * Builds a Bayesian network from its generated description.
+     * @param description The network that was generated from a Hugin file.
+     * @param network The network to encode the description in.
      */
-    static int loadNetwork(const std::string& fileName, bayes_net* network);
+    static void buildNetwork(
+        const BayesNetDescription& description,
+        bayes_net* network
+    );
 
 private:
     enum ATTACK_TYPE
@@ -105,25 +128,134 @@ private:
         numAttackTypes
     };
 
+    /**
+     * The evidence for the networks, worked out from a QueryRisk once and
+     * shared by all of them. Each member is the state of the nodes of the
+     * same name; for the two state nodes, 0 means that the risk was found.
+     */
+    struct Features
+    {
+        unsigned char select;
+        unsigned char insert;
+        unsigned char mySqlComments;
+        unsigned char mySqlVersionComments;
+        unsigned char sensitiveTables;
+        unsigned char orStmts;
+        unsigned char unionStmts;
+        unsigned char unionAllStmts;
+        /// Some networks have one node for both kinds of union
+        unsigned char anyUnionStmts;
+        unsigned char bruteForce;
+        unsigned char ifStmts;
+        unsigned char hexStrings;
+        unsigned char benchmarkStmts;
+        unsigned char userStmts;
+        unsigned char fingerprintingStmts;
+        unsigned char stringStmts;
+        unsigned char mySqlStringConcat;
+        unsigned char stringManipulation;
+        unsigned char alwaysTrueConditional;
+        unsigned char commentedConditionals;
+        unsigned char commentedQuotes;
+        unsigned char globalVariables;
+        unsigned char joins;
+        unsigned char regexLength;
+        unsigned char slowRegex;
+        unsigned char alwaysTrue;
+        unsigned char orAlwaysTrue;
+        unsigned char informationSchema;
+        unsigned char orderByNumber;
+        unsigned char emptyPassword;
+        /// The password is only evidence if the query compares one
+        bool passwordUsed;
+    };
+
+    /**
+     * How many looked up probabilities were checked against the networks.
+     */
+    struct Verification
+    {
+        size_t checked;
+        size_t mismatched;
+    };
+
     // I don't know why, but this needs an unsigned long and won't compile
     // with a uint_32t
     typedef dlib::set<unsigned long>::compare_1b_c set_type; // NOLINT(runtime/int)
     typedef dlib::graph<set_type, set_type>::kernel_1a_c join_tree_type;
 
-    join_tree_type joinTrees_[numAttackTypes];
-    bayes_net bayesNets_[numAttackTypes];
+    /**
+     * The networks and join trees that a thread computes probabilities with.
+     * Setting evidence changes a network, and even reading a join tree moves
+     * the iterators in its nodes, so they can't be shared between threads.
+     */
+    struct InferenceScratch;
+
+    /**
+     * Borrows scratch networks until it goes out of scope.
+     */
+    class BorrowedScratch;
+
+    static void extractFeatures(const QueryRisk& qr, Features* features);
 
     /**
-     * Convenvience function to compute the probability of a given node having
-     * a particular state given some evidence.
+     * Looks up the probability of one type of attack from the evidence.
+     * @param verification If not nullptr, the probability is also checked
+     *  against the network.
+     */
+    ///@{
+    static double scoreAccess(
+        const Features& features,
+        Verification* verification
+    );
+    static double scoreBypass(
+        const Features& features,
+        Verification* verification
+    );
+    static double scoreModification(
+        const Features& features,
+        Verification* verification
+    );
+    static double scoreFingerprinting(
+        const Features& features,
+        Verification* verification
+    );
+    static double scoreSchema(
+        const Features& features,
+        Verification* verification
+    );
+    static double scoreDenial(
+        const Features& features,
+        Verification* verification
+    );
+    ///@}
+
+    /**
+     * Looks a probability up in a table.
+     * @param type The type of attack that the table is for.
+     * @param table The table of the probabilities.
+     * @param states The states of the nodes, by node number.
+     * @param verification If not nullptr, the probability is also checked
+     *  against the network.
+     */
+    static double lookUpProbability(
+        ATTACK_TYPE type,
+        const BayesTableDescription& table,
+        const int states[],
+        Verification* verification
+    );
+
+    /**
+     * Computes the probability of a given node having a particular state
+     * given some evidence from the network.
      * @param type The type of attack to compute probabilities for.
      * @param node Compute the probability of this node having a given state.
      * @param state Compute the probability of a given node having this state.
      * @param evidenceNodes The nodes that the provided evidence correspond to.
-     * @param evidenceStates The states of the evidence nodes.
+     * @param evidenceStates The states of the nodes, by node number.
      * @param evidenceSize How many items are in the given evidence array.
      */
-    double computeProbabilityOfState(
+    static double inferProbabilityOfState(
         ATTACK_TYPE type,
         int node,
         int state,
@@ -133,23 +265,19 @@ private:
     );
 
     /**
-     * Caches the probabilities from the Bayesian networks so they don't have
-     * to be calculated all the time.
-     */
-    EvidenceCache* caches_[numAttackTypes];
-
-    /**
-     * Encodes the evidence into an integral type so that I can use my
-     * LruCache for lookup.
+     * Scratch networks that aren't being used. Connections only last for a
+     * few queries, so the networks are kept here instead of with a thread,
+     * and are only built as many times as there have been threads
+     * verifying probabilities at once.
      */
-    static Evidence encodeEvidence(
-        const int nodeNumbers[],
-        const int states[],
-        const int size
-    );
+    ///@{
+    static std::vector<InferenceScratch*> freeScratch_;
+    static boost::mutex scratchMutex_;
+    ///@}
 
-    ComputeEvidenceParameters* cep_;
-    double computeEvidence(const Evidence&);
+    // ***** Hidden methods *****
+    DlibProbabilities(const DlibProbabilities&);
+    DlibProbabilities& operator=(const DlibProbabilities&);
 };
 
 #endif  // SRC_DLIBPROBABILITIES_HPP_
@@ -0,0 +1,426 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AutoPtrWithOperatorParens.hpp"
+#include "countSyscall.hpp"
+#include "EpollEventLoop.hpp"
+#include "Logger.hpp"
+#include "nullptr.hpp"
+#include "ProxyHalf.hpp"
+#include "Socket.hpp"
+#include "SocketException.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include <cassert>
+#include <cstring>
+#include <errno.h>
+#include <exception>
+#include <memory>
+#include <set>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <vector>
+
+using boost::bind;
+using boost::lock_guard;
+using boost::mutex;
+using std::auto_ptr;
+using std::exception;
+using std::set;
+using std::string;
+using std::vector;
+
+const int EpollEventLoop::MAX_EVENTS;
+
+static int createEpoll();
+static int createWakeFD(int epollFD);
+
+
+EpollEventLoop::EpollEventLoop() :
+    epollFD_(createEpoll()),
+    wakeFD_(createWakeFD(epollFD_)),
+    running_(true),
+    connectionCount_(0),
+    newConnectionsMutex_(),
+    newConnections_(),
+    connections_(),
+    closedConnections_(),
+    thread_(bind(&EpollEventLoop::run, this))
+{
+}
+
+
+EpollEventLoop::~EpollEventLoop()
+{
+    running_ = false;
+    const uint64_t one = 1;
+    if (write(wakeFD_, &one, sizeof(one)) < 0)
+    {
+        Logger::log(Logger::ERROR) << "Unable to wake event loop";
+    }
+    thread_.join();
+
+    registerNewConnections();
+    for (
+        set<Connection*>::iterator i(connections_.begin());
+        i != connections_.end();
+        ++i
+    )
+    {
+        destroyConnection(*i);
+    }
+    for (size_t i = 0; i < closedConnections_.size(); ++i)
+    {
+        destroyConnection(closedConnections_[i]);
+    }
+
+    close(wakeFD_);
+    close(epollFD_);
+}
+
+
+void EpollEventLoop::addProxy(
+    AutoPtrWithOperatorParens<ProxyHalf> in,
+    AutoPtrWithOperatorParens<ProxyHalf> out,
+    auto_ptr<Socket> inSocket,
+    auto_ptr<Socket> outSocket
+)
+{
+    inSocket->setBlocking(false);
+    outSocket->setBlocking(false);
+
+    Connection* connection = new Connection;
+    connection->closed = false;
+
+    connection->client.connection = connection;
+    connection->client.socket = inSocket.release();
+    connection->client.reader = in.release();
+    connection->client.peer = &connection->server;
+    connection->client.events = 0;
+
+    connection->server.connection = connection;
+    connection->server.socket = outSocket.release();
+    connection->server.reader = out.release();
+    connection->server.peer = &connection->client;
+    connection->server.events = 0;
+
+    {
+        lock_guard<mutex> lock(newConnectionsMutex_);
+        newConnections_.push_back(connection);
+    }
+    __sync_fetch_and_add(&connectionCount_, 1);
+
+    const uint64_t one = 1;
+    countSyscall();
+    if (write(wakeFD_, &one, sizeof(one)) < 0)
+    {
+        Logger::log(Logger::ERROR) << "Unable to wake event loop";
+    }
+}
+
+
+size_t EpollEventLoop::getConnectionCount() const
+{
+    return connectionCount_;
+}
+
+
+void EpollEventLoop::run()
+{
+    epoll_event events[MAX_EVENTS];
+    while (running_)
+    {
+        countSyscall();
+        const int eventCount = epoll_wait(epollFD_, events, MAX_EVENTS, -1);
+        if (eventCount < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            Logger::log(Logger::FATAL)
+                << "Event loop quitting after epoll_wait failed: "
+                << strerror(errno);
+            return;
+        }
+
+        for (int i = 0; i < eventCount; ++i)
+        {
+            Endpoint* const endpoint =
+                static_cast<Endpoint*>(events[i].data.ptr);
+            if (nullptr == endpoint)
+            {
+                uint64_t ignored;
+                countSyscall();
+                if (read(wakeFD_, &ignored, sizeof(ignored)) < 0)
+                {
+                    Logger::log(Logger::WARN)
+                        << "Unable to reset event loop wakeup";
+                }
+                registerNewConnections();
+            }
+            else if (!endpoint->connection->closed)
+            {
+                handleEvent(endpoint, events[i].events);
+            }
+        }
+
+        for (size_t i = 0; i < closedConnections_.size(); ++i)
+        {
+            destroyConnection(closedConnections_[i]);
+        }
+        closedConnections_.clear();
+    }
+}
+
+
+void EpollEventLoop::registerNewConnections()
+{
+    vector<Connection*> newConnections;
+    {
+        lock_guard<mutex> lock(newConnectionsMutex_);
+        newConnections.swap(newConnections_);
+    }
+
+    for (size_t i = 0; i < newConnections.size(); ++i)
+    {
+        Connection* const connection = newConnections[i];
+        Endpoint* const endpoints[] = {
+            &connection->client,
+            &connection->server
+        };
+        for (size_t j = 0; j < sizeof(endpoints) / sizeof(endpoints[0]); ++j)
+        {
+            epoll_event event;
+            std::memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.ptr = endpoints[j];
+            countSyscall();
+            if (
+                epoll_ctl(
+                    epollFD_,
+                    EPOLL_CTL_ADD,
+                    endpoints[j]->socket->getFileDescriptor(),
+                    &event
+                ) < 0
+            )
+            {
+                Logger::log(Logger::ERROR)
+                    << "Unable to add connection to event loop: "
+                    << strerror(errno);
+                closeConnection(connection);
+                break;
+            }
+            endpoints[j]->events = EPOLLIN;
+        }
+        if (!connection->closed)
+        {
+            connections_.insert(connection);
+        }
+    }
+}
+
+
+void EpollEventLoop::handleEvent(
+    Endpoint* const endpoint,
+    const uint32_t events
+)
+{
+    try
+    {
+        if (events & EPOLLOUT)
+        {
+            endpoint->socket->flushPendingOutput();
+        }
+        if (events & EPOLLIN)
+        {
+            endpoint->reader->handleAvailableData();
+        }
+        else if (events & (EPOLLERR | EPOLLHUP))
+        {
+            // Nothing left to read and the other side is gone
+            throw ClosedException();
+        }
+
+        // A ProxyHalf may have closed the connection itself
+        if (!endpoint->socket->isOpen() || !endpoint->peer->socket->isOpen())
+        {
+            throw ClosedException();
+        }
+
+        updateInterest(endpoint);
+        updateInterest(endpoint->peer);
+    }
+    catch (ClosedException& e)
+    {
+        // All done, so nothing else to do
+        closeConnection(endpoint->connection);
+    }
+    catch (exception& e)
+    {
+        Logger::log(Logger::ERROR)
+            << "EpollEventLoop connection exited unexpectedly with error: "
+            << e.what();
+        closeConnection(endpoint->connection);
+    }
+}
+
+
+void EpollEventLoop::updateInterest(Endpoint* const endpoint)
+{
+    // Only read more once everything we've already read has been written,
+    // so that output can't pile up if the other side stops reading
+    uint32_t events = 0;
+    if (
+        !endpoint->socket->hasPendingOutput()
+        && !endpoint->peer->socket->hasPendingOutput()
+    )
+    {
+        events |= EPOLLIN;
+    }
+    if (endpoint->socket->hasPendingOutput())
+    {
+        events |= EPOLLOUT;
+    }
+
+    if (events == endpoint->events)
+    {
+        return;
+    }
+
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.ptr = endpoint;
+    countSyscall();
+    if (
+        epoll_ctl(
+            epollFD_,
+            EPOLL_CTL_MOD,
+            endpoint->socket->getFileDescriptor(),
+            &event
+        ) < 0
+    )
+    {
+        string error("Unable to update event loop: ");
+        error += strerror(errno);
+        throw SocketException(error);
+    }
+    endpoint->events = events;
+}
+
+
+void EpollEventLoop::closeConnection(Connection* const connection)
+{
+    if (connection->closed)
+    {
+        return;
+    }
+    connection->closed = true;
+
+    Endpoint* const endpoints[] = {&connection->client, &connection->server};
+    for (size_t i = 0; i < sizeof(endpoints) / sizeof(endpoints[0]); ++i)
+    {
+        Socket* const socket = endpoints[i]->socket;
+        // Give anything that's still queued one last chance to go out
+        try
+        {
+            if (socket->isOpen() && socket->hasPendingOutput())
+            {
+                socket->flushPendingOutput();
+            }
+        }
+        catch (exception& e)
+        {
+            // The connection is being torn down anyway
+        }
+        // Closing the descriptor also removes it from the epoll set
+        socket->close();
+    }
+
+    connections_.erase(connection);
+    closedConnections_.push_back(connection);
+    Logger::log(Logger::DEBUG) << "Client disconnected from event loop";
+}
+
+
+void EpollEventLoop::destroyConnection(Connection* const connection)
+{
+    delete connection->client.reader;
+    delete connection->server.reader;
+    delete connection->client.socket;
+    delete connection->server.socket;
+    delete connection;
+    __sync_fetch_and_sub(&connectionCount_, 1);
+}
+
+
+/**
+ * Creates the epoll instance for an EpollEventLoop.
+ * @throw SocketException Unable to create the epoll instance.
+ */
+int createEpoll()
+{
+    const int epollFD = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFD < 0)
+    {
+        string error("Unable to create event loop: ");
+        error += strerror(errno);
+        throw SocketException(error);
+    }
+    return epollFD;
+}
+
+
+/**
+ * Creates the eventfd used to wake an EpollEventLoop and adds it to the epoll
+ * instance. The epoll instance is closed if anything goes wrong, since the
+ * EpollEventLoop constructor won't get a chance to clean it up.
+ * @throw SocketException Unable to create the eventfd.
+ */
+int createWakeFD(const int epollFD)
+{
+    const int wakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFD < 0)
+    {
+        close(epollFD);
+        string error("Unable to create event loop wakeup: ");
+        error += strerror(errno);
+        throw SocketException(error);
+    }
+
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if (epoll_ctl(epollFD, EPOLL_CTL_ADD, wakeFD, &event) < 0)
+    {
+        close(wakeFD);
+        close(epollFD);
+        string error("Unable to register event loop wakeup: ");
+        error += strerror(errno);
+        throw SocketException(error);
+    }
+    return wakeFD;
+}
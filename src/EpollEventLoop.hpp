@@ -0,0 +1,147 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_EPOLLEVENTLOOP_HPP_
+#define SRC_EPOLLEVENTLOOP_HPP_
+
+#include "AutoPtrWithOperatorParens.hpp"
+#include "EventLoop.hpp"
+#include "ProxyHalf.hpp"
+#include "Socket.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include <memory>
+#include <set>
+#include <vector>
+
+/**
+ * EventLoop that uses epoll. Sockets are switched to non-blocking mode and
+ * each ProxyHalf is only asked to handle data once epoll reports that its
+ * incoming Socket is readable. Output
+ * that the kernel won't immediately accept is queued in the Socket and
+ * flushed when the Socket becomes writable again; while a Socket has queued
+ * output, we stop reading from the connection so that a slow reader can't
+ * make us buffer without bound.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class EpollEventLoop : public EventLoop
+{
+public:
+    /**
+     * Default constructor. Starts the loop thread.
+     * @throw SocketException Unable to create the epoll instance.
+     */
+    EpollEventLoop();
+
+    /**
+     * Destructor. Stops the loop thread and closes all of its connections.
+     */
+    ~EpollEventLoop();
+
+    /**
+     * Overridden from EventLoop. The Sockets are switched to non-blocking
+     * mode.
+     */
+    virtual void addProxy(
+        AutoPtrWithOperatorParens<ProxyHalf> in,
+        AutoPtrWithOperatorParens<ProxyHalf> out,
+        std::auto_ptr<Socket> inSocket,
+        std::auto_ptr<Socket> outSocket
+    );
+
+    virtual size_t getConnectionCount() const;
+
+private:
+    struct Connection;
+
+    /**
+     * One direction of a Connection: a Socket and the ProxyHalf that reads
+     * from it.
+     */
+    struct Endpoint
+    {
+        Connection* connection;
+        Socket* socket;
+        ProxyHalf* reader;
+        Endpoint* peer;
+        uint32_t events;
+    };
+
+    struct Connection
+    {
+        Endpoint client;
+        Endpoint server;
+        bool closed;
+    };
+
+    /**
+     * Waits for and dispatches events until the loop is stopped.
+     */
+    void run();
+
+    /**
+     * Adds any connections that were handed over by other threads to epoll.
+     */
+    void registerNewConnections();
+
+    void handleEvent(Endpoint* endpoint, uint32_t events);
+
+    /**
+     * Recomputes which events we care about for an Endpoint and updates epoll
+     * if they changed.
+     */
+    void updateInterest(Endpoint* endpoint);
+
+    /**
+     * Closes both sockets of a connection. The connection itself is deleted
+     * once the current batch of events has been processed, because other
+     * events in the batch may still refer to it.
+     */
+    void closeConnection(Connection* connection);
+
+    void destroyConnection(Connection* connection);
+
+    static const int MAX_EVENTS = 64;
+
+    const int epollFD_;
+    const int wakeFD_;
+    volatile bool running_;
+    volatile size_t connectionCount_;
+
+    boost::mutex newConnectionsMutex_;
+    std::vector<Connection*> newConnections_;
+
+    // Only touched from the loop thread
+    std::set<Connection*> connections_;
+    std::vector<Connection*> closedConnections_;
+
+    // This needs to be the last member so that everything else is
+    // initialized before the loop thread starts
+    boost::thread thread_;
+
+    // ***** Hidden methods *****
+    EpollEventLoop(const EpollEventLoop&);
+    EpollEventLoop& operator=(const EpollEventLoop&);
+};
+
+#endif  // SRC_EPOLLEVENTLOOP_HPP_
@@ -0,0 +1,44 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EpollEventLoop.hpp"
+#include "EventLoop.hpp"
+#include "IoUringEventLoop.hpp"
+#include "Logger.hpp"
+
+
+EventLoop* EventLoop::create(const bool useIoUring)
+{
+    if (useIoUring)
+    {
+        if (IoUringEventLoop::isSupported())
+        {
+            return new IoUringEventLoop;
+        }
+        Logger::log(Logger::WARN)
+            << "io_uring is not supported by this kernel, using epoll instead";
+    }
+    return new EpollEventLoop;
+}
+
+
+EventLoop::~EventLoop()
+{
+}
@@ -0,0 +1,75 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_EVENTLOOP_HPP_
+#define SRC_EVENTLOOP_HPP_
+
+#include "AutoPtrWithOperatorParens.hpp"
+#include "ProxyHalf.hpp"
+#include "Socket.hpp"
+
+#include <memory>
+
+/**
+ * Class interface for running many proxied connections on a single thread.
+ * Rather than dedicating a pair of threads to every connection like Proxy
+ * does, implementations only hand data to a ProxyHalf once it has arrived.
+ * The loop thread is started by the constructor and stopped by the
+ * destructor. Connections can be added from any thread.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class EventLoop
+{
+public:
+    /**
+     * Creates an event loop using the best available backend.
+     * @param useIoUring Use io_uring if the kernel supports it. If it
+     *  doesn't, this falls back to epoll.
+     * @throw SocketException Unable to create the event loop.
+     */
+    static EventLoop* create(bool useIoUring);
+
+    virtual ~EventLoop();
+
+    /**
+     * Hands a connection over to this loop. The loop takes ownership of
+     * everything.
+     * @param in The ProxyHalf that reads from the client.
+     * @param out The ProxyHalf that reads from the server.
+     * @param inSocket The socket from the client to this proxy.
+     * @param outSocket The socket from this proxy to the server.
+     */
+    virtual void addProxy(
+        AutoPtrWithOperatorParens<ProxyHalf> in,
+        AutoPtrWithOperatorParens<ProxyHalf> out,
+        std::auto_ptr<Socket> inSocket,
+        std::auto_ptr<Socket> outSocket
+    ) = 0;
+
+    /**
+     * Returns the number of connections that this loop is responsible for,
+     * including ones that have been added but not yet registered.
+     */
+    virtual size_t getConnectionCount() const = 0;
+};
+
+#endif  // SRC_EVENTLOOP_HPP_
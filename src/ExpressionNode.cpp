@@ -111,16 +111,16 @@ string ExpressionNode::getValue() const
     }
 
     assert(
-        3 == children_.size()
+        3 == getChildrenCount()
         && "Expression nodes should either have a simple expression or two"
         && "simple expressions with an operator for children"
     );
 
     const ExpressionNode* expr1 = dynamic_cast<const ExpressionNode*>(
-        children_.at(0)
+        getChild(0)
     );
     const ExpressionNode* expr2 = dynamic_cast<const ExpressionNode*>(
-        children_.at(2)
+        getChild(2)
     );
     assert(
         nullptr != expr1
@@ -145,7 +145,7 @@ string ExpressionNode::getValue() const
     }
     catch (bad_lexical_cast&) {}
 
-    const string& oper = children_.at(1)->getName();
+    const string& oper = getChild(1)->getName();
     if ("+" == oper)
     {
         return lexical_cast<string>(child1 + child2);
@@ -229,6 +229,14 @@ QueryRisk::EmptyPassword ExpressionNode::emptyPassword() const
 }
 
 
+bool ExpressionNode::isLiteralSensitive() const
+{
+    // Identifiers are part of the query's shape, but anything else has to be
+    // evaluated to see if it's true
+    return !identifier_;
+}
+
+
 bool ExpressionNode::isNumber(const std::string& str)
 {
     // This method has been optimized because SQLassie was spending a lot of
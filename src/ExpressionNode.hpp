@@ -73,6 +73,12 @@ public:
      */
     virtual QueryRisk::EmptyPassword emptyPassword() const WARN_UNUSED_RESULT;
 
+    /**
+     * Determines if the results depend on the values of literals.
+     * Overridden from ConditionalNode.
+     */
+    virtual bool isLiteralSensitive() const WARN_UNUSED_RESULT;
+
     /**
      * Gets the value of this expression.
      */
@@ -88,6 +94,11 @@ public:
      */
     bool isNumber() const WARN_UNUSED_RESULT;
 
+    /**
+     * Determines if the string represents a decimal number.
+     */
+    static bool isNumber(const std::string& str);
+
     /**
      * Overridden from AstNode.
      */
@@ -103,11 +114,6 @@ private:
     const bool identifier_;
     const bool quotedString_;
 
-    /**
-     * Determines if the string represents a decimal number.
-     */
-    static bool isNumber(const std::string& str);
-
     ExpressionNode(const ExpressionNode& rhs);
     ExpressionNode& operator=(const ExpressionNode& rhs);
 };
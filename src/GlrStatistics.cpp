@@ -0,0 +1,184 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GlrStatistics.hpp"
+#include "nullptr.hpp"
+
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+using boost::lock_guard;
+using boost::mutex;
+using std::endl;
+using std::map;
+using std::ostream;
+using std::sort;
+using std::strstr;
+using std::vector;
+
+// Defined by the parser when it's built with YYDEBUG
+extern int yydebug;
+
+// Static members
+mutex GlrStatistics::mutex_;
+map<int, GlrStatistics::RuleCounts> GlrStatistics::rules_;
+uint64_t GlrStatistics::parses_ = 0;
+uint64_t GlrStatistics::splitParses_ = 0;
+uint64_t GlrStatistics::splits_ = 0;
+uint64_t GlrStatistics::merges_ = 0;
+long GlrStatistics::splitStack_ = -1;
+int GlrStatistics::lastRule_ = -1;
+bool GlrStatistics::parseSplit_ = false;
+
+GlrStatistics::RuleCounts::RuleCounts() :
+    line(0),
+    splits(0),
+    deferred(0),
+    merges(0)
+{
+}
+
+
+void GlrStatistics::enable()
+{
+    yydebug = 1;
+}
+
+
+int GlrStatistics::trace(FILE*, const char* const format, ...)
+{
+    char message[256];
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(message, sizeof(message), format, arguments);
+    va_end(arguments);
+
+    lock_guard<mutex> lock(mutex_);
+
+    const char* found;
+    if (nullptr != (found = strstr(message, "Starting parse")))
+    {
+        ++parses_;
+        splitStack_ = -1;
+        lastRule_ = -1;
+        parseSplit_ = false;
+    }
+    else if (nullptr != (found = strstr(message, "Splitting off stack")))
+    {
+        ++splits_;
+        if (!parseSplit_)
+        {
+            ++splitParses_;
+            parseSplit_ = true;
+        }
+        if (1 != sscanf(found, "Splitting off stack %ld", &splitStack_))
+        {
+            splitStack_ = -1;
+        }
+    }
+    else if (nullptr != strstr(message, "action deferred"))
+    {
+        found = strstr(message, "Reduced stack");
+        long stack = -1;
+        int rule = -1;
+        int line = 0;
+        // Newer versions of Bison give the line, older ones use #rule
+        if (
+            nullptr != found
+            && (
+                sscanf(found, "Reduced stack %ld by rule %d (line %d)",
+                    &stack, &rule, &line) >= 2
+                || sscanf(found, "Reduced stack %ld by rule #%d",
+                    &stack, &rule) == 2
+            )
+        )
+        {
+            RuleCounts& counts = rules_[rule];
+            counts.line = line;
+            ++counts.deferred;
+            if (stack == splitStack_)
+            {
+                ++counts.splits;
+                splitStack_ = -1;
+            }
+            lastRule_ = rule;
+        }
+    }
+    else if (nullptr != strstr(message, "Merging stack"))
+    {
+        ++merges_;
+        if (lastRule_ >= 0)
+        {
+            ++rules_[lastRule_].merges;
+        }
+    }
+    return 0;
+}
+
+
+void GlrStatistics::print(ostream& out)
+{
+    vector<RuleAndCounts> rules;
+    {
+        lock_guard<mutex> lock(mutex_);
+        out << "Parses: " << parses_ << '\n'
+            << "Parses that split: " << splitParses_ << '\n'
+            << "Splits: " << splits_ << '\n'
+            << "Merges: " << merges_ << '\n';
+        rules.assign(rules_.begin(), rules_.end());
+    }
+
+    sort(rules.begin(), rules.end(), splitMore);
+    for (size_t i = 0; i < rules.size(); ++i)
+    {
+        const RuleCounts& counts = rules[i].second;
+        out << "Rule " << rules[i].first;
+        if (counts.line > 0)
+        {
+            out << " (parser.y:" << counts.line << ')';
+        }
+        out << ": " << counts.splits << " splits, "
+            << counts.deferred << " deferred reductions, "
+            << counts.merges << " merges\n";
+    }
+    out.flush();
+}
+
+
+bool GlrStatistics::splitMore(
+    const RuleAndCounts& rule1,
+    const RuleAndCounts& rule2
+)
+{
+    if (rule1.second.splits != rule2.second.splits)
+    {
+        return rule1.second.splits > rule2.second.splits;
+    }
+    return rule1.second.deferred > rule2.second.deferred;
+}
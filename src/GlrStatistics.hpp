@@ -0,0 +1,110 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_GLRSTATISTICS_HPP_
+#define SRC_GLRSTATISTICS_HPP_
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <cstdio>
+#include <map>
+#include <ostream>
+#include <utility>
+
+/**
+ * Counts how often the GLR parser splits its stack and merges stacks back
+ * together, and which grammar rules it was reducing by when it did. The
+ * counts come from the parser's debug trace, so this only works with a
+ * parser that was built with YYDEBUG and GLR_STATISTICS defined, and it's
+ * meant for corpus runs rather than for production.
+ * @author Brandon Skari
+ * @date October 17 2026
+ */
+
+class GlrStatistics
+{
+public:
+    /**
+     * Turns on the parser's trace so that it can be counted.
+     */
+    static void enable();
+
+    /**
+     * Used as YYFPRINTF by the parser. Counts the messages about splits and
+     * merges and throws away everything else.
+     * @return 0, because nobody checks what fprintf returns.
+     */
+    static int trace(FILE* stream, const char* format, ...);
+
+    /**
+     * Prints the totals and the counts for each rule, the rules that split
+     * the most first.
+     */
+    static void print(std::ostream& out);
+
+private:
+    GlrStatistics();
+
+    struct RuleCounts
+    {
+        RuleCounts();
+        /// The rule's line in parser.y
+        int line;
+        /// How many splits started with a reduction by this rule
+        uint64_t splits;
+        /// How many reductions by this rule were deferred by a split
+        uint64_t deferred;
+        /// How many merges followed a reduction by this rule
+        uint64_t merges;
+    };
+    typedef std::pair<int, RuleCounts> RuleAndCounts;
+
+    /**
+     * Sorts rules by how often they split, most first.
+     */
+    static bool splitMore(
+        const RuleAndCounts& rule1,
+        const RuleAndCounts& rule2
+    );
+
+    static boost::mutex mutex_;
+    static std::map<int, RuleCounts> rules_;
+    static uint64_t parses_;
+    static uint64_t splitParses_;
+    static uint64_t splits_;
+    static uint64_t merges_;
+
+    /**
+     * State from earlier messages in the current parse.
+     */
+    ///@{
+    // The stack that was just split off, until it reduces by something
+    static long splitStack_;
+    // The last rule that a reduction was deferred for
+    static int lastRule_;
+    static bool parseSplit_;
+    ///@}
+
+    // ***** Hidden methods *****
+    GlrStatistics(const GlrStatistics&);
+    GlrStatistics& operator=(const GlrStatistics&);
+};
+
+#endif  // SRC_GLRSTATISTICS_HPP_
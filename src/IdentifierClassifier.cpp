@@ -0,0 +1,292 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "IdentifierClassifier.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <queue>
+
+/**
+ * Keywords that QueryRisk looks for and their categories.
+ */
+struct Keyword
+{
+    const char* name;
+    size_t length;
+    unsigned int categories;
+};
+
+#define KEYWORD(name, categories) {name, sizeof(name) - 1, categories}
+static const Keyword KEYWORDS[] = {
+    // This list taken from GreenSQL and appended by me. mid, substr,
+    // substring and char are also string manipulation functions.
+    KEYWORD(
+        "mid",
+        IdentifierClassifier::BRUTE_FORCE
+            | IdentifierClassifier::STRING_MANIPULATION
+    ),
+    KEYWORD(
+        "substr",
+        IdentifierClassifier::BRUTE_FORCE
+            | IdentifierClassifier::STRING_MANIPULATION
+    ),
+    KEYWORD(
+        "substring",
+        IdentifierClassifier::BRUTE_FORCE
+            | IdentifierClassifier::STRING_MANIPULATION
+    ),
+    KEYWORD(
+        "char",
+        IdentifierClassifier::BRUTE_FORCE
+            | IdentifierClassifier::STRING_MANIPULATION
+    ),
+    KEYWORD("load_file", IdentifierClassifier::BRUTE_FORCE),
+    // String manipulation functions that can be used for detection evasion
+    KEYWORD("concat", IdentifierClassifier::STRING_MANIPULATION),
+    KEYWORD("concatws", IdentifierClassifier::STRING_MANIPULATION),
+    KEYWORD("insert", IdentifierClassifier::STRING_MANIPULATION),
+    KEYWORD("hex", IdentifierClassifier::STRING_MANIPULATION),
+    KEYWORD("replace", IdentifierClassifier::STRING_MANIPULATION),
+    KEYWORD("reverse", IdentifierClassifier::STRING_MANIPULATION),
+    // This list taken from the MySQL manual; all the functions are synonymous
+    KEYWORD("current_user", IdentifierClassifier::USER_STATEMENT),
+    KEYWORD("session_user", IdentifierClassifier::USER_STATEMENT),
+    KEYWORD("system_user", IdentifierClassifier::USER_STATEMENT),
+    KEYWORD("user", IdentifierClassifier::USER_STATEMENT),
+    // Fingerprinting functions for MySQL, taken from
+    // "SQL Injection Attacks and Defense" by Justin Clarke
+    KEYWORD("schema", IdentifierClassifier::FINGERPRINTING),
+    KEYWORD("database", IdentifierClassifier::FINGERPRINTING),
+    KEYWORD("version", IdentifierClassifier::FINGERPRINTING),
+    KEYWORD("connection_id", IdentifierClassifier::FINGERPRINTING),
+    KEYWORD("last_insert_id", IdentifierClassifier::FINGERPRINTING),
+    KEYWORD("row_count", IdentifierClassifier::FINGERPRINTING),
+    KEYWORD("benchmark", IdentifierClassifier::BENCHMARK),
+    KEYWORD("if", IdentifierClassifier::IF_FUNCTION),
+    // Information schema is a special table that contains information about
+    // the database and tables in the database
+    KEYWORD("information_schema", IdentifierClassifier::INFORMATION_SCHEMA),
+    KEYWORD("mysql", IdentifierClassifier::INFORMATION_SCHEMA)
+};
+#undef KEYWORD
+static const size_t KEYWORDS_COUNT = sizeof(KEYWORDS) / sizeof(KEYWORDS[0]);
+
+/**
+ * Parts of table names that QueryRisk looks for. This list taken from
+ * GreenSQL; the user, customer and member tables are also user tables.
+ */
+struct Fragment
+{
+    const char* text;
+    unsigned int categories;
+};
+
+static const Fragment FRAGMENTS[] = {
+    {
+        "customer",
+        IdentifierClassifier::SENSITIVE_TABLE
+            | IdentifierClassifier::USER_TABLE
+    },
+    {
+        "member",
+        IdentifierClassifier::SENSITIVE_TABLE
+            | IdentifierClassifier::USER_TABLE
+    },
+    {"order", IdentifierClassifier::SENSITIVE_TABLE},
+    {"admin", IdentifierClassifier::SENSITIVE_TABLE},
+    {
+        "user",
+        IdentifierClassifier::SENSITIVE_TABLE
+            | IdentifierClassifier::USER_TABLE
+    },
+    {"permission", IdentifierClassifier::SENSITIVE_TABLE},
+    {"session", IdentifierClassifier::SENSITIVE_TABLE}
+};
+static const size_t FRAGMENTS_COUNT = sizeof(FRAGMENTS) / sizeof(FRAGMENTS[0]);
+
+/**
+ * Lower case letters get a column of their own in the automaton, and every
+ * other character shares the last one.
+ */
+static const int ALPHABET_SIZE = 27;
+
+/**
+ * Enough states for a trie of all the fragments.
+ */
+static const size_t MAX_STATES = 64;
+
+/**
+ * Lower cases an ASCII character. The regexes that this replaced were only
+ * case insensitive for ASCII anyway.
+ */
+static inline char toLower(char c);
+
+/**
+ * The automaton's column for a character.
+ */
+static inline int column(char c);
+
+/**
+ * Aho-Corasick automaton for the table name fragments. Every state knows
+ * where to go for every character, so matching is a table lookup for each
+ * character of the name with no backtracking.
+ */
+class FragmentAutomaton
+{
+public:
+    FragmentAutomaton();
+
+    unsigned int match(const char* text, size_t length) const;
+
+private:
+    unsigned char next_[MAX_STATES][ALPHABET_SIZE];
+    // The categories of every fragment that ends in each state
+    unsigned int categories_[MAX_STATES];
+};
+
+static const FragmentAutomaton fragmentAutomaton;
+
+
+unsigned int IdentifierClassifier::classifyName(
+    const char* const name,
+    const size_t length
+)
+{
+    for (size_t i = 0; i < KEYWORDS_COUNT; ++i)
+    {
+        const Keyword& keyword = KEYWORDS[i];
+        if (keyword.length != length)
+        {
+            continue;
+        }
+        size_t j = 0;
+        while (j < length && toLower(name[j]) == keyword.name[j])
+        {
+            ++j;
+        }
+        if (j == length)
+        {
+            return keyword.categories;
+        }
+    }
+    return NONE;
+}
+
+
+unsigned int IdentifierClassifier::classifyTable(
+    const char* const table,
+    const size_t length
+)
+{
+    return fragmentAutomaton.match(table, length);
+}
+
+
+FragmentAutomaton::FragmentAutomaton()
+{
+    // Build a trie of the fragments, with 0 meaning no child yet. Nothing
+    // goes back to the root, so 0 is never a child.
+    memset(next_, 0, sizeof(next_));
+    memset(categories_, 0, sizeof(categories_));
+    size_t states = 1;
+    for (size_t i = 0; i < FRAGMENTS_COUNT; ++i)
+    {
+        size_t state = 0;
+        for (const char* c = FRAGMENTS[i].text; '\0' != *c; ++c)
+        {
+            unsigned char& child = next_[state][column(*c)];
+            if (0 == child)
+            {
+                assert(states < MAX_STATES);
+                child = static_cast<unsigned char>(states);
+                ++states;
+            }
+            state = child;
+        }
+        categories_[state] |= FRAGMENTS[i].categories;
+    }
+
+    // Fill in the missing transitions breadth first from the failure links,
+    // so that every state's failure link is done before the state is
+    unsigned char failure[MAX_STATES];
+    failure[0] = 0;
+    std::queue<unsigned char> pending;
+    for (int c = 0; c < ALPHABET_SIZE; ++c)
+    {
+        const unsigned char child = next_[0][c];
+        if (0 != child)
+        {
+            failure[child] = 0;
+            pending.push(child);
+        }
+    }
+    while (!pending.empty())
+    {
+        const unsigned char state = pending.front();
+        pending.pop();
+        categories_[state] |= categories_[failure[state]];
+        for (int c = 0; c < ALPHABET_SIZE; ++c)
+        {
+            const unsigned char child = next_[state][c];
+            if (0 != child)
+            {
+                failure[child] = next_[failure[state]][c];
+                pending.push(child);
+            }
+            else
+            {
+                next_[state][c] = next_[failure[state]][c];
+            }
+        }
+    }
+}
+
+
+unsigned int FragmentAutomaton::match(
+    const char* const text,
+    const size_t length
+) const
+{
+    const unsigned int ALL = IdentifierClassifier::SENSITIVE_TABLE
+        | IdentifierClassifier::USER_TABLE;
+    unsigned int found = IdentifierClassifier::NONE;
+    size_t state = 0;
+    for (size_t i = 0; i < length && ALL != found; ++i)
+    {
+        state = next_[state][column(text[i])];
+        found |= categories_[state];
+    }
+    return found;
+}
+
+
+char toLower(const char c)
+{
+    return ('A' <= c && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+
+int column(const char c)
+{
+    const char lower = toLower(c);
+    return ('a' <= lower && lower <= 'z') ? lower - 'a' : ALPHABET_SIZE - 1;
+}
@@ -0,0 +1,77 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_IDENTIFIERCLASSIFIER_HPP_
+#define SRC_IDENTIFIERCLASSIFIER_HPP_
+
+#include <cstddef>
+
+/**
+ * Sorts the identifiers that QueryRisk checks into the risk categories that
+ * it cares about. The keyword lists are fixed, so they're compiled into
+ * tables instead of being matched with regular expressions. All matching is
+ * case insensitive and nothing is allocated.
+ * @author Brandon Skari
+ * @date October 17 2026
+ */
+
+class IdentifierClassifier
+{
+public:
+    enum Category
+    {
+        NONE = 0,
+        // Function names
+        BRUTE_FORCE = 1 << 0,
+        STRING_MANIPULATION = 1 << 1,
+        USER_STATEMENT = 1 << 2,
+        FINGERPRINTING = 1 << 3,
+        BENCHMARK = 1 << 4,
+        IF_FUNCTION = 1 << 5,
+        // Database names
+        INFORMATION_SCHEMA = 1 << 6,
+        // Parts of table names
+        SENSITIVE_TABLE = 1 << 7,
+        USER_TABLE = 1 << 8
+    };
+
+    /**
+     * Looks up a whole identifier in the keyword table.
+     * @return The categories of the keyword that the identifier is, or NONE.
+     */
+    static unsigned int classifyName(const char* name, size_t length);
+
+    /**
+     * Looks for the sensitive fragments anywhere in a table name, in a single
+     * pass over the name.
+     * @return SENSITIVE_TABLE and USER_TABLE if any of their fragments are in
+     *  the name.
+     */
+    static unsigned int classifyTable(const char* table, size_t length);
+
+private:
+    IdentifierClassifier();
+
+    // ***** Hidden methods *****
+    IdentifierClassifier(const IdentifierClassifier&);
+    IdentifierClassifier& operator=(const IdentifierClassifier&);
+};
+
+#endif  // SRC_IDENTIFIERCLASSIFIER_HPP_
@@ -28,11 +28,9 @@
 #include <boost/regex.hpp>
 #include <cassert>
 #include <string>
-#include <vector>
 using boost::regex;
 using boost::regex_match;
 using std::string;
-using std::vector;
 
 
 InValuesListNode::InValuesListNode(const bool in,
@@ -46,7 +44,11 @@ InValuesListNode::InValuesListNode(const bool in,
 
 InValuesListNode::~InValuesListNode()
 {
-    delete expression_;
+    // Nodes in an arena don't own the other nodes that they point to
+    if (!isInArena())
+    {
+        delete expression_;
+    }
 }
 
 
@@ -70,13 +72,11 @@ bool InValuesListNode::isAlwaysTrue() const
 
     const string firstExpression(expression_->getValue());
 
-    vector<const AstNode*>::const_iterator end(children_.end());
-    for (vector<const AstNode*>::const_iterator i(children_.begin());
-        i != end;
-        ++i)
+    const size_t childrenCount = getChildrenCount();
+    for (size_t i = 0; i < childrenCount; ++i)
     {
         const ExpressionNode* const expr =
-            dynamic_cast<const ExpressionNode*>(*i);
+            dynamic_cast<const ExpressionNode*>(getChild(i));
         assert(nullptr != expr &&
             "InValuesListNode should only have ExpressionNode* children");
 
@@ -111,6 +111,13 @@ QueryRisk::EmptyPassword InValuesListNode::emptyPassword() const
 }
 
 
+bool InValuesListNode::isLiteralSensitive() const
+{
+    // Both checks look at the value of the expression unless it's a field
+    return !expression_->isIdentifier();
+}
+
+
 void InValuesListNode::print(
     std::ostream& out,
     const int depth,
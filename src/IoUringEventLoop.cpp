@@ -0,0 +1,1019 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AutoPtrWithOperatorParens.hpp"
+#include "countSyscall.hpp"
+#include "IoUringEventLoop.hpp"
+#include "Logger.hpp"
+#include "nullptr.hpp"
+#include "PacketBufferPool.hpp"
+#include "ProxyHalf.hpp"
+#include "Socket.hpp"
+#include "SocketException.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include <cassert>
+#include <cstring>
+#include <errno.h>
+#include <exception>
+#include <linux/io_uring.h>
+#include <memory>
+#include <set>
+#include <string>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+using boost::bind;
+using boost::lock_guard;
+using boost::mutex;
+using std::auto_ptr;
+using std::exception;
+using std::set;
+using std::string;
+using std::vector;
+
+const unsigned IoUringEventLoop::RING_ENTRIES;
+const size_t IoUringEventLoop::READ_BUFFER_SIZE;
+const size_t IoUringEventLoop::WRITE_BUFFER_SIZE;
+const size_t IoUringEventLoop::REGISTERED_CONNECTIONS;
+const size_t IoUringEventLoop::BUFFER_SLOT_SIZE;
+
+static int createWakeFD();
+static string errorString(const char* message, int error);
+
+
+/**
+ * The memory shared with the kernel for one io_uring instance, along with the
+ * buffers that are registered with it.
+ */
+struct IoUringEventLoop::Ring
+{
+    /**
+     * @throw SocketException Unable to set up io_uring.
+     */
+    explicit Ring(unsigned entries);
+    ~Ring();
+
+    /**
+     * Returns a cleared submission entry. If the submission queue is full,
+     * the queued entries are submitted first to make room.
+     * @throw SocketException Unable to submit.
+     */
+    io_uring_sqe* getSubmission();
+
+    /**
+     * Submits all queued entries and waits for at least minComplete
+     * completions, all with one system call.
+     * @throw SocketException Unable to submit.
+     */
+    void submitAndWait(unsigned minComplete);
+
+    /**
+     * Copies all available completions as (user data, result) pairs and
+     * frees their slots in the completion queue.
+     */
+    void getCompletions(vector<std::pair<uint64_t, int32_t> >* completions);
+
+    int fd;
+    io_uring_params params;
+
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    io_uring_sqe* sqes;
+    size_t sqesSize;
+
+    volatile unsigned* sqHead;
+    volatile unsigned* sqTail;
+    unsigned sqMask;
+    unsigned* sqArray;
+    unsigned sqLocalTail;
+    unsigned queued;
+
+    volatile unsigned* cqHead;
+    volatile unsigned* cqTail;
+    unsigned cqMask;
+    io_uring_cqe* cqes;
+
+    uint8_t* buffers;
+    size_t buffersSize;
+    bool buffersRegistered;
+
+private:
+    void release();
+
+    // ***** Hidden methods *****
+    Ring(const Ring&);
+    Ring& operator=(const Ring&);
+};
+
+
+IoUringEventLoop::Ring::Ring(const unsigned entries) :
+    fd(-1),
+    params(),
+    sqRing(MAP_FAILED),
+    sqRingSize(0),
+    cqRing(MAP_FAILED),
+    cqRingSize(0),
+    sqes(static_cast<io_uring_sqe*>(MAP_FAILED)),
+    sqesSize(0),
+    sqHead(nullptr),
+    sqTail(nullptr),
+    sqMask(0),
+    sqArray(nullptr),
+    sqLocalTail(0),
+    queued(0),
+    cqHead(nullptr),
+    cqTail(nullptr),
+    cqMask(0),
+    cqes(nullptr),
+    buffers(static_cast<uint8_t*>(MAP_FAILED)),
+    buffersSize(0),
+    buffersRegistered(false)
+{
+    memset(&params, 0, sizeof(params));
+    fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0)
+    {
+        throw SocketException(errorString("Unable to set up io_uring", errno));
+    }
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    // Newer kernels let both rings share one mapping
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        sqRingSize = std::max(sqRingSize, cqRingSize);
+        cqRingSize = sqRingSize;
+    }
+
+    sqRing = mmap(
+        nullptr,
+        sqRingSize,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        fd,
+        IORING_OFF_SQ_RING
+    );
+    if (MAP_FAILED == sqRing)
+    {
+        const int error = errno;
+        release();
+        throw SocketException(
+            errorString("Unable to map io_uring submission queue", error)
+        );
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        cqRing = sqRing;
+    }
+    else
+    {
+        cqRing = mmap(
+            nullptr,
+            cqRingSize,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            fd,
+            IORING_OFF_CQ_RING
+        );
+        if (MAP_FAILED == cqRing)
+        {
+            const int error = errno;
+            release();
+            throw SocketException(
+                errorString("Unable to map io_uring completion queue", error)
+            );
+        }
+    }
+
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe*>(
+        mmap(
+            nullptr,
+            sqesSize,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            fd,
+            IORING_OFF_SQES
+        )
+    );
+    if (MAP_FAILED == sqes)
+    {
+        const int error = errno;
+        release();
+        throw SocketException(
+            errorString("Unable to map io_uring submission entries", error)
+        );
+    }
+
+    uint8_t* const sq = static_cast<uint8_t*>(sqRing);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqLocalTail = *sqTail;
+
+    uint8_t* const cq = static_cast<uint8_t*>(cqRing);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    buffersSize = REGISTERED_CONNECTIONS * BUFFER_SLOT_SIZE;
+    buffers = static_cast<uint8_t*>(
+        mmap(
+            nullptr,
+            buffersSize,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS,
+            -1,
+            0
+        )
+    );
+    if (MAP_FAILED == buffers)
+    {
+        const int error = errno;
+        release();
+        throw SocketException(
+            errorString("Unable to allocate io_uring buffers", error)
+        );
+    }
+
+    // Registering the buffers pins them in memory, which can fail if the
+    // locked memory limit is low. Everything still works without it, just
+    // with a bit more overhead per operation.
+    iovec registration;
+    registration.iov_base = buffers;
+    registration.iov_len = buffersSize;
+    if (
+        syscall(
+            __NR_io_uring_register,
+            fd,
+            IORING_REGISTER_BUFFERS,
+            &registration,
+            1
+        ) < 0
+    )
+    {
+        Logger::log(Logger::INFO)
+            << "Unable to register io_uring buffers, continuing without: "
+            << strerror(errno);
+    }
+    else
+    {
+        buffersRegistered = true;
+    }
+}
+
+
+IoUringEventLoop::Ring::~Ring()
+{
+    release();
+}
+
+
+void IoUringEventLoop::Ring::release()
+{
+    if (MAP_FAILED != buffers)
+    {
+        munmap(buffers, buffersSize);
+        buffers = static_cast<uint8_t*>(MAP_FAILED);
+    }
+    if (MAP_FAILED != sqes)
+    {
+        munmap(sqes, sqesSize);
+        sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    }
+    if (MAP_FAILED != cqRing && cqRing != sqRing)
+    {
+        munmap(cqRing, cqRingSize);
+    }
+    cqRing = MAP_FAILED;
+    if (MAP_FAILED != sqRing)
+    {
+        munmap(sqRing, sqRingSize);
+        sqRing = MAP_FAILED;
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+}
+
+
+io_uring_sqe* IoUringEventLoop::Ring::getSubmission()
+{
+    unsigned head = *sqHead;
+    __sync_synchronize();
+    if (sqLocalTail - head >= params.sq_entries)
+    {
+        submitAndWait(0);
+        head = *sqHead;
+        __sync_synchronize();
+        if (sqLocalTail - head >= params.sq_entries)
+        {
+            throw SocketException("io_uring submission queue is full");
+        }
+    }
+
+    const unsigned index = sqLocalTail & sqMask;
+    sqArray[index] = index;
+    io_uring_sqe* const sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ++sqLocalTail;
+    ++queued;
+    return sqe;
+}
+
+
+void IoUringEventLoop::Ring::submitAndWait(const unsigned minComplete)
+{
+    if (0 == queued && 0 == minComplete)
+    {
+        return;
+    }
+
+    // Make the new entries visible to the kernel
+    __sync_synchronize();
+    *sqTail = sqLocalTail;
+    __sync_synchronize();
+
+    while (true)
+    {
+        countSyscall();
+        const int submitted = syscall(
+            __NR_io_uring_enter,
+            fd,
+            queued,
+            minComplete,
+            (minComplete > 0 ? IORING_ENTER_GETEVENTS : 0),
+            nullptr,
+            0
+        );
+        if (submitted >= 0)
+        {
+            queued -= std::min(queued, static_cast<unsigned>(submitted));
+            return;
+        }
+        else if (EINTR == errno)
+        {
+            continue;
+        }
+        else if (EBUSY == errno || EAGAIN == errno)
+        {
+            // The completion queue is backed up; the caller needs to handle
+            // some completions before we can submit more
+            return;
+        }
+        throw SocketException(
+            errorString("Unable to submit to io_uring", errno)
+        );
+    }
+}
+
+
+void IoUringEventLoop::Ring::getCompletions(
+    vector<std::pair<uint64_t, int32_t> >* const completions
+)
+{
+    assert(nullptr != completions);
+    completions->clear();
+
+    unsigned head = *cqHead;
+    const unsigned tail = *cqTail;
+    __sync_synchronize();
+    while (head != tail)
+    {
+        const io_uring_cqe& cqe = cqes[head & cqMask];
+        completions->push_back(std::make_pair(cqe.user_data, cqe.res));
+        ++head;
+    }
+    __sync_synchronize();
+    *cqHead = head;
+}
+
+
+bool IoUringEventLoop::isSupported()
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    const int fd = syscall(__NR_io_uring_setup, 4, &params);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bool supported = (0 != (params.features & IORING_FEAT_NODROP));
+
+    // Make sure the operations we need are there; IORING_OP_READ and
+    // IORING_OP_WRITE only showed up in Linux 5.6, along with the probe
+    const size_t probeOps = 256;
+    vector<uint8_t> probeMemory(
+        sizeof(io_uring_probe) + probeOps * sizeof(io_uring_probe_op),
+        0
+    );
+    io_uring_probe* const probe =
+        reinterpret_cast<io_uring_probe*>(&probeMemory[0]);
+    if (
+        syscall(
+            __NR_io_uring_register,
+            fd,
+            IORING_REGISTER_PROBE,
+            probe,
+            probeOps
+        ) < 0
+    )
+    {
+        supported = false;
+    }
+    else
+    {
+        const uint8_t neededOps[] = {
+            IORING_OP_READ_FIXED,
+            IORING_OP_WRITE_FIXED,
+            IORING_OP_READ,
+            IORING_OP_WRITE,
+            IORING_OP_ASYNC_CANCEL
+        };
+        for (size_t i = 0; i < sizeof(neededOps) / sizeof(neededOps[0]); ++i)
+        {
+            if (
+                neededOps[i] >= probe->ops_len
+                || !(probe->ops[neededOps[i]].flags & IO_URING_OP_SUPPORTED)
+            )
+            {
+                supported = false;
+            }
+        }
+    }
+
+    close(fd);
+    return supported;
+}
+
+
+IoUringEventLoop::IoUringEventLoop() :
+    ring_(new Ring(RING_ENTRIES)),
+    wakeFD_(createWakeFD()),
+    wakeValue_(0),
+    running_(true),
+    connectionCount_(0),
+    newConnectionsMutex_(),
+    newConnections_(),
+    connections_(),
+    changedConnections_(),
+    freeBufferSlots_(),
+    readData_(),
+    thread_(bind(&IoUringEventLoop::run, this))
+{
+}
+
+
+IoUringEventLoop::~IoUringEventLoop()
+{
+    running_ = false;
+    const uint64_t one = 1;
+    if (write(wakeFD_, &one, sizeof(one)) < 0)
+    {
+        Logger::log(Logger::ERROR) << "Unable to wake event loop";
+    }
+    thread_.join();
+    PacketBufferPool::release(&readData_);
+
+    // The loop waits for all of its connections to finish before quitting,
+    // so all that's left are ones that were never started
+    for (size_t i = 0; i < newConnections_.size(); ++i)
+    {
+        destroyConnection(newConnections_[i]);
+    }
+    close(wakeFD_);
+}
+
+
+void IoUringEventLoop::addProxy(
+    AutoPtrWithOperatorParens<ProxyHalf> in,
+    AutoPtrWithOperatorParens<ProxyHalf> out,
+    auto_ptr<Socket> inSocket,
+    auto_ptr<Socket> outSocket
+)
+{
+    inSocket->setDeferredOutput(true);
+    outSocket->setDeferredOutput(true);
+
+    Connection* connection = new Connection;
+    connection->bufferSlot = -1;
+    connection->operationsInFlight = 0;
+    connection->closed = false;
+    connection->changed = false;
+
+    Endpoint* const endpoints[] = {&connection->client, &connection->server};
+    for (size_t i = 0; i < sizeof(endpoints) / sizeof(endpoints[0]); ++i)
+    {
+        endpoints[i]->connection = connection;
+        endpoints[i]->readBuffer = nullptr;
+        endpoints[i]->writeBuffer = nullptr;
+        endpoints[i]->writeOffset = 0;
+        endpoints[i]->writeLength = 0;
+        endpoints[i]->reading = false;
+        endpoints[i]->writing = false;
+        endpoints[i]->finished = false;
+    }
+    connection->client.socket = inSocket.release();
+    connection->client.reader = in.release();
+    connection->client.peer = &connection->server;
+    connection->server.socket = outSocket.release();
+    connection->server.reader = out.release();
+    connection->server.peer = &connection->client;
+
+    {
+        lock_guard<mutex> lock(newConnectionsMutex_);
+        newConnections_.push_back(connection);
+    }
+    __sync_fetch_and_add(&connectionCount_, 1);
+
+    const uint64_t one = 1;
+    countSyscall();
+    if (write(wakeFD_, &one, sizeof(one)) < 0)
+    {
+        Logger::log(Logger::ERROR) << "Unable to wake event loop";
+    }
+}
+
+
+size_t IoUringEventLoop::getConnectionCount() const
+{
+    return connectionCount_;
+}
+
+
+void IoUringEventLoop::run()
+{
+    for (size_t i = 0; i < REGISTERED_CONNECTIONS; ++i)
+    {
+        freeBufferSlots_.push_back(REGISTERED_CONNECTIONS - i - 1);
+    }
+
+    vector<std::pair<uint64_t, int32_t> > completions;
+    try
+    {
+        submitWakeRead();
+        while (running_ || !connections_.empty())
+        {
+            ring_->submitAndWait(1);
+            ring_->getCompletions(&completions);
+            for (size_t i = 0; i < completions.size(); ++i)
+            {
+                handleCompletion(completions[i].first, completions[i].second);
+            }
+
+            for (size_t i = 0; i < changedConnections_.size(); ++i)
+            {
+                Connection* const connection = changedConnections_[i];
+                connection->changed = false;
+                updateConnection(connection);
+                if (connection->closed && 0 == connection->operationsInFlight)
+                {
+                    destroyConnection(connection);
+                }
+            }
+            changedConnections_.clear();
+        }
+    }
+    catch (exception& e)
+    {
+        Logger::log(Logger::FATAL)
+            << "Event loop quitting after io_uring failed: "
+            << e.what();
+    }
+}
+
+
+void IoUringEventLoop::registerNewConnections()
+{
+    vector<Connection*> newConnections;
+    {
+        lock_guard<mutex> lock(newConnectionsMutex_);
+        newConnections.swap(newConnections_);
+    }
+
+    for (size_t i = 0; i < newConnections.size(); ++i)
+    {
+        Connection* const connection = newConnections[i];
+
+        uint8_t* buffers;
+        if (!freeBufferSlots_.empty())
+        {
+            connection->bufferSlot = freeBufferSlots_.back();
+            freeBufferSlots_.pop_back();
+            buffers =
+                ring_->buffers + connection->bufferSlot * BUFFER_SLOT_SIZE;
+        }
+        else
+        {
+            buffers = new uint8_t[BUFFER_SLOT_SIZE];
+        }
+        connection->client.readBuffer = buffers;
+        connection->client.writeBuffer = buffers + READ_BUFFER_SIZE;
+        connection->server.readBuffer =
+            connection->client.writeBuffer + WRITE_BUFFER_SIZE;
+        connection->server.writeBuffer =
+            connection->server.readBuffer + READ_BUFFER_SIZE;
+
+        connections_.insert(connection);
+        submitRead(&connection->client);
+        submitRead(&connection->server);
+    }
+}
+
+
+void IoUringEventLoop::handleCompletion(
+    const uint64_t userData,
+    const int32_t result
+)
+{
+    const Operation operation = static_cast<Operation>(userData & 3);
+    if (WAKE_OPERATION == operation)
+    {
+        if (running_)
+        {
+            registerNewConnections();
+            submitWakeRead();
+        }
+        else
+        {
+            for (
+                set<Connection*>::iterator i(connections_.begin());
+                i != connections_.end();
+                ++i
+            )
+            {
+                closeConnection(*i, nullptr);
+            }
+        }
+        return;
+    }
+
+    Endpoint* const endpoint = reinterpret_cast<Endpoint*>(userData & ~3);
+    Connection* const connection = endpoint->connection;
+    --connection->operationsInFlight;
+    if (!connection->changed)
+    {
+        connection->changed = true;
+        changedConnections_.push_back(connection);
+    }
+
+    switch (operation)
+    {
+    case READ_OPERATION:
+        handleRead(endpoint, result);
+        break;
+    case WRITE_OPERATION:
+        handleWrite(endpoint, result);
+        break;
+    case CANCEL_OPERATION:
+    case WAKE_OPERATION:
+        break;
+    default:
+        assert(false && "Unknown io_uring operation");
+    }
+}
+
+
+void IoUringEventLoop::handleRead(
+    Endpoint* const endpoint,
+    const int32_t result
+)
+{
+    endpoint->reading = false;
+    Connection* const connection = endpoint->connection;
+    if (connection->closed)
+    {
+        return;
+    }
+
+    if (-EINTR == result || -EAGAIN == result)
+    {
+        submitRead(endpoint);
+        return;
+    }
+    else if (0 == result)
+    {
+        closeConnection(connection, endpoint);
+        return;
+    }
+    else if (result < 0)
+    {
+        Logger::log(Logger::ERROR)
+            << "IoUringEventLoop connection exited with error: "
+            << strerror(-result);
+        closeConnection(connection, endpoint);
+        return;
+    }
+
+    // The ProxyHalf can take the buffer, so replace it if it did
+    if (readData_.capacity() < PacketBufferPool::getBufferSize())
+    {
+        PacketBufferPool::acquire(&readData_);
+    }
+    readData_.assign(endpoint->readBuffer, endpoint->readBuffer + result);
+    try
+    {
+        endpoint->reader->handleReceivedData(readData_);
+    }
+    catch (ClosedException& e)
+    {
+        // All done, so nothing else to do
+        closeConnection(connection, nullptr);
+        return;
+    }
+    catch (exception& e)
+    {
+        Logger::log(Logger::ERROR)
+            << "IoUringEventLoop connection exited with error: "
+            << e.what();
+        closeConnection(connection, nullptr);
+        return;
+    }
+
+    // A ProxyHalf may have closed the connection itself
+    if (!endpoint->socket->isOpen() || !endpoint->peer->socket->isOpen())
+    {
+        closeConnection(connection, nullptr);
+    }
+}
+
+
+void IoUringEventLoop::handleWrite(
+    Endpoint* const endpoint,
+    const int32_t result
+)
+{
+    endpoint->writing = false;
+    if (endpoint->finished)
+    {
+        return;
+    }
+
+    if (-EINTR == result || -EAGAIN == result)
+    {
+        submitWrite(endpoint);
+        return;
+    }
+    else if (result <= 0)
+    {
+        if (-EPIPE != result && -ECONNRESET != result)
+        {
+            Logger::log(Logger::ERROR)
+                << "IoUringEventLoop connection exited with error: "
+                << strerror(-result);
+        }
+        closeConnection(endpoint->connection, endpoint);
+        return;
+    }
+
+    endpoint->writeOffset += result;
+    if (endpoint->writeOffset < endpoint->writeLength)
+    {
+        submitWrite(endpoint);
+    }
+}
+
+
+void IoUringEventLoop::updateConnection(Connection* const connection)
+{
+    Endpoint* const endpoints[] = {&connection->client, &connection->server};
+
+    // Write out anything that was queued while handling this batch
+    for (size_t i = 0; i < sizeof(endpoints) / sizeof(endpoints[0]); ++i)
+    {
+        Endpoint* const endpoint = endpoints[i];
+        if (
+            endpoint->writing
+            || endpoint->finished
+            || endpoint->writeOffset < endpoint->writeLength
+            || !endpoint->socket->isOpen()
+        )
+        {
+            continue;
+        }
+        endpoint->writeLength = endpoint->socket->takePendingOutput(
+            endpoint->writeBuffer,
+            WRITE_BUFFER_SIZE
+        );
+        endpoint->writeOffset = 0;
+        if (endpoint->writeLength > 0)
+        {
+            submitWrite(endpoint);
+        }
+    }
+
+    if (connection->closed)
+    {
+        return;
+    }
+
+    // Only read more once everything we've already read has been written,
+    // so that output can't pile up if the other side stops reading
+    for (size_t i = 0; i < sizeof(endpoints) / sizeof(endpoints[0]); ++i)
+    {
+        if (
+            endpoints[i]->writing
+            || endpoints[i]->socket->hasPendingOutput()
+        )
+        {
+            return;
+        }
+    }
+    for (size_t i = 0; i < sizeof(endpoints) / sizeof(endpoints[0]); ++i)
+    {
+        if (!endpoints[i]->reading)
+        {
+            submitRead(endpoints[i]);
+        }
+    }
+}
+
+
+void IoUringEventLoop::submitRead(Endpoint* const endpoint)
+{
+    Connection* const connection = endpoint->connection;
+    io_uring_sqe* const sqe = ring_->getSubmission();
+    if (ring_->buffersRegistered && connection->bufferSlot >= 0)
+    {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->buf_index = 0;
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_READ;
+    }
+    sqe->fd = endpoint->socket->getFileDescriptor();
+    sqe->addr = reinterpret_cast<uintptr_t>(endpoint->readBuffer);
+    sqe->len = READ_BUFFER_SIZE;
+    sqe->user_data = reinterpret_cast<uintptr_t>(endpoint) | READ_OPERATION;
+    endpoint->reading = true;
+    ++connection->operationsInFlight;
+}
+
+
+void IoUringEventLoop::submitWrite(Endpoint* const endpoint)
+{
+    Connection* const connection = endpoint->connection;
+    io_uring_sqe* const sqe = ring_->getSubmission();
+    if (ring_->buffersRegistered && connection->bufferSlot >= 0)
+    {
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->buf_index = 0;
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_WRITE;
+    }
+    sqe->fd = endpoint->socket->getFileDescriptor();
+    sqe->addr = reinterpret_cast<uintptr_t>(
+        endpoint->writeBuffer + endpoint->writeOffset
+    );
+    sqe->len = endpoint->writeLength - endpoint->writeOffset;
+    sqe->user_data = reinterpret_cast<uintptr_t>(endpoint) | WRITE_OPERATION;
+    endpoint->writing = true;
+    ++connection->operationsInFlight;
+}
+
+
+void IoUringEventLoop::submitCancel(
+    Endpoint* const endpoint,
+    const Operation operation
+)
+{
+    io_uring_sqe* const sqe = ring_->getSubmission();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uintptr_t>(endpoint) | operation;
+    sqe->user_data = reinterpret_cast<uintptr_t>(endpoint) | CANCEL_OPERATION;
+    ++endpoint->connection->operationsInFlight;
+}
+
+
+void IoUringEventLoop::submitWakeRead()
+{
+    io_uring_sqe* const sqe = ring_->getSubmission();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wakeFD_;
+    sqe->addr = reinterpret_cast<uintptr_t>(&wakeValue_);
+    sqe->len = sizeof(wakeValue_);
+    sqe->user_data = WAKE_OPERATION;
+}
+
+
+void IoUringEventLoop::closeConnection(
+    Connection* const connection,
+    Endpoint* const finished
+)
+{
+    if (!connection->closed)
+    {
+        connection->closed = true;
+        Logger::log(Logger::DEBUG) << "Client disconnected from event loop";
+    }
+
+    Endpoint* const endpoints[] = {&connection->client, &connection->server};
+    for (size_t i = 0; i < sizeof(endpoints) / sizeof(endpoints[0]); ++i)
+    {
+        Endpoint* const endpoint = endpoints[i];
+        if (
+            nullptr == finished
+            || finished == endpoint
+            || !endpoint->socket->isOpen()
+        )
+        {
+            endpoint->finished = true;
+        }
+        if (endpoint->reading)
+        {
+            submitCancel(endpoint, READ_OPERATION);
+        }
+        if (endpoint->finished && endpoint->writing)
+        {
+            submitCancel(endpoint, WRITE_OPERATION);
+        }
+    }
+
+    if (!connection->changed)
+    {
+        connection->changed = true;
+        changedConnections_.push_back(connection);
+    }
+}
+
+
+void IoUringEventLoop::destroyConnection(Connection* const connection)
+{
+    connections_.erase(connection);
+    if (connection->bufferSlot >= 0)
+    {
+        freeBufferSlots_.push_back(connection->bufferSlot);
+    }
+    else
+    {
+        delete [] connection->client.readBuffer;
+    }
+    delete connection->client.reader;
+    delete connection->server.reader;
+    delete connection->client.socket;
+    delete connection->server.socket;
+    delete connection;
+    __sync_fetch_and_sub(&connectionCount_, 1);
+}
+
+
+/**
+ * Creates the eventfd used to wake an IoUringEventLoop.
+ * @throw SocketException Unable to create the eventfd.
+ */
+int createWakeFD()
+{
+    const int wakeFD = eventfd(0, EFD_CLOEXEC);
+    if (wakeFD < 0)
+    {
+        throw SocketException(
+            errorString("Unable to create event loop wakeup", errno)
+        );
+    }
+    return wakeFD;
+}
+
+
+string errorString(const char* const message, const int error)
+{
+    string errorMessage(message);
+    errorMessage += ": ";
+    errorMessage += strerror(error);
+    return errorMessage;
+}
@@ -0,0 +1,201 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_IOURINGEVENTLOOP_HPP_
+#define SRC_IOURINGEVENTLOOP_HPP_
+
+#include "AutoPtrWithOperatorParens.hpp"
+#include "EventLoop.hpp"
+#include "ProxyHalf.hpp"
+#include "Socket.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include <memory>
+#include <set>
+#include <vector>
+
+/**
+ * EventLoop that uses io_uring. Instead of waiting for a Socket to become
+ * readable and then reading from it, reads and writes are queued up for the
+ * kernel to complete on its own, and every read and write that was queued
+ * while handling one batch of completions is submitted with a single system
+ * call, no matter how many connections they belong to. Reads and writes go
+ * through buffers that are registered with the kernel when it allows it, so
+ * that the kernel doesn't need to map them for every operation.
+ *
+ * Sockets are put into deferred output mode, so that any data a ProxyHalf
+ * sends is only queued; once a batch of completions has been handled, the
+ * queued data is copied into the connection's write buffer and submitted.
+ * Like EpollEventLoop, a connection isn't read from while it has output that
+ * hasn't been written yet.
+ *
+ * This talks to the kernel directly rather than depending on liburing.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class IoUringEventLoop : public EventLoop
+{
+public:
+    /**
+     * Returns true if the running kernel supports everything this needs.
+     */
+    static bool isSupported();
+
+    /**
+     * Default constructor. Starts the loop thread.
+     * @throw SocketException Unable to set up io_uring.
+     */
+    IoUringEventLoop();
+
+    /**
+     * Destructor. Stops the loop thread and closes all of its connections.
+     */
+    ~IoUringEventLoop();
+
+    virtual void addProxy(
+        AutoPtrWithOperatorParens<ProxyHalf> in,
+        AutoPtrWithOperatorParens<ProxyHalf> out,
+        std::auto_ptr<Socket> inSocket,
+        std::auto_ptr<Socket> outSocket
+    );
+
+    virtual size_t getConnectionCount() const;
+
+private:
+    struct Ring;
+    struct Connection;
+
+    /**
+     * One direction of a Connection: a Socket, the ProxyHalf that reads
+     * from it, and the buffers for its reads and writes.
+     */
+    struct Endpoint
+    {
+        Connection* connection;
+        Socket* socket;
+        ProxyHalf* reader;
+        Endpoint* peer;
+        uint8_t* readBuffer;
+        uint8_t* writeBuffer;
+        size_t writeOffset;
+        size_t writeLength;
+        bool reading;
+        bool writing;
+        bool finished;
+    };
+
+    struct Connection
+    {
+        Endpoint client;
+        Endpoint server;
+        /// Which section of the registered buffers this connection uses, or
+        /// -1 if it uses its own buffers
+        int bufferSlot;
+        int operationsInFlight;
+        bool closed;
+        bool changed;
+    };
+
+    /**
+     * The operation is stored in the low bits of each submission's user data;
+     * the rest holds the Endpoint pointer.
+     */
+    enum Operation
+    {
+        WAKE_OPERATION = 0,
+        READ_OPERATION = 1,
+        WRITE_OPERATION = 2,
+        CANCEL_OPERATION = 3
+    };
+
+    /**
+     * Submits queued operations and handles completions until the loop is
+     * stopped.
+     */
+    void run();
+
+    /**
+     * Starts reading from any connections that were handed over by other
+     * threads.
+     */
+    void registerNewConnections();
+
+    void handleCompletion(uint64_t userData, int32_t result);
+    void handleRead(Endpoint* endpoint, int32_t result);
+    void handleWrite(Endpoint* endpoint, int32_t result);
+
+    /**
+     * Starts writes for any newly queued output on a connection and restarts
+     * reads that were paused waiting for output to drain.
+     */
+    void updateConnection(Connection* connection);
+
+    void submitRead(Endpoint* endpoint);
+    void submitWrite(Endpoint* endpoint);
+    void submitCancel(Endpoint* endpoint, Operation operation);
+    void submitWakeRead();
+
+    /**
+     * Stops reading from a connection. Output that's still queued for an
+     * Endpoint that hasn't finished is still written. The connection is
+     * deleted once all of its operations have completed.
+     * @param finished The Endpoint whose Socket failed, or nullptr if both
+     *  are done.
+     */
+    void closeConnection(Connection* connection, Endpoint* finished);
+
+    void destroyConnection(Connection* connection);
+
+    static const unsigned RING_ENTRIES = 1024;
+    static const size_t READ_BUFFER_SIZE = 4096;
+    static const size_t WRITE_BUFFER_SIZE = 16384;
+    static const size_t REGISTERED_CONNECTIONS = 256;
+    // Each connection has a read and a write buffer for both Endpoints
+    static const size_t BUFFER_SLOT_SIZE =
+        2 * (READ_BUFFER_SIZE + WRITE_BUFFER_SIZE);
+
+    std::auto_ptr<Ring> ring_;
+    const int wakeFD_;
+    uint64_t wakeValue_;
+    volatile bool running_;
+    volatile size_t connectionCount_;
+
+    boost::mutex newConnectionsMutex_;
+    std::vector<Connection*> newConnections_;
+
+    // Only touched from the loop thread
+    std::set<Connection*> connections_;
+    std::vector<Connection*> changedConnections_;
+    std::vector<int> freeBufferSlots_;
+    // Reused for every read; see PacketBufferPool
+    std::vector<uint8_t> readData_;
+
+    // This needs to be the last member so that everything else is
+    // initialized before the loop thread starts
+    boost::thread thread_;
+
+    // ***** Hidden methods *****
+    IoUringEventLoop(const IoUringEventLoop&);
+    IoUringEventLoop& operator=(const IoUringEventLoop&);
+};
+
+#endif  // SRC_IOURINGEVENTLOOP_HPP_
@@ -0,0 +1,335 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MySqlAuthentication.hpp"
+#include "MySqlConstants.hpp"
+#include "Sha1.hpp"
+
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <cassert>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using std::copy;
+using std::ifstream;
+using std::string;
+using std::vector;
+
+static const char* const NATIVE_PASSWORD_PLUGIN = "mysql_native_password";
+
+const size_t MySqlAuthentication::HASH_LENGTH;
+const size_t MySqlAuthentication::SCRAMBLE_LENGTH;
+const size_t MySqlAuthentication::SCRAMBLE_FIRST_PART_LENGTH;
+const uint8_t MySqlAuthentication::PROTOCOL_VERSION;
+
+
+bool MySqlAuthentication::getScramble(
+    const uint8_t* const packet,
+    const size_t length,
+    vector<uint8_t>* const scramble
+)
+{
+    size_t firstPart;
+    size_t secondPart;
+    if (!findScramble(packet, length, &firstPart, &secondPart))
+    {
+        return false;
+    }
+    scramble->assign(
+        packet + firstPart,
+        packet + firstPart + SCRAMBLE_FIRST_PART_LENGTH
+    );
+    scramble->insert(
+        scramble->end(),
+        packet + secondPart,
+        packet + secondPart + SCRAMBLE_LENGTH - SCRAMBLE_FIRST_PART_LENGTH
+    );
+    return true;
+}
+
+
+void MySqlAuthentication::makeScramble(vector<uint8_t>* const scramble)
+{
+    scramble->resize(SCRAMBLE_LENGTH);
+    ifstream random("/dev/urandom", std::ios::binary);
+    for (size_t i = 0; i < SCRAMBLE_LENGTH; ++i)
+    {
+        char c;
+        if (!random.get(c))
+        {
+            c = static_cast<char>(rand());
+        }
+        // MySQL sticks to printable characters, and some clients expect that
+        (*scramble)[i] = '!' + static_cast<uint8_t>(c) % ('~' - '!' + 1);
+    }
+}
+
+
+bool MySqlAuthentication::clearCapabilities(
+    uint8_t* const packet,
+    const size_t length,
+    const uint32_t capabilities
+)
+{
+    size_t firstPart;
+    size_t secondPart;
+    if (!findScramble(packet, length, &firstPart, &secondPart))
+    {
+        return false;
+    }
+    // 8: scramble, 1: filler, 2: lower capabilities, 1: character set,
+    // 2: status, 2: upper capabilities
+    const size_t BEGIN_CAPABILITIES = firstPart + 8 + 1;
+    const size_t BEGIN_UPPER_CAPABILITIES = BEGIN_CAPABILITIES + 2 + 1 + 2;
+    packet[BEGIN_CAPABILITIES] &= ~static_cast<uint8_t>(capabilities);
+    packet[BEGIN_CAPABILITIES + 1] &= ~static_cast<uint8_t>(capabilities >> 8);
+    packet[BEGIN_UPPER_CAPABILITIES] &=
+        ~static_cast<uint8_t>(capabilities >> 16);
+    packet[BEGIN_UPPER_CAPABILITIES + 1] &=
+        ~static_cast<uint8_t>(capabilities >> 24);
+    return true;
+}
+
+
+bool MySqlAuthentication::prepareHandshake(
+    vector<uint8_t>* const handshake,
+    const vector<uint8_t>& scramble
+)
+{
+    assert(SCRAMBLE_LENGTH == scramble.size());
+    size_t firstPart;
+    size_t secondPart;
+    if (
+        !findScramble(
+            &(*handshake)[0],
+            handshake->size(),
+            &firstPart,
+            &secondPart
+        )
+    )
+    {
+        return false;
+    }
+    copy(
+        scramble.begin(),
+        scramble.begin() + SCRAMBLE_FIRST_PART_LENGTH,
+        handshake->begin() + firstPart
+    );
+    copy(
+        scramble.begin() + SCRAMBLE_FIRST_PART_LENGTH,
+        scramble.end(),
+        handshake->begin() + secondPart
+    );
+
+    // The pooled connections log in without OK packets instead of EOF
+    // packets, so clients can't ask for them either
+    clearCapabilities(
+        &(*handshake)[0],
+        handshake->size(),
+        MySqlConstants::CLIENT_SSL | MySqlConstants::CLIENT_DEPRECATE_EOF
+    );
+
+    // Newer servers name their authentication plugin after the scramble
+    const size_t BEGIN_PLUGIN =
+        secondPart + SCRAMBLE_LENGTH - SCRAMBLE_FIRST_PART_LENGTH + 1;
+    if (handshake->size() > BEGIN_PLUGIN)
+    {
+        handshake->resize(BEGIN_PLUGIN);
+        handshake->insert(
+            handshake->end(),
+            NATIVE_PASSWORD_PLUGIN,
+            NATIVE_PASSWORD_PLUGIN + strlen(NATIVE_PASSWORD_PLUGIN) + 1
+        );
+        const size_t payloadLength = handshake->size() - 3 - 1;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            (*handshake)[i] = static_cast<uint8_t>(payloadLength >> (8 * i));
+        }
+    }
+    return true;
+}
+
+
+void MySqlAuthentication::scramblePassword(
+    const vector<uint8_t>& passwordHash,
+    const vector<uint8_t>& scramble,
+    vector<uint8_t>* const token
+)
+{
+    token->clear();
+    if (passwordHash.empty())
+    {
+        return;
+    }
+
+    vector<uint8_t> storedHash;
+    sha1(&passwordHash[0], passwordHash.size(), &storedHash);
+    vector<uint8_t> salted(scramble);
+    salted.insert(salted.end(), storedHash.begin(), storedHash.end());
+    sha1(&salted[0], salted.size(), token);
+    for (size_t i = 0; i < HASH_LENGTH; ++i)
+    {
+        (*token)[i] ^= passwordHash[i];
+    }
+}
+
+
+bool MySqlAuthentication::recoverPasswordHash(
+    const vector<uint8_t>& token,
+    const vector<uint8_t>& scramble,
+    const vector<uint8_t>& storedHash,
+    vector<uint8_t>* const passwordHash
+)
+{
+    passwordHash->clear();
+    if (storedHash.empty() || token.empty())
+    {
+        return storedHash.empty() && token.empty();
+    }
+    if (HASH_LENGTH != token.size() || HASH_LENGTH != storedHash.size())
+    {
+        return false;
+    }
+
+    vector<uint8_t> salted(scramble);
+    salted.insert(salted.end(), storedHash.begin(), storedHash.end());
+    sha1(&salted[0], salted.size(), passwordHash);
+    for (size_t i = 0; i < HASH_LENGTH; ++i)
+    {
+        (*passwordHash)[i] ^= token[i];
+    }
+
+    // If the client got the password wrong, this won't match
+    vector<uint8_t> check;
+    sha1(&(*passwordHash)[0], passwordHash->size(), &check);
+    if (check != storedHash)
+    {
+        passwordHash->clear();
+        return false;
+    }
+    return true;
+}
+
+
+bool MySqlAuthentication::parseStoredHash(
+    const string& column,
+    vector<uint8_t>* const storedHash
+)
+{
+    storedHash->clear();
+    if (column.empty())
+    {
+        return true;
+    }
+    if (1 + 2 * HASH_LENGTH != column.size() || '*' != column[0])
+    {
+        return false;
+    }
+    for (size_t i = 1; i < column.size(); i += 2)
+    {
+        uint8_t byte = 0;
+        for (size_t j = i; j < i + 2; ++j)
+        {
+            const char c = toupper(column[j]);
+            byte <<= 4;
+            if (c >= '0' && c <= '9')
+            {
+                byte |= c - '0';
+            }
+            else if (c >= 'A' && c <= 'F')
+            {
+                byte |= c - 'A' + 10;
+            }
+            else
+            {
+                storedHash->clear();
+                return false;
+            }
+        }
+        storedHash->push_back(byte);
+    }
+    return true;
+}
+
+
+void MySqlAuthentication::sha1(
+    const uint8_t* const data,
+    const size_t length,
+    vector<uint8_t>* const hash
+)
+{
+    Sha1 hasher;
+    hasher.update(data, length);
+    hash->resize(HASH_LENGTH);
+    hasher.finish(&(*hash)[0]);
+}
+
+
+bool MySqlAuthentication::findScramble(
+    const uint8_t* const packet,
+    const size_t length,
+    size_t* const firstPart,
+    size_t* const secondPart
+)
+{
+    /*--------------------------------------
+    Handshake packets look like this:
+    Bytes - Description
+    3 - payload length
+    1 - packet number
+    1 - protocol version, 10
+    n - null-terminated server version
+    4 - thread id
+    8 - first part of the scramble
+    1 - filler, always 0
+    2 - server capabilities
+    1 - character set
+    2 - server status
+    13 - filler
+    12 - rest of the scramble, then a 0
+    n - (optional) null-terminated authentication plugin name
+    --------------------------------------*/
+    // 3: payload length, 1: packet number
+    const size_t BEGIN_PROTOCOL_VERSION = 3 + 1;
+    if (
+        length <= BEGIN_PROTOCOL_VERSION
+        || PROTOCOL_VERSION != packet[BEGIN_PROTOCOL_VERSION]
+    )
+    {
+        return false;
+    }
+    size_t i = BEGIN_PROTOCOL_VERSION + 1;
+    while (i < length && '\0' != packet[i])
+    {
+        ++i;
+    }
+    // Past the version string and the thread id
+    *firstPart = i + 1 + 4;
+    // 8: scramble, 1: filler, 2: capabilities, 1: character set,
+    // 2: status, 13: filler
+    *secondPart = *firstPart + 8 + 1 + 2 + 1 + 2 + 13;
+    return *secondPart + SCRAMBLE_LENGTH - SCRAMBLE_FIRST_PART_LENGTH
+        <= length;
+}
@@ -0,0 +1,156 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_MYSQLAUTHENTICATION_HPP_
+#define SRC_MYSQLAUTHENTICATION_HPP_
+
+#include <boost/cstdint.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * The arithmetic behind MySQL's mysql_native_password logins. The server
+ * sends a random 20 byte scramble, the client answers with
+ * SHA1(password) XOR SHA1(scramble + SHA1(SHA1(password))), and the server
+ * checks that against the SHA1(SHA1(password)) that it keeps in mysql.user.
+ * Knowing the stored hash lets SQLassie recover SHA1(password) from a
+ * client's answer, which is enough to log that client in to other servers,
+ * e.g. replicas, without ever seeing the password itself.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class MySqlAuthentication
+{
+public:
+    /**
+     * Reads the scramble out of a server's handshake packet.
+     * @param packet The whole handshake packet, header included.
+     * @param length The length of the packet.
+     * @param scramble Filled with the scramble.
+     * @return False if the packet isn't a protocol 10 handshake.
+     */
+    static bool getScramble(
+        const uint8_t* packet,
+        size_t length,
+        std::vector<uint8_t>* scramble
+    );
+
+    /**
+     * Makes a new random scramble, for handshakes that SQLassie sends to
+     * clients itself.
+     */
+    static void makeScramble(std::vector<uint8_t>* scramble);
+
+    /**
+     * Stops a server's handshake from offering some capabilities, so that
+     * the client doesn't ask for them.
+     * @param packet The whole handshake packet, header included.
+     * @param length The length of the packet.
+     * @param capabilities The CLIENT_ flags from MySqlConstants to clear.
+     * @return False if the packet isn't a protocol 10 handshake.
+     */
+    static bool clearCapabilities(
+        uint8_t* packet,
+        size_t length,
+        uint32_t capabilities
+    );
+
+    /**
+     * Turns a server's handshake into one that SQLassie can send to a
+     * client itself: the scramble is replaced, SSL and OK packets instead
+     * of EOF packets aren't offered and mysql_native_password is asked
+     * for.
+     * @param handshake The whole handshake packet, header included.
+     * @param scramble The scramble to put in it.
+     * @return False if the packet isn't a protocol 10 handshake.
+     */
+    static bool prepareHandshake(
+        std::vector<uint8_t>* handshake,
+        const std::vector<uint8_t>& scramble
+    );
+
+    /**
+     * Computes the answer to a scramble.
+     * @param passwordHash SHA1(password), or empty for no password.
+     * @param scramble The server's scramble.
+     * @param token Filled with the answer, which is empty if the password
+     *  is.
+     */
+    static void scramblePassword(
+        const std::vector<uint8_t>& passwordHash,
+        const std::vector<uint8_t>& scramble,
+        std::vector<uint8_t>* token
+    );
+
+    /**
+     * Recovers SHA1(password) from a client's answer to a scramble.
+     * @param token The client's answer.
+     * @param scramble The scramble that the client answered.
+     * @param storedHash SHA1(SHA1(password)), or empty for no password.
+     * @param passwordHash Filled with SHA1(password).
+     * @return False if the answer doesn't match the stored hash.
+     */
+    static bool recoverPasswordHash(
+        const std::vector<uint8_t>& token,
+        const std::vector<uint8_t>& scramble,
+        const std::vector<uint8_t>& storedHash,
+        std::vector<uint8_t>* passwordHash
+    );
+
+    /**
+     * Converts the hash from mysql.user's Password column, e.g.
+     * "*2470C0C06DEE42FD1618BB99005ADCA2EC9D1E19", to bytes.
+     * @return False if it isn't a mysql_native_password hash.
+     */
+    static bool parseStoredHash(
+        const std::string& column,
+        std::vector<uint8_t>* storedHash
+    );
+
+    /**
+     * Computes the SHA1 hash of some data.
+     */
+    static void sha1(
+        const uint8_t* data,
+        size_t length,
+        std::vector<uint8_t>* hash
+    );
+
+    static const size_t HASH_LENGTH = 20;
+    static const size_t SCRAMBLE_LENGTH = 20;
+    static const uint8_t PROTOCOL_VERSION = 10;
+
+private:
+    /**
+     * Finds the two parts of the scramble in a handshake packet.
+     * @return False if the packet isn't a protocol 10 handshake.
+     */
+    static bool findScramble(
+        const uint8_t* packet,
+        size_t length,
+        size_t* firstPart,
+        size_t* secondPart
+    );
+
+    static const size_t SCRAMBLE_FIRST_PART_LENGTH = 8;
+};
+
+#endif  // SRC_MYSQLAUTHENTICATION_HPP_
@@ -0,0 +1,495 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Logger.hpp"
+#include "MySqlAuthentication.hpp"
+#include "MySqlBackendConnection.hpp"
+#include "MySqlConstants.hpp"
+#include "MySqlPacketReader.hpp"
+#include "MySqlSocket.hpp"
+#include "nullptr.hpp"
+#include "PacketBufferPool.hpp"
+#include "SocketException.hpp"
+
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using std::min;
+using std::string;
+using std::vector;
+
+static const uint8_t RESULT_OK = 0x00;
+static const uint8_t RESULT_LOCAL_INFILE = 0xFB;
+static const uint8_t RESULT_EOF = 0xFE;
+static const uint8_t RESULT_ERROR = 0xFF;
+// Rows can start with 0xFE too, but then they're at least this long
+static const size_t MIN_ROW_LENGTH = 9;
+static const char* const NATIVE_PASSWORD_PLUGIN = "mysql_native_password";
+
+
+MySqlBackendConnection::MySqlBackendConnection(
+    const uint16_t port,
+    const string& host,
+    const int connectTimeoutMilliseconds
+) :
+    socket_(new MySqlSocket(port, host, true, connectTimeoutMilliseconds)),
+    reader_(),
+    received_(),
+    message_(),
+    discarded_(),
+    output_(),
+    handshake_(),
+    handshakeRead_(false),
+    serverStatus_(MySqlConstants::STATUS_AUTO_COMMIT)
+{
+}
+
+
+MySqlBackendConnection::MySqlBackendConnection(const string& domainSocket) :
+    socket_(new MySqlSocket(domainSocket)),
+    reader_(),
+    received_(),
+    message_(),
+    discarded_(),
+    output_(),
+    handshake_(),
+    handshakeRead_(false),
+    serverStatus_(MySqlConstants::STATUS_AUTO_COMMIT)
+{
+}
+
+
+MySqlBackendConnection::~MySqlBackendConnection()
+{
+    socket_->close();
+    PacketBufferPool::release(&received_);
+    releasePackets(&message_);
+    releasePackets(&discarded_);
+}
+
+
+bool MySqlBackendConnection::logIn(
+    const string& user,
+    const vector<uint8_t>& passwordHash,
+    const uint8_t characterSet,
+    const string& database
+)
+{
+    const vector<uint8_t>& handshake = readHandshake();
+    if (handshake.empty())
+    {
+        return false;
+    }
+    vector<uint8_t> scramble;
+    if (
+        !MySqlAuthentication::getScramble(
+            &handshake[0],
+            handshake.size(),
+            &scramble
+        )
+    )
+    {
+        Logger::log(Logger::WARN) << "Unsupported MySQL handshake";
+        return false;
+    }
+    uint8_t sequence = handshake.at(3) + 1;
+
+    /*-----------------------------------------------
+    Authentication packets look like this:
+    Bytes - Description
+    4 - client flags
+    4 - max packet size
+    1 - charset number
+    23 - filler, always 0x00
+    n - null-terminated username string
+    n - length coded password
+    n - (optional) null-terminated database string
+    -----------------------------------------------*/
+    uint32_t flags =
+        MySqlConstants::CLIENT_LONG_PASSWORD
+        | MySqlConstants::CLIENT_LONG_FLAG
+        | MySqlConstants::CLIENT_PROTOCOL_41
+        | MySqlConstants::CLIENT_TRANSACTIONS
+        | MySqlConstants::CLIENT_SECURE_CONNECTION
+        | MySqlConstants::CLIENT_MULTI_RESULTS;
+    if (!database.empty())
+    {
+        flags |= MySqlConstants::CLIENT_CONNECT_WITH_DB;
+    }
+    const uint32_t maxPacketSize = MySqlPacketReader::MAX_PAYLOAD_LENGTH;
+    vector<uint8_t> payload;
+    for (int i = 0; i < 4; ++i)
+    {
+        payload.push_back(static_cast<uint8_t>(flags >> (8 * i)));
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        payload.push_back(static_cast<uint8_t>(maxPacketSize >> (8 * i)));
+    }
+    payload.push_back(characterSet);
+    payload.resize(payload.size() + 23, 0);
+    payload.insert(payload.end(), user.begin(), user.end());
+    payload.push_back('\0');
+    vector<uint8_t> token;
+    MySqlAuthentication::scramblePassword(passwordHash, scramble, &token);
+    payload.push_back(static_cast<uint8_t>(token.size()));
+    payload.insert(payload.end(), token.begin(), token.end());
+    if (!database.empty())
+    {
+        payload.insert(payload.end(), database.begin(), database.end());
+        payload.push_back('\0');
+    }
+    output_.clear();
+    appendPackets(payload, sequence, &output_);
+    socket_->send(output_);
+
+    releasePackets(&discarded_);
+    uint8_t result = readMessage(&discarded_);
+    if (RESULT_EOF == result)
+    {
+        // The server wants us to use another plugin; only answer if it's the
+        // one that we know, with the new scramble that it sent
+        const vector<uint8_t>& request = discarded_.front();
+        const size_t BEGIN_PLUGIN = MySqlPacketReader::HEADER_LENGTH + 1;
+        const size_t pluginLength = strlen(NATIVE_PASSWORD_PLUGIN);
+        if (
+            request.size() < BEGIN_PLUGIN + pluginLength + 1
+                + MySqlAuthentication::SCRAMBLE_LENGTH
+            || 0 != memcmp(
+                &request[BEGIN_PLUGIN],
+                NATIVE_PASSWORD_PLUGIN,
+                pluginLength + 1
+            )
+        )
+        {
+            Logger::log(Logger::WARN)
+                << "MySQL asked for an unsupported authentication plugin";
+            return false;
+        }
+        const vector<uint8_t>::const_iterator scrambleBegin =
+            request.begin() + BEGIN_PLUGIN + pluginLength + 1;
+        scramble.assign(
+            scrambleBegin,
+            scrambleBegin + MySqlAuthentication::SCRAMBLE_LENGTH
+        );
+        MySqlAuthentication::scramblePassword(passwordHash, scramble, &token);
+        sequence = request.at(3) + 1;
+        output_.clear();
+        appendPackets(token, sequence, &output_);
+        socket_->send(output_);
+
+        releasePackets(&discarded_);
+        result = readMessage(&discarded_);
+    }
+    if (RESULT_OK != result)
+    {
+        releasePackets(&discarded_);
+        return false;
+    }
+    MySqlPacketReader::getStatusFlags(
+        &discarded_.front()[0],
+        discarded_.front().size(),
+        &serverStatus_
+    );
+    releasePackets(&discarded_);
+    return true;
+}
+
+
+const vector<uint8_t>& MySqlBackendConnection::readHandshake()
+{
+    if (!handshakeRead_)
+    {
+        handshakeRead_ = true;
+        releasePackets(&discarded_);
+        // The server refuses connections, e.g. when it has too many, by
+        // sending an error instead of a handshake
+        if (RESULT_ERROR != readMessage(&discarded_))
+        {
+            handshake_ = discarded_.front();
+        }
+        releasePackets(&discarded_);
+    }
+    return handshake_;
+}
+
+
+bool MySqlBackendConnection::runCommand(
+    const uint8_t commandCode,
+    const string& argument,
+    vector<vector<uint8_t> >* const response
+)
+{
+    vector<uint8_t> payload;
+    payload.reserve(1 + argument.size());
+    payload.push_back(commandCode);
+    payload.insert(payload.end(), argument.begin(), argument.end());
+    output_.clear();
+    appendPackets(payload, 0, &output_);
+    socket_->send(output_);
+    return readResponse(response);
+}
+
+
+bool MySqlBackendConnection::runCommand(
+    const vector<vector<uint8_t> >& packets,
+    vector<vector<uint8_t> >* const response
+)
+{
+    assert(!packets.empty() && nullptr != response);
+    socket_->send(packets);
+    if (packets.front().size() <= MySqlPacketReader::HEADER_LENGTH)
+    {
+        return readResponse(response);
+    }
+    switch (packets.front()[MySqlPacketReader::HEADER_LENGTH])
+    {
+        // The server doesn't answer these
+        case MySqlConstants::COM_STMT_CLOSE:
+        case MySqlConstants::COM_STMT_SEND_LONG_DATA:
+            return true;
+
+        // One EOF, OK or error packet, or a line of text
+        case MySqlConstants::COM_DEBUG:
+        case MySqlConstants::COM_SET_OPTION:
+        case MySqlConstants::COM_STATISTICS:
+            return RESULT_ERROR != readMessage(response);
+
+        // Column definitions or rows without the rest of a result set
+        case MySqlConstants::COM_FIELD_LIST:
+        case MySqlConstants::COM_STMT_FETCH:
+            return readUntilEof(1, response);
+
+        case MySqlConstants::COM_STMT_PREPARE:
+            return readPrepareResponse(response);
+
+        default:
+            return readResponse(response);
+    }
+}
+
+
+void MySqlBackendConnection::close()
+{
+    if (!socket_->isOpen())
+    {
+        return;
+    }
+    try
+    {
+        // 3: payload length, 1: packet number, 1: command
+        const uint8_t quit[] = {
+            0x01, 0x00, 0x00,
+            0x00,
+            MySqlConstants::COM_QUIT
+        };
+        socket_->send(quit, sizeof(quit));
+    }
+    catch (SocketException&)
+    {
+        // It's going away anyway
+    }
+    socket_->close();
+}
+
+
+bool MySqlBackendConnection::readResponse(
+    vector<vector<uint8_t> >* response
+)
+{
+    // Callers that don't care about the response still have to read it
+    if (nullptr == response)
+    {
+        releasePackets(&discarded_);
+        response = &discarded_;
+    }
+
+    while (true)
+    {
+        const uint8_t result = readMessage(response);
+        if (RESULT_ERROR == result)
+        {
+            return false;
+        }
+        else if (RESULT_LOCAL_INFILE == result)
+        {
+            // Nobody is going to send a file to a connection like this
+            throw SocketException("Unexpected LOCAL INFILE request");
+        }
+        else if (RESULT_OK != result)
+        {
+            // The column definitions and the rows each end with an EOF
+            if (!readUntilEof(2, response))
+            {
+                return false;
+            }
+        }
+
+        const vector<uint8_t>& last = response->back();
+        if (
+            !MySqlPacketReader::getStatusFlags(
+                &last[0],
+                last.size(),
+                &serverStatus_
+            )
+        )
+        {
+            Logger::log(Logger::WARN)
+                << "Unable to read the status of a MySQL response";
+            return true;
+        }
+        // The real name of this flag is SERVER_MORE_RESULTS_EXISTS
+        if (0 == (serverStatus_ & MySqlConstants::STATUS_MULTI_QUERY))
+        {
+            return true;
+        }
+    }
+}
+
+
+bool MySqlBackendConnection::readUntilEof(
+    int eofPackets,
+    vector<vector<uint8_t> >* const response
+)
+{
+    while (eofPackets > 0)
+    {
+        const size_t packet = response->size();
+        const uint8_t type = readMessage(response);
+        if (RESULT_ERROR == type)
+        {
+            return false;
+        }
+        if (
+            RESULT_EOF == type
+            && (*response)[packet].size()
+                < MySqlPacketReader::HEADER_LENGTH + MIN_ROW_LENGTH
+        )
+        {
+            --eofPackets;
+        }
+    }
+    return true;
+}
+
+
+bool MySqlBackendConnection::readPrepareResponse(
+    vector<vector<uint8_t> >* const response
+)
+{
+    const size_t first = response->size();
+    if (RESULT_ERROR == readMessage(response))
+    {
+        return false;
+    }
+    // 1: status, 4: statement ID, 2: columns, 2: parameters
+    const vector<uint8_t>& ok = (*response)[first];
+    const size_t BEGIN_COLUMNS = MySqlPacketReader::HEADER_LENGTH + 1 + 4;
+    if (ok.size() < BEGIN_COLUMNS + 2 + 2)
+    {
+        throw SocketException("Short COM_STMT_PREPARE response from MySQL");
+    }
+    const int columns = ok[BEGIN_COLUMNS] | (ok[BEGIN_COLUMNS + 1] << 8);
+    const int parameters =
+        ok[BEGIN_COLUMNS + 2] | (ok[BEGIN_COLUMNS + 3] << 8);
+    // Each list of definitions that's there ends with an EOF
+    const int eofPackets = (columns > 0 ? 1 : 0) + (parameters > 0 ? 1 : 0);
+    return readUntilEof(eofPackets, response);
+}
+
+
+uint8_t MySqlBackendConnection::readMessage(
+    vector<vector<uint8_t> >* const packets
+)
+{
+    while (!reader_.nextMessage(&message_))
+    {
+        if (received_.capacity() < PacketBufferPool::getBufferSize())
+        {
+            PacketBufferPool::acquire(&received_);
+        }
+        socket_->receive(&received_);
+        reader_.append(&received_);
+    }
+
+    assert(!message_.empty());
+    if (message_.front().size() <= MySqlPacketReader::HEADER_LENGTH)
+    {
+        throw SocketException("Empty packet from MySQL");
+    }
+    const uint8_t result = message_.front()[MySqlPacketReader::HEADER_LENGTH];
+    for (size_t i = 0; i < message_.size(); ++i)
+    {
+        packets->push_back(vector<uint8_t>());
+        packets->back().swap(message_[i]);
+    }
+    message_.clear();
+    return result;
+}
+
+
+uint8_t MySqlBackendConnection::appendPackets(
+    const vector<uint8_t>& payload,
+    uint8_t sequence,
+    vector<uint8_t>* const output
+)
+{
+    size_t offset = 0;
+    // A payload that fills a packet exactly is ended with an empty one
+    do
+    {
+        const size_t length = min(
+            payload.size() - offset,
+            static_cast<size_t>(MySqlPacketReader::MAX_PAYLOAD_LENGTH)
+        );
+        output->push_back(static_cast<uint8_t>(length));
+        output->push_back(static_cast<uint8_t>(length >> 8));
+        output->push_back(static_cast<uint8_t>(length >> 16));
+        output->push_back(sequence);
+        ++sequence;
+        output->insert(
+            output->end(),
+            payload.begin() + offset,
+            payload.begin() + offset + length
+        );
+        offset += length;
+        if (MySqlPacketReader::MAX_PAYLOAD_LENGTH != length)
+        {
+            break;
+        }
+    } while (true);
+    return sequence;
+}
+
+
+void MySqlBackendConnection::releasePackets(
+    vector<vector<uint8_t> >* const packets
+)
+{
+    for (size_t i = 0; i < packets->size(); ++i)
+    {
+        PacketBufferPool::release(&(*packets)[i]);
+    }
+    packets->clear();
+}
@@ -0,0 +1,195 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_MYSQLBACKENDCONNECTION_HPP_
+#define SRC_MYSQLBACKENDCONNECTION_HPP_
+
+#include "MySqlPacketReader.hpp"
+class MySqlSocket;
+
+#include <boost/cstdint.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A connection to a MySQL server that SQLassie logs in to and talks to
+ * itself, instead of relaying a client's handshake, e.g. a connection to a
+ * replica. Commands are run synchronously: each one is sent and its whole
+ * response is read before returning, so this should only be used from
+ * threads that are allowed to block.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class MySqlBackendConnection
+{
+public:
+    /**
+     * Connects to a server over the network.
+     * @param port The port that MySQL is listening on.
+     * @param host The host that MySQL is running on.
+     * @param connectTimeoutMilliseconds Give up connecting after this long.
+     * @throw SocketException Unable to connect.
+     */
+    MySqlBackendConnection(
+        uint16_t port,
+        const std::string& host,
+        int connectTimeoutMilliseconds
+    );
+
+    /**
+     * Connects to a server on a Unix domain socket.
+     * @param domainSocket The domain socket that MySQL is listening on.
+     * @throw SocketException Unable to connect.
+     */
+    explicit MySqlBackendConnection(const std::string& domainSocket);
+
+    ~MySqlBackendConnection();
+
+    /**
+     * Reads the server's handshake, if it hasn't been read yet.
+     * @return The whole handshake packet, or an empty one if the server
+     *  refused the connection.
+     * @throw SocketException
+     */
+    const std::vector<uint8_t>& readHandshake();
+
+    /**
+     * Reads the server's handshake and logs in with mysql_native_password.
+     * @param user The user to log in as.
+     * @param passwordHash SHA1(password), or empty for no password.
+     * @param characterSet The character set number to ask for.
+     * @param database The database to start in, or empty for none.
+     * @return False if the server refused the login.
+     * @throw SocketException
+     */
+    bool logIn(
+        const std::string& user,
+        const std::vector<uint8_t>& passwordHash,
+        uint8_t characterSet,
+        const std::string& database
+    );
+
+    /**
+     * Sends a command and reads its whole response.
+     * @param commandCode The MySQL command, e.g. COM_QUERY.
+     * @param argument The rest of the command, e.g. the query.
+     * @param response If set, filled with the packets of the response,
+     *  headers included. The buffers come from PacketBufferPool.
+     * @return False if the server answered with an error.
+     * @throw SocketException
+     */
+    bool runCommand(
+        uint8_t commandCode,
+        const std::string& argument,
+        std::vector<std::vector<uint8_t> >* response
+    );
+
+    /**
+     * Sends a command that's already split into packets, e.g. one that was
+     * received from a client, and reads its whole response. Commands that
+     * the server doesn't answer, like COM_STMT_CLOSE, return right away.
+     * @param packets The packets of the command, headers included.
+     * @param response Filled with the packets of the response.
+     * @return False if the server answered with an error.
+     * @throw SocketException
+     */
+    bool runCommand(
+        const std::vector<std::vector<uint8_t> >& packets,
+        std::vector<std::vector<uint8_t> >* response
+    );
+
+    /**
+     * Returns the server status flags from the last OK or EOF packet.
+     */
+    inline uint16_t getServerStatus() const { return serverStatus_; }
+
+    /**
+     * Tells the server that we're leaving and closes the connection.
+     */
+    void close();
+
+private:
+    /**
+     * Reads the response to a command.
+     * @return False if the server answered with an error.
+     * @throw SocketException
+     */
+    bool readResponse(std::vector<std::vector<uint8_t> >* response);
+
+    /**
+     * Reads packets until a number of EOF packets have been read, e.g. the
+     * column definitions and rows of a result set.
+     * @return False if the server answered with an error.
+     * @throw SocketException
+     */
+    bool readUntilEof(
+        int eofPackets,
+        std::vector<std::vector<uint8_t> >* response
+    );
+
+    /**
+     * Reads the response to COM_STMT_PREPARE, which is followed by the
+     * parameter and column definitions.
+     * @return False if the server answered with an error.
+     * @throw SocketException
+     */
+    bool readPrepareResponse(std::vector<std::vector<uint8_t> >* response);
+
+    /**
+     * Reads the next logical message and appends its packets to a list.
+     * @return The first byte of the message's payload.
+     * @throw SocketException
+     */
+    uint8_t readMessage(std::vector<std::vector<uint8_t> >* packets);
+
+    /**
+     * Appends a payload to a buffer as packets, splitting it where it's too
+     * long for one packet.
+     * @return The sequence number after the last packet.
+     */
+    static uint8_t appendPackets(
+        const std::vector<uint8_t>& payload,
+        uint8_t sequence,
+        std::vector<uint8_t>* output
+    );
+
+    /**
+     * Gives the buffers in a list of packets back to the pool and clears it.
+     */
+    static void releasePackets(std::vector<std::vector<uint8_t> >* packets);
+
+    std::auto_ptr<MySqlSocket> socket_;
+    MySqlPacketReader reader_;
+    std::vector<uint8_t> received_;
+    std::vector<std::vector<uint8_t> > message_;
+    std::vector<std::vector<uint8_t> > discarded_;
+    std::vector<uint8_t> output_;
+    std::vector<uint8_t> handshake_;
+    bool handshakeRead_;
+    uint16_t serverStatus_;
+
+    // ***** Hidden methods *****
+    MySqlBackendConnection(const MySqlBackendConnection&);
+    MySqlBackendConnection& operator=(const MySqlBackendConnection&);
+};
+
+#endif  // SRC_MYSQLBACKENDCONNECTION_HPP_
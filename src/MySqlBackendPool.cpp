@@ -0,0 +1,400 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Logger.hpp"
+#include "MySqlAuthentication.hpp"
+#include "MySqlBackendConnection.hpp"
+#include "MySqlBackendPool.hpp"
+#include "MySqlSocket.hpp"
+#include "nullptr.hpp"
+#include "SocketException.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <cassert>
+#include <memory>
+#include <poll.h>
+#include <string>
+#include <vector>
+
+using boost::lexical_cast;
+using boost::lock_guard;
+using boost::mutex;
+using std::auto_ptr;
+using std::string;
+using std::vector;
+
+const int MySqlBackendPool::DEFAULT_CONNECT_TIMEOUT;
+const int MySqlBackendPool::DEFAULT_HEALTH_CHECK_INTERVAL;
+
+// utf8_general_ci; health checks don't send any text
+static const uint8_t HEALTH_CHECK_CHARACTER_SET = 33;
+
+
+MySqlBackendPool::Backend::Backend(
+    const string& backendHost,
+    const uint16_t backendPort,
+    const unsigned backendWeight
+) :
+    host(backendHost),
+    port(backendPort),
+    weight(backendWeight),
+    healthy(true),
+    connections(0)
+{
+}
+
+
+MySqlBackendPool::MySqlBackendPool(const int connectTimeoutMilliseconds) :
+    backends_(),
+    next_(0),
+    connectTimeoutMilliseconds_(connectTimeoutMilliseconds),
+    healthCheckUser_(),
+    healthCheckPasswordHash_(),
+    mutex_(),
+    healthThread_()
+{
+}
+
+
+MySqlBackendPool::~MySqlBackendPool()
+{
+    if (healthThread_.joinable())
+    {
+        healthThread_.interrupt();
+        healthThread_.join();
+    }
+}
+
+
+void MySqlBackendPool::addBackend(
+    const string& host,
+    const uint16_t port,
+    const unsigned weight
+)
+{
+    assert(weight > 0);
+    const Backend backend(host, port, weight);
+
+    lock_guard<mutex> lg(mutex_);
+    backends_.push_back(backend);
+}
+
+
+bool MySqlBackendPool::parseBackend(
+    const string& backend,
+    string* const host,
+    uint16_t* const port,
+    unsigned* const weight
+)
+{
+    const size_t portStart = backend.find(':');
+    if (string::npos == portStart || 0 == portStart)
+    {
+        return false;
+    }
+    const size_t weightStart = backend.find(':', portStart + 1);
+    try
+    {
+        const int portNumber = lexical_cast<int>(
+            backend.substr(portStart + 1, weightStart - portStart - 1)
+        );
+        int weightNumber = 1;
+        if (string::npos != weightStart)
+        {
+            weightNumber = lexical_cast<int>(backend.substr(weightStart + 1));
+        }
+        if (
+            portNumber < 1 || portNumber > 65535
+            || weightNumber < 1 || weightNumber > 1000
+        )
+        {
+            return false;
+        }
+        *host = backend.substr(0, portStart);
+        *port = static_cast<uint16_t>(portNumber);
+        *weight = static_cast<unsigned>(weightNumber);
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+        return false;
+    }
+    return true;
+}
+
+
+size_t MySqlBackendPool::size() const
+{
+    lock_guard<mutex> lg(mutex_);
+    return backends_.size();
+}
+
+
+int MySqlBackendPool::acquire()
+{
+    lock_guard<mutex> lg(mutex_);
+    int best = -1;
+    for (size_t i = 0; i < backends_.size(); ++i)
+    {
+        const size_t index = (next_ + i) % backends_.size();
+        const Backend& backend = backends_[index];
+        if (!backend.healthy)
+        {
+            continue;
+        }
+        // Compare connections / weight without dividing
+        if (
+            -1 == best
+            || backend.connections * backends_[best].weight
+                < backends_[best].connections * backend.weight
+        )
+        {
+            best = index;
+        }
+    }
+    if (-1 != best)
+    {
+        ++backends_[best].connections;
+        next_ = best + 1;
+    }
+    return best;
+}
+
+
+void MySqlBackendPool::release(const int backend)
+{
+    lock_guard<mutex> lg(mutex_);
+    assert(backend >= 0 && static_cast<size_t>(backend) < backends_.size());
+    assert(backends_[backend].connections > 0);
+    --backends_[backend].connections;
+}
+
+
+MySqlBackendConnection* MySqlBackendPool::connect(const int backend)
+{
+    string host;
+    uint16_t port;
+    {
+        lock_guard<mutex> lg(mutex_);
+        assert(backend >= 0 && static_cast<size_t>(backend) < backends_.size());
+        host = backends_[backend].host;
+        port = backends_[backend].port;
+    }
+
+    try
+    {
+        return new MySqlBackendConnection(
+            port,
+            host,
+            connectTimeoutMilliseconds_
+        );
+    }
+    catch (SocketException& e)
+    {
+        Logger::log(Logger::WARN)
+            << "Unable to connect to "
+            << host
+            << ':'
+            << port
+            << ": "
+            << e.what();
+        markDown(backend);
+        return nullptr;
+    }
+}
+
+
+void MySqlBackendPool::markDown(const int backend)
+{
+    lock_guard<mutex> lg(mutex_);
+    assert(backend >= 0 && static_cast<size_t>(backend) < backends_.size());
+    if (backends_[backend].healthy)
+    {
+        backends_[backend].healthy = false;
+        Logger::log(Logger::WARN)
+            << "Taking "
+            << backends_[backend].host
+            << ':'
+            << backends_[backend].port
+            << " out of rotation";
+    }
+}
+
+
+bool MySqlBackendPool::isHealthy(const int backend) const
+{
+    lock_guard<mutex> lg(mutex_);
+    return backends_.at(backend).healthy;
+}
+
+
+size_t MySqlBackendPool::getConnectionCount(const int backend) const
+{
+    lock_guard<mutex> lg(mutex_);
+    return backends_.at(backend).connections;
+}
+
+
+void MySqlBackendPool::setHealthCheckLogin(
+    const string& user,
+    const string& password
+)
+{
+    lock_guard<mutex> lg(mutex_);
+    healthCheckUser_ = user;
+    healthCheckPasswordHash_.clear();
+    if (!password.empty())
+    {
+        MySqlAuthentication::sha1(
+            reinterpret_cast<const uint8_t*>(password.c_str()),
+            password.size(),
+            &healthCheckPasswordHash_
+        );
+    }
+}
+
+
+void MySqlBackendPool::checkHealth()
+{
+    vector<Backend> backends;
+    {
+        lock_guard<mutex> lg(mutex_);
+        backends = backends_;
+    }
+
+    // Don't hold the lock while waiting on the network
+    vector<bool> healthy(backends.size());
+    for (size_t i = 0; i < backends.size(); ++i)
+    {
+        healthy[i] = probe(backends[i].host, backends[i].port);
+    }
+
+    lock_guard<mutex> lg(mutex_);
+    for (size_t i = 0; i < backends.size(); ++i)
+    {
+        if (healthy[i] != backends_[i].healthy)
+        {
+            Logger::log(healthy[i] ? Logger::INFO : Logger::WARN)
+                << (healthy[i] ? "Putting " : "Taking ")
+                << backends_[i].host
+                << ':'
+                << backends_[i].port
+                << (healthy[i] ? " back into" : " out of")
+                << " rotation";
+        }
+        backends_[i].healthy = healthy[i];
+    }
+}
+
+
+void MySqlBackendPool::startHealthChecks(const int intervalSeconds)
+{
+    assert(intervalSeconds > 0);
+    healthThread_ = boost::thread(
+        boost::bind(&MySqlBackendPool::runHealthChecks, this, intervalSeconds)
+    );
+}
+
+
+bool MySqlBackendPool::probe(const string& host, const uint16_t port) const
+{
+    string user;
+    vector<uint8_t> passwordHash;
+    {
+        lock_guard<mutex> lg(mutex_);
+        user = healthCheckUser_;
+        passwordHash = healthCheckPasswordHash_;
+    }
+
+    try
+    {
+        if (!user.empty())
+        {
+            // Connections that hang up before logging in count against the
+            // host in MySQL, so log in properly where we can
+            auto_ptr<MySqlBackendConnection> connection(
+                new MySqlBackendConnection(
+                    port,
+                    host,
+                    connectTimeoutMilliseconds_
+                )
+            );
+            const bool loggedIn = connection->logIn(
+                user,
+                passwordHash,
+                HEALTH_CHECK_CHARACTER_SET,
+                string()
+            );
+            connection->close();
+            return loggedIn;
+        }
+
+        // Without a login, the server only has to send a handshake
+        MySqlSocket socket(port, host, true, connectTimeoutMilliseconds_);
+        pollfd waiting;
+        waiting.fd = socket.getFileDescriptor();
+        waiting.events = POLLIN;
+        waiting.revents = 0;
+        if (poll(&waiting, 1, connectTimeoutMilliseconds_) <= 0)
+        {
+            return false;
+        }
+        vector<uint8_t> handshake;
+        socket.receive(&handshake);
+        // 3: payload length, 1: packet number
+        const size_t BEGIN_PROTOCOL_VERSION = 3 + 1;
+        return handshake.size() > BEGIN_PROTOCOL_VERSION
+            && MySqlAuthentication::PROTOCOL_VERSION
+                == handshake[BEGIN_PROTOCOL_VERSION];
+    }
+    catch (SocketException& e)
+    {
+        Logger::log(Logger::DEBUG)
+            << "Health check of "
+            << host
+            << ':'
+            << port
+            << " failed: "
+            << e.what();
+        return false;
+    }
+}
+
+
+void MySqlBackendPool::runHealthChecks(const int intervalSeconds)
+{
+    try
+    {
+        while (true)
+        {
+            boost::this_thread::sleep(
+                boost::posix_time::seconds(intervalSeconds)
+            );
+            checkHealth();
+        }
+    }
+    catch (boost::thread_interrupted&)
+    {
+        // Shutting down
+    }
+}
@@ -0,0 +1,185 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_MYSQLBACKENDPOOL_HPP_
+#define SRC_MYSQLBACKENDPOOL_HPP_
+
+class MySqlBackendConnection;
+
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * A set of interchangeable MySQL servers, e.g. the replicas of a primary,
+ * that connections are spread across. Each new connection goes to the
+ * healthy server with the fewest connections for its weight. Servers that
+ * fail to connect are taken out of rotation until a background health check
+ * can log in to them again.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class MySqlBackendPool
+{
+public:
+    /**
+     * Constructor.
+     * @param connectTimeoutMilliseconds How long to wait for a server to
+     *  accept a connection before treating it as down.
+     */
+    explicit MySqlBackendPool(
+        int connectTimeoutMilliseconds = DEFAULT_CONNECT_TIMEOUT
+    );
+
+    /**
+     * Destructor. Stops the health checks.
+     */
+    ~MySqlBackendPool();
+
+    /**
+     * Adds a server. Servers start out healthy.
+     * @param host The host that MySQL is running on.
+     * @param port The port that MySQL is listening on.
+     * @param weight How many connections this server should get relative to
+     *  the others.
+     */
+    void addBackend(const std::string& host, uint16_t port, unsigned weight);
+
+    /**
+     * Parses a server from the configuration, formatted as host:port or
+     * host:port:weight.
+     * @return False if the server isn't formatted correctly.
+     */
+    static bool parseBackend(
+        const std::string& backend,
+        std::string* host,
+        uint16_t* port,
+        unsigned* weight
+    );
+
+    /**
+     * Returns the number of servers.
+     */
+    size_t size() const;
+
+    /**
+     * Picks the healthy server with the fewest connections for its weight
+     * and counts a new connection to it. Every server that's returned has to
+     * be given back with release.
+     * @return The server, or -1 if none are healthy.
+     */
+    int acquire();
+
+    /**
+     * Stops counting a connection to a server.
+     */
+    void release(int backend);
+
+    /**
+     * Connects to a server. If it can't be reached, it's marked as down.
+     * @return The connection, which the caller owns, or nullptr.
+     */
+    MySqlBackendConnection* connect(int backend);
+
+    /**
+     * Takes a server out of rotation until it passes a health check.
+     */
+    void markDown(int backend);
+
+    /**
+     * Returns true if a server is in rotation.
+     */
+    bool isHealthy(int backend) const;
+
+    /**
+     * Returns the number of connections to a server.
+     */
+    size_t getConnectionCount(int backend) const;
+
+    /**
+     * Sets the login that health checks use. Without one, a server only has
+     * to send a handshake to be healthy.
+     * @param user The user to log in as.
+     * @param password The user's password.
+     */
+    void setHealthCheckLogin(
+        const std::string& user,
+        const std::string& password
+    );
+
+    /**
+     * Checks every server once and updates which ones are in rotation.
+     */
+    void checkHealth();
+
+    /**
+     * Starts checking the servers in the background.
+     * @param intervalSeconds How long to wait between checks.
+     */
+    void startHealthChecks(int intervalSeconds);
+
+    static const int DEFAULT_CONNECT_TIMEOUT = 1000;
+    static const int DEFAULT_HEALTH_CHECK_INTERVAL = 5;
+
+private:
+    struct Backend
+    {
+        std::string host;
+        uint16_t port;
+        unsigned weight;
+        bool healthy;
+        size_t connections;
+        /// New servers are in rotation until a health check fails
+        Backend(
+            const std::string& backendHost,
+            uint16_t backendPort,
+            unsigned backendWeight
+        );
+    };
+
+    /**
+     * Tries to log in to a server.
+     * @return True if the server is up.
+     */
+    bool probe(const std::string& host, uint16_t port) const;
+
+    /**
+     * Runs the health checks until the thread is interrupted.
+     */
+    void runHealthChecks(int intervalSeconds);
+
+    std::vector<Backend> backends_;
+    /// Where to start looking, so that ties are spread around
+    size_t next_;
+    const int connectTimeoutMilliseconds_;
+    std::string healthCheckUser_;
+    std::vector<uint8_t> healthCheckPasswordHash_;
+    mutable boost::mutex mutex_;
+    boost::thread healthThread_;
+
+    // ***** Hidden methods *****
+    MySqlBackendPool(const MySqlBackendPool&);
+    MySqlBackendPool& operator=(const MySqlBackendPool&);
+};
+
+#endif  // SRC_MYSQLBACKENDPOOL_HPP_
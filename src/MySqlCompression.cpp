@@ -0,0 +1,186 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MySqlCompression.hpp"
+#include "nullptr.hpp"
+#include "SocketException.hpp"
+
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <cassert>
+#include <vector>
+#include <zlib.h>
+
+using std::min;
+using std::vector;
+
+const size_t MySqlCompression::HEADER_LENGTH;
+const size_t MySqlCompression::MAX_FRAME_LENGTH;
+const int MySqlCompression::DEFAULT_LEVEL;
+const size_t MySqlCompression::DEFAULT_THRESHOLD;
+
+static void writeLength(size_t length, uint8_t* destination);
+static size_t readLength(const uint8_t* source);
+
+
+MySqlCompression::MySqlCompression() :
+    enabled_(false),
+    level_(DEFAULT_LEVEL),
+    threshold_(DEFAULT_THRESHOLD)
+{
+}
+
+
+MySqlCompression::MySqlCompression(const int level, const size_t threshold) :
+    enabled_(true),
+    level_(level),
+    threshold_(threshold)
+{
+    assert(level >= 1 && level <= 9);
+}
+
+
+uint8_t MySqlCompression::appendFrames(
+    const uint8_t* data,
+    size_t length,
+    uint8_t sequence,
+    vector<uint8_t>* const frames
+) const
+{
+    assert(nullptr != frames);
+    bool first = true;
+    while (length > 0 || first)
+    {
+        if (!first)
+        {
+            ++sequence;
+        }
+        first = false;
+
+        const size_t chunkLength = min(length, MAX_FRAME_LENGTH);
+        const size_t start = frames->size();
+
+        if (chunkLength >= threshold_)
+        {
+            // Compress straight into the output
+            uLongf compressedLength = compressBound(chunkLength);
+            frames->resize(start + HEADER_LENGTH + compressedLength);
+            const int result = compress2(
+                &(*frames)[start + HEADER_LENGTH],
+                &compressedLength,
+                data,
+                chunkLength,
+                level_
+            );
+            if (Z_OK == result && compressedLength < chunkLength)
+            {
+                frames->resize(start + HEADER_LENGTH + compressedLength);
+                writeLength(compressedLength, &(*frames)[start]);
+                (*frames)[start + 3] = sequence;
+                writeLength(chunkLength, &(*frames)[start + 4]);
+                data += chunkLength;
+                length -= chunkLength;
+                continue;
+            }
+            // Incompressible, so just store it
+            frames->resize(start);
+        }
+
+        frames->resize(start + HEADER_LENGTH);
+        writeLength(chunkLength, &(*frames)[start]);
+        (*frames)[start + 3] = sequence;
+        writeLength(0, &(*frames)[start + 4]);
+        frames->insert(frames->end(), data, data + chunkLength);
+        data += chunkLength;
+        length -= chunkLength;
+    }
+    return sequence;
+}
+
+
+size_t MySqlCompression::frameLength(
+    const vector<uint8_t>& data,
+    const size_t offset
+)
+{
+    if (data.size() < offset + HEADER_LENGTH)
+    {
+        return 0;
+    }
+    const size_t length = HEADER_LENGTH + readLength(&data[offset]);
+    if (data.size() < offset + length)
+    {
+        return 0;
+    }
+    return length;
+}
+
+
+void MySqlCompression::decompressFrame(
+    const uint8_t* const frame,
+    const size_t length,
+    vector<uint8_t>* const data
+)
+{
+    assert(nullptr != data);
+    assert(length >= HEADER_LENGTH);
+    const size_t compressedLength = length - HEADER_LENGTH;
+    const size_t uncompressedLength = readLength(frame + 4);
+
+    // Stored as is
+    if (0 == uncompressedLength)
+    {
+        data->insert(
+            data->end(),
+            frame + HEADER_LENGTH,
+            frame + HEADER_LENGTH + compressedLength
+        );
+        return;
+    }
+
+    const size_t start = data->size();
+    data->resize(start + uncompressedLength);
+    uLongf decompressedLength = uncompressedLength;
+    const int result = uncompress(
+        &(*data)[start],
+        &decompressedLength,
+        frame + HEADER_LENGTH,
+        compressedLength
+    );
+    if (Z_OK != result || uncompressedLength != decompressedLength)
+    {
+        data->resize(start);
+        throw SocketException("Corrupt compressed MySQL packet");
+    }
+}
+
+
+void writeLength(const size_t length, uint8_t* const destination)
+{
+    destination[0] = length & 0xFF;
+    destination[1] = (length >> 8) & 0xFF;
+    destination[2] = (length >> 16) & 0xFF;
+}
+
+
+size_t readLength(const uint8_t* const source)
+{
+    return source[0] | (source[1] << 8) | (source[2] << 16);
+}
@@ -0,0 +1,109 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_MYSQLCOMPRESSION_HPP_
+#define SRC_MYSQLCOMPRESSION_HPP_
+
+#include <boost/cstdint.hpp>
+#include <vector>
+
+/**
+ * Reads and writes the frames of the MySQL compressed protocol. Once a
+ * client and server agree on CLIENT_COMPRESS, every packet after the
+ * authentication is wrapped in frames that have a 3 byte compressed
+ * length, a 1 byte sequence number and a 3 byte uncompressed length
+ * followed by the zlib compressed data. An uncompressed length of 0 means
+ * that the data is stored as is. A frame can hold several packets, and a
+ * packet can be split across frames.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class MySqlCompression
+{
+public:
+    /**
+     * Default constructor. Compression is disabled.
+     */
+    MySqlCompression();
+
+    /**
+     * Constructor that enables compression.
+     * @param level The zlib compression level, from 1 (fastest) to 9
+     *  (smallest).
+     * @param threshold Data smaller than this is sent uncompressed, because
+     *  compressing it wouldn't save anything.
+     */
+    MySqlCompression(int level, size_t threshold);
+
+    /**
+     * Returns true if clients are allowed to use compression.
+     */
+    inline bool isEnabled() const { return enabled_; }
+
+    /**
+     * Wraps data in frames and appends them to a buffer.
+     * @param data The data to wrap. This can be empty, in which case one
+     *  empty frame is added.
+     * @param length The length of the data.
+     * @param sequence The sequence number of the first frame.
+     * @param frames The buffer to append the frames to.
+     * @return The sequence number of the last frame.
+     */
+    uint8_t appendFrames(
+        const uint8_t* data,
+        size_t length,
+        uint8_t sequence,
+        std::vector<uint8_t>* frames
+    ) const;
+
+    /**
+     * Returns the length of the frame that starts at an offset, header
+     * included, or 0 if all of it hasn't been received yet.
+     */
+    static size_t frameLength(const std::vector<uint8_t>& data, size_t offset);
+
+    /**
+     * Decompresses a whole frame.
+     * @param frame The frame, header included.
+     * @param length The length of the frame.
+     * @param data The buffer to append the frame's data to.
+     * @throw SocketException The frame is corrupt.
+     */
+    static void decompressFrame(
+        const uint8_t* frame,
+        size_t length,
+        std::vector<uint8_t>* data
+    );
+
+    /// 3: compressed length, 1: sequence number, 3: uncompressed length
+    static const size_t HEADER_LENGTH = 3 + 1 + 3;
+    static const size_t MAX_FRAME_LENGTH = 0xFFFFFF;
+    static const int DEFAULT_LEVEL = 6;
+    /// The same threshold that MySQL uses
+    static const size_t DEFAULT_THRESHOLD = 50;
+
+private:
+    bool enabled_;
+    int level_;
+    size_t threshold_;
+};
+
+#endif  // SRC_MYSQLCOMPRESSION_HPP_
@@ -0,0 +1,509 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Logger.hpp"
+#include "MySqlAuthentication.hpp"
+#include "MySqlBackendConnection.hpp"
+#include "MySqlConnectionPool.hpp"
+#include "MySqlConstants.hpp"
+#include "MySqlSessionState.hpp"
+#include "nullptr.hpp"
+#include "SocketException.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <cassert>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using boost::lock_guard;
+using boost::mutex;
+using boost::unique_lock;
+using std::auto_ptr;
+using std::make_pair;
+using std::map;
+using std::string;
+using std::vector;
+
+const int MySqlConnectionPool::DEFAULT_MAX_CONNECTIONS;
+const int MySqlConnectionPool::DEFAULT_WAIT;
+
+/// Connections that have been idle for this long are checked before use
+static const time_t IDLE_CHECK_SECONDS = 30;
+
+
+MySqlConnectionPool::Lease::Lease(
+    const string& leaseUser,
+    const string& leaseDatabase
+) :
+    user(leaseUser),
+    database(leaseDatabase)
+{
+}
+
+
+MySqlConnectionPool::MySqlConnectionPool(
+    const uint16_t port,
+    const string& host,
+    const size_t maxConnections,
+    const int waitMilliseconds
+) :
+    networkSocket_(true),
+    port_(port),
+    host_(host),
+    domainSocket_(),
+    maxConnections_(maxConnections),
+    waitMilliseconds_(waitMilliseconds),
+    handshake_(),
+    idle_(),
+    counts_(),
+    leases_(),
+    mutex_(),
+    released_()
+{
+    assert(maxConnections > 0);
+}
+
+
+MySqlConnectionPool::MySqlConnectionPool(
+    const string& domainSocket,
+    const size_t maxConnections,
+    const int waitMilliseconds
+) :
+    networkSocket_(false),
+    port_(0),
+    host_(),
+    domainSocket_(domainSocket),
+    maxConnections_(maxConnections),
+    waitMilliseconds_(waitMilliseconds),
+    handshake_(),
+    idle_(),
+    counts_(),
+    leases_(),
+    mutex_(),
+    released_()
+{
+    assert(maxConnections > 0);
+}
+
+
+MySqlConnectionPool::~MySqlConnectionPool()
+{
+    for (
+        map<string, vector<IdleConnection> >::iterator i(idle_.begin());
+        idle_.end() != i;
+        ++i
+    )
+    {
+        for (size_t j = 0; j < i->second.size(); ++j)
+        {
+            try
+            {
+                i->second[j].connection->close();
+            }
+            catch (SocketException&)
+            {
+                // Closing anyway
+            }
+            delete i->second[j].connection;
+        }
+    }
+}
+
+
+bool MySqlConnectionPool::makeHandshake(vector<uint8_t>* const handshake)
+{
+    {
+        lock_guard<mutex> lg(mutex_);
+        *handshake = handshake_;
+    }
+    if (handshake->empty())
+    {
+        // The server's handshake doesn't change, so this is only done once
+        auto_ptr<MySqlBackendConnection> connection(connect());
+        *handshake = connection->readHandshake();
+        if (handshake->empty())
+        {
+            return false;
+        }
+        lock_guard<mutex> lg(mutex_);
+        handshake_ = *handshake;
+    }
+
+    vector<uint8_t> scramble;
+    MySqlAuthentication::makeScramble(&scramble);
+    return MySqlAuthentication::prepareHandshake(handshake, scramble);
+}
+
+
+MySqlBackendConnection* MySqlConnectionPool::acquire(
+    const string& user,
+    const vector<uint8_t>& passwordHash,
+    const uint8_t characterSet,
+    const MySqlSessionState& session,
+    ACQUIRE_ERROR* const error
+)
+{
+    const string countKey(getCountKey(user, session.getDatabase()));
+    const string idleKey(getIdleKey(user, session));
+    // Idle connections for the same user and database start with this
+    const string countPrefix(countKey + '\0');
+    const boost::system_time deadline =
+        boost::get_system_time()
+        + boost::posix_time::milliseconds(waitMilliseconds_);
+
+    while (true)
+    {
+        IdleConnection reused = {nullptr, 0};
+        auto_ptr<MySqlBackendConnection> replaced;
+        {
+            unique_lock<mutex> lock(mutex_);
+            while (true)
+            {
+                const map<string, vector<IdleConnection> >::iterator match(
+                    idle_.find(idleKey)
+                );
+                if (idle_.end() != match)
+                {
+                    reused = match->second.back();
+                    match->second.pop_back();
+                    if (match->second.empty())
+                    {
+                        idle_.erase(match);
+                    }
+                    break;
+                }
+                if (counts_[countKey] < maxConnections_)
+                {
+                    ++counts_[countKey];
+                    break;
+                }
+                // At the limit, an idle connection with other settings can
+                // be closed to make room for one with the right settings
+                const map<string, vector<IdleConnection> >::iterator other(
+                    idle_.lower_bound(countPrefix)
+                );
+                if (
+                    idle_.end() != other
+                    && 0 == other->first.compare(
+                        0,
+                        countPrefix.size(),
+                        countPrefix
+                    )
+                )
+                {
+                    replaced.reset(other->second.back().connection);
+                    other->second.pop_back();
+                    if (other->second.empty())
+                    {
+                        idle_.erase(other);
+                    }
+                    break;
+                }
+                if (!released_.timed_wait(lock, deadline))
+                {
+                    Logger::log(Logger::WARN)
+                        << "Timed out waiting for a MySQL connection for "
+                        << user;
+                    if (nullptr != error)
+                    {
+                        *error = ACQUIRE_TIMED_OUT;
+                    }
+                    return nullptr;
+                }
+            }
+            if (nullptr != reused.connection)
+            {
+                leases_.insert(
+                    make_pair(
+                        reused.connection,
+                        Lease(user, session.getDatabase())
+                    )
+                );
+            }
+        }
+
+        if (nullptr != replaced.get())
+        {
+            try
+            {
+                replaced->close();
+            }
+            catch (SocketException&)
+            {
+                // Closing anyway
+            }
+            replaced.reset();
+        }
+
+        if (nullptr != reused.connection)
+        {
+            if (
+                time(nullptr) - reused.since < IDLE_CHECK_SECONDS
+                || isAlive(reused.connection)
+            )
+            {
+                return reused.connection;
+            }
+            // The server timed it out, so try again
+            Logger::log(Logger::DEBUG) << "Dropping a closed MySQL connection";
+            discard(reused.connection);
+            continue;
+        }
+
+        MySqlBackendConnection* connection = nullptr;
+        ACQUIRE_ERROR failure = ACQUIRE_REFUSED;
+        try
+        {
+            connection = connect();
+            if (
+                setUp(
+                    connection,
+                    user,
+                    passwordHash,
+                    characterSet,
+                    session
+                )
+            )
+            {
+                lock_guard<mutex> lg(mutex_);
+                leases_.insert(
+                    make_pair(connection, Lease(user, session.getDatabase()))
+                );
+                return connection;
+            }
+            Logger::log(Logger::WARN)
+                << "MySQL refused a pooled connection for "
+                << user;
+        }
+        catch (SocketException& e)
+        {
+            Logger::log(Logger::WARN)
+                << "Unable to open a pooled MySQL connection: "
+                << e.what();
+            failure = ACQUIRE_UNREACHABLE;
+        }
+        delete connection;
+        if (nullptr != error)
+        {
+            *error = failure;
+        }
+
+        lock_guard<mutex> lg(mutex_);
+        decrementCount(countKey);
+        released_.notify_all();
+        return nullptr;
+    }
+}
+
+
+void MySqlConnectionPool::release(
+    MySqlBackendConnection* const connection,
+    const MySqlSessionState& session
+)
+{
+    lock_guard<mutex> lg(mutex_);
+    const map<const MySqlBackendConnection*, Lease>::iterator lease(
+        leases_.find(connection)
+    );
+    assert(leases_.end() != lease && "Released a connection twice");
+    const Lease& owner = lease->second;
+
+    // The client might have switched databases, which can put this one
+    // over the limit until a connection is closed
+    if (owner.database != session.getDatabase())
+    {
+        decrementCount(getCountKey(owner.user, owner.database));
+        ++counts_[getCountKey(owner.user, session.getDatabase())];
+    }
+    const IdleConnection idle = {connection, time(nullptr)};
+    idle_[getIdleKey(owner.user, session)].push_back(idle);
+    leases_.erase(lease);
+    // Waiters might want other users and databases, so wake all of them
+    released_.notify_all();
+}
+
+
+void MySqlConnectionPool::discard(MySqlBackendConnection* const connection)
+{
+    {
+        lock_guard<mutex> lg(mutex_);
+        const map<const MySqlBackendConnection*, Lease>::iterator lease(
+            leases_.find(connection)
+        );
+        assert(leases_.end() != lease && "Discarded a connection twice");
+        decrementCount(
+            getCountKey(lease->second.user, lease->second.database)
+        );
+        leases_.erase(lease);
+        released_.notify_all();
+    }
+
+    try
+    {
+        connection->close();
+    }
+    catch (SocketException&)
+    {
+        // Closing anyway
+    }
+    delete connection;
+}
+
+
+size_t MySqlConnectionPool::getConnectionCount(
+    const string& user,
+    const string& database
+) const
+{
+    lock_guard<mutex> lg(mutex_);
+    const map<string, size_t>::const_iterator count(
+        counts_.find(getCountKey(user, database))
+    );
+    return counts_.end() == count ? 0 : count->second;
+}
+
+
+size_t MySqlConnectionPool::getIdleCount() const
+{
+    lock_guard<mutex> lg(mutex_);
+    size_t count = 0;
+    for (
+        map<string, vector<IdleConnection> >::const_iterator i(idle_.begin());
+        idle_.end() != i;
+        ++i
+    )
+    {
+        count += i->second.size();
+    }
+    return count;
+}
+
+
+MySqlBackendConnection* MySqlConnectionPool::connect() const
+{
+    if (networkSocket_)
+    {
+        return new MySqlBackendConnection(port_, host_, waitMilliseconds_);
+    }
+    return new MySqlBackendConnection(domainSocket_);
+}
+
+
+bool MySqlConnectionPool::setUp(
+    MySqlBackendConnection* const connection,
+    const string& user,
+    const vector<uint8_t>& passwordHash,
+    const uint8_t characterSet,
+    const MySqlSessionState& session
+)
+{
+    if (
+        !connection->logIn(
+            user,
+            passwordHash,
+            characterSet,
+            session.getDatabase()
+        )
+    )
+    {
+        return false;
+    }
+    const vector<string>& statements = session.getStatements();
+    for (size_t i = 0; i < statements.size(); ++i)
+    {
+        if (
+            !connection->runCommand(
+                MySqlConstants::COM_QUERY,
+                statements[i],
+                nullptr
+            )
+        )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool MySqlConnectionPool::isAlive(MySqlBackendConnection* const connection)
+{
+    try
+    {
+        return connection->runCommand(
+            MySqlConstants::COM_PING,
+            string(),
+            nullptr
+        );
+    }
+    catch (SocketException&)
+    {
+        return false;
+    }
+}
+
+
+void MySqlConnectionPool::decrementCount(const string& countKey)
+{
+    const map<string, size_t>::iterator count(counts_.find(countKey));
+    assert(counts_.end() != count && count->second > 0);
+    if (0 == --count->second)
+    {
+        counts_.erase(count);
+    }
+}
+
+
+string MySqlConnectionPool::getCountKey(
+    const string& user,
+    const string& database
+)
+{
+    // Names can't have nulls in them
+    string key(user);
+    key += '\0';
+    key += database;
+    return key;
+}
+
+
+string MySqlConnectionPool::getIdleKey(
+    const string& user,
+    const MySqlSessionState& session
+)
+{
+    string key(getCountKey(user, session.getDatabase()));
+    key += '\0';
+    const vector<string>& statements = session.getStatements();
+    for (size_t i = 0; i < statements.size(); ++i)
+    {
+        key += statements[i];
+        key += '\0';
+    }
+    return key;
+}
@@ -0,0 +1,245 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_MYSQLCONNECTIONPOOL_HPP_
+#define SRC_MYSQLCONNECTIONPOOL_HPP_
+
+class MySqlBackendConnection;
+class MySqlSessionState;
+
+#include "nullptr.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Logged in connections to a MySQL server that clients borrow for one
+ * statement or transaction at a time, so that lots of short-lived clients
+ * don't each cost the server a thread and a login. There are at most a
+ * fixed number of connections for each user and database; clients that
+ * need one while they're all busy wait for one to be given back.
+ *
+ * Idle connections are kept apart by the session variables that have been
+ * set on them, so that a client only gets a connection that has exactly
+ * its own settings.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class MySqlConnectionPool
+{
+public:
+    /**
+     * Constructor for a server on the network.
+     * @param port The port that MySQL is listening on.
+     * @param host The host that MySQL is running on.
+     * @param maxConnections The most connections for each user and database.
+     * @param waitMilliseconds How long a client waits for a connection when
+     *  they're all busy.
+     */
+    MySqlConnectionPool(
+        uint16_t port,
+        const std::string& host,
+        size_t maxConnections,
+        int waitMilliseconds
+    );
+
+    /**
+     * Constructor for a server on a Unix domain socket.
+     * @param domainSocket The domain socket that MySQL is listening on.
+     * @param maxConnections The most connections for each user and database.
+     * @param waitMilliseconds How long a client waits for a connection when
+     *  they're all busy.
+     */
+    MySqlConnectionPool(
+        const std::string& domainSocket,
+        size_t maxConnections,
+        int waitMilliseconds
+    );
+
+    /**
+     * Destructor. Closes the idle connections.
+     */
+    ~MySqlConnectionPool();
+
+    /**
+     * Makes a handshake for SQLassie to send to a new client itself, based
+     * on the server's, with a new scramble.
+     * @param handshake Filled with the whole handshake packet.
+     * @return False if the server refused the connection.
+     * @throw SocketException Unable to connect to the server.
+     */
+    bool makeHandshake(std::vector<uint8_t>* handshake);
+
+    /**
+     * Why acquire didn't lend out a connection.
+     */
+    enum ACQUIRE_ERROR
+    {
+        /// The connections for the user and database stayed busy
+        ACQUIRE_TIMED_OUT,
+        /// The server refused the login or the session's database or
+        /// variables
+        ACQUIRE_REFUSED,
+        /// The server couldn't be reached
+        ACQUIRE_UNREACHABLE
+    };
+
+    /**
+     * Lends out a connection that's logged in as the user and has the
+     * session's database and variables.
+     * @param user The user to log in as.
+     * @param passwordHash SHA1(password), or empty for no password.
+     * @param characterSet The character set number to ask for.
+     * @param session The client's session.
+     * @param error If not nullptr, set to why there's no connection when
+     *  nullptr is returned.
+     * @return nullptr if the server refused the login, if it couldn't be
+     *  reached, or if the connections for the user and database stayed busy
+     *  for too long.
+     */
+    MySqlBackendConnection* acquire(
+        const std::string& user,
+        const std::vector<uint8_t>& passwordHash,
+        uint8_t characterSet,
+        const MySqlSessionState& session,
+        ACQUIRE_ERROR* error = nullptr
+    );
+
+    /**
+     * Gives a connection back so that other clients can use it.
+     * @param connection The connection from acquire.
+     * @param session The session that the connection has now, which might
+     *  have changed since it was lent out.
+     */
+    void release(
+        MySqlBackendConnection* connection,
+        const MySqlSessionState& session
+    );
+
+    /**
+     * Closes a lent out connection whose state isn't known, e.g. because
+     * the client disconnected partway through a transaction.
+     */
+    void discard(MySqlBackendConnection* connection);
+
+    /**
+     * Returns the number of open connections, lent out or idle, for a user
+     * and database.
+     */
+    size_t getConnectionCount(
+        const std::string& user,
+        const std::string& database
+    ) const;
+
+    /**
+     * Returns the number of connections that are waiting to be lent out.
+     */
+    size_t getIdleCount() const;
+
+    static const int DEFAULT_MAX_CONNECTIONS = 20;
+    static const int DEFAULT_WAIT = 5000;
+
+private:
+    struct Lease
+    {
+        std::string user;
+        std::string database;
+        Lease(const std::string& leaseUser, const std::string& leaseDatabase);
+    };
+
+    struct IdleConnection
+    {
+        MySqlBackendConnection* connection;
+        time_t since;
+    };
+
+    /**
+     * Opens a new connection that isn't logged in yet.
+     * @throw SocketException
+     */
+    MySqlBackendConnection* connect() const;
+
+    /**
+     * Logs a new connection in and sets it up for a session.
+     * @return False if the server refused the login or a setting.
+     * @throw SocketException
+     */
+    static bool setUp(
+        MySqlBackendConnection* connection,
+        const std::string& user,
+        const std::vector<uint8_t>& passwordHash,
+        uint8_t characterSet,
+        const MySqlSessionState& session
+    );
+
+    /**
+     * Makes sure that a connection that has been idle for a while is still
+     * open, e.g. that the server hasn't timed it out.
+     */
+    static bool isAlive(MySqlBackendConnection* connection);
+
+    /**
+     * Takes one off of the number of connections for a user and database.
+     * The lock must be held.
+     */
+    void decrementCount(const std::string& countKey);
+
+    /**
+     * Returns the key that connections are counted under.
+     */
+    static std::string getCountKey(
+        const std::string& user,
+        const std::string& database
+    );
+
+    /**
+     * Returns the key that idle connections with a session are kept under.
+     */
+    static std::string getIdleKey(
+        const std::string& user,
+        const MySqlSessionState& session
+    );
+
+    const bool networkSocket_;
+    const uint16_t port_;
+    const std::string host_;
+    const std::string domainSocket_;
+    const size_t maxConnections_;
+    const int waitMilliseconds_;
+
+    std::vector<uint8_t> handshake_;
+    std::map<std::string, std::vector<IdleConnection> > idle_;
+    std::map<std::string, size_t> counts_;
+    std::map<const MySqlBackendConnection*, Lease> leases_;
+    mutable boost::mutex mutex_;
+    boost::condition_variable released_;
+
+    // ***** Hidden methods *****
+    MySqlConnectionPool(const MySqlConnectionPool&);
+    MySqlConnectionPool& operator=(const MySqlConnectionPool&);
+};
+
+#endif  // SRC_MYSQLCONNECTIONPOOL_HPP_
@@ -104,6 +104,8 @@ public:
     static const uint32_t CLIENT_MULTI_STATEMENTS = 65536;
     /// Enable/disable multi-results
     static const uint32_t CLIENT_MULTI_RESULTS = 131072;
+    /// Client expects OK packets instead of EOF packets
+    static const uint32_t CLIENT_DEPRECATE_EOF = 16777216;
     ///@}
 
     /**
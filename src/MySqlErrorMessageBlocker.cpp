@@ -19,27 +19,60 @@
  */
 
 #include "Logger.hpp"
+#include "MySqlAuthentication.hpp"
+#include "MySqlCompression.hpp"
 #include "MySqlConstants.hpp"
 #include "MySqlErrorMessageBlocker.hpp"
+#include "MySqlPacketReader.hpp"
 #include "MySqlSocket.hpp"
 #include "nullptr.hpp"
+#include "PacketBufferPool.hpp"
 #include "ProxyHalf.hpp"
 #include "QueryRisk.hpp"
 #include "Socket.hpp"
 
+#include <algorithm>
 #include <boost/cstdint.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
 #include <cassert>
+#include <string>
 #include <vector>
 
+using boost::lock_guard;
+using boost::mutex;
+using std::min;
+using std::string;
 using std::vector;
 
 MySqlErrorMessageBlocker::MySqlErrorMessageBlocker(
     MySqlSocket* incomingConnection,
-    MySqlSocket* outgoingConnection
+    MySqlSocket* outgoingConnection,
+    const bool passThroughResultSets,
+    const MySqlCompression& compression
 ) :
     ProxyHalf(incomingConnection, outgoingConnection),
     lastQueryType_(QueryRisk::TYPE_UNKNOWN),
-    firstPacket_(true)
+    firstPacket_(true),
+    passThroughResultSets_(passThroughResultSets),
+    responseExpected_(false),
+    eofPacketsRemaining_(0),
+    pendingQueryType_(QueryRisk::TYPE_UNKNOWN),
+    queryPending_(false),
+    pendingQueryMutex_(),
+    payloadRemaining_(0),
+    continuation_(false),
+    carry_(),
+    scramble_(),
+    serverStatus_(MySqlConstants::STATUS_AUTO_COMMIT),
+    compression_(compression),
+    compressionRequested_(false),
+    compressed_(false),
+    sequenceOffset_(0),
+    frames_(),
+    frameData_(),
+    frameOutput_(),
+    framesOut_()
 {
 }
 
@@ -49,136 +82,485 @@ MySqlErrorMessageBlocker::MySqlErrorMessageBlocker(
 ) :
     ProxyHalf(rhs),
     lastQueryType_(rhs.lastQueryType_),
-    firstPacket_(rhs.firstPacket_)
+    firstPacket_(rhs.firstPacket_),
+    passThroughResultSets_(rhs.passThroughResultSets_),
+    responseExpected_(rhs.responseExpected_),
+    eofPacketsRemaining_(rhs.eofPacketsRemaining_),
+    pendingQueryType_(rhs.pendingQueryType_),
+    queryPending_(rhs.queryPending_),
+    pendingQueryMutex_(),
+    payloadRemaining_(rhs.payloadRemaining_),
+    continuation_(rhs.continuation_),
+    carry_(),
+    scramble_(rhs.scramble_),
+    serverStatus_(rhs.serverStatus_),
+    compression_(rhs.compression_),
+    compressionRequested_(rhs.compressionRequested_),
+    compressed_(rhs.compressed_),
+    sequenceOffset_(rhs.sequenceOffset_),
+    frames_(),
+    frameData_(),
+    frameOutput_(),
+    framesOut_()
 {
+    carry_.swap(rhs.carry_);
+    frames_.swap(rhs.frames_);
 }
 
 
 MySqlErrorMessageBlocker::~MySqlErrorMessageBlocker()
 {
+    PacketBufferPool::release(&carry_);
 }
 
 
 void MySqlErrorMessageBlocker::handleMessage(vector<uint8_t>& rawMessage) const
 {
+    if (compressed_)
+    {
+        frames_.insert(frames_.end(), rawMessage.begin(), rawMessage.end());
+        handleFrames();
+        return;
+    }
+
+    filterPackets(rawMessage);
+
+    // Everything after the end of the authentication is compressed
+    if (compressed_ && !carry_.empty())
+    {
+        frames_.swap(carry_);
+        carry_.clear();
+        handleFrames();
+    }
+}
+
+
+void MySqlErrorMessageBlocker::handleFrames() const
+{
+    size_t offset = 0;
+    size_t length;
+    while (0 != (length = MySqlCompression::frameLength(frames_, offset)))
+    {
+        uint8_t* const frame = &frames_[offset];
+        frameData_.clear();
+        MySqlCompression::decompressFrame(frame, length, &frameData_);
+        frameOutput_.clear();
+        filterPackets(frameData_);
+
+        // Frames keep their sequence numbers, apart from any difference that
+        // MySqlGuard introduced when it rewrote the client's frames
+        const uint8_t sequence = frame[3] + sequenceOffset_;
+        if (frameOutput_ == frameData_)
+        {
+            frame[3] = sequence;
+            framesOut_.insert(framesOut_.end(), frame, frame + length);
+        }
+        else
+        {
+            compression_.appendFrames(
+                (frameOutput_.empty() ? nullptr : &frameOutput_[0]),
+                frameOutput_.size(),
+                sequence,
+                &framesOut_
+            );
+        }
+        offset += length;
+    }
+    frames_.erase(frames_.begin(), frames_.begin() + offset);
+
+    if (!framesOut_.empty())
+    {
+        outgoingConnection_->send(framesOut_);
+        framesOut_.clear();
+    }
+}
+
+
+void MySqlErrorMessageBlocker::filterPackets(vector<uint8_t>& data) const
+{
+    const uint8_t RESULT_OK = 0x00;
     const uint8_t RESULT_ERROR = 0xFF;
+    const uint8_t RESULT_EOF = 0xFE;
+    // Rows can start with 0xFE too, but then they're at least this long
+    const size_t MIN_ROW_LENGTH = 9;
+    // Payloads of exactly this length are continued in the next packet
+    const size_t MAX_PACKET_LENGTH = 0xFFFFFF;
+    // 3: packet length, 1: packet number
+    const size_t HEADER_LENGTH = 3 + 1;
+    // Reading this much would take a few receives, so splice it instead
+    const size_t SPLICE_THRESHOLD = 8192;
 
-    MySqlSocket* mySqlSocketPtr;
-    #ifndef NDEBUG
-        mySqlSocketPtr = dynamic_cast<MySqlSocket*>(outgoingConnection_);
-        assert(
-            nullptr != mySqlSocketPtr &&
-            "MySqlErrorMessageBlocker should have MySqlSockets"
-        );
-    #else
-        mySqlSocketPtr = static_cast<MySqlSocket*>(outgoingConnection_);
-    #endif
+    // The client waits for the whole response to one query before sending
+    // the next, so a new query never starts partway through this data
+    takePendingQuery();
 
-    assert(
-        rawMessage.size() >= 5 &&
-        "Response message from MySQL is empty"
-    );
-    if (rawMessage.size() < 5)
+    // Packets can be split across reads, so whatever was left over from the
+    // last read goes in front of this one
+    vector<uint8_t>* messagePtr = &data;
+    if (!carry_.empty())
+    {
+        carry_.insert(carry_.end(), data.begin(), data.end());
+        messagePtr = &carry_;
+    }
+    vector<uint8_t>& message = *messagePtr;
+    if (message.empty())
     {
-        mySqlSocketPtr->sendErrorPacket(0);
         return;
     }
 
-    // First three bytes are the packet length
-    // Fourth byte is the packet number
-    const uint8_t packetNumber = rawMessage.at(3);
+    // Compressed data is collected so that it can be put back into frames
+    vector<uint8_t>* const output = (compressed_ ? &frameOutput_ : nullptr);
 
-    // The first packet sent from the server is the handshake initialization
-    // packet. This includes information about the server's capabilities. Per
-    // ticket #11, we don't support compression, so lie to the client and
-    // clear that bit so that the client doesn't try to use compression.
-    if (firstPacket_)
-    {
-        firstPacket_ = false;
-
-        // 3: packet length, 1: packet number number,
-        // 1: server version, n: null-terminated server version string
-        const size_t BEGIN_VERSION_STRING = 3 + 1 + 1;
-        size_t i = BEGIN_VERSION_STRING;
-        while (i < rawMessage.size() && rawMessage.at(i) != '\0')
+    size_t position = 0;
+    size_t forwarded = 0;
+    bool batching = false;
+    while (position < message.size())
+    {
+        if (payloadRemaining_ > 0)
         {
-            ++i;
+            const size_t skipped =
+                min(payloadRemaining_, message.size() - position);
+            position += skipped;
+            payloadRemaining_ -= skipped;
+            continue;
         }
-        ++i; // One past the version string
-        // 4: thread id, 8: password scramble buffer, 1: filler
-        const size_t BEGIN_SERVER_CAPABILITIES = i + 4 + 8 + 1;
 
-        if (BEGIN_SERVER_CAPABILITIES >= rawMessage.size())
+        const size_t available = message.size() - position;
+        if (available < HEADER_LENGTH)
         {
-            Logger::log(Logger::ERROR) << "Unable to unset client compression";
+            break;
         }
-        else
+        const size_t length =
+            message[position]
+            | (message[position + 1] << 8)
+            | (message[position + 2] << 16);
+        const size_t packetEnd = position + HEADER_LENGTH + length;
+
+        if (!continuation_ && 0 != length)
         {
-            // Flip off the compression bit
-            rawMessage.at(BEGIN_SERVER_CAPABILITIES) =
-                rawMessage.at(BEGIN_SERVER_CAPABILITIES) &
-                ~(static_cast<uint8_t>(MySqlConstants::CLIENT_COMPRESS));
+            if (available < HEADER_LENGTH + 1)
+            {
+                break;
+            }
+            const uint8_t resultType = message[position + HEADER_LENGTH];
+            const bool eof =
+                RESULT_EOF == resultType
+                && length < MIN_ROW_LENGTH
+                && eofPacketsRemaining_ > 0;
+            const bool authenticated =
+                compressionRequested_
+                && !compressed_
+                && RESULT_OK == resultType;
+            const bool ok = responseExpected_ && RESULT_OK == resultType;
+
+            // These are all short, so wait until the whole packet is here
+            if (
+                (
+                    firstPacket_
+                    || eof
+                    || authenticated
+                    || ok
+                    || RESULT_ERROR == resultType
+                )
+                && message.size() < packetEnd
+            )
+            {
+                break;
+            }
+
+            if (firstPacket_)
+            {
+                firstPacket_ = false;
+                MySqlAuthentication::getScramble(
+                    &message[position],
+                    length + HEADER_LENGTH,
+                    &scramble_
+                );
+                clearCapabilities(&message[position], length + HEADER_LENGTH);
+            }
+            else if (RESULT_ERROR == resultType)
+            {
+                // Send what came before the error, the replacement and what
+                // came after it together
+                if (nullptr == output && !batching)
+                {
+                    outgoingConnection_->beginBatch();
+                    batching = true;
+                }
+                emit(output, &message[0] + forwarded, &message[0] + position);
+                replaceError(
+                    output,
+                    &message[position],
+                    length + HEADER_LENGTH
+                );
+                forwarded = packetEnd;
+                responseExpected_ = false;
+                eofPacketsRemaining_ = 0;
+            }
+            else if (authenticated)
+            {
+                // Both sides switch to compressed frames right after this
+                compressed_ = true;
+                position = packetEnd;
+                break;
+            }
+            else if (eof)
+            {
+                --eofPacketsRemaining_;
+                // 1: EOF marker, 2: warning count, 2: status flags
+                if (0 == eofPacketsRemaining_ && length >= 1 + 2 + 2)
+                {
+                    const size_t status =
+                        message[position + HEADER_LENGTH + 3]
+                        | (message[position + HEADER_LENGTH + 4] << 8);
+                    serverStatus_ = status;
+                    // The real name of this flag is SERVER_MORE_RESULTS_EXISTS
+                    responseExpected_ =
+                        0 != (status & MySqlConstants::STATUS_MULTI_QUERY);
+                }
+            }
+            else if (ok)
+            {
+                uint16_t status;
+                responseExpected_ = false;
+                if (
+                    MySqlPacketReader::getStatusFlags(
+                        &message[position],
+                        length + HEADER_LENGTH,
+                        &status
+                    )
+                )
+                {
+                    serverStatus_ = status;
+                    // The real name of this flag is SERVER_MORE_RESULTS_EXISTS
+                    responseExpected_ =
+                        0 != (status & MySqlConstants::STATUS_MULTI_QUERY);
+                }
+            }
+            else if (responseExpected_)
+            {
+                responseExpected_ = false;
+                // The column definitions and the rows each end with an EOF
+                if (isResultSetHeader(resultType))
+                {
+                    eofPacketsRemaining_ = 2;
+                }
+            }
         }
 
-        ProxyHalf::handleMessage(rawMessage);
+        continuation_ = (MAX_PACKET_LENGTH == length);
+        position += HEADER_LENGTH;
+        payloadRemaining_ = length;
+    }
+
+    // Forward everything up to the partial packet, if there is one
+    emit(output, &message[0] + forwarded, &message[0] + position);
+    if (batching)
+    {
+        outgoingConnection_->endBatch();
+    }
+
+    if (messagePtr == &carry_)
+    {
+        carry_.erase(carry_.begin(), carry_.begin() + position);
+    }
+    else
+    {
+        carry_.assign(data.begin() + position, data.end());
+    }
+
+    // Every type byte has been looked at, so the rest of a big packet can
+    // skip the read and go straight to the client
+    if (
+        passThroughResultSets_
+        && !compressed_
+        && carry_.empty()
+        && payloadRemaining_ >= SPLICE_THRESHOLD
+    )
+    {
+        incomingConnection_->spliceTo(*outgoingConnection_, payloadRemaining_);
+        payloadRemaining_ = 0;
+    }
+}
+
+
+void MySqlErrorMessageBlocker::clearCapabilities(
+    uint8_t* const packet,
+    const size_t length
+) const
+{
+    // The first packet sent from the server is the handshake initialization
+    // packet. This includes information about the server's capabilities.
+    // Result sets are followed by counting their EOF packets, so lie to the
+    // client and clear the bit that would replace those with OK packets. Per
+    // ticket #11, compression isn't supported unless it's been turned on, so
+    // clear that bit too so that the client doesn't try to use it.
+    uint32_t capabilities = MySqlConstants::CLIENT_DEPRECATE_EOF;
+    if (!compression_.isEnabled())
+    {
+        capabilities |= MySqlConstants::CLIENT_COMPRESS;
+    }
+    if (
+        !MySqlAuthentication::clearCapabilities(packet, length, capabilities)
+    )
+    {
+        Logger::log(Logger::ERROR)
+            << "Unable to unset client compression and OK packets instead "
+            << "of EOF packets";
+    }
+}
+
+
+void MySqlErrorMessageBlocker::emit(
+    vector<uint8_t>* const output,
+    const uint8_t* const begin,
+    const uint8_t* const end
+) const
+{
+    if (begin == end)
+    {
+        return;
+    }
+    if (nullptr != output)
+    {
+        output->insert(output->end(), begin, end);
         return;
     }
+    outgoingConnection_->send(begin, end - begin);
+}
+
+
+void MySqlErrorMessageBlocker::emit(
+    vector<uint8_t>* const output,
+    const vector<uint8_t>& packet
+) const
+{
+    emit(output, &packet[0], &packet[0] + packet.size());
+}
+
+
+void MySqlErrorMessageBlocker::replaceError(
+    vector<uint8_t>* const output,
+    const uint8_t* const packet,
+    const size_t length
+) const
+{
+    MySqlSocket* mySqlSocketPtr;
+    #ifndef NDEBUG
+        mySqlSocketPtr = dynamic_cast<MySqlSocket*>(outgoingConnection_);
+        assert(
+            nullptr != mySqlSocketPtr &&
+            "MySqlErrorMessageBlocker should have MySqlSockets"
+        );
+    #else
+        mySqlSocketPtr = static_cast<MySqlSocket*>(outgoingConnection_);
+    #endif
 
-    // First byte of the payload is the result type
-    const uint8_t resultType = rawMessage.at(4);
+    // Fourth byte is the packet number
+    const uint8_t packetNumber = packet[3];
 
-    if (RESULT_ERROR == resultType)
+    // 3: packet length, 1: packet number number,
+    // 1: result type, 2: errno, 6: error code
+    const size_t BEGIN_MESSAGE = 3 + 1 + 1 + 2 + 6;
+    if (length > BEGIN_MESSAGE)
     {
-        // 3: packet length, 1: packet number number,
-        // 1: result type, 2: errno, 6: error code
-        const int BEGIN_MESSAGE = 3 + 1 + 1 + 2 + 6;
-        // Pretend the message is a C-style string for printing
-        rawMessage.push_back('\0');
         Logger::log(Logger::WARN)
             << "Blocked MySQL error message: "
-            << reinterpret_cast<char*>(&rawMessage[BEGIN_MESSAGE]);
+            << string(
+                reinterpret_cast<const char*>(packet + BEGIN_MESSAGE),
+                length - BEGIN_MESSAGE
+            );
+    }
 
-        switch (lastQueryType_)
-        {
-            // Commands that generate results
-            case QueryRisk::TYPE_SELECT:
-            case QueryRisk::TYPE_DESCRIBE:
-            case QueryRisk::TYPE_EXPLAIN:
-            case QueryRisk::TYPE_SHOW:
-                mySqlSocketPtr->sendEmptySetPacket();
-                break;
+    // The query failed partway through the rows, so the client is already
+    // reading a result set and can only be told that it failed
+    if (eofPacketsRemaining_ > 0)
+    {
+        emit(output, mySqlSocketPtr->getErrorPacket(packetNumber));
+        return;
+    }
 
-            // Commands that just get an acknowledgement back
-            case QueryRisk::TYPE_INSERT:
-            case QueryRisk::TYPE_UPDATE:
-            case QueryRisk::TYPE_DELETE:
-            case QueryRisk::TYPE_SET:
-            case QueryRisk::TYPE_TRANSACTION:
-                mySqlSocketPtr->sendOkPacket(packetNumber);
-                break;
+    switch (lastQueryType_)
+    {
+        // Commands that generate results
+        case QueryRisk::TYPE_SELECT:
+        case QueryRisk::TYPE_DESCRIBE:
+        case QueryRisk::TYPE_EXPLAIN:
+        case QueryRisk::TYPE_SHOW:
+            emit(output, mySqlSocketPtr->getEmptySetPacket());
+            break;
 
-            // Invalid queries, things like "DANCE FOR ME MYSQL"
-            case QueryRisk::TYPE_UNKNOWN:
-                mySqlSocketPtr->sendErrorPacket(packetNumber);
-                break;
+        // Commands that just get an acknowledgement back
+        case QueryRisk::TYPE_INSERT:
+        case QueryRisk::TYPE_UPDATE:
+        case QueryRisk::TYPE_DELETE:
+        case QueryRisk::TYPE_SET:
+        case QueryRisk::TYPE_TRANSACTION:
+            emit(output, mySqlSocketPtr->getOkPacket(packetNumber));
+            break;
 
-            default:
-                Logger::log(Logger::ERROR)
-                    << "Unexpected case for last query type "
-                    << "in MySqlErrorMessageBlocker "
-                    << lastQueryType_;
-                assert(false);
-                mySqlSocketPtr->sendErrorPacket(packetNumber);
-        }
+        // Invalid queries, things like "DANCE FOR ME MYSQL"
+        case QueryRisk::TYPE_UNKNOWN:
+            emit(output, mySqlSocketPtr->getErrorPacket(packetNumber));
+            break;
+
+        default:
+            Logger::log(Logger::ERROR)
+                << "Unexpected case for last query type "
+                << "in MySqlErrorMessageBlocker "
+                << lastQueryType_;
+            assert(false);
+            emit(output, mySqlSocketPtr->getErrorPacket(packetNumber));
     }
-    else // Forward everything except errors
+}
+
+
+bool MySqlErrorMessageBlocker::isResultSetHeader(const uint8_t resultType)
+{
+    const uint8_t RESULT_OK = 0x00;
+    const uint8_t RESULT_LOCAL_INFILE = 0xFB;
+    const uint8_t RESULT_EOF = 0xFE;
+    const uint8_t RESULT_ERROR = 0xFF;
+    // Anything else is the column count
+    return RESULT_OK != resultType
+        && RESULT_LOCAL_INFILE != resultType
+        && RESULT_EOF != resultType
+        && RESULT_ERROR != resultType;
+}
+
+
+void MySqlErrorMessageBlocker::takePendingQuery() const
+{
+    lock_guard<mutex> lg(pendingQueryMutex_);
+    if (!queryPending_)
     {
-        ProxyHalf::handleMessage(rawMessage);
+        return;
     }
+    queryPending_ = false;
+    lastQueryType_ = pendingQueryType_;
+    responseExpected_ = true;
+    eofPacketsRemaining_ = 0;
 }
 
 
 void MySqlErrorMessageBlocker::setQueryType(const QueryRisk::QueryType type)
 {
-    lastQueryType_ = type;
+    lock_guard<mutex> lg(pendingQueryMutex_);
+    pendingQueryType_ = type;
+    queryPending_ = true;
+}
+
+
+void MySqlErrorMessageBlocker::startCompression()
+{
+    assert(compression_.isEnabled());
+    compressionRequested_ = true;
+}
+
+
+void MySqlErrorMessageBlocker::setCompressedSequenceOffset(
+    const uint8_t offset
+)
+{
+    sequenceOffset_ = offset;
 }
@@ -21,6 +21,7 @@
 #ifndef SRC_MYSQLERRORMESSAGEBLOCKER_HPP_
 #define SRC_MYSQLERRORMESSAGEBLOCKER_HPP_
 
+#include "MySqlCompression.hpp"
 #include "ProxyHalf.hpp"
 #include "QueryRisk.hpp"
 class MySqlSocket;
@@ -29,6 +30,7 @@ class MySqlSocket;
 #include <vector>
 #include <fstream>
 #include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
 
 /**
  * Half of a full proxy that receives responses from a MySQL database and
@@ -48,9 +50,15 @@ public:
      * @param incomingConnection The socket to listen on.
      * @param outgoingConnection The socket to write to.
      * logged.
+     * @param passThroughResultSets Once the start of a large packet has been
+     *  checked, splice the rest of it straight to the client instead of
+     *  reading it. Both sockets must be blocking.
+     * @param compression Whether clients may use the compressed protocol,
+     *  and how to compress any frames that have to be rebuilt.
      */
     MySqlErrorMessageBlocker(MySqlSocket* incomingConnection,
-        MySqlSocket* outgoingConnection);
+        MySqlSocket* outgoingConnection, bool passThroughResultSets = false,
+        const MySqlCompression& compression = MySqlCompression());
 
     /**
      * Copy constructor needed for Boost threads. This can't be const because
@@ -66,10 +74,45 @@ public:
     /**
      * Tell the class what kind of query generated a particular response. This
      * way, the blocker can tailor the error message. For example, INSERT
-     * queries can return an 'OK' packet.
+     * queries can return an 'OK' packet. This needs to be called before the
+     * query is forwarded to MySQL.
      */
     void setQueryType(QueryRisk::QueryType type);
 
+    /**
+     * Tell the class that the client asked for compression. Both sides
+     * switch to compressed frames once the server accepts the login.
+     */
+    void startCompression();
+
+    /**
+     * Returns true once the connection uses compressed frames.
+     */
+    inline bool isCompressed() const { return compressed_; }
+
+    /**
+     * Tell the class how far the sequence numbers of the frames that the
+     * client sent are ahead of the ones that MySQL received, so that the
+     * responses can be numbered the way the client expects.
+     */
+    void setCompressedSequenceOffset(uint8_t offset);
+
+    /**
+     * Returns the scramble from the server's handshake, which is needed to
+     * log the client in to other servers. Empty until the handshake has
+     * been received.
+     */
+    inline const std::vector<uint8_t>& getScramble() const
+    {
+        return scramble_;
+    }
+
+    /**
+     * Returns the server status flags from the end of the last response,
+     * e.g. to tell if the connection is in a transaction.
+     */
+    inline uint16_t getServerStatus() const { return serverStatus_; }
+
 private:
     /**
      * Handles a message from MySQL. Inherited from ProxyHalf.
@@ -77,14 +120,99 @@ private:
     void handleMessage(std::vector<uint8_t>& rawMessage) const;
 
     /**
-     * Sends an error packet to the client.
-     * @param packetNumber The packet number that should be in the packet.
-     * @throw SocketExpcetion
+     * Handles the whole compressed frames in frames_. Frames that are
+     * unchanged are forwarded as they are.
+     * @throw SocketException
+     */
+    void handleFrames() const;
+
+    /**
+     * Checks every packet in some uncompressed data from MySQL and forwards
+     * it, replacing any error messages. A packet that is cut off is kept
+     * until the rest of it arrives.
+     * @throw SocketException
      */
-    void sendErrorPacket(uint8_t packetNumber) const;
+    void filterPackets(std::vector<uint8_t>& data) const;
 
-    QueryRisk::QueryType lastQueryType_;
+    /**
+     * Forwards data to the client.
+     * @param output If set, the data is appended here instead.
+     */
+    ///@{
+    void emit(std::vector<uint8_t>* output, const uint8_t* begin,
+        const uint8_t* end) const;
+    void emit(std::vector<uint8_t>* output,
+        const std::vector<uint8_t>& packet) const;
+    ///@}
+
+    /**
+     * Clears the bits in the server's handshake packet for what the blocker
+     * can't follow: compression, unless it's enabled, and OK packets
+     * instead of EOF packets at the ends of result sets.
+     * @param packet The whole handshake packet, header included.
+     * @param length The length of the packet.
+     */
+    void clearCapabilities(uint8_t* packet, size_t length) const;
+
+    /**
+     * Logs an error packet from MySQL and sends a generic replacement for it
+     * to the client.
+     * @param output If set, the replacement is appended here instead.
+     * @param packet The whole error packet, header included.
+     * @param length The length of the packet.
+     * @throw SocketException
+     */
+    void replaceError(std::vector<uint8_t>* output, const uint8_t* packet,
+        size_t length) const;
+
+    /**
+     * Returns true if the first byte of a response's payload starts a result
+     * set, i.e. it's a column count and not an OK, EOF or error packet.
+     */
+    static bool isResultSetHeader(uint8_t resultType);
+
+    /**
+     * Starts expecting the response to the query from the last call to
+     * setQueryType, if there's been one since this was last called.
+     */
+    void takePendingQuery() const;
+
+    /// The type of the query whose response is being handled
+    mutable QueryRisk::QueryType lastQueryType_;
     mutable bool firstPacket_;
+    const bool passThroughResultSets_;
+    /// Set when a query has been forwarded and its response hasn't started
+    mutable bool responseExpected_;
+    /// EOF packets left before the current result set ends
+    mutable int eofPacketsRemaining_;
+    /// setQueryType is called from the client's thread, so the query is
+    /// handed over here and taken by the thread that reads from MySQL
+    ///@{
+    mutable QueryRisk::QueryType pendingQueryType_;
+    mutable bool queryPending_;
+    mutable boost::mutex pendingQueryMutex_;
+    ///@}
+    /// Bytes of the current packet that haven't been forwarded yet
+    mutable size_t payloadRemaining_;
+    /// Set when the current packet continues the previous one
+    mutable bool continuation_;
+    /// The start of a packet that was split across reads
+    mutable std::vector<uint8_t> carry_;
+    mutable std::vector<uint8_t> scramble_;
+    mutable volatile uint16_t serverStatus_;
+
+    const MySqlCompression compression_;
+    volatile bool compressionRequested_;
+    mutable volatile bool compressed_;
+    volatile uint8_t sequenceOffset_;
+    /// Compressed frames that haven't been completely received yet
+    mutable std::vector<uint8_t> frames_;
+    /// Reused buffers for handling compressed frames
+    ///@{
+    mutable std::vector<uint8_t> frameData_;
+    mutable std::vector<uint8_t> frameOutput_;
+    mutable std::vector<uint8_t> framesOut_;
+    ///@}
 
     // ***** Hidden methods *****
     MySqlErrorMessageBlocker& operator=(const MySqlErrorMessageBlocker&);
@@ -18,20 +18,30 @@
  * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "AttackProbabilities.hpp"
 #include "Logger.hpp"
+#include "MySqlAuthentication.hpp"
+#include "MySqlBackendConnection.hpp"
+#include "MySqlBackendPool.hpp"
+#include "MySqlCompression.hpp"
+#include "MySqlConnectionPool.hpp"
 #include "nullptr.hpp"
 #include "MySqlConstants.hpp"
-#include "MySqlConstants.hpp"
 #include "MySqlErrorMessageBlocker.hpp"
 #include "MySqlGuard.hpp"
 #include "MySqlGuardObjectContainer.hpp"
 #include "MySqlLoginCheck.hpp"
+#include "MySqlPacketReader.hpp"
 #include "MySqlSocket.hpp"
+#include "PacketBufferPool.hpp"
 #include "ParserInterface.hpp"
 #include "ProxyHalf.hpp"
+#include "QueryDecisionCache.hpp"
 #include "QueryRisk.hpp"
+#include "QueryShapeCache.hpp"
 #include "QueryWhitelist.hpp"
 #include "Socket.hpp"
+#include "SocketException.hpp"
 
 #include <boost/algorithm/string.hpp>
 #include <boost/cstdint.hpp>
@@ -46,18 +56,49 @@ using boost::replace_all;
 MySqlGuard::MySqlGuard(
     MySqlSocket* incomingConnection,
     MySqlSocket* outgoingConnection,
-    MySqlErrorMessageBlocker* blocker
+    MySqlErrorMessageBlocker* blocker,
+    const MySqlCompression& compression,
+    MySqlBackendPool* replicas,
+    MySqlConnectionPool* pool
 ) :
     ProxyHalf(incomingConnection, outgoingConnection),
     firstPacket_(true),
     lastCommandCode_('\0'),
-    packetLength_(0),
-    packetLengthSoFar_(0),
+    reader_(),
     command_(),
     messageParts_(),
+    forwardedParts_(),
     commandCode_(),
-    waitingForMore_(false),
+    compression_(compression),
+    compressionRequested_(false),
+    frames_(),
+    frameData_(),
+    uncompressed_(),
+    clientSequence_(0),
+    messageSequence_(0),
+    sequenceOffset_(0),
+    replicas_(nullptr == blocker ? nullptr : replicas),
+    session_(),
+    replicaLogin_(false),
+    user_(),
+    characterSet_(0),
+    passwordHash_(),
+    replica_(nullptr),
+    replicaIndex_(-1),
+    replicaVersion_(0),
+    replicaDatabase_(),
+    replicaResponse_(),
+    pool_(nullptr == blocker ? nullptr : pool),
+    backend_(nullptr),
+    backendDirty_(false),
+    previousSession_(),
+    poolResponse_(),
+    responseData_(),
     blocker_(blocker),
+    loginTimeout_(0),
+    queryTimeout_(0),
+    decisionCache_(nullptr),
+    shapeCache_(nullptr),
     probabilityBlockLevel_(PROBABILITY_BLOCK_LEVEL),
     probabilityLogLevel_(PROBABILITY_LOG_LEVEL)
 {
@@ -66,71 +107,172 @@ MySqlGuard::MySqlGuard(
 
 MySqlGuard::~MySqlGuard()
 {
+    dropReplica();
+    detachBackend(true);
+    releaseParts(&messageParts_);
+    releaseParts(&forwardedParts_);
+    releaseParts(&replicaResponse_);
+    releaseParts(&poolResponse_);
+    PacketBufferPool::release(&responseData_);
 }
 
 
-void MySqlGuard::handleMessage(std::vector<uint8_t>& rawMessage) const
+void MySqlGuard::setTimeouts(
+    const int loginMilliseconds,
+    const int queryMilliseconds
+)
 {
-    assert(
-        rawMessage.size() >= 5
-        && "MySQL message in MySqlGuard is unexpectedly short"
-    );
-    if (rawMessage.size() < 5)
-    {
-        ProxyHalf::handleMessage(rawMessage);
-        return;
-    }
+    loginTimeout_ = loginMilliseconds;
+    queryTimeout_ = queryMilliseconds;
+}
 
-    // The first packet is the authentication packet
-    if (firstPacket_)
+
+void MySqlGuard::useDecisionCache(QueryDecisionCache* const cache)
+{
+    decisionCache_ = cache;
+}
+
+
+void MySqlGuard::useShapeCache(QueryShapeCache* const cache)
+{
+    shapeCache_ = cache;
+}
+
+
+int MySqlGuard::getReceiveTimeout() const
+{
+    if (firstPacket_ && loginTimeout_ > 0)
     {
-        handleFirstPacket(rawMessage);
-        return;
+        return loginTimeout_;
     }
+    return ProxyHalf::getReceiveTimeout();
+}
+
 
-    // If it's the beginning of a new message (4th byte is packet number)
-    // or if it's a continuation of a previous message
-    if (0 == rawMessage.at(3) || waitingForMore_)
+void MySqlGuard::handleMessage(std::vector<uint8_t>& rawMessage) const
+{
+    // Reads don't line up with commands; a command can be split across
+    // several reads, so only handle whole ones
+    // Everything that a read produced goes out together, i.e. all of the
+    // packets that were let through in one write to the server and all of
+    // the fake responses in one write to the client
+    incomingConnection_->beginBatch();
+    try
     {
-        if (!waitingForMore_)  // Beginning of new message
+        if (isCompressed())
+        {
+            handleFrames(rawMessage);
+        }
+        else
         {
-            packetLengthSoFar_ = 0;
-            messageParts_.clear();
-            command_.assign(rawMessage.begin() + 5, rawMessage.end());
-
-            // 1st-3rd bytes are the packet length
-            const uint8_t byte1 = rawMessage.at(0);
-            const uint8_t byte2 = rawMessage.at(1);
-            const uint8_t byte3 = rawMessage.at(2);
-            const uint8_t headerLength = 4;
-            packetLength_ = byte1 + (byte2 << 8) + (byte3 << 16) + headerLength;
-
-            // 5th byte is the command code
-            commandCode_ = rawMessage.at(4);
-            lastCommandCode_ = commandCode_;
+            reader_.append(&rawMessage);
+            handleCommands();
         }
-        else  // Continuation of previous command
+        // Pooled connections run each command as it comes
+        if (nullptr == pool_)
         {
-            command_.append(rawMessage.begin(), rawMessage.end());
+            outgoingConnection_->send(forwardedParts_);
         }
+    }
+    catch (...)
+    {
+        releaseParts(&messageParts_);
+        releaseParts(&forwardedParts_);
+        throw;
+    }
+    releaseParts(&forwardedParts_);
+    incomingConnection_->endBatch();
+}
 
-        packetLengthSoFar_ += rawMessage.size();
 
-        if (packetLengthSoFar_ < packetLength_)
+void MySqlGuard::handleFrames(const vector<uint8_t>& rawMessage) const
+{
+    frames_.insert(frames_.end(), rawMessage.begin(), rawMessage.end());
+    size_t offset = 0;
+    size_t length;
+    while (0 != (length = MySqlCompression::frameLength(frames_, offset)))
+    {
+        // Replies are numbered following on from the client's frames
+        clientSequence_ = frames_[offset + 3];
+        if (reader_.empty())
         {
-            // There will be more packets, so save this one and wait
-            messageParts_.push_back(rawMessage);
-
-            waitingForMore_ = true;
-            return;
+            messageSequence_ = clientSequence_;
         }
-        else  // Got the whole packet
+        frameData_.clear();
+        MySqlCompression::decompressFrame(
+            &frames_[offset],
+            length,
+            &frameData_
+        );
+        reader_.append(&frameData_);
+        handleCommands();
+        offset += length;
+    }
+    frames_.erase(frames_.begin(), frames_.begin() + offset);
+}
+
+
+void MySqlGuard::handleCommands() const
+{
+    while (reader_.nextMessage(&messageParts_))
+    {
+        handleCommand();
+        releaseParts(&messageParts_);
+    }
+}
+
+
+void MySqlGuard::handleCommand() const
+{
+    assert(!messageParts_.empty());
+    vector<uint8_t>& firstPart = messageParts_.front();
+
+    // The first packet is the authentication packet
+    if (firstPacket_)
+    {
+        handleFirstPacket(firstPart);
+        return;
+    }
+
+    // Packets that don't start a new command (the first packet number isn't
+    // 0) are answers to the server, like LOAD DATA LOCAL INFILE contents
+    if (
+        firstPart.size() < MySqlPacketReader::HEADER_LENGTH + 1
+        || 0 != firstPart.at(3)
+    )
+    {
+        // Pooled connections don't ask for these, see runOnPool
+        if (nullptr == pool_)
         {
-            packetLengthSoFar_ = 0;
-            waitingForMore_ = false;
+            forwardMessageParts();
         }
+        return;
     }
 
+    // 5th byte is the command code, and the rest of the payloads are the
+    // command, e.g. the query
+    commandCode_ = firstPart.at(4);
+    lastCommandCode_ = commandCode_;
+    // Leave room for the parser to scan the query in place
+    size_t commandLength =
+        firstPart.size() - MySqlPacketReader::HEADER_LENGTH - 1;
+    for (size_t i = 1; i < messageParts_.size(); ++i)
+    {
+        commandLength +=
+            messageParts_[i].size() - MySqlPacketReader::HEADER_LENGTH;
+    }
+    command_.reserve(commandLength + ParserInterface::SCAN_PADDING);
+    command_.assign(
+        firstPart.begin() + MySqlPacketReader::HEADER_LENGTH + 1,
+        firstPart.end()
+    );
+    for (size_t i = 1; i < messageParts_.size(); ++i)
+    {
+        command_.append(
+            messageParts_[i].begin() + MySqlPacketReader::HEADER_LENGTH,
+            messageParts_[i].end()
+        );
+    }
 
     MySqlSocket* mySqlSocket;
     #ifndef NDEBUG
@@ -142,17 +284,56 @@ void MySqlGuard::handleMessage(std::vector<uint8_t>& rawMessage) const
     #else
         mySqlSocket = static_cast<MySqlSocket*>(incomingConnection_);
     #endif
-    const uint8_t messageNumber = rawMessage.at(3);
+    // Replies have to follow on from the last packet
+    const uint8_t messageNumber = messageParts_.back().at(3);
+    // Lets a failed command undo its changes to the session
+    previousSession_ = session_;
 
     bool dangerous;
     QueryRisk::QueryType type;
     switch (commandCode_)
     {
-        // All of these are safe and should be forwarded
         // Choose a database
         case MySqlConstants::COM_INIT_DB:
-        // Parameterized statement stuff
+            if (!attachBackend(messageNumber))
+            {
+                break;
+            }
+            session_.setDatabase(command_);
+            forwardMessageParts();
+            break;
+
+        // The replica would still be logged in as the old user
+        case MySqlConstants::COM_CHANGE_USER:
+            if (nullptr != pool_)
+            {
+                // Pooled connections belong to one user, and SQLassie would
+                // have to answer the new login itself
+                sendResponse(
+                    mySqlSocket->getErrorPacket(
+                        messageNumber + 1,
+                        MySqlConstants::ERROR_NOT_SUPPORTED_YET,
+                        "Changing users isn't supported"
+                    )
+                );
+                break;
+            }
+            replicaLogin_ = false;
+            dropReplica();
+            forwardMessageParts();
+            break;
+
+        // Prepared statements only exist on the connection that made them
         case MySqlConstants::COM_STMT_PREPARE:
+            if (nullptr != pool_)
+            {
+                session_.makeUnportable();
+            }
+            forwardMessageParts();
+            break;
+
+        // All of these are safe and should be forwarded
+        // Parameterized statement stuff
         case MySqlConstants::COM_STMT_CLOSE:
         case MySqlConstants::COM_STMT_EXECUTE:
         case MySqlConstants::COM_STMT_RESET:
@@ -160,8 +341,6 @@ void MySqlGuard::handleMessage(std::vector<uint8_t>& rawMessage) const
         case MySqlConstants::COM_STMT_SEND_LONG_DATA:
         // Set MySQL options
         case MySqlConstants::COM_SET_OPTION:
-        // Change user
-        case MySqlConstants::COM_CHANGE_USER:
         // Master slave replication stuff
         case MySqlConstants::COM_REFRESH:
         case MySqlConstants::COM_BINLOG_DUMP:
@@ -176,7 +355,7 @@ void MySqlGuard::handleMessage(std::vector<uint8_t>& rawMessage) const
         case MySqlConstants::COM_STATISTICS:
         case MySqlConstants::COM_DEBUG:
 
-            ProxyHalf::handleMessage(rawMessage);
+            forwardMessageParts();
             break;
 
         // These are unsafe and should not be sent to the server
@@ -184,7 +363,7 @@ void MySqlGuard::handleMessage(std::vector<uint8_t>& rawMessage) const
         case MySqlConstants::COM_DROP_DB:
         case MySqlConstants::COM_PROCESS_KILL:
         case MySqlConstants::COM_SHUTDOWN:
-            mySqlSocket->sendEmptySetPacket();
+            sendResponse(mySqlSocket->getEmptySetPacket());
             break;
 
         // These are internal states and should not be sent to us
@@ -194,7 +373,7 @@ void MySqlGuard::handleMessage(std::vector<uint8_t>& rawMessage) const
         case MySqlConstants::COM_TIME:
         case MySqlConstants::COM_DELAYED_INSERT:
         case MySqlConstants::COM_CONNECT_OUT:
-            mySqlSocket->sendErrorPacket(messageNumber + 1);
+            sendResponse(mySqlSocket->getErrorPacket(messageNumber + 1));
             break;
 
         case MySqlConstants::COM_QUIT:
@@ -203,39 +382,28 @@ void MySqlGuard::handleMessage(std::vector<uint8_t>& rawMessage) const
 
         case MySqlConstants::COM_QUERY:
             // Analyze the query
-            analyzeQuery(command_, &dangerous, &type);
+            analyzeQuery(&command_, &dangerous, &type);
 
             if (!dangerous)
             {
-                // Let the MySqlErrorMessageBlocker know what type the query is
-                if (nullptr != blocker_)
+                if (runOnReplica(type) || !attachBackend(messageNumber))
                 {
-                    blocker_->setQueryType(type);
+                    break;
                 }
+                session_.observeQuery(command_, type);
 
-                // If the message has been split into a bunch of parts, then
-                // send those parts first
-                if (!messageParts_.empty())
+                // Let the MySqlErrorMessageBlocker know what type the query is
+                if (nullptr != blocker_)
                 {
-                    vector<vector<uint8_t> >::const_iterator end(
-                        messageParts_.end()
-                    );
-                    for (
-                        vector<vector<uint8_t> >::iterator i(
-                            messageParts_.begin()
-                        );
-                        i != end;
-                        ++i
-                    )
+                    blocker_->setQueryType(type);
+                    // Pooled queries are answered before this returns
+                    if (queryTimeout_ > 0 && nullptr == pool_)
                     {
-                        ProxyHalf::handleMessage(*i);
+                        blocker_->expectDataWithin(queryTimeout_);
                     }
-                    messageParts_.clear();
                 }
 
-                // This is either the whole message, or the last part of the
-                // message - send it either way
-                ProxyHalf::handleMessage(rawMessage);
+                forwardMessageParts();
             }
             // Dangerous packet
             else
@@ -247,7 +415,7 @@ void MySqlGuard::handleMessage(std::vector<uint8_t>& rawMessage) const
                     case QueryRisk::TYPE_DESCRIBE:
                     case QueryRisk::TYPE_EXPLAIN:
                     case QueryRisk::TYPE_SHOW:
-                        mySqlSocket->sendEmptySetPacket();
+                        sendResponse(mySqlSocket->getEmptySetPacket());
                         break;
 
                     // Commands that just get an acknowledgement back
@@ -256,12 +424,16 @@ void MySqlGuard::handleMessage(std::vector<uint8_t>& rawMessage) const
                     case QueryRisk::TYPE_DELETE:
                     case QueryRisk::TYPE_SET:
                     case QueryRisk::TYPE_TRANSACTION:
-                        mySqlSocket->sendOkPacket(messageNumber + 1);
+                        sendResponse(
+                            mySqlSocket->getOkPacket(messageNumber + 1)
+                        );
                         break;
 
                     // Invalid queries, things like "DANCE FOR ME MYSQL"
                     case QueryRisk::TYPE_UNKNOWN:
-                        mySqlSocket->sendErrorPacket(messageNumber + 1);
+                        sendResponse(
+                            mySqlSocket->getErrorPacket(messageNumber + 1)
+                        );
                         break;
 
                     default:
@@ -269,13 +441,10 @@ void MySqlGuard::handleMessage(std::vector<uint8_t>& rawMessage) const
                             << "Unexpected case in MySqlGuard::handleMessage() "
                             << type;
                         assert(false);
-                        checkBadNumbers(
-                            string(
-                                rawMessage.begin(),
-                                rawMessage.end()
-                            )
+                        checkBadNumbers(command_);
+                        sendResponse(
+                            mySqlSocket->getErrorPacket(messageNumber + 1)
                         );
-                        mySqlSocket->sendErrorPacket(messageNumber + 1);
                 }
             }
             break;
@@ -286,201 +455,413 @@ void MySqlGuard::handleMessage(std::vector<uint8_t>& rawMessage) const
                 << commandCode_;
             assert(false);
             // Default to just sending it
-            ProxyHalf::handleMessage(rawMessage);
+            forwardMessageParts();
             break;
     }
 }
 
 
-void MySqlGuard::analyzeQuery(
-    const string& query,
-    bool* const dangerous,
-    QueryRisk::QueryType* const queryType
-) const
+void MySqlGuard::forwardMessageParts() const
 {
-    QueryRisk qr;
-    int status;
+    if (nullptr != pool_)
+    {
+        runOnPool();
+        return;
+    }
+    if (!isCompressed())
+    {
+        for (size_t i = 0; i < messageParts_.size(); ++i)
+        {
+            forwardedParts_.push_back(vector<uint8_t>());
+            forwardedParts_.back().swap(messageParts_[i]);
+        }
+        return;
+    }
 
-    ParserInterface interface(query);
-    status = interface.parse(&qr);
+    uncompressed_.clear();
+    for (size_t i = 0; i < messageParts_.size(); ++i)
+    {
+        uncompressed_.insert(
+            uncompressed_.end(),
+            messageParts_[i].begin(),
+            messageParts_[i].end()
+        );
+    }
 
-    // Check for whitelisted queries
-    /// @TODO(bskari) should parse whitelisted only be checked if it fails to
-    /// parse?
-    if (
-        QueryWhitelist::isParseWhitelisted(interface.getHash()) ||
-        QueryWhitelist::isBlockWhitelisted(interface.getHash(), qr)
-    )
+    // The frames of a new command are numbered from 0, while answers to the
+    // server, like LOAD DATA LOCAL INFILE contents, carry on from the
+    // server's last frame
+    const bool command = (0 == messageParts_.front().at(3));
+    const uint8_t firstSequence =
+        (command ? 0 : messageSequence_ - sequenceOffset_);
+    forwardedParts_.push_back(vector<uint8_t>());
+    PacketBufferPool::acquire(&forwardedParts_.back());
+    const uint8_t lastSequence = compression_.appendFrames(
+        &uncompressed_[0],
+        uncompressed_.size(),
+        firstSequence,
+        &forwardedParts_.back()
+    );
+
+    // Usually the client's frames and ours line up, but if they don't, the
+    // responses have to be renumbered
+    sequenceOffset_ = clientSequence_ - lastSequence;
+    blocker_->setCompressedSequenceOffset(sequenceOffset_);
+}
+
+
+void MySqlGuard::sendResponse(const vector<uint8_t>& packets) const
+{
+    if (!isCompressed())
     {
-        *dangerous = false;
-        *queryType = QueryRisk::TYPE_UNKNOWN;
+        incomingConnection_->send(packets);
         return;
     }
+    uncompressed_.clear();
+    compression_.appendFrames(
+        &packets[0],
+        packets.size(),
+        clientSequence_ + 1,
+        &uncompressed_
+    );
+    incomingConnection_->send(uncompressed_);
+}
 
-    *queryType = qr.queryType;
 
-    // If the query was not successfully parsed (i.e. it's an invalid query)
-    if (0 != status || !qr.valid)
+bool MySqlGuard::runOnReplica(const QueryRisk::QueryType type) const
+{
+    if (nullptr == replicas_ || !replicaLogin_)
+    {
+        return false;
+    }
+    session_.setServerStatus(blocker_->getServerStatus());
+    // Anything that was let through earlier in this read hasn't even been
+    // sent to the primary yet, and responses have to stay in order
+    if (
+        QueryRisk::TYPE_SELECT != type
+        || isCompressed()
+        || !forwardedParts_.empty()
+        || session_.inTransaction()
+        || !session_.isPortable()
+        || !MySqlSessionState::isReplicaSafe(command_)
+    )
+    {
+        return false;
+    }
+
+    bool succeeded;
+    try
+    {
+        if (!prepareReplica())
+        {
+            return false;
+        }
+        succeeded = replica_->runCommand(messageParts_, &replicaResponse_);
+    }
+    catch (SocketException& e)
     {
         Logger::log(Logger::WARN)
-            << "Blocked invalid query '"
-            << query
-            << "'";
-        *dangerous = true;
-        return;
+            << "Lost connection to replica, using the primary instead: "
+            << e.what();
+        replicas_->markDown(replicaIndex_);
+        dropReplica();
+        releaseParts(&replicaResponse_);
+        return false;
+    }
+
+    // Let the primary answer instead, e.g. if the replica is behind and
+    // doesn't have a table yet; its errors go through the blocker
+    if (!succeeded)
+    {
+        Logger::log(Logger::DEBUG)
+            << "Replica returned an error, using the primary instead";
+        releaseParts(&replicaResponse_);
+        return false;
     }
+    incomingConnection_->send(replicaResponse_);
+    releaseParts(&replicaResponse_);
+    return true;
+}
 
-    *dangerous = false;
-    string formattedQuery;
-    bool formatted = false;
 
-    // Authentication bypass attack
-    if (QueryRisk::TYPE_SELECT == qr.queryType && qr.userTable)
+bool MySqlGuard::prepareReplica() const
+{
+    if (nullptr == replica_)
     {
-        const double probability =
-            MySqlGuardObjectContainer::getProbabilityOfBypassAttack(qr);
-        *dangerous = *dangerous || (probability >= probabilityBlockLevel_);
-        if (probability > probabilityLogLevel_)
+        replicaIndex_ = replicas_->acquire();
+        if (-1 == replicaIndex_)
         {
-            if (!formatted)
-            {
-                formatted = true;
-                formattedQuery = query;
-                formatQuery(formattedQuery);
-            }
-            MySqlGuardObjectContainer::logBlockedQuery(
-                formattedQuery,
-                "bypass",
-                probability
-            );
+            return false;
+        }
+        replica_ = replicas_->connect(replicaIndex_);
+        if (nullptr == replica_)
+        {
+            dropReplica();
+            return false;
+        }
+        if (
+            !replica_->logIn(
+                user_,
+                passwordHash_,
+                characterSet_,
+                session_.getDatabase()
+            )
+        )
+        {
+            // If the replica doesn't take the login now, it won't later
+            Logger::log(Logger::WARN)
+                << "Replica refused the login for "
+                << user_
+                << ", sending all of its queries to the primary";
+            replicaLogin_ = false;
+            dropReplica();
+            return false;
         }
+        replicaDatabase_ = session_.getDatabase();
+        replicaVersion_ = 0;
     }
 
-    // Data access attack
-    if (QueryRisk::TYPE_SELECT == qr.queryType)
+    if (session_.getVersion() == replicaVersion_)
     {
-        const double probability =
-            MySqlGuardObjectContainer::getProbabilityOfAccessAttack(qr);
-        *dangerous = *dangerous || (probability >= probabilityBlockLevel_);
-        if (probability > probabilityLogLevel_)
+        return true;
+    }
+    if (
+        session_.getDatabase() != replicaDatabase_
+        && !replica_->runCommand(
+            MySqlConstants::COM_INIT_DB,
+            session_.getDatabase(),
+            nullptr
+        )
+    )
+    {
+        return false;
+    }
+    replicaDatabase_ = session_.getDatabase();
+    // Setting things again is harmless, so just run all of them
+    const vector<string>& statements = session_.getStatements();
+    for (size_t i = 0; i < statements.size(); ++i)
+    {
+        if (
+            !replica_->runCommand(
+                MySqlConstants::COM_QUERY,
+                statements[i],
+                nullptr
+            )
+        )
         {
-            if (!formatted)
-            {
-                formatted = true;
-                formattedQuery = query;
-                formatQuery(formattedQuery);
-            }
-            MySqlGuardObjectContainer::logBlockedQuery(
-                formattedQuery,
-                "data access",
-                   probability
-            );
+            return false;
         }
     }
+    replicaVersion_ = session_.getVersion();
+    return true;
+}
+
+
+void MySqlGuard::dropReplica() const
+{
+    if (nullptr != replica_)
+    {
+        replica_->close();
+        delete replica_;
+        replica_ = nullptr;
+    }
+    if (-1 != replicaIndex_)
+    {
+        replicas_->release(replicaIndex_);
+        replicaIndex_ = -1;
+    }
+}
+
+
+bool MySqlGuard::isCompressed() const
+{
+    return compressionRequested_ && blocker_->isCompressed();
+}
 
-    // Data modification attack
+
+void MySqlGuard::releaseParts(vector<vector<uint8_t> >* const parts)
+{
+    for (size_t i = 0; i < parts->size(); ++i)
+    {
+        PacketBufferPool::release(&(*parts)[i]);
+    }
+    // Keeps its capacity, so adding parts later doesn't allocate
+    parts->clear();
+}
+
+
+void MySqlGuard::analyzeQuery(
+    string* const query,
+    bool* const dangerous,
+    QueryRisk::QueryType* const queryType
+) const
+{
+    assert(nullptr != query);
+
+    QueryDecisionCache::Decision decision;
     if (
-        QueryRisk::TYPE_UPDATE == qr.queryType ||
-        QueryRisk::TYPE_INSERT == qr.queryType ||
-        QueryRisk::TYPE_DELETE == qr.queryType
+        nullptr == decisionCache_
+        || !decisionCache_->find(
+            *query,
+            session_.getDatabase(),
+            probabilityBlockLevel_,
+            probabilityLogLevel_,
+            &decision
+        )
     )
     {
-        const double probability =
-            MySqlGuardObjectContainer::getProbabilityOfModificationAttack(qr);
-        *dangerous = *dangerous || (probability >= probabilityBlockLevel_);
-        if (probability > probabilityLogLevel_)
+        // Queries that went over the parse budget are decided again,
+        // because whether they fit in its time limit depends on how busy
+        // the server was
+        if (decideQuery(query, &decision) && nullptr != decisionCache_)
         {
-            if (!formatted)
-            {
-                formatted = true;
-                formattedQuery = query;
-                formatQuery(formattedQuery);
-            }
-            MySqlGuardObjectContainer::logBlockedQuery(
-                formattedQuery,
-                "data modification",
-                   probability
+            decisionCache_->insert(
+                *query,
+                session_.getDatabase(),
+                probabilityBlockLevel_,
+                probabilityLogLevel_,
+                decision
             );
         }
     }
 
-    // Fingerprinting attack
-    // Fingerprinting attacks can come from select or data mods!
-    if (
-        QueryRisk::TYPE_SELECT == qr.queryType
-        || QueryRisk::TYPE_INSERT == qr.queryType
-        || QueryRisk::TYPE_UPDATE == qr.queryType
-        || QueryRisk::TYPE_DELETE == qr.queryType
-    )
+    // Cached decisions are logged too, so that repeated attacks show up
+    if (decision.invalid)
+    {
+        Logger::log(Logger::WARN)
+            << "Blocked invalid query '"
+            << *query
+            << "'";
+    }
+    else if (!decision.reports.empty())
     {
-        const double probability =
-            MySqlGuardObjectContainer::getProbabilityOfFingerprintingAttack(qr);
-        *dangerous = *dangerous || (probability >= probabilityBlockLevel_);
-        if (probability > probabilityLogLevel_)
+        string formattedQuery(*query);
+        formatQuery(formattedQuery);
+        for (size_t i = 0; i < decision.reports.size(); ++i)
         {
-            if (!formatted)
-            {
-                formatted = true;
-                formattedQuery = query;
-                formatQuery(formattedQuery);
-            }
             MySqlGuardObjectContainer::logBlockedQuery(
                 formattedQuery,
-                "fingerprinting",
-                probability
+                decision.reports[i].attackType,
+                decision.reports[i].probability
             );
         }
     }
 
-    // Schema discovery attack
-    // Schema attacks can come from select or data mods!
+    *dangerous = decision.dangerous;
+    *queryType = decision.queryType;
+}
+
+
+bool MySqlGuard::decideQuery(
+    string* const query,
+    QueryDecisionCache::Decision* const decision
+) const
+{
+    QueryRisk qr;
+    int status;
+
+    ParserInterface interface(query, shapeCache_);
+
+    // Check for whitelisted queries. The hash only needs the scanner, so
+    // parse whitelisted queries are let through without being parsed.
+    /// @TODO(bskari) should parse whitelisted only be checked if it fails to
+    /// parse?
+    bool mightBeBlockWhitelisted = false;
+    if (!QueryWhitelist::isEmpty())
+    {
+        const ParserInterface::QueryHash hash(interface.scanHash());
+        if (QueryWhitelist::isParseWhitelisted(hash))
+        {
+            decision->dangerous = false;
+            decision->queryType = QueryRisk::TYPE_UNKNOWN;
+            return true;
+        }
+        mightBeBlockWhitelisted = QueryWhitelist::isHashBlockWhitelisted(hash);
+    }
+
+    status = interface.parse(&qr);
+
     if (
-        QueryRisk::TYPE_SELECT == qr.queryType
-        || QueryRisk::TYPE_INSERT == qr.queryType
-        || QueryRisk::TYPE_UPDATE == qr.queryType
-        || QueryRisk::TYPE_DELETE == qr.queryType
+        mightBeBlockWhitelisted
+        && QueryWhitelist::isBlockWhitelisted(interface.getHash(), qr)
     )
     {
-        const double probability =
-            MySqlGuardObjectContainer::getProbabilityOfSchemaAttack(qr);
-        *dangerous = *dangerous || (probability >= probabilityBlockLevel_);
-        if (probability > probabilityLogLevel_)
+        decision->dangerous = false;
+        decision->queryType = QueryRisk::TYPE_UNKNOWN;
+        return true;
+    }
+
+    // Queries that the parser gave up on
+    if (ParserInterface::BUDGET_EXCEEDED == status)
+    {
+        decision->queryType = QueryRisk::TYPE_UNKNOWN;
+        if (ParserInterface::getBudget().blockOverBudget)
         {
-            if (!formatted)
-            {
-                formatted = true;
-                formattedQuery = query;
-                formatQuery(formattedQuery);
-            }
-            MySqlGuardObjectContainer::logBlockedQuery(
-                formattedQuery,
-                "schema discovery",
-                probability
-            );
+            decision->dangerous = true;
         }
+        else
+        {
+            decision->dangerous = hasScannerRisks(qr);
+        }
+        Logger::log(Logger::WARN)
+            << "Query went over the parse budget and was "
+            << (decision->dangerous ? "blocked" : "allowed")
+            << ": '"
+            << *query
+            << "'";
+        return false;
+    }
+
+    decision->queryType = qr.queryType;
+
+    // If the query was not successfully parsed (i.e. it's an invalid query)
+    if (0 != status || !qr.valid)
+    {
+        decision->dangerous = true;
+        decision->invalid = true;
+        return true;
     }
 
-    // Denial of service attack
-    if (QueryRisk::TYPE_SELECT == qr.queryType)
+    decision->dangerous = false;
+
+    // The names are reported with the attacks, so keep them as they were
+    static const char* const names[AttackScores::ATTACKS_COUNT] = {
+        "bypass",
+        "data access",
+        "data modification",
+        "fingerprinting",
+        "schema discovery",
+        "denial    of service"
+    };
+
+    AttackScores scores;
+    MySqlGuardObjectContainer::scoreAll(qr, &scores);
+    for (int i = 0; i < AttackScores::ATTACKS_COUNT; ++i)
     {
-        const double probability =
-            MySqlGuardObjectContainer::getProbabilityOfDenialAttack(qr);
-        *dangerous = *dangerous || (probability >= probabilityBlockLevel_);
-        if (probability > probabilityLogLevel_)
+        if (scores.applicable[i])
         {
-            if (!formatted)
-            {
-                formatted = true;
-                formattedQuery = query;
-                formatQuery(formattedQuery);
-            }
-            MySqlGuardObjectContainer::logBlockedQuery(
-                formattedQuery,
-                "denial    of service",
-                probability
-            );
+            addProbability(scores.probabilities[i], names[i], decision);
         }
     }
+    return true;
+}
+
+
+void MySqlGuard::addProbability(
+    const double probability,
+    const char* const attackType,
+    QueryDecisionCache::Decision* const decision
+) const
+{
+    decision->dangerous =
+        decision->dangerous || (probability >= probabilityBlockLevel_);
+    if (probability > probabilityLogLevel_)
+    {
+        QueryDecisionCache::Report report;
+        report.attackType = attackType;
+        report.probability = probability;
+        decision->reports.push_back(report);
+    }
 }
 
 
@@ -519,6 +900,19 @@ bool MySqlGuard::checkBadNumbers(const string& query)
 }
 
 
+bool MySqlGuard::hasScannerRisks(const QueryRisk& qr)
+{
+    return qr.multiLineComments > 0
+        || qr.hashComments > 0
+        || qr.dashDashComments > 0
+        || qr.mySqlComments > 0
+        || qr.mySqlVersionedComments > 0
+        || qr.hexStrings > 0
+        || qr.commentedConditionals > 0
+        || qr.commentedQuotes > 0;
+}
+
+
 void MySqlGuard::handleFirstPacket(vector<uint8_t>& rawMessage) const
 {
     firstPacket_ = false;
@@ -558,19 +952,247 @@ void MySqlGuard::handleFirstPacket(vector<uint8_t>& rawMessage) const
         const uint8_t packetNumber = rawMessage.at(3);
         mss->sendErrorPacket(packetNumber + 1);
         incomingConnection_->close();
-        outgoingConnection_->close();
+        if (nullptr != outgoingConnection_)
+        {
+            outgoingConnection_->close();
+        }
         return;
     }
 
     // Make sure the user can log in from that location
     const string username = reinterpret_cast<char*>(
         &rawMessage.at(3 + 1 + 4 + 4 + 1 + 23));
+    const bool usedPassword =
+        rawMessage.size() > i + 1 && 0 != rawMessage.at(i + 1);
     if (
         !MySqlLoginCheck::validUserHost(
             username,
             incomingConnection_->getPeerName()
         )
     )
+    {
+        denyLogin(username, usedPassword, rawMessage.at(3));
+        return;
+    }
+
+    if (nullptr != pool_)
+    {
+        logInToPool(rawMessage, username, usedPassword);
+        return;
+    }
+    if (nullptr != replicas_)
+    {
+        replicaLogin_ = readLogin(rawMessage);
+    }
+
+    // 3: packet length, 1: packet number
+    const size_t BEGIN_CLIENT_FLAGS = 3 + 1;
+    const bool clientCompresses =
+        0 != (
+            rawMessage.at(BEGIN_CLIENT_FLAGS)
+            & static_cast<uint8_t>(MySqlConstants::CLIENT_COMPRESS)
+        );
+    if (clientCompresses && compression_.isEnabled() && nullptr != blocker_)
+    {
+        // Both sides switch to compressed frames once the server accepts
+        // the login, and the blocker is the one that sees that
+        compressionRequested_ = true;
+        blocker_->startCompression();
+    }
+    else
+    {
+        // It looks like the MySQL command line client won't request
+        // compression if the server doesn't support it, but just to be safe,
+        // let's clear it so that the server won't try to use it.
+        rawMessage.at(BEGIN_CLIENT_FLAGS) =
+            rawMessage.at(BEGIN_CLIENT_FLAGS)
+            & ~(static_cast<uint8_t>(MySqlConstants::CLIENT_COMPRESS));
+    }
+
+    ProxyHalf::handleMessage(rawMessage);
+    return;
+}
+
+
+bool MySqlGuard::readLogin(const vector<uint8_t>& rawMessage) const
+{
+    // See handleFirstPacket for the layout
+    // 3: packet length, 1: packet number
+    const size_t BEGIN_CLIENT_FLAGS = 3 + 1;
+    const size_t BEGIN_CHARACTER_SET = BEGIN_CLIENT_FLAGS + 4 + 4;
+    const size_t BEGIN_USERNAME = BEGIN_CHARACTER_SET + 1 + 23;
+    if (rawMessage.size() <= BEGIN_USERNAME)
+    {
+        return false;
+    }
+    uint32_t flags = 0;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        flags |= rawMessage[BEGIN_CLIENT_FLAGS + i] << (8 * i);
+    }
+    // Old style password hashes can't be recovered
+    if (0 == (flags & MySqlConstants::CLIENT_SECURE_CONNECTION))
+    {
+        return false;
+    }
+
+    size_t i = BEGIN_USERNAME;
+    while (i < rawMessage.size() && '\0' != rawMessage[i])
+    {
+        ++i;
+    }
+    if (i + 1 >= rawMessage.size())
+    {
+        return false;
+    }
+    const string user(
+        reinterpret_cast<const char*>(&rawMessage[BEGIN_USERNAME]),
+        i - BEGIN_USERNAME
+    );
+    const size_t tokenLength = rawMessage[i + 1];
+    const size_t beginToken = i + 2;
+    if (beginToken + tokenLength > rawMessage.size())
+    {
+        return false;
+    }
+    const vector<uint8_t> token(
+        rawMessage.begin() + beginToken,
+        rawMessage.begin() + beginToken + tokenLength
+    );
+    if (0 != (flags & MySqlConstants::CLIENT_CONNECT_WITH_DB))
+    {
+        const size_t beginDatabase = beginToken + tokenLength;
+        size_t end = beginDatabase;
+        while (end < rawMessage.size() && '\0' != rawMessage[end])
+        {
+            ++end;
+        }
+        if (end > beginDatabase)
+        {
+            session_.setDatabase(
+                string(
+                    reinterpret_cast<const char*>(&rawMessage[beginDatabase]),
+                    end - beginDatabase
+                )
+            );
+        }
+    }
+
+    // The user can have a different password for each host, so find the
+    // one that the client answered with
+    vector<vector<uint8_t> > storedHashes;
+    if (!MySqlLoginCheck::getPasswordHashes(user, &storedHashes))
+    {
+        Logger::log(Logger::DEBUG)
+            << "No password hash for "
+            << user
+            << ", can't log in to other servers";
+        return false;
+    }
+    for (size_t j = 0; j < storedHashes.size(); ++j)
+    {
+        if (
+            MySqlAuthentication::recoverPasswordHash(
+                token,
+                blocker_->getScramble(),
+                storedHashes[j],
+                &passwordHash_
+            )
+        )
+        {
+            user_ = user;
+            characterSet_ = rawMessage[BEGIN_CHARACTER_SET];
+            return true;
+        }
+    }
+    return false;
+}
+
+
+string MySqlGuard::getAccessDeniedMessage(
+    const string& username,
+    const bool usedPassword
+) const
+{
+    string errorMessage("Access denied for user '");
+    errorMessage += username;
+    errorMessage += "'@'";
+    errorMessage += incomingConnection_->getPeerName();
+    errorMessage += "' (using password: ";
+    errorMessage += (usedPassword ? "YES)" : "NO)");
+    return errorMessage;
+}
+
+
+void MySqlGuard::denyLogin(
+    const string& username,
+    const bool usedPassword,
+    const uint8_t packetNumber
+) const
+{
+    MySqlSocket* const mss = dynamic_cast<MySqlSocket*>(incomingConnection_);
+    assert(
+        nullptr != mss &&
+        "MySqlGuard should have MySqlSockets"
+    );
+    mss->sendErrorPacket(
+        packetNumber + 1,
+        MySqlConstants::ERROR_ACCESS_DENIED_ERROR,
+        getAccessDeniedMessage(username, usedPassword)
+    );
+    incomingConnection_->close();
+    if (nullptr != outgoingConnection_)
+    {
+        outgoingConnection_->close();
+    }
+}
+
+
+void MySqlGuard::logInToPool(
+    const vector<uint8_t>& rawMessage,
+    const string& username,
+    const bool usedPassword
+) const
+{
+    const uint8_t packetNumber = rawMessage.at(3);
+    if (!readLogin(rawMessage))
+    {
+        denyLogin(username, usedPassword, packetNumber);
+        return;
+    }
+
+    // Borrowing a connection checks that the user can use the database
+    if (!attachBackend(packetNumber))
+    {
+        incomingConnection_->close();
+        return;
+    }
+    MySqlSocket* const mss = dynamic_cast<MySqlSocket*>(incomingConnection_);
+    assert(
+        nullptr != mss &&
+        "MySqlGuard should have MySqlSockets"
+    );
+    sendResponse(mss->getOkPacket(packetNumber + 1));
+    detachBackend(false);
+}
+
+
+bool MySqlGuard::attachBackend(const uint8_t messageNumber) const
+{
+    if (nullptr == pool_ || nullptr != backend_)
+    {
+        return true;
+    }
+
+    MySqlConnectionPool::ACQUIRE_ERROR error;
+    backend_ = pool_->acquire(
+        user_,
+        passwordHash_,
+        characterSet_,
+        session_,
+        &error
+    );
+    if (nullptr == backend_)
     {
         MySqlSocket* const mss = dynamic_cast<MySqlSocket*>(
             incomingConnection_
@@ -579,61 +1201,123 @@ void MySqlGuard::handleFirstPacket(vector<uint8_t>& rawMessage) const
             nullptr != mss &&
             "MySqlGuard should have MySqlSockets"
         );
-        string errorMessage("Access denied for user '");
-        errorMessage += username;
-        errorMessage += "'@'";
-        errorMessage += incomingConnection_->getPeerName();
-        errorMessage += "' (using password: ";
-        if (rawMessage.size() <= i + 1 || 0 == rawMessage.at(i + 1))
+        switch (error)
         {
-            errorMessage += "NO)";
-        }
-        else
-        {
-            errorMessage += "YES)";
+        case MySqlConnectionPool::ACQUIRE_TIMED_OUT:
+            sendResponse(
+                mss->getErrorPacket(
+                    messageNumber + 1,
+                    MySqlConstants::ERROR_CON_COUNT_ERROR,
+                    "Too many connections"
+                )
+            );
+            break;
+        case MySqlConnectionPool::ACQUIRE_REFUSED:
+            // The server turned down the credentials from the client's
+            // login, e.g. because its password has changed since
+            sendResponse(
+                mss->getErrorPacket(
+                    messageNumber + 1,
+                    MySqlConstants::ERROR_ACCESS_DENIED_ERROR,
+                    getAccessDeniedMessage(user_, !passwordHash_.empty())
+                )
+            );
+            break;
+        default:
+            sendResponse(mss->getErrorPacket(messageNumber + 1));
         }
-        const uint8_t packetNumber = rawMessage.at(3);
-        mss->sendErrorPacket(
-            packetNumber + 1,
-            MySqlConstants::ERROR_ACCESS_DENIED_ERROR,
-            errorMessage
-        );
-        incomingConnection_->close();
-        outgoingConnection_->close();
+        return false;
+    }
+    return true;
+}
+
+
+void MySqlGuard::runOnPool() const
+{
+    const uint8_t messageNumber = messageParts_.back().at(3);
+    if (nullptr == backend_ && !attachBackend(messageNumber))
+    {
         return;
     }
 
-    // Per ticket #11, we don't support compression, so lie to the client and
-    // clear that bit so that the client doesn't try to use compression.
+    bool succeeded;
+    try
+    {
+        succeeded = backend_->runCommand(messageParts_, &poolResponse_);
+    }
+    catch (SocketException& e)
+    {
+        // This includes LOAD DATA LOCAL INFILE, which would need the client
+        // to talk to the pooled connection directly
+        Logger::log(Logger::WARN)
+            << "Lost pooled MySQL connection: "
+            << e.what();
+        releaseParts(&poolResponse_);
+        pool_->discard(backend_);
+        backend_ = nullptr;
+        backendDirty_ = false;
+        session_ = previousSession_;
+        MySqlSocket* const mss = dynamic_cast<MySqlSocket*>(
+            incomingConnection_
+        );
+        assert(
+            nullptr != mss &&
+            "MySqlGuard should have MySqlSockets"
+        );
+        sendResponse(mss->getErrorPacket(messageNumber + 1));
+        return;
+    }
 
-    // It looks like the MySQL command line client won't request compression
-    // if the server doesn't support it, but just to be safe, let's clear it
-    // so that the server won't try to use it.
+    // Part of a multiple statement query might have worked, so the pooled
+    // connection can't be trusted to match either session
+    if (!succeeded && session_.getVersion() != previousSession_.getVersion())
+    {
+        session_ = previousSession_;
+        backendDirty_ = true;
+    }
 
-    // 3: packet length, 1: packet number number,
-    // 1: server version, n: null-terminated server version string
-    const size_t BEGIN_VERSION_STRING = 3 + 1 + 1;
-    i = BEGIN_VERSION_STRING;
-    while (i < rawMessage.size() && rawMessage.at(i) != '\0')
+    PacketBufferPool::acquire(&responseData_);
+    for (size_t i = 0; i < poolResponse_.size(); ++i)
     {
-        ++i;
+        responseData_.insert(
+            responseData_.end(),
+            poolResponse_[i].begin(),
+            poolResponse_[i].end()
+        );
     }
-    ++i;  // One past the version string
-    // 4: thread id, 8: password scramble buffer, 1: filler
-    const size_t BEGIN_SERVER_CAPABILITIES = i + 4 + 8 + 1;
+    releaseParts(&poolResponse_);
+    // The blocker writes to the client on its own, so the client's batch
+    // has to go out first to keep the responses in order
+    incomingConnection_->endBatch();
+    blocker_->handleReceivedData(responseData_);
+    incomingConnection_->beginBatch();
+    PacketBufferPool::release(&responseData_);
 
-    if (BEGIN_SERVER_CAPABILITIES >= rawMessage.size())
+    detachBackend(false);
+}
+
+
+void MySqlGuard::detachBackend(const bool disconnecting) const
+{
+    if (nullptr == backend_)
+    {
+        return;
+    }
+    session_.setServerStatus(backend_->getServerStatus());
+    const bool reusable = !backendDirty_ && !session_.isPinned();
+    if (!reusable && !disconnecting)
     {
-        Logger::log(Logger::ERROR) << "Unable to unset client compression";
+        return;
+    }
+    if (reusable)
+    {
+        pool_->release(backend_, session_);
     }
     else
     {
-        // Flip off the compression bit
-        rawMessage.at(BEGIN_SERVER_CAPABILITIES) =
-            rawMessage.at(BEGIN_SERVER_CAPABILITIES) &
-            ~(static_cast<uint8_t>(MySqlConstants::CLIENT_COMPRESS));
+        // Closing the connection rolls back anything that's still open
+        pool_->discard(backend_);
     }
-
-    ProxyHalf::handleMessage(rawMessage);
-    return;
+    backend_ = nullptr;
+    backendDirty_ = false;
 }
@@ -21,12 +21,20 @@
 #ifndef SRC_MYSQLGUARD_HPP_
 #define SRC_MYSQLGUARD_HPP_
 
+class MySqlBackendConnection;
+class MySqlBackendPool;
+class MySqlConnectionPool;
 class MySqlSocket;
 class MySqlGuardObjectContainer;
 class MySqlErrorMessageBlocker;
+#include "MySqlCompression.hpp"
+#include "MySqlPacketReader.hpp"
 #include "nullptr.hpp"
+#include "MySqlSessionState.hpp"
 #include "ProxyHalf.hpp"
+#include "QueryDecisionCache.hpp"
 #include "QueryRisk.hpp"
+#include "QueryShapeCache.hpp"
 
 #include <string>
 #include <vector>
@@ -52,11 +60,26 @@ public:
      * @param blocker Optional link to the blocker so that it can be told what
      *  kind of command the query had and tailor any error messages to things
      *     like 'OK' for insert and update queries.
+     * @param compression Whether clients may use the compressed protocol,
+     *  and how to compress the commands that are forwarded. This needs the
+     *  blocker.
+     * @param replicas If set, SELECTs outside of transactions are sent to
+     *  one of these servers instead. Replica responses are read
+     *  synchronously, so this is only for connections that have their own
+     *  threads. This needs the blocker.
+     * @param pool If set, SQLassie answers the client's login itself and
+     *  commands are run on connections borrowed from this pool, for one
+     *  statement or transaction at a time. There's no outgoing connection
+     *  then, and responses are passed to the blocker directly. This is only
+     *  for connections that have their own threads.
      */
     MySqlGuard(
         MySqlSocket* incomingConnection,
         MySqlSocket* outgoingConnection,
-        MySqlErrorMessageBlocker* blocker = nullptr
+        MySqlErrorMessageBlocker* blocker = nullptr,
+        const MySqlCompression& compression = MySqlCompression(),
+        MySqlBackendPool* replicas = nullptr,
+        MySqlConnectionPool* pool = nullptr
     );
 
     /**
@@ -70,6 +93,36 @@ public:
      */
     ~MySqlGuard();
 
+    /**
+     * Sets the timeouts that are specific to MySQL. These only apply once
+     * useTimeouts has been called.
+     * @param loginMilliseconds How long the client has to log in, or 0 to
+     *  use the idle timeout.
+     * @param queryMilliseconds How long the server has to start answering
+     *  a query, or 0 to wait forever.
+     */
+    void setTimeouts(int loginMilliseconds, int queryMilliseconds);
+
+    /**
+     * Reuses the decisions for queries that have been seen before instead of
+     * analyzing them again.
+     * @param cache The decisions, shared with the other connections.
+     */
+    void useDecisionCache(QueryDecisionCache* cache);
+
+    /**
+     * Reuses what the parser found for queries that only differ from
+     * queries that have been seen before in their literals.
+     * @param cache The parsed shapes, shared with the other connections.
+     */
+    void useShapeCache(QueryShapeCache* cache);
+
+protected:
+    /**
+     * Overridden from ProxyHalf so that clients get less time to log in.
+     */
+    int getReceiveTimeout() const;
+
 private:
     /**
      * Analyzes a message and determines probability of SQL injection attacks.
@@ -82,16 +135,41 @@ private:
     /**
      * Analyzes a query and determines if it's dangerous or not; if it is,
      * the query is logged.
-     * @param query The query to analyze.
+     * @param query The query to analyze. It's scanned in place, so it's
+     *  changed while it's being parsed, but it's put back afterward.
      * @param dangerous In out variable that is set if the query is dangerous.
      * @param queryType In out variable that is set to the type of the query.
      */
     void analyzeQuery(
-        const std::string& query,
+        std::string* query,
         bool* const dangerous,
         QueryRisk::QueryType* const queryType
     ) const;
 
+    /**
+     * Parses a query and computes the probability of each kind of attack
+     * that it could be, without logging anything.
+     * @param query The query to analyze. It's scanned in place, so it's
+     *  changed while it's being parsed, but it's put back afterward.
+     * @param decision Set to whether the query is dangerous and what should
+     *  be logged about it.
+     * @return False if the decision shouldn't be cached, because the parser
+     *  went over its budget and the same query might fit in it next time.
+     */
+    bool decideQuery(
+        std::string* query,
+        QueryDecisionCache::Decision* decision
+    ) const;
+
+    /**
+     * Adds the probability of one kind of attack to a decision.
+     */
+    void addProbability(
+        double probability,
+        const char* attackType,
+        QueryDecisionCache::Decision* decision
+    ) const;
+
     /**
      * All of these objects are only used in handleMessage. I need them to keep
      * their values between subsequent calls to handleMessage, but I can't
@@ -102,16 +180,74 @@ private:
     ///@{
     mutable bool firstPacket_;
     mutable uint8_t lastCommandCode_;
-    mutable uint_least32_t packetLength_;
-    mutable uint_least32_t packetLengthSoFar_;
+    mutable MySqlPacketReader reader_;
     mutable std::string command_;
     mutable std::vector<std::vector<uint8_t> > messageParts_;
+    mutable std::vector<std::vector<uint8_t> > forwardedParts_;
     mutable uint8_t commandCode_;
-    mutable bool waitingForMore_;
+    ///@}
+
+    /**
+     * Compressed protocol state. Commands are decompressed so that they can
+     * be analyzed, and compressed again when they're forwarded.
+     */
+    ///@{
+    const MySqlCompression compression_;
+    mutable bool compressionRequested_;
+    mutable std::vector<uint8_t> frames_;
+    mutable std::vector<uint8_t> frameData_;
+    mutable std::vector<uint8_t> uncompressed_;
+    /// Sequence number of the last frame from the client
+    mutable uint8_t clientSequence_;
+    /// Sequence number of the frame that the current message started in
+    mutable uint8_t messageSequence_;
+    /// How far the client's frame numbers are ahead of the ones we send
+    mutable uint8_t sequenceOffset_;
+    ///@}
+
+    /**
+     * Read/write splitting state. The client's login is remembered so that
+     * it can be repeated on a replica.
+     */
+    ///@{
+    MySqlBackendPool* const replicas_;
+    mutable MySqlSessionState session_;
+    mutable bool replicaLogin_;
+    mutable std::string user_;
+    mutable uint8_t characterSet_;
+    /// SHA1(password), recovered from the client's login
+    mutable std::vector<uint8_t> passwordHash_;
+    mutable MySqlBackendConnection* replica_;
+    mutable int replicaIndex_;
+    /// The session version that the replica connection was last updated to
+    mutable size_t replicaVersion_;
+    mutable std::string replicaDatabase_;
+    mutable std::vector<std::vector<uint8_t> > replicaResponse_;
+    ///@}
+
+    /**
+     * Connection pooling state. The session is recreated on whichever
+     * pooled connection the client is given.
+     */
+    ///@{
+    MySqlConnectionPool* const pool_;
+    mutable MySqlBackendConnection* backend_;
+    /// Set when the backend's session might not match session_ anymore
+    mutable bool backendDirty_;
+    /// The session from before the current command, in case it fails
+    mutable MySqlSessionState previousSession_;
+    mutable std::vector<std::vector<uint8_t> > poolResponse_;
+    mutable std::vector<uint8_t> responseData_;
     ///@}
 
     MySqlErrorMessageBlocker* const blocker_;
 
+    int loginTimeout_;
+    int queryTimeout_;
+
+    QueryDecisionCache* decisionCache_;
+    QueryShapeCache* shapeCache_;
+
     const double probabilityBlockLevel_;
     const double probabilityLogLevel_;
 
@@ -126,8 +262,143 @@ private:
      */
     static bool checkBadNumbers(const std::string& query);
 
+    /**
+     * Checks for the risks that the scanner finds on its own, like comments
+     * and hex strings. Queries that the parser gave up on can be judged by
+     * these.
+     */
+    static bool hasScannerRisks(const QueryRisk& qr);
+
     void handleFirstPacket(std::vector<uint8_t>& rawMessage) const;
 
+    /**
+     * Decompresses the whole frames from the client and handles the commands
+     * in them.
+     * @throw SocketException
+     */
+    void handleFrames(const std::vector<uint8_t>& rawMessage) const;
+
+    /**
+     * Handles every whole command that reader_ has.
+     */
+    void handleCommands() const;
+
+    /**
+     * Handles the whole command in messageParts_.
+     */
+    void handleCommand() const;
+
+    /**
+     * Remembers what's needed to log the client in to other servers.
+     * @param rawMessage The client's authentication packet.
+     * @return False if the client's password couldn't be checked.
+     */
+    bool readLogin(const std::vector<uint8_t>& rawMessage) const;
+
+    /**
+     * Makes the message of MySQL's access denied error for a login.
+     * @param username The user that the client tried to log in as.
+     * @param usedPassword Whether the client sent a password.
+     */
+    std::string getAccessDeniedMessage(
+        const std::string& username,
+        bool usedPassword
+    ) const;
+
+    /**
+     * Sends the client an access denied error for its login and hangs up.
+     * @param username The user that the client tried to log in as.
+     * @param usedPassword Whether the client sent a password.
+     * @param packetNumber The number of the client's authentication packet.
+     */
+    void denyLogin(
+        const std::string& username,
+        bool usedPassword,
+        uint8_t packetNumber
+    ) const;
+
+    /**
+     * Answers the client's login without a server, checking its password
+     * with the hashes from MySqlLoginCheck and its database with a pooled
+     * connection.
+     * @param rawMessage The client's authentication packet.
+     * @param username The user that the client is logging in as.
+     * @param usedPassword Whether the client sent a password.
+     */
+    void logInToPool(
+        const std::vector<uint8_t>& rawMessage,
+        const std::string& username,
+        bool usedPassword
+    ) const;
+
+    /**
+     * Makes sure that the client has a pooled connection for the command in
+     * messageParts_, and remembers the session in case the command fails.
+     * Does nothing without a pool.
+     * @param messageNumber The number of the command's last packet.
+     * @return False if there wasn't a connection; the client has been sent
+     *  an error.
+     */
+    bool attachBackend(uint8_t messageNumber) const;
+
+    /**
+     * Runs the command in messageParts_ on the client's pooled connection
+     * and passes the response to the blocker.
+     */
+    void runOnPool() const;
+
+    /**
+     * Gives the client's pooled connection back, unless the client is in
+     * the middle of a transaction or has state that can't be recreated.
+     * @param disconnecting The client is gone, so the connection has to be
+     *  given back or closed no matter what.
+     */
+    void detachBackend(bool disconnecting) const;
+
+    /**
+     * Runs the query in messageParts_ on a replica and sends the response
+     * to the client, if that's safe.
+     * @param type The type of the query.
+     * @return False if the query should go to the primary instead.
+     */
+    bool runOnReplica(QueryRisk::QueryType type) const;
+
+    /**
+     * Makes sure that there's a replica connection with the same session
+     * as the primary one.
+     * @return False if there's no usable replica.
+     * @throw SocketException
+     */
+    bool prepareReplica() const;
+
+    /**
+     * Closes the replica connection, if there is one.
+     */
+    void dropReplica() const;
+
+    /**
+     * Sends a fake response to the client.
+     * @param packets The response's packets.
+     */
+    void sendResponse(const std::vector<uint8_t>& packets) const;
+
+    /**
+     * Returns true once the connection uses compressed frames.
+     */
+    bool isCompressed() const;
+
+    /**
+     * Moves the packets in messageParts_ to forwardedParts_. Everything in
+     * there is sent to the server together once the whole read has been
+     * handled.
+     */
+    void forwardMessageParts() const;
+
+    /**
+     * Gives the buffers in a list of packets back to the pool and clears it.
+     */
+    static void releaseParts(std::vector<std::vector<uint8_t> >* parts);
+
     // ***** Hidden methods *****
     MySqlGuard& operator=(const MySqlGuard&);
 };
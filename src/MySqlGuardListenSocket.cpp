@@ -18,8 +18,13 @@
  * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "EventLoop.hpp"
 #include "ListenSocket.hpp"
 #include "Logger.hpp"
+#include "MySqlBackendPool.hpp"
+#include "MySqlCompression.hpp"
+#include "MySqlConnectionPool.hpp"
+#include "MySqlConstants.hpp"
 #include "MySqlErrorMessageBlocker.hpp"
 #include "MySqlGuardListenSocket.hpp"
 #include "MySqlGuard.hpp"
@@ -27,17 +32,22 @@
 #include "MySqlSocket.hpp"
 #include "nullptr.hpp"
 #include "Proxy.hpp"
+#include "QueryDecisionCache.hpp"
+#include "QueryShapeCache.hpp"
 #include "Socket.hpp"
 #include "SocketException.hpp"
+#include "TimerWheel.hpp"
 
 #include <boost/thread.hpp>
 #include <memory>
 #include <netinet/in.h>
 #include <string>
 #include <sys/socket.h>
+#include <vector>
 
 using std::auto_ptr;
 using std::string;
+using std::vector;
 using boost::thread;
 
 
@@ -50,7 +60,18 @@ MySqlGuardListenSocket::MySqlGuardListenSocket(
     mySqlNetworkSocket_(true),
     mySqlPort_(mySqlPort),
     mySqlHost_(mySqlHost),
-    domainSocketFile_()
+    domainSocketFile_(),
+    eventLoops_(),
+    passThroughResultSets_(false),
+    compression_(),
+    replicas_(),
+    pool_(),
+    timers_(),
+    decisionCache_(),
+    shapeCache_(),
+    loginTimeout_(0),
+    idleTimeout_(0),
+    queryTimeout_(0)
 {
 }
 
@@ -64,7 +85,18 @@ MySqlGuardListenSocket::MySqlGuardListenSocket(
     mySqlNetworkSocket_(true),
     mySqlPort_(mySqlPort),
     mySqlHost_(mySqlHost),
-    domainSocketFile_()
+    domainSocketFile_(),
+    eventLoops_(),
+    passThroughResultSets_(false),
+    compression_(),
+    replicas_(),
+    pool_(),
+    timers_(),
+    decisionCache_(),
+    shapeCache_(),
+    loginTimeout_(0),
+    idleTimeout_(0),
+    queryTimeout_(0)
 {
 }
 
@@ -77,7 +109,18 @@ MySqlGuardListenSocket::MySqlGuardListenSocket(
         mySqlNetworkSocket_(false),
         mySqlPort_(0),
         mySqlHost_(),
-        domainSocketFile_(domainSocket)
+        domainSocketFile_(domainSocket),
+        eventLoops_(),
+        passThroughResultSets_(false),
+        compression_(),
+        replicas_(),
+    pool_(),
+    timers_(),
+    decisionCache_(),
+    shapeCache_(),
+    loginTimeout_(0),
+    idleTimeout_(0),
+    queryTimeout_(0)
 {
 }
 
@@ -90,13 +133,146 @@ MySqlGuardListenSocket::MySqlGuardListenSocket(
     mySqlNetworkSocket_(false),
     mySqlPort_(0),
     mySqlHost_(),
-    domainSocketFile_(serverDomainSocket)
+    domainSocketFile_(serverDomainSocket),
+    eventLoops_(),
+    passThroughResultSets_(false),
+    compression_(),
+    replicas_(),
+    pool_(),
+    timers_(),
+    decisionCache_(),
+    shapeCache_(),
+    loginTimeout_(0),
+    idleTimeout_(0),
+    queryTimeout_(0)
 {
 }
 
 
 MySqlGuardListenSocket::~MySqlGuardListenSocket()
 {
+    for (size_t i = 0; i < eventLoops_.size(); ++i)
+    {
+        delete eventLoops_[i];
+    }
+}
+
+
+void MySqlGuardListenSocket::useEventLoops(
+    const size_t loopCount,
+    const bool useIoUring
+)
+{
+    assert(loopCount > 0 && "Need at least one event loop");
+    for (size_t i = 0; i < loopCount; ++i)
+    {
+        eventLoops_.push_back(EventLoop::create(useIoUring));
+    }
+    Logger::log(Logger::INFO)
+        << "Running connections on "
+        << loopCount
+        << " event loop threads";
+}
+
+
+void MySqlGuardListenSocket::setPassThroughResultSets(const bool passThrough)
+{
+    passThroughResultSets_ = passThrough;
+}
+
+
+void MySqlGuardListenSocket::setCompression(
+    const MySqlCompression& compression
+)
+{
+    compression_ = compression;
+}
+
+
+void MySqlGuardListenSocket::setReplicas(auto_ptr<MySqlBackendPool> replicas)
+{
+    replicas_ = replicas;
+}
+
+
+void MySqlGuardListenSocket::usePooledConnections(
+    const size_t maxConnections,
+    const int waitMilliseconds
+)
+{
+    if (mySqlNetworkSocket_)
+    {
+        pool_.reset(
+            new MySqlConnectionPool(
+                mySqlPort_,
+                mySqlHost_,
+                maxConnections,
+                waitMilliseconds
+            )
+        );
+    }
+    else
+    {
+        pool_.reset(
+            new MySqlConnectionPool(
+                domainSocketFile_,
+                maxConnections,
+                waitMilliseconds
+            )
+        );
+    }
+}
+
+
+void MySqlGuardListenSocket::setTimeouts(
+    const int loginMilliseconds,
+    const int idleMilliseconds,
+    const int queryMilliseconds
+)
+{
+    loginTimeout_ = loginMilliseconds;
+    idleTimeout_ = idleMilliseconds;
+    queryTimeout_ = queryMilliseconds;
+    if (
+        nullptr == timers_.get()
+        && (loginMilliseconds > 0 || idleMilliseconds > 0
+            || queryMilliseconds > 0)
+    )
+    {
+        timers_.reset(new TimerWheel);
+        timers_->start();
+    }
+}
+
+
+void MySqlGuardListenSocket::useDecisionCache(const size_t maxBytes)
+{
+    decisionCache_.reset(new QueryDecisionCache(maxBytes));
+}
+
+
+void MySqlGuardListenSocket::useShapeCache(const size_t maxBytes)
+{
+    shapeCache_.reset(new QueryShapeCache(maxBytes));
+}
+
+
+void MySqlGuardListenSocket::startTimeouts(
+    MySqlGuard* const guard,
+    ProxyHalf* const blocker
+) const
+{
+    if (nullptr == timers_.get())
+    {
+        return;
+    }
+    guard->setTimeouts(loginTimeout_, queryTimeout_);
+    guard->useTimeouts(timers_.get(), idleTimeout_);
+    if (nullptr != blocker)
+    {
+        // The server only has to answer when a query is waiting
+        blocker->useTimeouts(timers_.get(), 0);
+    }
 }
 
 
@@ -124,6 +300,13 @@ void MySqlGuardListenSocket::handleConnection(
     auto_ptr<Socket> clientConnection
 ) const
 {
+    // The pooled connections' responses are read synchronously
+    if (nullptr != pool_.get() && eventLoops_.empty())
+    {
+        handlePooledConnection(clientConnection);
+        return;
+    }
+
     MySqlSocket* s;
     if (mySqlNetworkSocket_)
     {
@@ -150,16 +333,51 @@ void MySqlGuardListenSocket::handleConnection(
 
     string clientAddress(clientPtr->getPeerName());
 
-    MySqlErrorMessageBlocker* blocker =
-        new MySqlErrorMessageBlocker(s, clientPtr);
+    // Splicing blocks, so it's only done when the connection has its own
+    // threads
+    MySqlErrorMessageBlocker* blocker = new MySqlErrorMessageBlocker(
+        s,
+        clientPtr,
+        passThroughResultSets_ && eventLoops_.empty(),
+        compression_
+    );
     AutoPtrWithOperatorParens<ProxyHalf> server(blocker);
-    AutoPtrWithOperatorParens<ProxyHalf> client(
-        new MySqlGuard(
-            clientPtr,
-            s,
-            blocker
-        )
+    MySqlGuard* guard = new MySqlGuard(
+        clientPtr,
+        s,
+        blocker,
+        compression_,
+        // Replica responses are read synchronously
+        eventLoops_.empty() ? replicas_.get() : nullptr
     );
+    AutoPtrWithOperatorParens<ProxyHalf> client(guard);
+    guard->useDecisionCache(decisionCache_.get());
+    guard->useShapeCache(shapeCache_.get());
+    startTimeouts(guard, blocker);
+    if (!eventLoops_.empty())
+    {
+        // Give the connection to the least busy loop
+        EventLoop* loop = eventLoops_[0];
+        for (size_t i = 1; i < eventLoops_.size(); ++i)
+        {
+            if (
+                eventLoops_[i]->getConnectionCount()
+                < loop->getConnectionCount()
+            )
+            {
+                loop = eventLoops_[i];
+            }
+        }
+        loop->addProxy(client, server, clientConnection, serverConnection);
+        Logger::log(Logger::DEBUG)
+            << "New client connected from "
+            << clientAddress
+            << ", added to event loop with "
+            << loop->getConnectionCount()
+            << " connections";
+        return;
+    }
+
     // Create a new Proxy thread
     Proxy proxy(client, server, clientConnection, serverConnection);
     thread newThread(proxy);
@@ -169,3 +387,76 @@ void MySqlGuardListenSocket::handleConnection(
         << ", spawned thread #"
         << newThread.get_id();
 }
+
+
+void MySqlGuardListenSocket::handlePooledConnection(
+    auto_ptr<Socket> clientConnection
+) const
+{
+    MySqlSocket* const clientPtr = dynamic_cast<MySqlSocket*>(
+        clientConnection.get()
+    );
+    assert(
+        nullptr != clientPtr
+        && "MySqlGuardListenSocket::handlePooledConnection should be given "
+        && "MySqlSockets"
+    );
+    string clientAddress(clientPtr->getPeerName());
+
+    // The blocker never reads from a server; the guard hands it each
+    // response from the pool
+    MySqlErrorMessageBlocker* blocker = new MySqlErrorMessageBlocker(
+        nullptr,
+        clientPtr,
+        false,
+        MySqlCompression()
+    );
+    AutoPtrWithOperatorParens<ProxyHalf> server(blocker);
+    MySqlGuard* guard = new MySqlGuard(
+        clientPtr,
+        nullptr,
+        blocker,
+        MySqlCompression(),
+        replicas_.get(),
+        pool_.get()
+    );
+    AutoPtrWithOperatorParens<ProxyHalf> client(guard);
+    guard->useDecisionCache(decisionCache_.get());
+    guard->useShapeCache(shapeCache_.get());
+
+    // SQLassie greets the client itself, and the blocker needs to see the
+    // greeting to know the scramble
+    vector<uint8_t> greeting;
+    bool greeted;
+    try
+    {
+        greeted = pool_->makeHandshake(&greeting);
+    }
+    catch (SocketException& e)
+    {
+        Logger::log(Logger::ERROR)
+            << "Unable to get a handshake from MySQL: "
+            << e.what();
+        greeted = false;
+    }
+    if (!greeted)
+    {
+        clientPtr->sendErrorPacket(
+            0,
+            MySqlConstants::ERROR_CON_COUNT_ERROR,
+            "Unable to connect to MySQL"
+        );
+        return;
+    }
+    blocker->handleReceivedData(greeting);
+    startTimeouts(guard, nullptr);
+
+    // Create a new Proxy thread
+    Proxy proxy(client, server, clientConnection, auto_ptr<Socket>());
+    thread newThread(proxy);
+    Logger::log(Logger::DEBUG)
+        << "New client connected from "
+        << clientAddress
+        << ", using pooled connections in thread #"
+        << newThread.get_id();
+}
@@ -22,13 +22,24 @@
 #define SRC_MYSQLGUARDLISTENSOCKET_HPP_
 
 #include "ListenSocket.hpp"
+#include "MySqlBackendPool.hpp"
+#include "MySqlCompression.hpp"
+#include "MySqlConnectionPool.hpp"
 #include "Socket.hpp"
 #include "Proxy.hpp"
+#include "QueryDecisionCache.hpp"
+#include "QueryShapeCache.hpp"
+#include "TimerWheel.hpp"
 
 #include <memory>
 #include <string>
+#include <vector>
 #include <boost/cstdint.hpp>
 
+class EventLoop;
+class MySqlGuard;
+class ProxyHalf;
+
 /**
  * Listen socket that intercepts MySQL connections and analyzes them for
  * attacks. If any are found, the query is rejected.
@@ -102,6 +113,81 @@ public:
      */
     virtual void acceptClients() const;
 
+    /**
+     * Switches from spawning threads for each connection to running all of
+     * the connections on a fixed number of event loops. This should be
+     * called before acceptClients.
+     * @param loopCount The number of event loop threads to run.
+     * @param useIoUring Use io_uring instead of epoll if the kernel supports
+     *  it.
+     * @throw SocketException Unable to create an event loop.
+     */
+    void useEventLoops(size_t loopCount, bool useIoUring);
+
+    /**
+     * Once the first packet of a result set has been checked, splice the
+     * rest of it from MySQL to the client without copying it. Only used
+     * with the threads engine.
+     * @param passThrough Whether to pass result sets through.
+     */
+    void setPassThroughResultSets(bool passThrough);
+
+    /**
+     * Lets clients on this listener use the compressed protocol instead of
+     * hiding it from them. Defaults to not allowing it.
+     * @param compression How to compress what SQLassie forwards.
+     */
+    void setCompression(const MySqlCompression& compression);
+
+    /**
+     * Sends SELECTs that are outside of transactions to these replicas
+     * instead of the primary. Only used with the threads engine.
+     * @param replicas The replicas to balance reads across.
+     */
+    void setReplicas(std::auto_ptr<MySqlBackendPool> replicas);
+
+    /**
+     * Shares a pool of server connections between clients instead of
+     * giving each client its own, handing a connection to a client only for
+     * one command or transaction at a time. SQLassie answers the clients'
+     * logins itself, so the MySQL user needs to be able to read mysql.user.
+     * Only used with the threads engine.
+     * @param maxConnections The most connections for each user and database.
+     * @param waitMilliseconds How long a client waits for a connection.
+     */
+    void usePooledConnections(size_t maxConnections, int waitMilliseconds);
+
+    /**
+     * Closes connections that take too long. The timeouts are all run from
+     * one thread, so that idle connections don't wake anything up until
+     * their time is up.
+     * @param loginMilliseconds How long clients have to log in.
+     * @param idleMilliseconds How long clients can go without sending a
+     *  command.
+     * @param queryMilliseconds How long MySQL has to start answering a
+     *  query.
+     * Any of these can be 0 to wait forever.
+     */
+    void setTimeouts(
+        int loginMilliseconds,
+        int idleMilliseconds,
+        int queryMilliseconds
+    );
+
+    /**
+     * Remembers what was decided about each query, so that queries that
+     * clients send over and over aren't parsed and analyzed every time.
+     * @param maxBytes Roughly the most memory that the decisions can use.
+     */
+    void useDecisionCache(size_t maxBytes);
+
+    /**
+     * Remembers what the parser found for each shape of query, so that
+     * queries that only differ in their literals are only tokenized.
+     * @param maxBytes Roughly the most memory that the shapes can use.
+     */
+    void useShapeCache(size_t maxBytes);
+
 protected:
     /**
      * Handles a new network connection.
@@ -111,10 +197,34 @@ protected:
     void handleConnection(std::auto_ptr<Socket> clientConnection) const;
 
 private:
+    /**
+     * Handles a new network connection that will use pooled connections.
+     * @param clientConnection The Socket from the client's connection.
+     */
+    void handlePooledConnection(std::auto_ptr<Socket> clientConnection) const;
+
+    /**
+     * Starts the timeouts for a new connection's halves, if there are any.
+     * @param blocker The server's half, or nullptr if it doesn't read from a
+     *  server.
+     */
+    void startTimeouts(MySqlGuard* guard, ProxyHalf* blocker) const;
+
     bool mySqlNetworkSocket_;
     const uint16_t mySqlPort_;
     const std::string mySqlHost_;
     const std::string domainSocketFile_;
+    std::vector<EventLoop*> eventLoops_;
+    bool passThroughResultSets_;
+    MySqlCompression compression_;
+    std::auto_ptr<MySqlBackendPool> replicas_;
+    std::auto_ptr<MySqlConnectionPool> pool_;
+    std::auto_ptr<TimerWheel> timers_;
+    std::auto_ptr<QueryDecisionCache> decisionCache_;
+    std::auto_ptr<QueryShapeCache> shapeCache_;
+    int loginTimeout_;
+    int idleTimeout_;
+    int queryTimeout_;
 
     // ***** Hidden methods *****
     MySqlGuardListenSocket(const MySqlGuardListenSocket& rhs);
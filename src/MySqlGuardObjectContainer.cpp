@@ -25,7 +25,6 @@
 #include "MySqlGuardObjectContainer.hpp"
 #include "nullptr.hpp"
 
-#include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <fstream>
 #include <string>
@@ -41,43 +40,15 @@ using std::string;
 MySqlGuardObjectContainer* MySqlGuardObjectContainer::instance_ = nullptr;
 
 
-MySqlGuardObjectContainer::MySqlGuardObjectContainer(
-    const int numObjects
-) :
-    numObjects_(numObjects),
-    loadBalancer_(0),
-    attackProbsMutexes_(new mutex[numObjects]),
-    attackProbs_(new AttackProbabilities*[numObjects])
+MySqlGuardObjectContainer::MySqlGuardObjectContainer() :
+    attackProbs_(new DlibProbabilities)
 {
-    for (int i = 0; i < numObjects; ++i)
-    {
-        try
-        {
-            attackProbs_[i] = new DlibProbabilities;
-        }
-        catch (...)
-        {
-            for (int j = 0; j < i; ++j)
-            {
-                delete attackProbs_[j];
-            }
-            delete [] attackProbsMutexes_;
-            delete [] attackProbs_;
-            throw;
-        }
-    }
-    assert(
-        numObjects > 0 &&
-        numObjects <= 256 &&
-        "Number of objects should match the number of hardware threads"
-    );
 }
 
 
 MySqlGuardObjectContainer::~MySqlGuardObjectContainer()
 {
-    delete [] attackProbsMutexes_;
-    delete [] attackProbs_;
+    delete attackProbs_;
 }
 
 
@@ -89,8 +60,7 @@ void MySqlGuardObjectContainer::initialize()
 
     if (nullptr == instance_)
     {
-        const unsigned numCores = boost::thread::hardware_concurrency();
-        instance_ = new MySqlGuardObjectContainer(numCores);
+        instance_ = new MySqlGuardObjectContainer;
     }
 }
 
@@ -112,26 +82,6 @@ void MySqlGuardObjectContainer::logBlockedQuery(
 }
 
 
-int MySqlGuardObjectContainer::getLockOnProbabilityGenerator()
-{
-    /// @TODO(bskari) Make this lock stuff exception safe
-    // Try all the locks
-    for (int i = 0; i < numObjects_; ++i)
-    {
-        if (attackProbsMutexes_[i].try_lock())
-        {
-            return i;
-        }
-    }
-
-    // Wait on an arbitrary lock
-    const int currentLoadBalancer = loadBalancer_;
-    loadBalancer_ = (loadBalancer_ + 1) % numObjects_;
-    attackProbsMutexes_[currentLoadBalancer].lock();
-    return currentLoadBalancer;
-}
-
-
 double MySqlGuardObjectContainer::getProbabilityOfAccessAttack(
     const QueryRisk& qr
 )
@@ -140,11 +90,7 @@ double MySqlGuardObjectContainer::getProbabilityOfAccessAttack(
         instance_ != nullptr
         && "Called MySqlGuardObjectContainer singleton without initializing"
     );
-    const int lock = instance_->getLockOnProbabilityGenerator();
-    const double prob =
-        instance_->attackProbs_[lock]->getProbabilityOfAccessAttack(qr);
-    instance_->attackProbsMutexes_[lock].unlock();
-    return prob;
+    return instance_->attackProbs_->getProbabilityOfAccessAttack(qr);
 }
 
 
@@ -156,11 +102,7 @@ double MySqlGuardObjectContainer::getProbabilityOfBypassAttack(
         instance_ != nullptr
         && "Called MySqlGuardObjectContainer singleton without initializing"
     );
-    const int lock = instance_->getLockOnProbabilityGenerator();
-    const double prob =
-        instance_->attackProbs_[lock]->getProbabilityOfBypassAttack(qr);
-    instance_->attackProbsMutexes_[lock].unlock();
-    return prob;
+    return instance_->attackProbs_->getProbabilityOfBypassAttack(qr);
 }
 
 
@@ -172,11 +114,7 @@ double MySqlGuardObjectContainer::getProbabilityOfModificationAttack(
         instance_ != nullptr
         && "Called MySqlGuardObjectContainer singleton without initializing"
     );
-    const int lock = instance_->getLockOnProbabilityGenerator();
-    const double prob =
-        instance_->attackProbs_[lock]->getProbabilityOfModificationAttack(qr);
-    instance_->attackProbsMutexes_[lock].unlock();
-    return prob;
+    return instance_->attackProbs_->getProbabilityOfModificationAttack(qr);
 }
 
 
@@ -188,12 +126,7 @@ double MySqlGuardObjectContainer::getProbabilityOfFingerprintingAttack(
         instance_ != nullptr
         && "Called MySqlGuardObjectContainer singleton without initializing"
     );
-    const int lock = instance_->getLockOnProbabilityGenerator();
-    const double prob =
-        instance_->attackProbs_[lock]->
-            getProbabilityOfFingerprintingAttack(qr);
-    instance_->attackProbsMutexes_[lock].unlock();
-    return prob;
+    return instance_->attackProbs_->getProbabilityOfFingerprintingAttack(qr);
 }
 
 
@@ -205,11 +138,7 @@ double MySqlGuardObjectContainer::getProbabilityOfSchemaAttack(
         instance_ != nullptr
         && "Called MySqlGuardObjectContainer singleton without initializing"
     );
-    const int lock = instance_->getLockOnProbabilityGenerator();
-    const double prob =
-        instance_->attackProbs_[lock]->getProbabilityOfSchemaAttack(qr);
-    instance_->attackProbsMutexes_[lock].unlock();
-    return prob;
+    return instance_->attackProbs_->getProbabilityOfSchemaAttack(qr);
 }
 
 
@@ -221,9 +150,18 @@ double MySqlGuardObjectContainer::getProbabilityOfDenialAttack(
         instance_ != nullptr
         && "Called MySqlGuardObjectContainer singleton without initializing"
     );
-    const int lock = instance_->getLockOnProbabilityGenerator();
-    const double prob =
-        instance_->attackProbs_[lock]->getProbabilityOfDenialAttack(qr);
-    instance_->attackProbsMutexes_[lock].unlock();
-    return prob;
+    return instance_->attackProbs_->getProbabilityOfDenialAttack(qr);
+}
+
+
+void MySqlGuardObjectContainer::scoreAll(
+    const QueryRisk& qr,
+    AttackScores* const scores
+)
+{
+    assert(
+        instance_ != nullptr
+        && "Called MySqlGuardObjectContainer singleton without initializing"
+    );
+    instance_->attackProbs_->scoreAll(qr, scores);
 }
@@ -23,7 +23,6 @@
 
 #include "AttackProbabilities.hpp"
 
-#include <boost/thread.hpp>
 #include <string>
 #include <fstream>
 
@@ -31,7 +30,8 @@
  * MySqlGuard uses a bunch of objects that really only need to be made once and
  * can be reused, like the Bayesian networks and the log files. Rather than
  * opening and closing those files constantly, this class just opens them up
- * once and provides a thread safe way to access them. This is a singleton
+ * once and provides a thread safe way to access them. There is one set of
+ * Bayesian networks, which every thread uses at once. This is a singleton
  * class.
  * @author Brandon Skari
  * @date January 12 2011
@@ -68,34 +68,33 @@ public:
     static double getProbabilityOfSchemaAttack(const QueryRisk& qr);
     ///@}
 
+    /**
+     * Calculates the probability of every type of attack that applies to the
+     * type of query at once.
+     * @param qr The analyzed riskiness of a query.
+     * @param scores Filled with the applicable attacks and their
+     *  probabilities.
+     */
+    static void scoreAll(const QueryRisk& qr, AttackScores* scores);
+
 private:
     /**
      * Default constructor.
-     * @param numObjects The number of objects to make; this will allow
-     * concurrent access for that number of threads.
      * @throw DescribedException Unable to open a file.
      */
-    explicit MySqlGuardObjectContainer(int numObjects);
+    MySqlGuardObjectContainer();
 
     ~MySqlGuardObjectContainer();
 
     static void writeToLog(std::ofstream& log, double prob,
         const char* message);
 
-    /**
-     * Locks one attack probability generator. Callees must manually unlock it!
-     * @return The number of the probability generator that was locked.
-     */
-    int getLockOnProbabilityGenerator();
-
     static MySqlGuardObjectContainer* instance_;
 
-    /// @TODO(bskari) Rather than have locks around AttackProbabilities, have
-    /// individual locks around each probability generation method.
-    int numObjects_;
-    int loadBalancer_;
-    boost::mutex* attackProbsMutexes_;
-    AttackProbabilities** attackProbs_;
+    /**
+     * Safe to use from any number of threads at once.
+     */
+    AttackProbabilities* attackProbs_;
 
     // Disallowed methods
     MySqlGuardObjectContainer(const MySqlGuardObjectContainer& rhs);
@@ -19,6 +19,7 @@
  */
 
 #include "Logger.hpp"
+#include "MySqlAuthentication.hpp"
 #include "MySqlLoginCheck.hpp"
 #include "MySqlConstants.hpp"
 #include "nullptr.hpp"
@@ -31,10 +32,12 @@
 #include <mysql/mysql.h>
 #include <set>
 #include <string>
+#include <vector>
 
 using std::map;
 using std::string;
 using std::set;
+using std::vector;
 using boost::lock_guard;
 using boost::mutex;
 using boost::regex;
@@ -43,6 +46,7 @@ using boost::regex_search;
 
 // Static variables
 map<string, set<regex> > MySqlLoginCheck::userHostLogins_;
+map<string, vector<vector<uint8_t> > > MySqlLoginCheck::passwordHashes_;
 const MySqlLoginCheck* MySqlLoginCheck::instance_ = nullptr;
 mutex MySqlLoginCheck::initializationMutex_;
 
@@ -51,14 +55,21 @@ void MySqlLoginCheck::initialize(
     const std::string& username,
     const std::string& password,
     const std::string& host,
-    uint16_t port
+    uint16_t port,
+    const bool loadPasswordHashes
 )
 {
     lock_guard<mutex> lg(initializationMutex_);
 
     if (instance_ == nullptr)
     {
-        instance_ = new MySqlLoginCheck(username, password, host, port);
+        instance_ = new MySqlLoginCheck(
+            username,
+            password,
+            host,
+            port,
+            loadPasswordHashes
+        );
     }
 }
 
@@ -66,14 +77,20 @@ void MySqlLoginCheck::initialize(
 void MySqlLoginCheck::initialize(
     const string& username,
     const string& password,
-    const string& domainSocket
+    const string& domainSocket,
+    const bool loadPasswordHashes
 )
 {
     lock_guard<mutex> lg(initializationMutex_);
 
     if (instance_ == nullptr)
     {
-        instance_ = new MySqlLoginCheck(username, password, domainSocket);
+        instance_ = new MySqlLoginCheck(
+            username,
+            password,
+            domainSocket,
+            loadPasswordHashes
+        );
     }
 }
 
@@ -81,7 +98,8 @@ void MySqlLoginCheck::initialize(
 MySqlLoginCheck::MySqlLoginCheck(
     const string& username,
     const string& password,
-    const string& domainSocket
+    const string& domainSocket,
+    const bool loadPasswordHashes
 )
 {
     MYSQL* conn = mysql_init(nullptr);
@@ -110,6 +128,10 @@ MySqlLoginCheck::MySqlLoginCheck(
     }
 
     loadUserHostsFromMySql(conn);
+    if (loadPasswordHashes)
+    {
+        loadPasswordHashesFromMySql(conn);
+    }
 
     mysql_close(conn);
 }
@@ -120,7 +142,8 @@ MySqlLoginCheck::MySqlLoginCheck(
     const std::string& username,
     const std::string& password,
     const std::string& host,
-    uint16_t port
+    uint16_t port,
+    const bool loadPasswordHashes
 )
 {
     MYSQL* conn = mysql_init(nullptr);
@@ -149,6 +172,10 @@ MySqlLoginCheck::MySqlLoginCheck(
     }
 
     loadUserHostsFromMySql(conn);
+    if (loadPasswordHashes)
+    {
+        loadPasswordHashesFromMySql(conn);
+    }
 
     mysql_close(conn);
 }
@@ -242,6 +269,78 @@ bool MySqlLoginCheck::loadUserHostsFromMySql(MYSQL* conn)
 }
 
 
+bool MySqlLoginCheck::loadPasswordHashesFromMySql(MYSQL* conn)
+{
+    // Newer versions of MySQL moved the hashes to another column
+    if (
+        0 != mysql_query(conn, "SELECT User, Password FROM user")
+        && 0 != mysql_query(
+            conn,
+            "SELECT User, authentication_string FROM user"
+        )
+    )
+    {
+        Logger::log(Logger::ERROR)
+            << "Unable to access password hashes from MySQL";
+        Logger::log(Logger::DEBUG)
+            << "SELECT query failed to run: "
+            << mysql_error(conn);
+        return false;
+    }
+
+    MYSQL_RES* result = mysql_store_result(conn);
+    if (nullptr == result)
+    {
+        Logger::log(Logger::ERROR)
+            << "Unable to access password hashes from MySQL";
+        Logger::log(Logger::DEBUG)
+            << "Fetching results failed: "
+            << mysql_error(conn);
+        return false;
+    }
+
+    MYSQL_ROW row;
+    while (nullptr != (row = mysql_fetch_row(result)))
+    {
+        if (nullptr == row[0] || nullptr == row[1])
+        {
+            continue;
+        }
+        vector<uint8_t> hash;
+        // Users with other authentication plugins can't be logged in to
+        // other servers, so they're just left out
+        if (MySqlAuthentication::parseStoredHash(row[1], &hash))
+        {
+            passwordHashes_[row[0]].push_back(hash);
+        }
+    }
+    mysql_free_result(result);
+
+    Logger::log(Logger::DEBUG)
+        << "Loaded password hashes for "
+        << passwordHashes_.size()
+        << " users";
+    return true;
+}
+
+
+bool MySqlLoginCheck::getPasswordHashes(
+    const string& user,
+    vector<vector<uint8_t> >* const hashes
+)
+{
+    const map<string, vector<vector<uint8_t> > >::const_iterator u(
+        passwordHashes_.find(user)
+    );
+    if (passwordHashes_.end() == u)
+    {
+        return false;
+    }
+    *hashes = u->second;
+    return true;
+}
+
+
 bool MySqlLoginCheck::validUserHost(const string& user, const string& host)
 {
     Logger::log(Logger::DEBUG) << "Checking for " << user << '@' << host;
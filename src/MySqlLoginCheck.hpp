@@ -29,6 +29,7 @@ class st_mysql;
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 /**
  * Helper class to reduce a MySQL remote connection security bypass.
@@ -60,12 +61,14 @@ public:
         const std::string& username,
         const std::string& password,
         const std::string& host,
-        uint16_t port
+        uint16_t port,
+        bool loadPasswordHashes = false
     );
     static void initialize(
         const std::string& username,
         const std::string& password,
-        const std::string& domainSocket
+        const std::string& domainSocket,
+        bool loadPasswordHashes = false
     );
     ///@}
 
@@ -78,6 +81,19 @@ public:
      */
     static bool validUserHost(const std::string& user, const std::string& host);
 
+    /**
+     * Returns the mysql_native_password hashes that MySQL has for a user,
+     * one for each host that the user can log in from. These are only
+     * loaded if they were asked for when initializing.
+     * @param user The username.
+     * @param hashes Filled with the SHA1(SHA1(password)) hashes.
+     * @return False if there aren't any hashes for the user.
+     */
+    static bool getPasswordHashes(
+        const std::string& user,
+        std::vector<std::vector<uint8_t> >* hashes
+    );
+
 private:
     /**
      * Constructor is private because this is a singleton class.
@@ -87,12 +103,14 @@ private:
         const std::string& username,
         const std::string& password,
         const std::string& host,
-        uint16_t port
+        uint16_t port,
+        bool loadPasswordHashes
     );
     MySqlLoginCheck(
         const std::string& username,
         const std::string& password,
-        const std::string& domainSocket
+        const std::string& domainSocket,
+        bool loadPasswordHashes
     );
     ///@}
 
@@ -104,7 +122,16 @@ private:
      */
     bool loadUserHostsFromMySql(st_mysql* conn);
 
+    /**
+     * Loads the users' password hashes, which lets SQLassie log clients in
+     * to other servers, e.g. replicas.
+     * @return Successfully loaded the hashes.
+     */
+    bool loadPasswordHashesFromMySql(st_mysql* conn);
+
     static std::map<std::string, std::set<boost::regex> > userHostLogins_;
+    static std::map<std::string, std::vector<std::vector<uint8_t> > >
+        passwordHashes_;
     static const MySqlLoginCheck* instance_;
     static boost::mutex initializationMutex_;
 
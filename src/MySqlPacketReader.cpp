@@ -0,0 +1,271 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MySqlPacketReader.hpp"
+#include "nullptr.hpp"
+#include "PacketBufferPool.hpp"
+
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+using std::memcpy;
+using std::min;
+using std::vector;
+
+const size_t MySqlPacketReader::HEADER_LENGTH;
+const size_t MySqlPacketReader::MAX_PAYLOAD_LENGTH;
+const size_t MySqlPacketReader::MIN_RING_SIZE;
+
+
+MySqlPacketReader::MySqlPacketReader() :
+    ring_(),
+    head_(0),
+    size_(0),
+    whole_()
+{
+}
+
+
+MySqlPacketReader::~MySqlPacketReader()
+{
+    PacketBufferPool::release(&whole_);
+}
+
+
+void MySqlPacketReader::append(vector<uint8_t>* const data)
+{
+    assert(nullptr != data);
+    if (data->empty())
+    {
+        return;
+    }
+
+    if (0 == size_ && whole_.empty() && data->size() >= HEADER_LENGTH)
+    {
+        const size_t length =
+            (*data)[0] | ((*data)[1] << 8) | ((*data)[2] << 16);
+        if (
+            MAX_PAYLOAD_LENGTH != length
+            && HEADER_LENGTH + length == data->size()
+        )
+        {
+            whole_.swap(*data);
+            return;
+        }
+    }
+
+    // Keep everything in order
+    if (!whole_.empty())
+    {
+        vector<uint8_t> whole;
+        whole.swap(whole_);
+        append(&whole);
+        PacketBufferPool::release(&whole);
+    }
+
+    reserve(size_ + data->size());
+    const size_t mask = ring_.size() - 1;
+    const size_t tail = (head_ + size_) & mask;
+    const size_t firstPart = min(data->size(), ring_.size() - tail);
+    memcpy(&ring_[tail], &(*data)[0], firstPart);
+    if (firstPart < data->size())
+    {
+        memcpy(&ring_[0], &(*data)[firstPart], data->size() - firstPart);
+    }
+    size_ += data->size();
+}
+
+
+bool MySqlPacketReader::nextMessage(vector<vector<uint8_t> >* const packets)
+{
+    assert(nullptr != packets);
+    if (!whole_.empty())
+    {
+        packets->resize(1);
+        (*packets)[0].swap(whole_);
+        PacketBufferPool::release(&whole_);
+        return true;
+    }
+
+    // Make sure that every packet of the message is here
+    size_t offset = 0;
+    size_t packetCount = 0;
+    size_t length;
+    do
+    {
+        if (size_ - offset < HEADER_LENGTH)
+        {
+            return false;
+        }
+        length = payloadLength(offset);
+        if (size_ - offset < HEADER_LENGTH + length)
+        {
+            return false;
+        }
+        offset += HEADER_LENGTH + length;
+        ++packetCount;
+    } while (MAX_PAYLOAD_LENGTH == length);
+
+    packets->resize(packetCount);
+    for (size_t i = 0; i < packetCount; ++i)
+    {
+        copyOut(HEADER_LENGTH + payloadLength(0), &(*packets)[i]);
+    }
+
+    // Don't hang on to the memory from a huge message
+    if (0 == size_ && ring_.size() > PacketBufferPool::getBufferSize())
+    {
+        vector<uint8_t>().swap(ring_);
+    }
+    return true;
+}
+
+
+bool MySqlPacketReader::empty() const
+{
+    return 0 == size_ && whole_.empty();
+}
+
+
+bool MySqlPacketReader::getStatusFlags(
+    const uint8_t* const packet,
+    const size_t length,
+    uint16_t* const status
+)
+{
+    const uint8_t RESULT_OK = 0x00;
+    const uint8_t RESULT_EOF = 0xFE;
+    // Rows can start with 0xFE too, but then they're at least this long
+    const size_t MIN_ROW_LENGTH = 9;
+    if (length <= HEADER_LENGTH)
+    {
+        return false;
+    }
+    const size_t payloadLength = length - HEADER_LENGTH;
+    const uint8_t* const payload = packet + HEADER_LENGTH;
+
+    size_t position;
+    if (RESULT_EOF == payload[0] && payloadLength < MIN_ROW_LENGTH)
+    {
+        // 1: EOF marker, 2: warning count
+        position = 1 + 2;
+    }
+    else if (RESULT_OK == payload[0])
+    {
+        // 1: OK marker, then the length coded affected rows and insert ID
+        position = 1;
+        for (int i = 0; i < 2 && position < payloadLength; ++i)
+        {
+            switch (payload[position])
+            {
+                case 0xFC:
+                    position += 1 + 2;
+                    break;
+                case 0xFD:
+                    position += 1 + 3;
+                    break;
+                case 0xFE:
+                    position += 1 + 8;
+                    break;
+                default:
+                    position += 1;
+                    break;
+            }
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    if (position + 2 > payloadLength)
+    {
+        return false;
+    }
+    *status = payload[position] | (payload[position + 1] << 8);
+    return true;
+}
+
+
+size_t MySqlPacketReader::payloadLength(const size_t offset) const
+{
+    const size_t mask = ring_.size() - 1;
+    return ring_[(head_ + offset) & mask]
+        | (ring_[(head_ + offset + 1) & mask] << 8)
+        | (ring_[(head_ + offset + 2) & mask] << 16);
+}
+
+
+void MySqlPacketReader::copyOut(
+    const size_t length,
+    vector<uint8_t>* const destination
+)
+{
+    assert(length <= size_);
+    if (
+        destination->capacity() < length
+        && length <= PacketBufferPool::getBufferSize()
+    )
+    {
+        PacketBufferPool::acquire(destination);
+    }
+    destination->resize(length);
+
+    const size_t firstPart = min(length, ring_.size() - head_);
+    memcpy(&(*destination)[0], &ring_[head_], firstPart);
+    if (firstPart < length)
+    {
+        memcpy(&(*destination)[firstPart], &ring_[0], length - firstPart);
+    }
+    head_ = (head_ + length) & (ring_.size() - 1);
+    size_ -= length;
+}
+
+
+void MySqlPacketReader::reserve(const size_t length)
+{
+    if (length <= ring_.size())
+    {
+        return;
+    }
+
+    size_t newSize = (ring_.empty() ? MIN_RING_SIZE : ring_.size());
+    while (newSize < length)
+    {
+        newSize *= 2;
+    }
+
+    // Straighten the data out while moving it
+    vector<uint8_t> newRing(newSize);
+    if (size_ > 0)
+    {
+        const size_t firstPart = min(size_, ring_.size() - head_);
+        memcpy(&newRing[0], &ring_[head_], firstPart);
+        if (firstPart < size_)
+        {
+            memcpy(&newRing[firstPart], &ring_[0], size_ - firstPart);
+        }
+    }
+    ring_.swap(newRing);
+    head_ = 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_MYSQLPACKETREADER_HPP_
+#define SRC_MYSQLPACKETREADER_HPP_
+
+#include <boost/cstdint.hpp>
+#include <vector>
+
+/**
+ * Splits the data received from a MySQL connection back into packets, no
+ * matter how the reads happened to be split up or coalesced. Every packet
+ * starts with a 3 byte payload length and a 1 byte sequence number; a
+ * packet whose payload is exactly MAX_PAYLOAD_LENGTH bytes is continued in
+ * the next packet, so one logical message can be several packets. Data
+ * that isn't a whole message yet is kept in a ring buffer.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class MySqlPacketReader
+{
+public:
+    MySqlPacketReader();
+
+    ~MySqlPacketReader();
+
+    /**
+     * Adds data that was received from the connection. If nothing is
+     * buffered and the data is exactly one whole packet, which is by far the
+     * most common case, it's taken by swapping instead of being copied.
+     * @param data The received data. This may be left empty.
+     */
+    void append(std::vector<uint8_t>* data);
+
+    /**
+     * Removes the next complete logical message.
+     * @param packets Filled with the packets of the message, headers
+     *  included, so that they can be forwarded unchanged. Buffers that are
+     *  already in it are reused; new ones come from PacketBufferPool.
+     * @return False if a whole message hasn't been received yet.
+     */
+    bool nextMessage(std::vector<std::vector<uint8_t> >* packets);
+
+    /**
+     * Returns true if no data is buffered.
+     */
+    bool empty() const;
+
+    /**
+     * Reads the server status flags out of an OK or EOF packet.
+     * @param packet The whole packet, header included.
+     * @param length The length of the packet.
+     * @param status Set to the status flags.
+     * @return False if the packet isn't an OK or EOF packet.
+     */
+    static bool getStatusFlags(
+        const uint8_t* packet,
+        size_t length,
+        uint16_t* status
+    );
+
+    /// 3: payload length, 1: sequence number
+    static const size_t HEADER_LENGTH = 3 + 1;
+    static const size_t MAX_PAYLOAD_LENGTH = 0xFFFFFF;
+
+private:
+    /**
+     * Returns the payload length of the packet that starts at an offset
+     * into the buffered data.
+     */
+    size_t payloadLength(size_t offset) const;
+
+    /**
+     * Moves data from the front of the ring into a buffer.
+     */
+    void copyOut(size_t length, std::vector<uint8_t>* destination);
+
+    /**
+     * Makes sure the ring can hold at least this many bytes.
+     */
+    void reserve(size_t length);
+
+    // The ring's size is always a power of 2 so that offsets can be masked
+    std::vector<uint8_t> ring_;
+    size_t head_;
+    size_t size_;
+    /// A whole packet that was taken without copying
+    std::vector<uint8_t> whole_;
+
+    static const size_t MIN_RING_SIZE = 4096;
+
+    // ***** Hidden methods *****
+    MySqlPacketReader(const MySqlPacketReader&);
+    MySqlPacketReader& operator=(const MySqlPacketReader&);
+};
+
+#endif  // SRC_MYSQLPACKETREADER_HPP_
@@ -0,0 +1,288 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MySqlConstants.hpp"
+#include "MySqlSessionState.hpp"
+#include "QueryRisk.hpp"
+
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <boost/cstdint.hpp>
+#include <cctype>
+#include <string>
+#include <vector>
+
+using boost::algorithm::icontains;
+using boost::algorithm::istarts_with;
+using boost::algorithm::to_upper_copy;
+using boost::algorithm::trim_copy;
+using boost::algorithm::trim_copy_if;
+using boost::algorithm::is_any_of;
+using std::find;
+using std::string;
+using std::vector;
+
+const size_t MySqlSessionState::MAX_STATEMENTS;
+
+/**
+ * Anything that reads or changes state that belongs to one connection.
+ */
+static const char* const CONNECTION_SPECIFIC[] = {
+    "FOR UPDATE",
+    "LOCK IN SHARE MODE",
+    "INTO",
+    ":=",
+    "LAST_INSERT_ID",
+    "FOUND_ROWS",
+    "ROW_COUNT",
+    "CONNECTION_ID",
+    "GET_LOCK",
+    "RELEASE_LOCK",
+    "IS_FREE_LOCK",
+    "IS_USED_LOCK",
+    "MASTER_POS_WAIT"
+};
+
+/**
+ * Statements that leave state behind that can't be recreated by running
+ * the statement again somewhere else.
+ */
+static const char* const UNPORTABLE_PREFIXES[] = {
+    "LOCK",
+    "CREATE TEMPORARY",
+    "PREPARE",
+    "HANDLER"
+};
+
+/**
+ * Functions that read or leave behind state that belongs to the connection
+ * that runs them, so the session can't move to another one afterwards.
+ */
+static const char* const UNPORTABLE_FUNCTIONS[] = {
+    "LAST_INSERT_ID",
+    "FOUND_ROWS",
+    "ROW_COUNT",
+    "CONNECTION_ID",
+    "GET_LOCK"
+};
+
+/**
+ * Statements whose result can be read by the next statement, e.g. with
+ * LAST_INSERT_ID() or ROW_COUNT().
+ */
+static const char* const RESULT_PREFIXES[] = {
+    "INSERT",
+    "UPDATE",
+    "DELETE",
+    "REPLACE"
+};
+
+
+/**
+ * Returns true if a query stores something in a user variable, e.g.
+ * SELECT ... INTO @variable.
+ */
+static bool selectsIntoVariable(const string& query)
+{
+    const string upper(to_upper_copy(query));
+    const size_t INTO_LENGTH = 4;
+    size_t into = upper.find("INTO");
+    while (string::npos != into)
+    {
+        const size_t next =
+            upper.find_first_not_of(" \t\r\n", into + INTO_LENGTH);
+        if (string::npos != next && '@' == upper[next])
+        {
+            return true;
+        }
+        into = upper.find("INTO", into + INTO_LENGTH);
+    }
+    return false;
+}
+
+
+MySqlSessionState::MySqlSessionState() :
+    database_(),
+    statements_(),
+    version_(0),
+    portable_(true),
+    lastResult_(false),
+    serverStatus_(MySqlConstants::STATUS_AUTO_COMMIT)
+{
+}
+
+
+void MySqlSessionState::setDatabase(const string& database)
+{
+    if (database != database_)
+    {
+        database_ = database;
+        ++version_;
+    }
+}
+
+
+void MySqlSessionState::observeQuery(
+    const string& query,
+    const QueryRisk::QueryType type
+)
+{
+    const string trimmed(trim_copy(query));
+
+    lastResult_ =
+        QueryRisk::TYPE_INSERT == type
+        || QueryRisk::TYPE_UPDATE == type
+        || QueryRisk::TYPE_DELETE == type
+        || icontains(trimmed, "SQL_CALC_FOUND_ROWS");
+    for (
+        size_t i = 0;
+        i < sizeof(RESULT_PREFIXES) / sizeof(RESULT_PREFIXES[0]);
+        ++i
+    )
+    {
+        if (istarts_with(trimmed, RESULT_PREFIXES[i]))
+        {
+            lastResult_ = true;
+        }
+    }
+
+    if (
+        istarts_with(trimmed, "USE")
+        && trimmed.size() > 3
+        && isspace(trimmed[3])
+    )
+    {
+        setDatabase(
+            trim_copy_if(
+                trimmed.substr(3),
+                is_any_of(" \t\r\n`;")
+            )
+        );
+        return;
+    }
+
+    for (
+        size_t i = 0;
+        i < sizeof(UNPORTABLE_PREFIXES) / sizeof(UNPORTABLE_PREFIXES[0]);
+        ++i
+    )
+    {
+        if (istarts_with(trimmed, UNPORTABLE_PREFIXES[i]))
+        {
+            portable_ = false;
+            return;
+        }
+    }
+    if (QueryRisk::TYPE_SELECT == type && icontains(trimmed, ":="))
+    {
+        portable_ = false;
+        return;
+    }
+    for (
+        size_t i = 0;
+        i < sizeof(UNPORTABLE_FUNCTIONS) / sizeof(UNPORTABLE_FUNCTIONS[0]);
+        ++i
+    )
+    {
+        if (icontains(trimmed, UNPORTABLE_FUNCTIONS[i]))
+        {
+            portable_ = false;
+            return;
+        }
+    }
+    if (selectsIntoVariable(trimmed))
+    {
+        portable_ = false;
+        return;
+    }
+
+    if (QueryRisk::TYPE_SET != type && !istarts_with(trimmed, "SET"))
+    {
+        return;
+    }
+    // Global variables are shared by every connection, so running them
+    // again would change the other server for everyone
+    if (
+        istarts_with(trimmed, "SET GLOBAL")
+        || istarts_with(trimmed, "SET @@GLOBAL")
+    )
+    {
+        return;
+    }
+    // Setting the same thing again only has to happen once, but it has to
+    // come after everything that was set before it
+    vector<string>::iterator previous(
+        find(statements_.begin(), statements_.end(), trimmed)
+    );
+    if (statements_.end() != previous)
+    {
+        if (statements_.end() - 1 == previous)
+        {
+            return;
+        }
+        statements_.erase(previous);
+    }
+    else if (statements_.size() >= MAX_STATEMENTS)
+    {
+        portable_ = false;
+        return;
+    }
+    statements_.push_back(trimmed);
+    ++version_;
+}
+
+
+bool MySqlSessionState::inTransaction() const
+{
+    return 0 != (serverStatus_ & MySqlConstants::STATUS_IN_TRANSACTION)
+        || 0 == (serverStatus_ & MySqlConstants::STATUS_AUTO_COMMIT);
+}
+
+
+bool MySqlSessionState::isPinned() const
+{
+    return !portable_ || lastResult_ || inTransaction();
+}
+
+
+bool MySqlSessionState::isReplicaSafe(const string& query)
+{
+    for (
+        size_t i = 0;
+        i < sizeof(CONNECTION_SPECIFIC) / sizeof(CONNECTION_SPECIFIC[0]);
+        ++i
+    )
+    {
+        if (icontains(query, CONNECTION_SPECIFIC[i]))
+        {
+            return false;
+        }
+    }
+    // Several statements in one query might not all be SELECTs
+    const size_t semicolon = query.find(';');
+    if (
+        string::npos != semicolon
+        && string::npos != query.find_first_not_of(" \t\r\n;", semicolon)
+    )
+    {
+        return false;
+    }
+    return true;
+}
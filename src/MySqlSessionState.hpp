@@ -0,0 +1,127 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_MYSQLSESSIONSTATE_HPP_
+#define SRC_MYSQLSESSIONSTATE_HPP_
+
+#include "QueryRisk.hpp"
+
+#include <boost/cstdint.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * Keeps track of the parts of a client's MySQL session that the server
+ * remembers between statements, i.e. the current database, the SET
+ * statements that it has run and whether it's in a transaction, so that
+ * the same session can be recreated on another server connection. Sessions
+ * that do something that can't be copied, like locking tables or reading
+ * LAST_INSERT_ID(), are marked as not portable.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class MySqlSessionState
+{
+public:
+    MySqlSessionState();
+
+    /**
+     * Sets the current database, e.g. from COM_INIT_DB.
+     */
+    void setDatabase(const std::string& database);
+
+    /**
+     * Returns the current database, or an empty string if there isn't one.
+     */
+    inline const std::string& getDatabase() const { return database_; }
+
+    /**
+     * Updates the state for a query that's been sent to the server.
+     * @param query The query.
+     * @param type The type of the query.
+     */
+    void observeQuery(const std::string& query, QueryRisk::QueryType type);
+
+    /**
+     * Returns the statements that recreate the session's variables on
+     * another connection, in the order that they have to be run.
+     */
+    inline const std::vector<std::string>& getStatements() const
+    {
+        return statements_;
+    }
+
+    /**
+     * Returns a number that changes whenever the database or statements
+     * change, so that a connection can tell if it's up to date.
+     */
+    inline size_t getVersion() const { return version_; }
+
+    /**
+     * Returns false once the session has state that can't be recreated on
+     * another connection.
+     */
+    inline bool isPortable() const { return portable_; }
+
+    /**
+     * Marks the session as having state that can't be recreated, e.g. a
+     * prepared statement.
+     */
+    inline void makeUnportable() { portable_ = false; }
+
+    /**
+     * Sets the server status flags from the server's last OK or EOF packet.
+     */
+    inline void setServerStatus(uint16_t status) { serverStatus_ = status; }
+
+    /**
+     * Returns true if the session is in a transaction, or has turned off
+     * autocommit so that its next statement will start one.
+     */
+    bool inTransaction() const;
+
+    /**
+     * Returns true if the session has to stay on the connection that ran its
+     * last statement, i.e. it's in a transaction, it isn't portable or the
+     * next statement might need the last one's result.
+     */
+    bool isPinned() const;
+
+    /**
+     * Returns true if a SELECT query gives the same answer on any server
+     * with the same data, i.e. it doesn't lock anything or read anything
+     * that only the current connection knows about.
+     */
+    static bool isReplicaSafe(const std::string& query);
+
+    /// Sessions that SET more than this many things aren't copied
+    static const size_t MAX_STATEMENTS = 64;
+
+private:
+    std::string database_;
+    std::vector<std::string> statements_;
+    size_t version_;
+    bool portable_;
+    bool lastResult_;
+    uint16_t serverStatus_;
+};
+
+#endif  // SRC_MYSQLSESSIONSTATE_HPP_
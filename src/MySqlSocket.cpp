@@ -25,8 +25,10 @@
 #include <string>
 #include <cassert>
 #include <cstring>
+#include <vector>
 
 using std::string;
+using std::vector;
 
 
 /*--------------------------------------
@@ -48,8 +50,8 @@ const size_t MySqlSocket::errorPacketMessagePos = 3 + 1 + 1 + 2 + 1 + 5;
 
 
 MySqlSocket::MySqlSocket(const uint16_t port, const string& address,
-    bool blocking) :
-        Socket(port, address, blocking),
+    bool blocking, const int connectTimeoutMilliseconds) :
+        Socket(port, address, blocking, connectTimeoutMilliseconds),
         okPacket_(),
         emptySetPacket_(),
         errorPacket_(),
@@ -90,6 +92,27 @@ MySqlSocket::~MySqlSocket()
 
 
 void MySqlSocket::sendOkPacket(const uint8_t packetNumber) const
+{
+    send(getOkPacket(packetNumber));
+}
+
+
+void MySqlSocket::sendEmptySetPacket() const
+{
+    send(getEmptySetPacket());
+}
+
+
+void MySqlSocket::sendErrorPacket(const uint8_t packetNumber,
+    const uint16_t errorNumber, const string& message) const
+{
+    send(getErrorPacket(packetNumber, errorNumber, message));
+}
+
+
+const vector<uint8_t>& MySqlSocket::getOkPacket(
+    const uint8_t packetNumber
+) const
 {
     if (!okPacketInitialized_)
     {
@@ -101,12 +124,11 @@ void MySqlSocket::sendOkPacket(const uint8_t packetNumber) const
     assert(okPacket_.at(0) == okPacket_.size() - 4
         && "Incorrect payload length in okMessage packet");
 
-    // Send the ok packet
-    send(okPacket_);
+    return okPacket_;
 }
 
 
-void MySqlSocket::sendEmptySetPacket() const
+const vector<uint8_t>& MySqlSocket::getEmptySetPacket() const
 {
     if (!emptySetPacketInitialized_)
     {
@@ -117,13 +139,15 @@ void MySqlSocket::sendEmptySetPacket() const
     // be 1, server status will always be auto commit, warning count will be 0,
     // and message will be blank
 
-    // Send the empty set packet
-    send(emptySetPacket_);
+    return emptySetPacket_;
 }
 
 
-void MySqlSocket::sendErrorPacket(const uint8_t packetNumber,
-    const uint16_t errorNumber, const string& message) const
+const vector<uint8_t>& MySqlSocket::getErrorPacket(
+    const uint8_t packetNumber,
+    const uint16_t errorNumber,
+    const string& message
+) const
 {
     if (!errorPacketInitialized_)
     {
@@ -155,10 +179,7 @@ void MySqlSocket::sendErrorPacket(const uint8_t packetNumber,
     #endif
 
     // Insert message
-    if (errorPacket_.size() < errorPacketMessagePos + message.size())
-    {
-        errorPacket_.reserve(errorPacketMessagePos + message.size());
-    }
+    errorPacket_.resize(errorPacketMessagePos + message.size());
     copy(message.begin(), message.end(),
         errorPacket_.begin() + errorPacketMessagePos);
 
@@ -186,9 +207,7 @@ void MySqlSocket::sendErrorPacket(const uint8_t packetNumber,
         #endif
     #endif
 
-    // Send the error packet
-    send(errorPacket_.begin(),
-        errorPacket_.begin() + errorPacketMessagePos + message.size());
+    return errorPacket_;
 }
 
 
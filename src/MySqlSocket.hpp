@@ -41,9 +41,11 @@ public:
      * @param port The port to communicate on.
      * @param address The computer to connect to.
      * @param blocking If the socket should block on reads.
+     * @param connectTimeoutMilliseconds If positive, give up connecting
+     *  after this long.
      */
     MySqlSocket(const uint16_t port, const std::string& address,
-        bool blocking = true);
+        bool blocking = true, int connectTimeoutMilliseconds = 0);
 
     /**
      * Constructor to communicate on the localhost using Unix domain sockets.
@@ -94,6 +96,20 @@ public:
         const uint16_t errorNumber = 0x0428,
         const std::string& message = std::string("Error")) const;
 
+    /**
+     * Returns the packets that sendOkPacket, sendEmptySetPacket and
+     * sendErrorPacket would send, e.g. so that they can be wrapped in
+     * compressed frames first. The returned packets are only valid until
+     * the next call.
+     */
+    ///@{
+    const std::vector<uint8_t>& getOkPacket(uint8_t packetNumber) const;
+    const std::vector<uint8_t>& getEmptySetPacket() const;
+    const std::vector<uint8_t>& getErrorPacket(uint8_t packetNumber,
+        const uint16_t errorNumber = 0x0428,
+        const std::string& message = std::string("Error")) const;
+    ///@}
+
 private:
     /** Message buffers. */
     ///@{
@@ -57,10 +57,10 @@ AstNode* NegationNode::copy() const
 
 bool NegationNode::isAlwaysTrue() const
 {
-    assert(1 == children_.size() && "NegationNode should have 1 child");
+    assert(1 == getChildrenCount() && "NegationNode should have 1 child");
 
     const ExpressionNode* const expr = dynamic_cast<const ExpressionNode*>(
-        children_.at(0)
+        getChild(0)
     );
     assert(
         nullptr != expr &&
@@ -83,6 +83,22 @@ QueryRisk::EmptyPassword NegationNode::emptyPassword() const
 }
 
 
+bool NegationNode::isLiteralSensitive() const
+{
+    assert(1 == getChildrenCount() && "NegationNode should have 1 child");
+
+    const ExpressionNode* const expr = dynamic_cast<const ExpressionNode*>(
+        getChild(0)
+    );
+    assert(
+        nullptr != expr &&
+        "NegationNode should only an ExpressionNode child"
+    );
+
+    return expr->isLiteralSensitive();
+}
+
+
 void NegationNode::print(
     std::ostream& out,
     const int depth,
@@ -0,0 +1,129 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PacketBufferPool.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <vector>
+
+using boost::lock_guard;
+using boost::mutex;
+using std::vector;
+
+// Static members
+const size_t PacketBufferPool::DEFAULT_BUFFER_SIZE;
+const size_t PacketBufferPool::MAX_POOLED_BUFFERS;
+mutex PacketBufferPool::mutex_;
+vector<vector<uint8_t> > PacketBufferPool::freeBuffers_;
+size_t PacketBufferPool::bufferSize_ = PacketBufferPool::DEFAULT_BUFFER_SIZE;
+uint64_t PacketBufferPool::allocationCount_ = 0;
+uint64_t PacketBufferPool::reuseCount_ = 0;
+uint64_t PacketBufferPool::discardCount_ = 0;
+
+
+void PacketBufferPool::setBufferSize(const size_t bytes)
+{
+    lock_guard<mutex> lock(mutex_);
+    bufferSize_ = bytes;
+    // Anything already pooled is the wrong size now
+    freeBuffers_.clear();
+}
+
+
+size_t PacketBufferPool::getBufferSize()
+{
+    return bufferSize_;
+}
+
+
+void PacketBufferPool::acquire(vector<uint8_t>* const buffer)
+{
+    release(buffer);
+
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (!freeBuffers_.empty())
+        {
+            buffer->swap(freeBuffers_.back());
+            freeBuffers_.pop_back();
+            ++reuseCount_;
+            return;
+        }
+        ++allocationCount_;
+    }
+
+    // Allocate outside of the lock
+    buffer->reserve(bufferSize_);
+}
+
+
+void PacketBufferPool::release(vector<uint8_t>* const buffer)
+{
+    if (0 == buffer->capacity())
+    {
+        return;
+    }
+    buffer->clear();
+
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (
+            buffer->capacity() == bufferSize_
+            && freeBuffers_.size() < MAX_POOLED_BUFFERS
+        )
+        {
+            // The pool's own storage only ever grows to MAX_POOLED_BUFFERS
+            if (freeBuffers_.capacity() < MAX_POOLED_BUFFERS)
+            {
+                freeBuffers_.reserve(MAX_POOLED_BUFFERS);
+            }
+            freeBuffers_.push_back(vector<uint8_t>());
+            freeBuffers_.back().swap(*buffer);
+            return;
+        }
+        ++discardCount_;
+    }
+
+    // Free outside of the lock
+    vector<uint8_t>().swap(*buffer);
+}
+
+
+uint64_t PacketBufferPool::getAllocationCount()
+{
+    lock_guard<mutex> lock(mutex_);
+    return allocationCount_;
+}
+
+
+uint64_t PacketBufferPool::getReuseCount()
+{
+    lock_guard<mutex> lock(mutex_);
+    return reuseCount_;
+}
+
+
+uint64_t PacketBufferPool::getDiscardCount()
+{
+    lock_guard<mutex> lock(mutex_);
+    return discardCount_;
+}
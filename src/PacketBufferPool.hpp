@@ -0,0 +1,105 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_PACKETBUFFERPOOL_HPP_
+#define SRC_PACKETBUFFERPOOL_HPP_
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <vector>
+
+/**
+ * Pool of buffers for packets on their way through a ProxyHalf, so that
+ * receiving, analyzing and forwarding a message doesn't have to allocate.
+ * Buffers are plain vectors; they're handed from one owner to the next by
+ * swapping them, which never copies or allocates. Buffers that have grown
+ * past the pooled size are freed instead of being returned to the pool, so
+ * a few huge queries don't pin memory forever.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class PacketBufferPool
+{
+public:
+    /**
+     * Sets the capacity of the pooled buffers. Messages that fit in this
+     * don't cause any heap allocations once the pool has warmed up. Should
+     * be called before any buffers are acquired.
+     * @param bytes The capacity of each buffer.
+     */
+    static void setBufferSize(size_t bytes);
+
+    /**
+     * Returns the capacity of the pooled buffers.
+     */
+    static size_t getBufferSize();
+
+    /**
+     * Gives a buffer pooled storage with at least getBufferSize() capacity.
+     * Any storage that the buffer had is released first.
+     * @param buffer The buffer to fill. It will be empty.
+     */
+    static void acquire(std::vector<uint8_t>* buffer);
+
+    /**
+     * Returns a buffer's storage to the pool.
+     * @param buffer The buffer to take the storage from. It will be empty
+     *  and have no capacity.
+     */
+    static void release(std::vector<uint8_t>* buffer);
+
+    /**
+     * Returns how many buffers had to be allocated because the pool was
+     * empty.
+     */
+    static uint64_t getAllocationCount();
+
+    /**
+     * Returns how many buffers were handed out from the pool without
+     * allocating.
+     */
+    static uint64_t getReuseCount();
+
+    /**
+     * Returns how many released buffers were freed because they had grown
+     * too large, or because the pool was full.
+     */
+    static uint64_t getDiscardCount();
+
+private:
+    PacketBufferPool();
+
+    static const size_t DEFAULT_BUFFER_SIZE = 65536;
+    static const size_t MAX_POOLED_BUFFERS = 1024;
+
+    static boost::mutex mutex_;
+    static std::vector<std::vector<uint8_t> > freeBuffers_;
+    static size_t bufferSize_;
+    static uint64_t allocationCount_;
+    static uint64_t reuseCount_;
+    static uint64_t discardCount_;
+
+    // ***** Hidden methods *****
+    PacketBufferPool(const PacketBufferPool&);
+    PacketBufferPool& operator=(const PacketBufferPool&);
+};
+
+#endif  // SRC_PACKETBUFFERPOOL_HPP_
@@ -19,24 +19,52 @@
  */
 
 #include "clearStack.hpp"
+#include "ExpressionNode.hpp"
 #include "nullptr.hpp"
 #include "parser.tab.hpp"
 #include "ParserInterface.hpp"
+#include "QueryShapeCache.hpp"
 #include "scanner.yy.hpp"
 
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/tss.hpp>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <stack>
 #include <string>
+#include <vector>
 
-using boost::lock_guard;
+using boost::posix_time::microsec_clock;
+using boost::posix_time::milliseconds;
 using std::bad_alloc;
+using std::free;
+using std::malloc;
+using std::memcpy;
 using std::size_t;
 using std::stack;
 using std::string;
+using std::vector;
 
-// Methods from the parser
+const size_t ParserInterface::SCAN_PADDING;
+const int ParserInterface::BUDGET_EXCEEDED;
+ParserInterface::Budget ParserInterface::budget_;
+uint64_t ParserInterface::budgetExceededCount_ = 0;
+bool ParserInterface::useFastParser_ = false;
+uint64_t ParserInterface::fastParseCount_ = 0;
+uint64_t ParserInterface::glrParseCount_ = 0;
+
+/**
+ * Reading the clock for every token would cost more than the checks save,
+ * so the time budget is only checked every this many tokens.
+ */
+static const int BUDGET_CLOCK_INTERVAL = 16;
+
+// Methods from the parsers
 extern int yyparse(QueryRisk* const qrPtr, ParserInterface* const pi);
+extern int fast_parse(QueryRisk* const qrPtr, ParserInterface* const pi);
+extern void sql_begin_initial(yyscan_t yyscanner);
 
 
 /**
@@ -53,8 +81,23 @@ extern int yyparse(QueryRisk* const qrPtr, ParserInterface* const pi);
 class ParserInterfaceScannerMembers
 {
 public:
-    explicit ParserInterfaceScannerMembers(const char* const query);
+    ParserInterfaceScannerMembers();
     ~ParserInterfaceScannerMembers();
+
+    /**
+     * Starts scanning a query where it is, reusing the scanner. Flex writes
+     * into the buffer while it scans, but puts everything back by the time
+     * it's done.
+     * @param buffer The query, followed by two NULs.
+     * @param size The size of the query plus the two NULs.
+     */
+    void scan(char* buffer, size_t size);
+
+    /**
+     * Stops scanning the current query.
+     */
+    void finish();
+
     yyscan_t scanner_;
     YY_BUFFER_STATE bufferState_;
 private:
@@ -65,6 +108,71 @@ private:
 };
 
 
+/**
+ * The parts of a ParserInterface that can be kept from one query to the
+ * next: the scanner, the scanner's and parser's stacks, the arena for the
+ * nodes and the memory for the GLR parser's stacks. Each thread keeps one
+ * of these, so that parsing a query doesn't need to set everything up again.
+ */
+class ParserContext
+{
+public:
+    ParserContext();
+    ~ParserContext();
+
+    /**
+     * Gets the thread's context, or a new one if a ParserInterface on this
+     * thread is already using it.
+     */
+    static ParserContext* acquire();
+
+    /**
+     * Returns a context from acquire.
+     */
+    static void release(ParserContext* context);
+
+    /**
+     * Gets the thread's context, creating it if needed.
+     */
+    static ParserContext* get();
+
+    ScannerContext scannerContext_;
+    std::stack<AstNode*> valuesList_;
+    AstArena arena_;
+    std::stack<bool> isValuesListStack_;
+    ParserInterfaceScannerMembers scanner_;
+    // Memory that the GLR parser freed, ready for the next query
+    vector<void*> freeStacks_;
+    bool inUse_;
+
+private:
+    static boost::thread_specific_ptr<ParserContext> threadContext_;
+
+    // Hidden methods
+    ParserContext(const ParserContext& rhs);
+    ParserContext& operator=(const ParserContext& rhs);
+};
+
+boost::thread_specific_ptr<ParserContext> ParserContext::threadContext_;
+
+/**
+ * The GLR parser frees and allocates the same few stacks for every query, so
+ * the freed ones are kept around, up to this many.
+ */
+static const size_t MAX_FREE_STACKS = 8;
+
+/**
+ * Stacks start with their capacity, padded so that the stack is still
+ * aligned for anything.
+ */
+static const size_t STACK_HEADER_SIZE = 2 * sizeof(void*);
+
+/**
+ * Gets the capacity of a stack from its header.
+ */
+static size_t& stackCapacity(void* stack);
+
+
 /**
  * Customized yylex so that we can fool the parser into not calling the real
  * sql_lex directly. This way, we can keep track of the tokens from the query
@@ -82,21 +190,94 @@ int yylex(
 );
 
 
-ParserInterface::ParserInterface(const string& buffer) :
-    scannerContext_(),
-    scannerPimpl_(new ParserInterfaceScannerMembers(buffer.c_str())),
+ParserInterface::ParserInterface(
+    const string& buffer,
+    QueryShapeCache* const shapeCache
+) :
+    context_(ParserContext::acquire()),
+    scannerContext_(context_->scannerContext_),
+    scannerPimpl_(&context_->scanner_),
+    tokensHash_(),
+    valuesList_(context_->valuesList_),
+    arena_(context_->arena_),
+    isValuesListStack_(context_->isValuesListStack_),
+    shape_(),
+    recordShape_(false),
+    literalSensitive_(false),
+    shapeCache_(shapeCache),
+    ownedBuffer_(),
+    buffer_(&ownedBuffer_),
+    parsed_(false),
+    qr_(),
+    parserStatus_(0),
+    bufferLen_(buffer.size()),
+    checkingBudget_(false),
+    budgetExceeded_(false),
+    deadline_()
+{
+    try
+    {
+        ownedBuffer_.reserve(bufferLen_ + SCAN_PADDING);
+        ownedBuffer_.append(buffer);
+        ownedBuffer_.append(SCAN_PADDING, '\0');
+        startScanner();
+    }
+    catch (...)
+    {
+        ParserContext::release(context_);
+        throw;
+    }
+}
+
+
+ParserInterface::ParserInterface(
+    string* const buffer,
+    QueryShapeCache* const shapeCache
+) :
+    context_(ParserContext::acquire()),
+    scannerContext_(context_->scannerContext_),
+    scannerPimpl_(&context_->scanner_),
     tokensHash_(),
+    valuesList_(context_->valuesList_),
+    arena_(context_->arena_),
+    isValuesListStack_(context_->isValuesListStack_),
+    shape_(),
+    recordShape_(false),
+    literalSensitive_(false),
+    shapeCache_(shapeCache),
+    ownedBuffer_(),
+    buffer_(buffer),
     parsed_(false),
     qr_(),
     parserStatus_(0),
-    bufferLen_(buffer.size())
+    bufferLen_(buffer->size()),
+    checkingBudget_(false),
+    budgetExceeded_(false),
+    deadline_()
 {
+    assert(nullptr != buffer);
+    buffer_->append(SCAN_PADDING, '\0');
+    try
+    {
+        startScanner();
+    }
+    catch (...)
+    {
+        buffer_->resize(bufferLen_);
+        ParserContext::release(context_);
+        throw;
+    }
 }
 
 
 ParserInterface::~ParserInterface()
 {
-    delete scannerPimpl_;
+    // The tokens point into the query, so they have to go before it does
+    scannerPimpl_->finish();
+    scannerContext_.clear();
+    ParserContext::release(context_);
+    // Give the caller their query back the way it was
+    buffer_->resize(bufferLen_);
 }
 
 
@@ -109,13 +290,63 @@ int ParserInterface::parse(QueryRisk* const qrPtr)
         return parserStatus_;
     }
 
+    string shape;
+    if (nullptr != shapeCache_ && findShape(qrPtr, &shape))
+    {
+        qr_ = *qrPtr;
+        parserStatus_ = 0;
+        parsed_ = true;
+        return 0;
+    }
+
     int parserStatus;
     // Clear the stacks before every parsing attempt
-    clearStack(&scannerContext_.identifiers);
-    clearStack(&scannerContext_.quotedStrings);
-    clearStack(&scannerContext_.numbers);
+    scannerContext_.clear();
+    clearStack(&isValuesListStack_);
 
-    parserStatus = yyparse(qrPtr, this);
+    budgetExceeded_ = false;
+    if (budget_.maxMilliseconds > 0)
+    {
+        deadline_ = microsec_clock::universal_time()
+            + milliseconds(budget_.maxMilliseconds);
+    }
+    checkingBudget_ = true;
+    bool parsed = false;
+    if (useFastParser_)
+    {
+        // The fast parser treats the grammar's conflicts as syntax errors,
+        // so it only accepts queries that have one reading. Anything that
+        // it rejects gets another try from the GLR parser.
+        const QueryRisk original(*qrPtr);
+        parserStatus = fast_parse(qrPtr, this);
+        if (budgetExceeded_ || (0 == parserStatus && qrPtr->valid))
+        {
+            __sync_fetch_and_add(&fastParseCount_, 1);
+            parsed = true;
+        }
+        else
+        {
+            *qrPtr = original;
+            restartParse();
+        }
+    }
+    if (!parsed)
+    {
+        __sync_fetch_and_add(&glrParseCount_, 1);
+        parserStatus = yyparse(qrPtr, this);
+    }
+    checkingBudget_ = false;
+
+    // The GLR parser gives up with a memory exhausted error when its stacks
+    // go over maxStackItems. Either way, whatever the parser had found so
+    // far is only from part of the query, so it can't be trusted.
+    const int MEMORY_EXHAUSTED = 2;
+    if (budgetExceeded_ || MEMORY_EXHAUSTED == parserStatus)
+    {
+        __sync_fetch_and_add(&budgetExceededCount_, 1);
+        parserStatus = BUDGET_EXCEEDED;
+        qrPtr->valid = false;
+    }
 
     #ifndef NDEBUG
         if (0 == parserStatus && qrPtr->valid)
@@ -132,16 +363,38 @@ int ParserInterface::parse(QueryRisk* const qrPtr)
                 scannerContext_.numbers.empty()
                 && "Numbers stack not empty"
             );
+            assert(
+                valuesList_.empty()
+                && "Values list stack not empty"
+            );
         }
     #endif
 
+    // The risks have all been recorded, so the tree isn't needed anymore. A
+    // failed parse can leave IN list expressions behind, but they're in the
+    // arena too.
+    clearStack(&valuesList_);
+    arena_.reset();
+
     qr_ = *qrPtr;
     parserStatus_ = parserStatus;
     parsed_ = true;
 
+    if (
+        nullptr != shapeCache_
+        && 0 == parserStatus
+        && qrPtr->valid
+        && !literalSensitive_
+    )
+    {
+        shapeCache_->insert(shape, *qrPtr);
+    }
+
     // If the parser failed, we still need to manually calculate the rest of
     // the hash for this query. That calculation is handled in yylex, so just
-    // keep calling yylex ourselves until it hits the end of the buffer.
+    // keep calling yylex ourselves until it hits the end of the buffer. This
+    // also lets the scanner see the rest of queries that went over the
+    // budget.
     if (parserStatus != 0)
     {
         const int MIN_VALID_TOKEN = 255;
@@ -152,6 +405,213 @@ int ParserInterface::parse(QueryRisk* const qrPtr)
 }
 
 
+bool ParserInterface::findShape(QueryRisk* const qrPtr, string* const shape)
+{
+    assert(nullptr != qrPtr);
+    assert(nullptr != shape);
+
+    QueryRisk scanned;
+    recordShape_ = true;
+    const int MIN_VALID_TOKEN = 255;
+    while (yylex(nullptr, &scanned, this) > MIN_VALID_TOKEN);
+    recordShape_ = false;
+    shape->swap(shape_);
+
+    if (shapeCache_->find(*shape, qrPtr))
+    {
+        // The comments and hex strings are only seen by the scanner, so they
+        // aren't part of the shape
+        qrPtr->multiLineComments = scanned.multiLineComments;
+        qrPtr->hashComments = scanned.hashComments;
+        qrPtr->dashDashComments = scanned.dashDashComments;
+        qrPtr->mySqlComments = scanned.mySqlComments;
+        qrPtr->mySqlVersionedComments = scanned.mySqlVersionedComments;
+        qrPtr->hexStrings = scanned.hexStrings;
+        qrPtr->commentedConditionals = scanned.commentedConditionals;
+        qrPtr->commentedQuotes = scanned.commentedQuotes;
+        qrPtr->valid = scanned.valid;
+        return true;
+    }
+
+    // Start over so that the parser sees every token
+    startScanner();
+    tokensHash_ = QueryHash();
+    return false;
+}
+
+
+ParserInterface::Budget::Budget() :
+    maxTokens(0),
+    maxStackItems(10000),
+    maxMilliseconds(0),
+    blockOverBudget(true)
+{
+}
+
+
+void ParserInterface::setBudget(const Budget& budget)
+{
+    budget_ = budget;
+}
+
+
+const ParserInterface::Budget& ParserInterface::getBudget()
+{
+    return budget_;
+}
+
+
+uint64_t ParserInterface::getBudgetExceededCount()
+{
+    return budgetExceededCount_;
+}
+
+
+void ParserInterface::setFastParser(const bool useFastParser)
+{
+    useFastParser_ = useFastParser;
+}
+
+
+uint64_t ParserInterface::getFastParseCount()
+{
+    return fastParseCount_;
+}
+
+
+uint64_t ParserInterface::getGlrParseCount()
+{
+    return glrParseCount_;
+}
+
+
+bool ParserInterface::isOverBudget()
+{
+    if (!checkingBudget_)
+    {
+        return false;
+    }
+    if (budgetExceeded_)
+    {
+        return true;
+    }
+
+    const size_t tokens = static_cast<size_t>(tokensHash_.tokensCount);
+    if (budget_.maxTokens > 0 && tokens > budget_.maxTokens)
+    {
+        budgetExceeded_ = true;
+    }
+    else if (
+        budget_.maxMilliseconds > 0
+        && 0 == tokens % BUDGET_CLOCK_INTERVAL
+        && microsec_clock::universal_time() > deadline_
+    )
+    {
+        budgetExceeded_ = true;
+    }
+    return budgetExceeded_;
+}
+
+
+ParserInterface::QueryHash ParserInterface::scanHash()
+{
+    assert(!parsed_ && "scanHash() called after parse(QueryRisk* const)");
+
+    QueryRisk scanned;
+    const int MIN_VALID_TOKEN = 255;
+    while (yylex(nullptr, &scanned, this) > MIN_VALID_TOKEN);
+    const QueryHash hash(tokensHash_);
+
+    // Start over so that the query can still be parsed
+    startScanner();
+    scannerContext_.clear();
+    tokensHash_ = QueryHash();
+    return hash;
+}
+
+
+void ParserInterface::startScanner()
+{
+    scannerPimpl_->scan(&(*buffer_)[0], bufferLen_ + SCAN_PADDING);
+}
+
+
+void ParserInterface::restartParse()
+{
+    startScanner();
+    scannerContext_.clear();
+    clearStack(&valuesList_);
+    clearStack(&isValuesListStack_);
+    arena_.reset();
+    tokensHash_ = QueryHash();
+    literalSensitive_ = false;
+}
+
+
+void* ParserInterface::allocateStack(const size_t bytes)
+{
+    vector<void*>& freeStacks = ParserContext::get()->freeStacks_;
+    for (size_t i = 0; i < freeStacks.size(); ++i)
+    {
+        void* const stack = freeStacks[i];
+        if (stackCapacity(stack) >= bytes)
+        {
+            freeStacks[i] = freeStacks.back();
+            freeStacks.pop_back();
+            return stack;
+        }
+    }
+
+    char* const memory = static_cast<char*>(malloc(STACK_HEADER_SIZE + bytes));
+    if (nullptr == memory)
+    {
+        return nullptr;
+    }
+    void* const stack = memory + STACK_HEADER_SIZE;
+    stackCapacity(stack) = bytes;
+    return stack;
+}
+
+
+void* ParserInterface::reallocateStack(void* const stack, const size_t bytes)
+{
+    if (nullptr == stack)
+    {
+        return allocateStack(bytes);
+    }
+    if (stackCapacity(stack) >= bytes)
+    {
+        return stack;
+    }
+    void* const newStack = allocateStack(bytes);
+    if (nullptr == newStack)
+    {
+        return nullptr;
+    }
+    memcpy(newStack, stack, stackCapacity(stack));
+    freeStack(stack);
+    return newStack;
+}
+
+
+void ParserInterface::freeStack(void* const stack)
+{
+    if (nullptr == stack)
+    {
+        return;
+    }
+    vector<void*>& freeStacks = ParserContext::get()->freeStacks_;
+    if (freeStacks.size() < MAX_FREE_STACKS)
+    {
+        freeStacks.push_back(stack);
+    }
+    else
+    {
+        free(static_cast<char*>(stack) - STACK_HEADER_SIZE);
+    }
+}
+
+
 ParserInterface::QueryHash ParserInterface::getHash() const
 {
     assert(parsed_ && "gethash() called before parse(QueryRisk* const)");
@@ -182,9 +642,7 @@ size_t hash_value(const ParserInterface::QueryHash& qh)
 }
 
 
-ParserInterfaceScannerMembers::ParserInterfaceScannerMembers(
-    const char* const query
-) :
+ParserInterfaceScannerMembers::ParserInterfaceScannerMembers() :
     scanner_(),
     bufferState_(nullptr)
 {
@@ -192,22 +650,51 @@ ParserInterfaceScannerMembers::ParserInterfaceScannerMembers(
     {
         throw bad_alloc();
     }
-    bufferState_ = sql__scan_string(query, scanner_);
+}
+
+
+ParserInterfaceScannerMembers::~ParserInterfaceScannerMembers()
+{
+    finish();
+    sql_lex_destroy(scanner_);
+}
+
+
+void ParserInterfaceScannerMembers::scan(char* const buffer, const size_t size)
+{
+    finish();
+    // The last query might have stopped in the middle of a comment or string
+    sql_begin_initial(scanner_);
+    bufferState_ = sql__scan_buffer(buffer, size, scanner_);
     if (nullptr == bufferState_)
     {
-        sql_lex_destroy(scanner_);
         throw bad_alloc();
     }
 }
 
 
-ParserInterfaceScannerMembers::~ParserInterfaceScannerMembers()
+void ParserInterfaceScannerMembers::finish()
 {
-    sql__delete_buffer(bufferState_, scanner_);
-    sql_lex_destroy(scanner_);
+    if (nullptr != bufferState_)
+    {
+        sql__delete_buffer(bufferState_, scanner_);
+        bufferState_ = nullptr;
+    }
 }
 
 
+/**
+ * Adds a lexeme to the shape of the query. Identifiers are added with their
+ * text, because tables and functions are checked by name, and strings are
+ * added with the only things about them that the parser looks at in queries
+ * that aren't literal sensitive: whether they are empty and whether they are
+ * numbers.
+ * @param lexCode The new lexeme from the buffer stream.
+ * @param pi The ParserInterface that is building the shape.
+ */
+static void appendShape(const int lexCode, ParserInterface* const pi);
+
+
 /**
  * Calculates the partial sdbm hash, given a new lexeme.
  * @param lexCode The new lexeme from the buffer stream.
@@ -257,11 +744,35 @@ int yylex(
     {
         ++pi->tokensHash_.tokensCount;
         pi->tokensHash_.hash = sdbmHash(lexCode, pi->tokensHash_.hash);
+        if (pi->recordShape_)
+        {
+            appendShape(lexCode, pi);
+        }
+        // Ending the query early is the only way to stop the parser from
+        // here. The token is still hashed, so the hash covers the query.
+        if (pi->isOverBudget())
+        {
+            return 0;
+        }
     }
     return lexCode;
 }
 
 
+/**
+ * The fast parser's yylex. Its YYSTYPE is generated from the same %union
+ * as the GLR parser's, so they're the same type.
+ */
+int fast_lex(
+    YYSTYPE* const lvalp,
+    QueryRisk* const qr,
+    ParserInterface* const pi
+)
+{
+    return yylex(lvalp, qr, pi);
+}
+
+
 static ParserInterface::hashType sdbmHash(
     const int lexCode,
     const ParserInterface::hashType ht
@@ -269,3 +780,108 @@ static ParserInterface::hashType sdbmHash(
 {
     return lexCode + (ht << 6) + (ht << 16) - ht;
 }
+
+
+static void appendShape(const int lexCode, ParserInterface* const pi)
+{
+    const char EMPTY_STRING = 1;
+    const char NUMBER_STRING = 2;
+
+    string& shape = pi->shape_;
+    shape += static_cast<char>(lexCode & 0xFF);
+    shape += static_cast<char>((lexCode >> 8) & 0xFF);
+
+    if (IDENTIFIER == lexCode || GLOBAL_VARIABLE == lexCode)
+    {
+        const Lexeme& identifier = pi->scannerContext_.identifiers.top();
+        // Prefix the length so that the shape can't be ambiguous
+        const size_t length = identifier.length;
+        for (size_t i = 0; i < sizeof(uint32_t); ++i)
+        {
+            shape += static_cast<char>((length >> (i * 8)) & 0xFF);
+        }
+        shape.append(identifier.text, identifier.length);
+    }
+    else if (QUOTED_STRING == lexCode)
+    {
+        const Lexeme& str = pi->scannerContext_.quotedStrings.top();
+        char bits = 0;
+        if (str.empty())
+        {
+            bits |= EMPTY_STRING;
+        }
+        if (ExpressionNode::isNumber(str.str()))
+        {
+            bits |= NUMBER_STRING;
+        }
+        shape += bits;
+    }
+}
+
+
+ParserContext::ParserContext() :
+    scannerContext_(),
+    valuesList_(),
+    arena_(),
+    isValuesListStack_(),
+    scanner_(),
+    freeStacks_(),
+    inUse_(false)
+{
+    freeStacks_.reserve(MAX_FREE_STACKS);
+}
+
+
+ParserContext::~ParserContext()
+{
+    for (size_t i = 0; i < freeStacks_.size(); ++i)
+    {
+        free(static_cast<char*>(freeStacks_[i]) - STACK_HEADER_SIZE);
+    }
+}
+
+
+ParserContext* ParserContext::acquire()
+{
+    ParserContext* const context = get();
+    if (context->inUse_)
+    {
+        return new ParserContext();
+    }
+    context->inUse_ = true;
+    return context;
+}
+
+
+void ParserContext::release(ParserContext* const context)
+{
+    assert(nullptr != context);
+    if (threadContext_.get() == context)
+    {
+        context->inUse_ = false;
+    }
+    else
+    {
+        delete context;
+    }
+}
+
+
+ParserContext* ParserContext::get()
+{
+    ParserContext* context = threadContext_.get();
+    if (nullptr == context)
+    {
+        context = new ParserContext();
+        threadContext_.reset(context);
+    }
+    return context;
+}
+
+
+size_t& stackCapacity(void* const stack)
+{
+    return *reinterpret_cast<size_t*>(
+        static_cast<char*>(stack) - STACK_HEADER_SIZE
+    );
+}
@@ -21,18 +21,28 @@
 #ifndef SRC_PARSERINTERFACE_HPP_
 #define SRC_PARSERINTERFACE_HPP_
 
+#include "AstArena.hpp"
 #include "AstNode.hpp"
+#include "nullptr.hpp"
+class ParserContext;
 class ParserInterfaceScannerMembers;
 #include "QueryRisk.hpp"
+class QueryShapeCache;
 #include "ScannerContext.hpp"
 
 #include <boost/cstdint.hpp>
-#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <cstddef>
+#include <stack>
+#include <string>
 #include <vector>
 
 /**
  * Interface to the Bison parser so I don't have to keep allocating
- * YY_BUFFER_STATESs and stuff all over in my code.
+ * YY_BUFFER_STATESs and stuff all over in my code. The scanner and the
+ * parser's stacks are kept for each thread and reused from one instance to
+ * the next, so separate instances can parse queries from separate threads
+ * at the same time.
  * @author Brandon Skari
  * @date January 12 2011
  */
@@ -41,21 +51,106 @@ class ParserInterface
 {
 public:
     /**
-     * Default constructor.
+     * Default constructor. The query is copied so that the scanner has
+     * somewhere to work on it.
      * @param buffer The buffer to read tokens from (i.e. the query to be
      * parsed).
+     * @param shapeCache If set, the query is only tokenized when a query of
+     * the same shape has already been parsed.
      */
-    explicit ParserInterface(const std::string& buffer);
+    explicit ParserInterface(
+        const std::string& buffer,
+        QueryShapeCache* shapeCache = nullptr
+    );
+
+    /**
+     * Constructor that scans the query where it is instead of copying it.
+     * The scanner needs SCAN_PADDING NULs after the query, so they are added
+     * to the end of buffer until the ParserInterface is destroyed, and
+     * buffer must not be used in the meantime. Reserve room for them ahead
+     * of time so that buffer doesn't need to be reallocated.
+     * @param buffer The query to be parsed.
+     * @param shapeCache If set, the query is only tokenized when a query of
+     * the same shape has already been parsed.
+     */
+    explicit ParserInterface(
+        std::string* buffer,
+        QueryShapeCache* shapeCache = nullptr
+    );
 
     ~ParserInterface();
 
     /**
      * Parses the provided buffer.
      * @param qr The QueryRisk attributes of the parsed query.
-     * @return The status code from the Bison parser.
+     * @return The status code from the Bison parser, or BUDGET_EXCEEDED if
+     *  parsing was stopped because it went over the budget.
      */
     int parse(QueryRisk* const qr) WARN_UNUSED_RESULT;
 
+    /**
+     * Returned by parse when the query went over the budget. The QueryRisk
+     * is marked as invalid, but still has what the scanner found in the
+     * whole query.
+     */
+    static const int BUDGET_EXCEEDED = 3;
+
+    /**
+     * Limits on how much work parsing a single query can take. The GLR
+     * parser splits its stack on ambiguous input, and a query that makes it
+     * split over and over would otherwise tie up its thread.
+     */
+    struct Budget
+    {
+        Budget();
+        /// The most tokens the parser reads, or 0 for no limit
+        size_t maxTokens;
+        /// The most GLR stack items, shared by all of the split stacks
+        size_t maxStackItems;
+        /// How long the parser can take, or 0 for no limit
+        unsigned int maxMilliseconds;
+        /// If set, queries that go over the budget are blocked; otherwise,
+        /// they're judged only by what the scanner found in them
+        bool blockOverBudget;
+    };
+
+    /**
+     * Sets the budget for every parse. Should be called before any queries
+     * are parsed.
+     */
+    static void setBudget(const Budget& budget);
+
+    static const Budget& getBudget();
+
+    /**
+     * Returns how many queries have gone over the budget.
+     */
+    static uint64_t getBudgetExceededCount();
+
+    /**
+     * Sets whether queries are parsed with the deterministic fast parser
+     * first, before falling back to the GLR parser when it rejects them. The
+     * fast parser is off by default. Should be called before any queries are
+     * parsed.
+     */
+    static void setFastParser(bool useFastParser);
+
+    /**
+     * Returns how many queries the fast parser accepted, and how many were
+     * parsed by the GLR parser.
+     */
+    //@{
+    static uint64_t getFastParseCount();
+    static uint64_t getGlrParseCount();
+    //@}
+
+    /**
+     * Checks whether the parse has gone over the budget. Called by yylex
+     * after every token; once this returns true, the parser is given the
+     * end of the query so that it stops.
+     */
+    bool isOverBudget();
+
     typedef uint64_t hashType;
     struct QueryHash
     {
@@ -66,7 +161,25 @@ public:
     };
     QueryHash getHash() const;
 
-    ScannerContext scannerContext_;
+    /**
+     * Scans the query without parsing it and returns the hash of its tokens,
+     * the same hash that getHash returns after parsing. This is cheap enough
+     * to check the whitelists with before deciding whether to parse at all.
+     * The query can still be parsed afterward.
+     */
+    QueryHash scanHash();
+
+    static const size_t SCAN_PADDING = 2;
+
+    /**
+     * Allocators for the GLR parser's stacks that keep the memory in the
+     * thread's context between queries. Used by parser.y.
+     */
+    //@{
+    static void* allocateStack(size_t bytes);
+    static void* reallocateStack(void* stack, size_t bytes);
+    static void freeStack(void* stack);
+    //@}
 
     /**
      * @TODO(bskari) Declare yylex as a friend so that I can make these
@@ -75,19 +188,73 @@ public:
      * parser.tab.hpp includes this file, which creates a circular dependency.
      */
     //@{
-    ParserInterfaceScannerMembers* scannerPimpl_;
+    // The state that is kept between queries. The members below that are
+    // references are parts of it.
+    ParserContext* const context_;
+    ScannerContext& scannerContext_;
+    ParserInterfaceScannerMembers* const scannerPimpl_;
     // Used to tokenize the string before parsing, so that I can do things
     // like whitelist queries that fail to parse until I fix the parser.
     QueryHash tokensHash_;
+    // Expressions from the IN (...) list that is currently being parsed
+    std::stack<AstNode*>& valuesList_;
+    // Every node that the parser creates comes from here, so a whole parse
+    // is freed at once instead of node by node
+    AstArena& arena_;
+    // Whether each IN list was a list of values (true) or a subselect (false)
+    std::stack<bool>& isValuesListStack_;
+    // The query's shape for QueryShapeCache, built by yylex while
+    // recordShape_ is set
+    std::string shape_;
+    bool recordShape_;
+    // Set by the parser when the risks that it found depend on the values of
+    // literals, so they can't be reused for other queries of the same shape
+    bool literalSensitive_;
     //@}
 
 private:
+    /**
+     * Tokenizes the query and looks up its shape in the shape cache. If it
+     * isn't there, the scanner is reset so that the query can be parsed.
+     * @param qr Set to the QueryRisk attributes of the query on a hit.
+     * @param shape Set to the shape of the query.
+     * @return True if the shape was cached.
+     */
+    bool findShape(QueryRisk* qr, std::string* shape);
+
+    /**
+     * Starts scanning the query from the beginning.
+     */
+    void startScanner();
+
+    /**
+     * Throws away everything from a parsing attempt, so that the query can
+     * be parsed again from the beginning.
+     */
+    void restartParse();
+
+    QueryShapeCache* const shapeCache_;
+    // The copy of the query, if the caller's can't be scanned in place
+    std::string ownedBuffer_;
+    // The query followed by SCAN_PADDING NULs
+    std::string* const buffer_;
     bool parsed_;
     QueryRisk qr_;
     int parserStatus_;
-    const int bufferLen_;
+    const size_t bufferLen_;
+
+    // The budget is only checked while yyparse is running, so that the
+    // other passes of the scanner always see the whole query
+    bool checkingBudget_;
+    bool budgetExceeded_;
+    boost::posix_time::ptime deadline_;
+
+    static Budget budget_;
+    static uint64_t budgetExceededCount_;
 
-    static boost::mutex parserMutex_;
+    static bool useFastParser_;
+    static uint64_t fastParseCount_;
+    static uint64_t glrParseCount_;
 
     // Hidden methods
     ParserInterface(const ParserInterface& rhs);
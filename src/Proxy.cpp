@@ -20,6 +20,7 @@
 
 #include "AutoPtrWithOperatorParens.hpp"
 #include "Logger.hpp"
+#include "nullptr.hpp"
 #include "Proxy.hpp"
 #include "ProxyHalf.hpp"
 #include "Socket.hpp"
@@ -56,6 +57,9 @@ Proxy::Proxy(Proxy& rhs) :
 
 Proxy::~Proxy()
 {
+    // The halves' timeouts use the sockets, so the halves have to go first
+    in_.reset();
+    out_.reset();
 }
 
 
@@ -68,9 +72,14 @@ void Proxy::operator()()
 void Proxy::runUntilFinished()
 {
     thread inThread(in_);
-    thread outThread(out_);
+    // Pooled connections don't have a server socket to read from, so the
+    // client's half passes the responses along itself
+    if (nullptr != outSocket_.get())
+    {
+        thread outThread(out_);
+        outThread.join();
+    }
     inThread.join();
-    outThread.join();
     Logger::log(Logger::DEBUG)
         << "Client disconnected, quitting thread #"
         << boost::this_thread::get_id();
@@ -19,16 +19,22 @@
  */
 
 #include "Logger.hpp"
+#include "nullptr.hpp"
+#include "PacketBufferPool.hpp"
 #include "ProxyHalf.hpp"
 #include "SocketException.hpp"
 #include "Socket.hpp"
+#include "TimerWheel.hpp"
 
+#include <boost/bind.hpp>
 #include <boost/cstdint.hpp>
 #include <boost/thread.hpp>
 #include <exception>
 #include <memory>
 #include <vector>
 
+using boost::lock_guard;
+using boost::mutex;
 using std::vector;
 using std::exception;
 using std::auto_ptr;
@@ -37,20 +43,35 @@ using std::auto_ptr;
 ProxyHalf::ProxyHalf(Socket* const incomingConnection,
     Socket* const outgoingConnection) :
         incomingConnection_(incomingConnection),
-        outgoingConnection_(outgoingConnection)
+        outgoingConnection_(outgoingConnection),
+        packet_(),
+        timers_(nullptr),
+        idleTimeout_(0),
+        timeout_(0),
+        timeoutMutex_()
 {
 }
 
 
 ProxyHalf::ProxyHalf(ProxyHalf& rhs) :
     incomingConnection_(rhs.incomingConnection_),
-    outgoingConnection_(rhs.outgoingConnection_)
+    outgoingConnection_(rhs.outgoingConnection_),
+    packet_(),
+    timers_(rhs.timers_),
+    idleTimeout_(rhs.idleTimeout_),
+    timeout_(0),
+    timeoutMutex_()
 {
+    packet_.swap(rhs.packet_);
+    // The timeout would expire on the old object
+    rhs.stopTimeout();
 }
 
 
 ProxyHalf::~ProxyHalf()
 {
+    stopTimeout();
+    PacketBufferPool::release(&packet_);
 }
 
 
@@ -61,16 +82,20 @@ void ProxyHalf::operator()()
     {
         while (true)
         {
-            vector<uint8_t> packet(incomingConnection_->receive());
+            preparePacketBuffer();
+            startTimeout(getReceiveTimeout());
+            incomingConnection_->receive(&packet_);
+            stopTimeout();
 
-            handleMessage(packet);
+            handleMessage(packet_);
         }
     }
     catch (ClosedException& e)
     {
         // All done, so nothing else to do
+        stopTimeout();
         incomingConnection_->close();
-        outgoingConnection_->close();
+        closeOutgoing();
     }
     catch (exception& e)
     {
@@ -79,13 +104,129 @@ void ProxyHalf::operator()()
             << e.what();
 
         // Close the remaining connections
+        stopTimeout();
         incomingConnection_->close();
-        outgoingConnection_->close();
+        closeOutgoing();
     }
 }
 
 
+bool ProxyHalf::handleAvailableData()
+{
+    // Event loops keep lots of mostly idle connections, so give the buffer
+    // back to the pool instead of holding on to it between reads
+    preparePacketBuffer();
+    try
+    {
+        const bool received = incomingConnection_->receiveAvailable(&packet_);
+        if (received)
+        {
+            stopTimeout();
+            handleMessage(packet_);
+            startTimeout(getReceiveTimeout());
+        }
+        PacketBufferPool::release(&packet_);
+        return received;
+    }
+    catch (...)
+    {
+        stopTimeout();
+        PacketBufferPool::release(&packet_);
+        throw;
+    }
+}
+
+
+void ProxyHalf::handleReceivedData(vector<uint8_t>& data)
+{
+    handleMessage(data);
+}
+
+
 void ProxyHalf::handleMessage(vector<uint8_t>& rawMessage) const
 {
     outgoingConnection_->send(rawMessage.begin(), rawMessage.end());
 }
+
+
+void ProxyHalf::useTimeouts(
+    TimerWheel* const timers,
+    const int idleMilliseconds
+)
+{
+    timers_ = timers;
+    idleTimeout_ = idleMilliseconds;
+    // Event loops only come back to this when data arrives, so the first
+    // wait has to be timed from here
+    startTimeout(getReceiveTimeout());
+}
+
+
+void ProxyHalf::expectDataWithin(const int milliseconds) const
+{
+    startTimeout(milliseconds);
+}
+
+
+int ProxyHalf::getReceiveTimeout() const
+{
+    return idleTimeout_;
+}
+
+
+void ProxyHalf::closeOutgoing() const
+{
+    // Pooled connections don't keep a server socket for each client
+    if (nullptr != outgoingConnection_)
+    {
+        outgoingConnection_->close();
+    }
+}
+
+
+void ProxyHalf::startTimeout(const int milliseconds) const
+{
+    if (nullptr == timers_ || milliseconds <= 0)
+    {
+        return;
+    }
+    lock_guard<mutex> lg(timeoutMutex_);
+    timers_->cancel(timeout_);
+    timeout_ = timers_->schedule(
+        milliseconds,
+        boost::bind(&ProxyHalf::timeOut, incomingConnection_)
+    );
+}
+
+
+void ProxyHalf::stopTimeout() const
+{
+    if (nullptr == timers_)
+    {
+        return;
+    }
+    lock_guard<mutex> lg(timeoutMutex_);
+    timers_->cancel(timeout_);
+    timeout_ = 0;
+}
+
+
+void ProxyHalf::timeOut(Socket* const connection)
+{
+    Logger::log(Logger::INFO)
+        << "Closing the connection with "
+        << connection->getPeerName()
+        << " after it timed out";
+    // Whoever is waiting on the connection wakes up and closes both sides
+    connection->shutdown();
+}
+
+
+void ProxyHalf::preparePacketBuffer()
+{
+    // handleMessage is allowed to take the buffer by swapping it out
+    if (packet_.capacity() < PacketBufferPool::getBufferSize())
+    {
+        PacketBufferPool::acquire(&packet_);
+    }
+}
@@ -21,8 +21,11 @@
 #ifndef SRC_PROXYHALF_HPP_
 #define SRC_PROXYHALF_HPP_
 
+#include "TimerWheel.hpp"
+
 #include <vector>
 #include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
 
 class Socket;
 
@@ -59,17 +62,94 @@ public:
      */
     void operator()();
 
+    /**
+     * Handles whatever data is waiting on the incoming Socket without
+     * blocking. This is used by EventLoop in place of operator(), so that
+     * many connections can share a single thread.
+     * @return False if there was no data waiting.
+     * @throw ClosedException The incoming connection was closed.
+     */
+    bool handleAvailableData();
+
+    /**
+     * Handles data that has already been read from the incoming Socket, e.g.
+     * by an EventLoop that does its own reading.
+     */
+    void handleReceivedData(std::vector<uint8_t>& data);
+
+    /**
+     * Closes the connection if nothing arrives on the incoming Socket for a
+     * while. Only time spent waiting for data counts, not time spent
+     * handling it. This should be called before the connection is run.
+     * @param timers The wheel that runs the timeouts. It must outlive this.
+     * @param idleMilliseconds How long to wait for each message, or 0 to
+     *  wait forever.
+     */
+    void useTimeouts(TimerWheel* timers, int idleMilliseconds);
+
+    /**
+     * Closes the connection unless something arrives on the incoming Socket
+     * within a time limit, e.g. when a response is due. This can be called
+     * from other threads. Does nothing unless useTimeouts has been called.
+     * @param milliseconds How long to wait.
+     */
+    void expectDataWithin(int milliseconds) const;
+
 protected:
     /**
      * Handles a message that has just been received from the incoming Socket.
-     * In this class, just forward the message.
+     * In this class, just forward the message. Implementations that need to
+     * hold on to the message can take it by swapping it out, which leaves
+     * rawMessage empty; it should eventually be given back to
+     * PacketBufferPool.
      */
     virtual void handleMessage(std::vector<uint8_t>& rawMessage) const;
 
+    /**
+     * Returns how long to wait for the next message before closing the
+     * connection, or 0 to wait forever. Derived classes can override this,
+     * e.g. to wait less for a login than for a query.
+     */
+    virtual int getReceiveTimeout() const;
+
     Socket* const incomingConnection_;
     Socket* const outgoingConnection_;
 
 private:
+    /**
+     * Closes the outgoing connection, if there is one.
+     */
+    void closeOutgoing() const;
+
+    /**
+     * Makes sure that packet_ has storage from PacketBufferPool.
+     */
+    void preparePacketBuffer();
+
+    /**
+     * Replaces any running timeout with a new one. Does nothing if
+     * milliseconds isn't positive.
+     */
+    void startTimeout(int milliseconds) const;
+
+    /**
+     * Cancels the running timeout, if there is one.
+     */
+    void stopTimeout() const;
+
+    /**
+     * Called by the TimerWheel when a timeout expires.
+     */
+    static void timeOut(Socket* connection);
+
+    /// Reused for every message that's received
+    std::vector<uint8_t> packet_;
+
+    TimerWheel* timers_;
+    int idleTimeout_;
+    mutable TimerWheel::TimerId timeout_;
+    mutable boost::mutex timeoutMutex_;
+
     // ***** Hidden methods *****
     ProxyHalf& operator=(const ProxyHalf&);
 };
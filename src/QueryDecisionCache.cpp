@@ -0,0 +1,173 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ConcurrentCache.hpp"
+#include "Logger.hpp"
+#include "QueryDecisionCache.hpp"
+#include "Sha1.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <vector>
+
+using boost::shared_ptr;
+using std::string;
+
+const int QueryDecisionCache::DEFAULT_SHARDS_COUNT;
+
+
+QueryDecisionCache::Decision::Decision() :
+    dangerous(false),
+    queryType(QueryRisk::TYPE_UNKNOWN),
+    invalid(false),
+    reports()
+{
+}
+
+
+QueryDecisionCache::Entry::Entry(
+    const string& entryQuery,
+    const string& entryDatabase,
+    const Decision& entryDecision
+) :
+    query(entryQuery),
+    database(entryDatabase),
+    decision(entryDecision)
+{
+}
+
+
+QueryDecisionCache::QueryDecisionCache(
+    const size_t maxBytes,
+    const int shardsCount
+) :
+    cache_(maxBytes, shardsCount)
+{
+}
+
+
+QueryDecisionCache::~QueryDecisionCache()
+{
+    Logger::log(Logger::INFO)
+        << "Query decision cache: "
+        << getHits()
+        << " hits, "
+        << getMisses()
+        << " misses, "
+        << getEvictions()
+        << " evictions";
+}
+
+
+bool QueryDecisionCache::find(
+    const string& query,
+    const string& database,
+    const double blockLevel,
+    const double logLevel,
+    Decision* const decision
+)
+{
+    const shared_ptr<const Entry> entry(
+        cache_.find(makeKey(query, database, blockLevel, logLevel))
+    );
+    if (
+        !entry
+        || entry->query != query
+        || entry->database != database
+    )
+    {
+        return false;
+    }
+    *decision = entry->decision;
+    return true;
+}
+
+
+void QueryDecisionCache::insert(
+    const string& query,
+    const string& database,
+    const double blockLevel,
+    const double logLevel,
+    const Decision& decision
+)
+{
+    // Another connection might have just decided the same query, or this
+    // could be a different query with the same hash; either way the new
+    // entry replaces the old one
+    cache_.insert(
+        makeKey(query, database, blockLevel, logLevel),
+        Entry(query, database, decision),
+        query.size()
+            + database.size()
+            + decision.reports.size() * sizeof(Report)
+    );
+}
+
+
+uint64_t QueryDecisionCache::getHits() const
+{
+    return cache_.getHits();
+}
+
+
+uint64_t QueryDecisionCache::getMisses() const
+{
+    return cache_.getMisses();
+}
+
+
+uint64_t QueryDecisionCache::getEvictions() const
+{
+    return cache_.getEvictions();
+}
+
+
+size_t QueryDecisionCache::size() const
+{
+    return cache_.size();
+}
+
+
+size_t QueryDecisionCache::getBytes() const
+{
+    return cache_.getBytes();
+}
+
+
+QueryDecisionCache::Key QueryDecisionCache::makeKey(
+    const string& query,
+    const string& database,
+    const double blockLevel,
+    const double logLevel
+)
+{
+    Sha1 hasher;
+    // The database name can't have a NUL in it, so this separates it from
+    // the query
+    hasher.update(database.c_str(), database.size() + 1);
+    hasher.update(&blockLevel, sizeof(blockLevel));
+    hasher.update(&logLevel, sizeof(logLevel));
+    hasher.update(query.data(), query.size());
+
+    Key key;
+    hasher.finish(key.digest);
+    return key;
+}
@@ -0,0 +1,187 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_QUERYDECISIONCACHE_HPP_
+#define SRC_QUERYDECISIONCACHE_HPP_
+
+#include "ConcurrentCache.hpp"
+#include "QueryRisk.hpp"
+#include "Sha1.hpp"
+
+#include <boost/cstdint.hpp>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * Remembers what MySqlGuard decided about the exact query strings that it
+ * has seen, so that the same query doesn't have to be parsed and run
+ * through the Bayesian networks again. Entries are found by the SHA1 of the
+ * query, the database and the probability thresholds, and the query and
+ * database are compared byte for byte before an entry is used.
+ *
+ * The entries are kept in a ConcurrentCache, so lots of connections can use
+ * it at once, and the entries that haven't been used recently are evicted
+ * once the cache uses more than a set amount of memory.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class QueryDecisionCache
+{
+public:
+    /**
+     * An attack probability that was high enough to be logged.
+     */
+    struct Report
+    {
+        const char* attackType;
+        double probability;
+    };
+
+    /**
+     * Everything that MySqlGuard needs to handle a query again, including
+     * what it logged, so that repeated attacks are still logged.
+     */
+    struct Decision
+    {
+        bool dangerous;
+        QueryRisk::QueryType queryType;
+        // The query failed to parse
+        bool invalid;
+        std::vector<Report> reports;
+        Decision();
+    };
+
+    /**
+     * Constructor.
+     * @param maxBytes Roughly the most memory that the entries can use.
+     * @param shardsCount How many separately locked parts to split the
+     *  cache into.
+     */
+    explicit QueryDecisionCache(
+        size_t maxBytes,
+        int shardsCount = DEFAULT_SHARDS_COUNT
+    );
+
+    /**
+     * Destructor. Logs how well the cache did.
+     */
+    ~QueryDecisionCache();
+
+    /**
+     * Looks up the decision for a query.
+     * @param query The exact text of the query.
+     * @param database The database that the query is run in.
+     * @param blockLevel The probability at which queries are blocked.
+     * @param logLevel The probability at which queries are logged.
+     * @param decision Set to the decision if there is one.
+     * @return False if the decision isn't cached.
+     */
+    bool find(
+        const std::string& query,
+        const std::string& database,
+        double blockLevel,
+        double logLevel,
+        Decision* decision
+    );
+
+    /**
+     * Saves the decision for a query, evicting entries that haven't been
+     * used recently if the cache is full.
+     * @param query The exact text of the query.
+     * @param database The database that the query is run in.
+     * @param blockLevel The probability at which queries are blocked.
+     * @param logLevel The probability at which queries are logged.
+     * @param decision The decision to save.
+     */
+    void insert(
+        const std::string& query,
+        const std::string& database,
+        double blockLevel,
+        double logLevel,
+        const Decision& decision
+    );
+
+    /**
+     * Statistics, summed over the shards.
+     */
+    ///@{
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+    uint64_t getEvictions() const;
+    size_t size() const;
+    size_t getBytes() const;
+    ///@}
+
+    static const int DEFAULT_SHARDS_COUNT = 16;
+
+private:
+    /// SHA1 of the query, database and thresholds
+    struct Key
+    {
+        uint8_t digest[Sha1::DIGEST_LENGTH];
+
+        friend bool operator==(const Key& key1, const Key& key2)
+        {
+            return 0 == std::memcmp(
+                key1.digest,
+                key2.digest,
+                sizeof(key1.digest)
+            );
+        }
+
+        friend std::size_t hash_value(const Key& key)
+        {
+            // It's already a good hash
+            std::size_t hash;
+            std::memcpy(&hash, key.digest, sizeof(hash));
+            return hash;
+        }
+    };
+
+    /// The query and database are kept to check that the digest matches
+    struct Entry
+    {
+        const std::string query;
+        const std::string database;
+        const Decision decision;
+        Entry(
+            const std::string& entryQuery,
+            const std::string& entryDatabase,
+            const Decision& entryDecision
+        );
+    };
+
+    static Key makeKey(
+        const std::string& query,
+        const std::string& database,
+        double blockLevel,
+        double logLevel
+    );
+
+    ConcurrentCache<Key, Entry> cache_;
+
+    // Hidden methods
+    QueryDecisionCache(const QueryDecisionCache& rhs);
+    QueryDecisionCache& operator=(const QueryDecisionCache& rhs);
+};
+
+#endif  // SRC_QUERYDECISIONCACHE_HPP_
@@ -18,51 +18,16 @@
  * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "IdentifierClassifier.hpp"
 #include "Logger.hpp"
 #include "QueryRisk.hpp"
 
 #include <string>
 #include <map>
-#include <boost/regex.hpp>
 #include <boost/functional/hash/hash.hpp>
 
 using std::endl;
 using std::string;
-using boost::regex;
-using boost::regex_search;
-
-// This list taken from GreenSQL
-regex QueryRisk::sensitiveTablesRegex(
-    ".*(customer|member|order|admin|user|permission|session).*",
-    regex::perl | regex::icase);
-// This list taken from GreenSQL and appended by me
-regex QueryRisk::bruteForceCommandsRegex(
-    "^(mid|substr|substring|load_file|char)$",
-    regex::perl | regex::icase);
-// This list taken from the MySQL manual; all the functions are synonymous
-regex QueryRisk::userStatementsRegex(
-    "^(current_user|session_user|system_user|user)$",
-    regex::perl | regex::icase);
-// Fingerprinting functions for MySQL, taken from
-// "SQL Injection Attacks and Defense" by Justin Clarke
-regex QueryRisk::fingerprintingRegex(
-    "^(schema|database|version|connection_id|last_insert_id|row_count)$",
-    regex::perl | regex::icase);
-// String manipulation functions that can be used for detection evasion
-regex QueryRisk::stringManipulationRegex(
-    "^(concat|concatws|char|insert|hex|mid|replace|reverse|substr|substring)$",
-    regex::perl | regex::icase);
-// Information schema is a special table that contains information about the
-// database and tables in the database
-regex QueryRisk::informationSchemaRegex(
-    "^(information_schema|mysql)$", regex::perl | regex::icase);
-// Anything concerning the users table
-const regex QueryRisk::userTableRegex(
-    "(user|customer|member)", regex::perl | regex::icase);
-
-// These are just useful for doing case-insensitive compares
-regex QueryRisk::ifRegex("^if$", regex::perl | regex::icase);
-regex QueryRisk::benchmarkRegex("^benchmark$", regex::perl | regex::icase);
 
 QueryRisk::QueryRisk() :
     queryType(TYPE_UNKNOWN),
@@ -140,18 +105,73 @@ QueryRisk::QueryRisk(const QueryRisk& rhs) :
 }
 
 
+QueryRisk& QueryRisk::operator=(const QueryRisk& rhs)
+{
+    queryType = rhs.queryType;
+    multiLineComments = rhs.multiLineComments;
+    hashComments = rhs.hashComments;
+    dashDashComments = rhs.dashDashComments;
+    mySqlComments = rhs.mySqlComments;
+    mySqlVersionedComments = rhs.mySqlVersionedComments;
+    sensitiveTables = rhs.sensitiveTables;
+    orStatements = rhs.orStatements;
+    unionStatements = rhs.unionStatements;
+    unionAllStatements = rhs.unionAllStatements;
+    bruteForceCommands = rhs.bruteForceCommands;
+    ifStatements = rhs.ifStatements;
+    hexStrings = rhs.hexStrings;
+    benchmarkStatements = rhs.benchmarkStatements;
+    userStatements = rhs.userStatements;
+    fingerprintingStatements = rhs.fingerprintingStatements;
+    mySqlStringConcat = rhs.mySqlStringConcat;
+    stringManipulationStatements = rhs.stringManipulationStatements;
+    alwaysTrueConditional = rhs.alwaysTrueConditional;
+    commentedConditionals = rhs.commentedConditionals;
+    commentedQuotes = rhs.commentedQuotes;
+    globalVariables = rhs.globalVariables;
+    joinStatements = rhs.joinStatements;
+    crossJoinStatements = rhs.crossJoinStatements;
+    regexLength = rhs.regexLength;
+    slowRegexes = rhs.slowRegexes;
+    emptyPassword = rhs.emptyPassword;
+    multipleQueries = rhs.multipleQueries;
+    orderByNumber = rhs.orderByNumber;
+    alwaysTrue = rhs.alwaysTrue;
+    informationSchema = rhs.informationSchema;
+    valid = rhs.valid;
+    userTable = rhs.userTable;
+    return *this;
+}
+
+
 void QueryRisk::checkTable(const string& table)
 {
-    if (regex_search(table, sensitiveTablesRegex))
+    checkTable(table.data(), table.size());
+}
+
+
+void QueryRisk::checkTable(const char* const table, const size_t length)
+{
+    const unsigned int categories =
+        IdentifierClassifier::classifyTable(table, length);
+    if (categories & IdentifierClassifier::SENSITIVE_TABLE)
         ++sensitiveTables;
-    if (regex_search(table, userTableRegex))
+    if (categories & IdentifierClassifier::USER_TABLE)
         userTable = true;
 }
 
 
-void QueryRisk::checkDatabase(const string& table)
+void QueryRisk::checkDatabase(const string& database)
+{
+    checkDatabase(database.data(), database.size());
+}
+
+
+void QueryRisk::checkDatabase(const char* const database, const size_t length)
 {
-    if (regex_search(table, informationSchemaRegex))
+    const unsigned int categories =
+        IdentifierClassifier::classifyName(database, length);
+    if (categories & IdentifierClassifier::INFORMATION_SCHEMA)
         informationSchema = true;
 }
 
@@ -172,17 +192,25 @@ void QueryRisk::checkRegex(const string& regexStr)
 
 void QueryRisk::checkFunction(const string& function)
 {
-    if (regex_search(function, bruteForceCommandsRegex))
+    checkFunction(function.data(), function.size());
+}
+
+
+void QueryRisk::checkFunction(const char* const function, const size_t length)
+{
+    const unsigned int categories =
+        IdentifierClassifier::classifyName(function, length);
+    if (categories & IdentifierClassifier::BRUTE_FORCE)
         ++bruteForceCommands;
-    if (regex_search(function, stringManipulationRegex))
+    if (categories & IdentifierClassifier::STRING_MANIPULATION)
         ++stringManipulationStatements;
-    else if (regex_search(function, userStatementsRegex))
+    else if (categories & IdentifierClassifier::USER_STATEMENT)
         ++userStatements;
-    else if (regex_search(function, fingerprintingRegex))
+    else if (categories & IdentifierClassifier::FINGERPRINTING)
         ++fingerprintingStatements;
-    else if (regex_search(function, benchmarkRegex))
+    else if (categories & IdentifierClassifier::BENCHMARK)
         ++benchmarkStatements;
-    else if (regex_search(function, ifRegex))
+    else if (categories & IdentifierClassifier::IF_FUNCTION)
         ++ifStatements;
 }
 
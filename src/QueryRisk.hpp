@@ -21,8 +21,9 @@
 #ifndef SRC_QUERYRISK_HPP_
 #define SRC_QUERYRISK_HPP_
 
-#include <boost/regex.hpp>
+#include <cstddef>
 #include <ostream>
+#include <string>
 
 /**
  * Stores information about potentionally dangers commands that are found in a
@@ -42,6 +43,8 @@ public:
 
     QueryRisk(const QueryRisk& rhs);
 
+    QueryRisk& operator=(const QueryRisk& rhs);
+
     enum QueryType
     {
         TYPE_UNKNOWN,
@@ -106,12 +109,16 @@ public:
 
     /**
      * Checks an identifier for a risky identifier and it it is risky, it
-     * increments the respective variable.
+     * increments the respective variable. The identifier doesn't need to be
+     * null terminated, so the parser can check its tokens where they are.
      */
     ///@{
     void checkTable(const std::string& table);
+    void checkTable(const char* table, size_t length);
     void checkFunction(const std::string& function);
+    void checkFunction(const char* function, size_t length);
     void checkDatabase(const std::string& database);
+    void checkDatabase(const char* database, size_t length);
     ///@}
 
     /**
@@ -121,17 +128,6 @@ public:
 
     friend std::ostream& operator<<(std::ostream& out, const QueryRisk& rhs);
     friend std::ostream& operator<<(std::ostream& out, const QueryType qt);
-
-private:
-    static boost::regex sensitiveTablesRegex;
-    static boost::regex bruteForceCommandsRegex;
-    static boost::regex userStatementsRegex;
-    static boost::regex ifRegex;
-    static boost::regex benchmarkRegex;
-    static boost::regex fingerprintingRegex;
-    static boost::regex informationSchemaRegex;
-    static boost::regex stringManipulationRegex;
-    static const boost::regex userTableRegex;
 };
 
 
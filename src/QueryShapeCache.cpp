@@ -0,0 +1,113 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ConcurrentCache.hpp"
+#include "Logger.hpp"
+#include "nullptr.hpp"
+#include "QueryRisk.hpp"
+#include "QueryShapeCache.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <cassert>
+#include <string>
+
+using boost::shared_ptr;
+using std::string;
+
+const int QueryShapeCache::DEFAULT_SHARDS_COUNT;
+
+
+QueryShapeCache::QueryShapeCache(
+    const size_t maxBytes,
+    const int shardsCount
+) :
+    cache_(maxBytes, shardsCount)
+{
+}
+
+
+QueryShapeCache::~QueryShapeCache()
+{
+    Logger::log(Logger::INFO)
+        << "Query shape cache: "
+        << getHits()
+        << " hits, "
+        << getMisses()
+        << " misses, "
+        << getEvictions()
+        << " evictions";
+}
+
+
+bool QueryShapeCache::find(const string& shape, QueryRisk* const qr)
+{
+    assert(nullptr != qr);
+    const shared_ptr<const QueryRisk> found(cache_.find(shape));
+    if (!found)
+    {
+        return false;
+    }
+    *qr = *found;
+    return true;
+}
+
+
+void QueryShapeCache::insert(const string& shape, const QueryRisk& qr)
+{
+    // The shape is stored in both the entry and the index
+    cache_.insert(shape, qr, 2 * shape.size());
+}
+
+
+void QueryShapeCache::clear()
+{
+    cache_.clear();
+}
+
+
+uint64_t QueryShapeCache::getHits() const
+{
+    return cache_.getHits();
+}
+
+
+uint64_t QueryShapeCache::getMisses() const
+{
+    return cache_.getMisses();
+}
+
+
+uint64_t QueryShapeCache::getEvictions() const
+{
+    return cache_.getEvictions();
+}
+
+
+size_t QueryShapeCache::size() const
+{
+    return cache_.size();
+}
+
+
+size_t QueryShapeCache::getBytes() const
+{
+    return cache_.getBytes();
+}
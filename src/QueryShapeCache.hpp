@@ -0,0 +1,107 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_QUERYSHAPECACHE_HPP_
+#define SRC_QUERYSHAPECACHE_HPP_
+
+#include "ConcurrentCache.hpp"
+#include "QueryRisk.hpp"
+
+#include <boost/cstdint.hpp>
+#include <string>
+
+/**
+ * Remembers the QueryRisk that the parser found for each shape of query, so
+ * that queries that only differ in their literals (e.g. "WHERE id = 1323"
+ * and "WHERE id = 7") only have to be tokenized instead of parsed. A shape
+ * is the query's tokens, the text of its identifiers and a few bits about
+ * each string literal; ParserInterface builds it while scanning and only
+ * saves shapes whose parse didn't depend on any other literal values.
+ *
+ * The entries are kept in a ConcurrentCache, so lots of connections can use
+ * it at once, and the entries that haven't been used recently are evicted
+ * once the cache uses more than a set amount of memory.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class QueryShapeCache
+{
+public:
+    /**
+     * Constructor.
+     * @param maxBytes Roughly the most memory that the entries can use.
+     * @param shardsCount How many separately locked parts to split the
+     *  cache into.
+     */
+    explicit QueryShapeCache(
+        size_t maxBytes,
+        int shardsCount = DEFAULT_SHARDS_COUNT
+    );
+
+    /**
+     * Destructor. Logs how well the cache did.
+     */
+    ~QueryShapeCache();
+
+    /**
+     * Looks up the parsed risks for a shape.
+     * @param shape The shape of the query from ParserInterface.
+     * @param qr Set to the risks found when the shape was parsed, if they
+     *  are cached.
+     * @return False if the shape isn't cached.
+     */
+    bool find(const std::string& shape, QueryRisk* qr);
+
+    /**
+     * Saves the parsed risks for a shape, evicting entries that haven't been
+     * used recently if the cache is full.
+     * @param shape The shape of the query from ParserInterface.
+     * @param qr The risks found by parsing the query.
+     */
+    void insert(const std::string& shape, const QueryRisk& qr);
+
+    /**
+     * Forgets every shape.
+     */
+    void clear();
+
+    /**
+     * Statistics, summed over the shards.
+     */
+    ///@{
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+    uint64_t getEvictions() const;
+    size_t size() const;
+    size_t getBytes() const;
+    ///@}
+
+    static const int DEFAULT_SHARDS_COUNT = 16;
+
+private:
+    ConcurrentCache<std::string, QueryRisk> cache_;
+
+    // Hidden methods
+    QueryShapeCache(const QueryShapeCache& rhs);
+    QueryShapeCache& operator=(const QueryShapeCache& rhs);
+};
+
+#endif  // SRC_QUERYSHAPECACHE_HPP_
@@ -72,7 +72,8 @@ QueryWhitelist::QueryWhitelist(
     ),
     allowedFilename_(nullptr != allowedFilename ? *allowedFilename : ""),
     failToParseList_(),
-    allowedList_()
+    allowedList_(),
+    allowedHashes_()
 {
     if (nullptr != failToParseFilename)
     {
@@ -133,6 +134,26 @@ bool QueryWhitelist::isBlockWhitelisted(
 }
 
 
+bool QueryWhitelist::isHashBlockWhitelisted(
+    const ParserInterface::QueryHash& hash
+)
+{
+    assert(nullptr != instance_);
+
+    return instance_->allowedHashes_.end() !=
+        instance_->allowedHashes_.find(hash);
+}
+
+
+bool QueryWhitelist::isEmpty()
+{
+    assert(nullptr != instance_);
+
+    return instance_->failToParseList_.empty()
+        && instance_->allowedList_.empty();
+}
+
+
 void QueryWhitelist::readFailToParseQueriesFile(const string& filename)
 {
     queryList queries(readQueriesFromFile(filename));
@@ -178,6 +199,7 @@ void QueryWhitelist::readAllowedQueriesFile(const string& filename)
         allowedList_.insert(
             pair<ParserInterface::QueryHash, QueryRisk>(pi.getHash(), qr)
         );
+        allowedHashes_.insert(pi.getHash());
     }
 }
 
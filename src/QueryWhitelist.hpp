@@ -70,6 +70,20 @@ public:
         const QueryRisk& qr
     );
 
+    /**
+     * Determines if any query with this hash is block whitelisted, so that
+     * isBlockWhitelisted only needs to be checked when this is true. Unlike
+     * isBlockWhitelisted, this doesn't need the query to be parsed.
+     * @param hash The hash of the query to be checked.
+     */
+    static bool isHashBlockWhitelisted(const ParserInterface::QueryHash& hash);
+
+    /**
+     * Determines if there are no whitelisted queries at all, in which case
+     * there's no reason to hash queries before parsing them.
+     */
+    static bool isEmpty();
+
 private:
     /**
      * Default constructor.
@@ -98,6 +112,7 @@ private:
             QueryRisk
         >
     > allowedList_;
+    boost::unordered_set<ParserInterface::QueryHash> allowedHashes_;
 
     static QueryWhitelist* instance_;
 
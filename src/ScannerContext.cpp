@@ -18,17 +18,63 @@
  * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "clearStack.hpp"
+#include "nullptr.hpp"
 #include "ScannerContext.hpp"
 
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <ostream>
 #include <stack>
 #include <string>
 
+using std::ostream;
+using std::string;
+using std::strlen;
+
+
+Lexeme::Lexeme(const char* const lexemeText, const size_t lexemeLength) :
+    text(lexemeText),
+    length(lexemeLength)
+{
+}
+
+
+Lexeme::Lexeme(const char* const lexemeText) :
+    text(lexemeText),
+    length(strlen(lexemeText))
+{
+}
+
+
+string Lexeme::str() const
+{
+    return string(text, length);
+}
+
+
+bool Lexeme::empty() const
+{
+    return 0 == length;
+}
+
+
+ostream& operator<<(ostream& out, const Lexeme& lexeme)
+{
+    return out.write(lexeme.text, lexeme.length);
+}
+
+
 ScannerContext::ScannerContext() :
     identifiers(),
     identifier(),
     quotedStrings(),
+    quotedStart(nullptr),
     quotedString(),
-    numbers()
+    quotedStringEscaped(false),
+    numbers(),
+    materialized_()
 {
 }
 
@@ -36,3 +82,20 @@ ScannerContext::ScannerContext() :
 ScannerContext::~ScannerContext()
 {
 }
+
+
+Lexeme ScannerContext::materialize(const string& text)
+{
+    materialized_.push_back(text);
+    const string& copy = materialized_.back();
+    return Lexeme(copy.data(), copy.size());
+}
+
+
+void ScannerContext::clear()
+{
+    clearStack(&identifiers);
+    clearStack(&quotedStrings);
+    clearStack(&numbers);
+    materialized_.clear();
+}
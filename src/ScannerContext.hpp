@@ -21,23 +21,72 @@
 #ifndef SRC_SCANNERCONTEXT_HPP_
 #define SRC_SCANNERCONTEXT_HPP_
 
+#include <cstddef>
+#include <deque>
+#include <iosfwd>
 #include <stack>
 #include <string>
 
+/**
+ * The text of a token. Most tokens are used just as they appear in the
+ * query, so they point straight into the buffer that is being scanned; only
+ * tokens whose text is different from the query, like strings with escaped
+ * quotes in them, are copied (see ScannerContext::materialize). Lexemes are
+ * only valid while the buffer and the ScannerContext are.
+ */
+struct Lexeme
+{
+    Lexeme(const char* lexemeText, size_t lexemeLength);
+    /**
+     * Makes a lexeme of some text that isn't from the query, like a keyword
+     * that is used as an identifier. The text must outlive the lexeme.
+     */
+    explicit Lexeme(const char* lexemeText);
+    std::string str() const;
+    bool empty() const;
+
+    const char* text;
+    size_t length;
+};
+
+std::ostream& operator<<(std::ostream& out, const Lexeme& lexeme);
+
+
 struct ScannerContext
 {
-    std::stack<std::string> identifiers;
+    std::stack<Lexeme> identifiers;
     std::string identifier;
-    std::stack<std::string> quotedStrings;
+    std::stack<Lexeme> quotedStrings;
+    // Where the text of the quoted string that is being scanned starts
+    const char* quotedStart;
+    // The quoted string that is being scanned, once an escape changes it so
+    // that it's no longer the same as the query
     std::string quotedString;
-    // Using strings instead of ints for this stack because otherwise I would
+    bool quotedStringEscaped;
+    // Using lexemes instead of ints for this stack because otherwise I would
     // get weird segmentation fault errors whenever I'd try to pop it
-    std::stack<std::string> numbers;
+    std::stack<Lexeme> numbers;
 
     ScannerContext();
     ~ScannerContext();
 
+    /**
+     * Keeps a copy of some text for as long as the tokens of this query are
+     * needed. Used for tokens that aren't in the query as is.
+     * @return A lexeme of the copy.
+     */
+    Lexeme materialize(const std::string& text);
+
+    /**
+     * Removes all of the tokens, before scanning another query.
+     */
+    void clear();
+
 private:
+    // Strings from materialize. Elements in a deque don't move when more are
+    // added, so lexemes that point into them stay valid.
+    std::deque<std::string> materialized_;
+
     // Hidden methods
     ScannerContext(const ScannerContext& rhs);
     ScannerContext& operator=(const ScannerContext& rhs);
@@ -0,0 +1,166 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "nullptr.hpp"
+#include "Sha1.hpp"
+
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <cassert>
+#include <cstring>
+
+const size_t Sha1::DIGEST_LENGTH;
+const size_t Sha1::BLOCK_LENGTH;
+
+static inline uint32_t rotateLeft(uint32_t value, unsigned bits);
+
+
+Sha1::Sha1() :
+    block_(),
+    blockLength_(0),
+    totalLength_(0)
+{
+    state_[0] = 0x67452301;
+    state_[1] = 0xEFCDAB89;
+    state_[2] = 0x98BADCFE;
+    state_[3] = 0x10325476;
+    state_[4] = 0xC3D2E1F0;
+}
+
+
+void Sha1::update(const void* const data, size_t length)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    totalLength_ += length;
+    while (length > 0)
+    {
+        const size_t copied = std::min(length, BLOCK_LENGTH - blockLength_);
+        memcpy(&block_[blockLength_], bytes, copied);
+        blockLength_ += copied;
+        bytes += copied;
+        length -= copied;
+        if (BLOCK_LENGTH == blockLength_)
+        {
+            processBlock();
+            blockLength_ = 0;
+        }
+    }
+}
+
+
+void Sha1::finish(uint8_t* const digest)
+{
+    assert(nullptr != digest);
+    const uint64_t totalBits = totalLength_ * 8;
+
+    // Pad with a 1 bit and then 0s, leaving room for the length at the end
+    block_[blockLength_++] = 0x80;
+    if (blockLength_ > BLOCK_LENGTH - 8)
+    {
+        memset(&block_[blockLength_], 0, BLOCK_LENGTH - blockLength_);
+        processBlock();
+        blockLength_ = 0;
+    }
+    memset(&block_[blockLength_], 0, BLOCK_LENGTH - 8 - blockLength_);
+    for (size_t i = 0; i < 8; ++i)
+    {
+        block_[BLOCK_LENGTH - 1 - i] =
+            static_cast<uint8_t>(totalBits >> (i * 8));
+    }
+    processBlock();
+    blockLength_ = 0;
+
+    for (size_t i = 0; i < 5; ++i)
+    {
+        digest[i * 4] = static_cast<uint8_t>(state_[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state_[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state_[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state_[i]);
+    }
+}
+
+
+void Sha1::processBlock()
+{
+    uint32_t words[80];
+    for (size_t i = 0; i < 16; ++i)
+    {
+        words[i] = (static_cast<uint32_t>(block_[i * 4]) << 24)
+            | (static_cast<uint32_t>(block_[i * 4 + 1]) << 16)
+            | (static_cast<uint32_t>(block_[i * 4 + 2]) << 8)
+            | static_cast<uint32_t>(block_[i * 4 + 3]);
+    }
+    for (size_t i = 16; i < 80; ++i)
+    {
+        words[i] = rotateLeft(
+            words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16],
+            1
+        );
+    }
+
+    uint32_t a = state_[0];
+    uint32_t b = state_[1];
+    uint32_t c = state_[2];
+    uint32_t d = state_[3];
+    uint32_t e = state_[4];
+    for (size_t i = 0; i < 80; ++i)
+    {
+        uint32_t f;
+        uint32_t k;
+        if (i < 20)
+        {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        }
+        else if (i < 40)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        }
+        else if (i < 60)
+        {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        }
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        const uint32_t temp = rotateLeft(a, 5) + f + e + k + words[i];
+        e = d;
+        d = c;
+        c = rotateLeft(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+}
+
+
+uint32_t rotateLeft(const uint32_t value, const unsigned bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
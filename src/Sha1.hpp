@@ -0,0 +1,73 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_SHA1_HPP_
+#define SRC_SHA1_HPP_
+
+#include <boost/cstdint.hpp>
+#include <cstddef>
+
+/**
+ * Computes SHA1 hashes, both for MySQL's password scrambles and for looking
+ * up queries in the decision cache. Data can be added in pieces.
+ * @author Brandon Skari
+ * @date October 17 2026
+ */
+
+class Sha1
+{
+public:
+    static const size_t DIGEST_LENGTH = 20;
+
+    /**
+     * Default constructor.
+     */
+    Sha1();
+
+    /**
+     * Adds some data to the hash.
+     */
+    void update(const void* data, size_t length);
+
+    /**
+     * Finishes the hash. Nothing more can be added afterwards.
+     * @param digest Where to write the DIGEST_LENGTH bytes of the hash.
+     */
+    void finish(uint8_t* digest);
+
+private:
+    static const size_t BLOCK_LENGTH = 64;
+
+    /**
+     * Hashes the block in block_.
+     */
+    void processBlock();
+
+    uint32_t state_[5];
+    uint8_t block_[BLOCK_LENGTH];
+    size_t blockLength_;
+    uint64_t totalLength_;
+
+    // ***** Hidden methods *****
+    Sha1(const Sha1&);
+    Sha1& operator=(const Sha1&);
+};
+
+#endif  // SRC_SHA1_HPP_
@@ -18,6 +18,7 @@
  * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "countSyscall.hpp"
 #include "Logger.hpp"
 #include "nullptr.hpp"
 #include "Socket.hpp"
@@ -28,14 +29,21 @@
 #include <fcntl.h>
 #include <boost/cstdint.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
 #include <cassert>
+#include <climits>
 #include <cstring>
 #include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
+#include <signal.h>
 #include <string>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
+#include <unistd.h>
 #include <vector>
 
 using std::memset;
@@ -43,17 +51,34 @@ using std::vector;
 using std::min;
 using std::string;
 using boost::lexical_cast;
+using boost::lock_guard;
+using boost::mutex;
 
 const ssize_t Socket::MAX_RECEIVE;
 const size_t Socket::TIMEOUT_SECONDS;
 const size_t Socket::TIMEOUT_MILLISECONDS;
+const size_t Socket::MAX_BATCH_COPY;
 
 
-Socket::Socket(const uint16_t port, const string& address, bool blocking) :
+Socket::Socket(
+    const uint16_t port,
+    const string& address,
+    bool blocking,
+    const int connectTimeoutMilliseconds
+) :
     socketFD_(socket(AF_INET, SOCK_STREAM, 0)),
     open_(true),
-    buffer_(MAX_RECEIVE, 0),
-    peerName_()
+    blocking_(blocking),
+    deferOutput_(false),
+    pendingOutput_(),
+    batching_(false),
+    batchOwner_(),
+    batch_(),
+    pipeReadFD_(-1),
+    pipeWriteFD_(-1),
+    peerName_(),
+    closeMutex_(),
+    batchMutex_()
 {
     // Did socket creation succeed?
     if (socketFD_ < 0)
@@ -112,6 +137,15 @@ Socket::Socket(const uint16_t port, const string& address, bool blocking) :
     for (addrinfo* ptr = serverInfo; nullptr != ptr; ptr = ptr->ai_next)
     {
         // Connect to the remote machine
+        if (connectTimeoutMilliseconds > 0)
+        {
+            if (connectWithTimeout(ptr, connectTimeoutMilliseconds))
+            {
+                connected = true;
+                break;
+            }
+            continue;
+        }
         int status;
         do
         {
@@ -131,17 +165,12 @@ Socket::Socket(const uint16_t port, const string& address, bool blocking) :
 
     if (!connected)
     {
-        throw SocketException(
-            string("Unable to connect to server: ") + strerror(errno));
-    }
-
-    // Set the timeout for listens on this socket
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
-    if (0 != setsockopt(socketFD_, SOL_SOCKET, SO_RCVTIMEO,
-        reinterpret_cast<char*>(&tv), sizeof(tv)))
-    {
-        throw SocketException("Unable to set timeout");
+        // Nothing owns the descriptor once the constructor throws
+        const string error(
+            string("Unable to connect to server: ") + strerror(errno)
+        );
+        ::close(socketFD_);
+        throw SocketException(error);
     }
 
     setPeerName();
@@ -151,8 +180,17 @@ Socket::Socket(const uint16_t port, const string& address, bool blocking) :
 Socket::Socket(const string& domainSocket, bool blocking) :
     socketFD_(socket(PF_UNIX, SOCK_STREAM, 0)),
     open_(true),
-    buffer_(MAX_RECEIVE, 0),
-    peerName_()
+    blocking_(blocking),
+    deferOutput_(false),
+    pendingOutput_(),
+    batching_(false),
+    batchOwner_(),
+    batch_(),
+    pipeReadFD_(-1),
+    pipeWriteFD_(-1),
+    peerName_(),
+    closeMutex_(),
+    batchMutex_()
 {
     sockaddr_un sockAddr;
     size_t sockAddrLength;
@@ -203,16 +241,6 @@ Socket::Socket(const string& domainSocket, bool blocking) :
         throw SocketException(error);
     }
 
-    // Set the timeout for listens on this socket
-    timeval tv;
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
-    if (0 != setsockopt(socketFD_, SOL_SOCKET, SO_RCVTIMEO,
-        reinterpret_cast<char*>(&tv), sizeof(tv)))
-    {
-        throw SocketException("Unable to set timeout");
-    }
-
     setPeerName();
 }
 
@@ -220,8 +248,17 @@ Socket::Socket(const string& domainSocket, bool blocking) :
 Socket::Socket(const int fileDescriptor) :
     socketFD_(fileDescriptor),
     open_(true),
-    buffer_(MAX_RECEIVE, 0),
-    peerName_()
+    blocking_(true),
+    deferOutput_(false),
+    pendingOutput_(),
+    batching_(false),
+    batchOwner_(),
+    batch_(),
+    pipeReadFD_(-1),
+    pipeWriteFD_(-1),
+    peerName_(),
+    closeMutex_(),
+    batchMutex_()
 {
     sockaddr_storage sockAddr;
 
@@ -232,16 +269,6 @@ Socket::Socket(const int fileDescriptor) :
         throw SocketException("Invalid file descriptor");
     }
 
-    // Set the timeout for listens on this socket
-    timeval tv;
-    tv.tv_sec = 5;
-    tv.tv_usec = 0;
-    if (0 != setsockopt(socketFD_, SOL_SOCKET, SO_RCVTIMEO,
-        reinterpret_cast<char*>(&tv), sizeof(tv)))
-    {
-        throw SocketException("Unable to set timeout");
-    }
-
     setPeerName();
 }
 
@@ -261,71 +288,351 @@ void Socket::send(const vector<uint8_t>& message) const
 void Socket::send(const vector<uint8_t>::const_iterator& begin,
     const vector<uint8_t>::const_iterator& end) const
 {
-    // Check to make sure the socket isn't closed before trying to send
-    if (!open_)
+    if (begin == end)
     {
-        throw ClosedException();
+        return;
+    }
+    sendAll(reinterpret_cast<const char*>(&(*begin)), end - begin);
+}
+
+
+void Socket::send(const char* const message) const
+{
+    send(message, strlen(message));
+}
+
+
+void Socket::send(const uint8_t* const message, const size_t length) const
+{
+    send(reinterpret_cast<const char*>(message), length);
+}
+
+
+void Socket::send(const char* const message, const size_t length) const
+{
+    sendAll(message, length);
+}
+
+
+void Socket::send(const vector<vector<uint8_t> >& messages) const
+{
+    if (isBatching())
+    {
+        for (size_t i = 0; i < messages.size(); ++i)
+        {
+            send(messages[i]);
+        }
+        return;
     }
-    if (::send(socketFD_, &(*begin), end - begin, MSG_NOSIGNAL) < 0)
+
+    vector<iovec> parts;
+    parts.reserve(messages.size());
+    for (size_t i = 0; i < messages.size(); ++i)
     {
-        if (!open_)
+        if (!messages[i].empty())
         {
-            throw ClosedException();
+            iovec part;
+            part.iov_base = const_cast<uint8_t*>(&messages[i][0]);
+            part.iov_len = messages[i].size();
+            parts.push_back(part);
         }
-        string error("Failed to send: ");
-        error += strerror(errno);
-        throw SocketException(error);
+    }
+    if (!parts.empty())
+    {
+        sendGather(&parts[0], parts.size());
     }
 }
 
 
-void Socket::send(const char* const message) const
+void Socket::beginBatch() const
 {
-    send(message, strlen(message));
+    lock_guard<mutex> lg(batchMutex_);
+    assert(!batching_ && "Socket batches don't nest");
+    batchOwner_ = pthread_self();
+    batching_ = true;
 }
 
 
-void Socket::send(const uint8_t* const message, const uint16_t length) const
+void Socket::endBatch() const
 {
-    send(reinterpret_cast<const char*>(message), length);
+    {
+        lock_guard<mutex> lg(batchMutex_);
+        batching_ = false;
+    }
+    sendBatch(nullptr, 0);
 }
 
 
-void Socket::send(const char* const message, const uint16_t length) const
+bool Socket::isBatching() const
+{
+    // The thread that forwards responses in the other direction might be
+    // sending on this socket too, and its sends can't be held back
+    lock_guard<mutex> lg(batchMutex_);
+    return batching_ && pthread_equal(batchOwner_, pthread_self());
+}
+
+
+bool Socket::addToBatch(const char* const message, const size_t length) const
+{
+    {
+        lock_guard<mutex> lg(batchMutex_);
+        if (!batching_ || !pthread_equal(batchOwner_, pthread_self()))
+        {
+            return false;
+        }
+        if (batch_.size() + length < MAX_BATCH_COPY)
+        {
+            batch_.insert(batch_.end(), message, message + length);
+            return true;
+        }
+    }
+
+    // Too big to be worth copying, so send it along with the batch
+    sendBatch(message, length);
+    return true;
+}
+
+
+void Socket::sendBatch(const char* const message, const size_t length) const
+{
+    // Sending can block, so the batch is taken out and sent without holding
+    // the lock
+    vector<uint8_t> held;
+    {
+        lock_guard<mutex> lg(batchMutex_);
+        held.swap(batch_);
+    }
+
+    iovec parts[2];
+    size_t count = 0;
+    if (!held.empty())
+    {
+        parts[count].iov_base = &held[0];
+        parts[count].iov_len = held.size();
+        ++count;
+    }
+    if (length > 0)
+    {
+        parts[count].iov_base = const_cast<char*>(message);
+        parts[count].iov_len = length;
+        ++count;
+    }
+    if (0 == count)
+    {
+        return;
+    }
+
+    try
+    {
+        sendGather(parts, count);
+    }
+    catch (...)
+    {
+        held.clear();
+        lock_guard<mutex> lg(batchMutex_);
+        if (batch_.empty())
+        {
+            batch_.swap(held);
+        }
+        throw;
+    }
+    // Put the buffer back so that the next batch doesn't have to allocate,
+    // unless another thread has started one in the meantime
+    held.clear();
+    lock_guard<mutex> lg(batchMutex_);
+    if (batch_.empty())
+    {
+        batch_.swap(held);
+    }
+}
+
+
+void Socket::sendAll(const char* message, size_t length) const
 {
     // Check to make sure the socket isn't closed before trying to send
     if (!open_)
     {
         throw ClosedException();
     }
-    if (::send(socketFD_, message, length, MSG_NOSIGNAL) < 0)
+
+    // Deferred output is already written out all at once
+    if (!deferOutput_ && addToBatch(message, length))
     {
-        if (!open_)
+        return;
+    }
+
+    iovec part;
+    part.iov_base = const_cast<char*>(message);
+    part.iov_len = length;
+    sendGather(&part, 1);
+}
+
+
+void Socket::sendGather(iovec* parts, size_t count) const
+{
+    if (!open_)
+    {
+        throw ClosedException();
+    }
+
+    // Anything already queued has to go out first to keep the stream in order
+    if (deferOutput_ || !pendingOutput_.empty())
+    {
+        for (size_t i = 0; i < count; ++i)
         {
-            throw ClosedException();
+            const uint8_t* const base =
+                static_cast<const uint8_t*>(parts[i].iov_base);
+            pendingOutput_.insert(
+                pendingOutput_.end(),
+                base,
+                base + parts[i].iov_len
+            );
         }
-        string error("Failed to send: ");
-        error += strerror(errno);
-        throw SocketException(error);
+        return;
+    }
+
+    while (count > 0)
+    {
+        // Skip over anything that's already been sent
+        if (0 == parts->iov_len)
+        {
+            ++parts;
+            --count;
+            continue;
+        }
+
+        msghdr header;
+        memset(&header, 0, sizeof(header));
+        header.msg_iov = parts;
+        header.msg_iovlen = min(count, static_cast<size_t>(IOV_MAX));
+        int flags = MSG_NOSIGNAL;
+        // Let the kernel hold back a partial segment if there's more coming
+        if (count > static_cast<size_t>(IOV_MAX))
+        {
+            flags |= MSG_MORE;
+        }
+
+        countSyscall();
+        ssize_t sentBytes = ::sendmsg(socketFD_, &header, flags);
+        if (sentBytes < 0)
+        {
+            if (!open_)
+            {
+                throw ClosedException();
+            }
+            else if (EINTR == errno)
+            {
+                continue;
+            }
+            else if (!blocking_ && (EAGAIN == errno || EWOULDBLOCK == errno))
+            {
+                // Save the rest for when the socket is writable again
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const uint8_t* const base =
+                        static_cast<const uint8_t*>(parts[i].iov_base);
+                    pendingOutput_.insert(
+                        pendingOutput_.end(),
+                        base,
+                        base + parts[i].iov_len
+                    );
+                }
+                return;
+            }
+            string error("Failed to send: ");
+            error += strerror(errno);
+            throw SocketException(error);
+        }
+
+        while (sentBytes > 0)
+        {
+            const size_t sent =
+                min(static_cast<size_t>(sentBytes), parts->iov_len);
+            parts->iov_base = static_cast<uint8_t*>(parts->iov_base) + sent;
+            parts->iov_len -= sent;
+            sentBytes -= sent;
+            if (0 == parts->iov_len)
+            {
+                ++parts;
+                --count;
+            }
+        }
+    }
+}
+
+
+bool Socket::flushPendingOutput() const
+{
+    if (!open_)
+    {
+        throw ClosedException();
+    }
+
+    size_t sentSoFar = 0;
+    while (sentSoFar < pendingOutput_.size())
+    {
+        countSyscall();
+        const ssize_t sentBytes = ::send(
+            socketFD_,
+            &pendingOutput_[sentSoFar],
+            pendingOutput_.size() - sentSoFar,
+            MSG_NOSIGNAL
+        );
+        if (sentBytes < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            else if (EAGAIN == errno || EWOULDBLOCK == errno)
+            {
+                break;
+            }
+            string error("Failed to send: ");
+            error += strerror(errno);
+            throw SocketException(error);
+        }
+        sentSoFar += sentBytes;
     }
+    pendingOutput_.erase(
+        pendingOutput_.begin(),
+        pendingOutput_.begin() + sentSoFar
+    );
+    return pendingOutput_.empty();
 }
 
 
 vector<uint8_t> Socket::receive() const
 {
+    vector<uint8_t> message;
+    receive(&message);
+    return message;
+}
+
+
+void Socket::receive(vector<uint8_t>* const message) const
+{
+    assert(nullptr != message);
+    // If the buffer came from PacketBufferPool, this doesn't allocate
+    message->resize(MAX_RECEIVE);
+
     // There are four cases here:
     // Another thread may have closed the socket
     // The entity we connected to closed the socket
     // The socket is still open, we just have to keep waiting for data
     // Some other error occurred
+    // There's no receive timeout, so this sleeps until there's data or the
+    // socket is shut down, e.g. by close or by a TimerWheel timeout
     ssize_t returnedBytes = 0;
     while (returnedBytes <= 0)
     {
-        returnedBytes = ::recv(socketFD_, &buffer_[0], buffer_.size(), 0);
+        countSyscall();
+        returnedBytes = ::recv(socketFD_, &(*message)[0], MAX_RECEIVE, 0);
 
         // Entity performed an orderly close
         if (0 == returnedBytes)
         {
+            message->clear();
             throw ClosedException();
         }
         else if (returnedBytes < 0)
@@ -333,6 +640,7 @@ vector<uint8_t> Socket::receive() const
             // Another thread closed the socket while we were waiting
             if (!open_)
             {
+                message->clear();
                 throw ClosedException();
             }
             // Socket is still open, wait for more data
@@ -343,6 +651,7 @@ vector<uint8_t> Socket::receive() const
             // Some other error
             else
             {
+                message->clear();
                 string error("Failed to read: ");
                 error += strerror(errno);
                 throw SocketException(error);
@@ -354,30 +663,284 @@ vector<uint8_t> Socket::receive() const
             break;
         }
     }
-    return vector<uint8_t>(
-        buffer_.begin(),
-        buffer_.begin() + min(MAX_RECEIVE, returnedBytes)
+    message->resize(returnedBytes);
+}
+
+
+size_t Socket::takePendingOutput(
+    uint8_t* const destination,
+    const size_t maxLength
+) const
+{
+    const size_t length = min(maxLength, pendingOutput_.size());
+    if (0 == length)
+    {
+        return 0;
+    }
+    memcpy(destination, &pendingOutput_[0], length);
+    pendingOutput_.erase(
+        pendingOutput_.begin(),
+        pendingOutput_.begin() + length
     );
+    return length;
+}
+
+
+bool Socket::receiveAvailable(vector<uint8_t>* const message) const
+{
+    assert(nullptr != message);
+    if (!open_)
+    {
+        throw ClosedException();
+    }
+
+    // If the buffer came from PacketBufferPool, this doesn't allocate
+    message->resize(MAX_RECEIVE);
+    ssize_t returnedBytes;
+    do
+    {
+        countSyscall();
+        returnedBytes = ::recv(socketFD_, &(*message)[0], MAX_RECEIVE, 0);
+    } while (returnedBytes < 0 && EINTR == errno);
+
+    if (0 == returnedBytes)
+    {
+        message->clear();
+        throw ClosedException();
+    }
+    else if (returnedBytes < 0)
+    {
+        message->clear();
+        if (EAGAIN == errno || EWOULDBLOCK == errno)
+        {
+            return false;
+        }
+        string error("Failed to read: ");
+        error += strerror(errno);
+        throw SocketException(error);
+    }
+
+    message->resize(returnedBytes);
+    return true;
+}
+
+
+void Socket::spliceTo(const Socket& destination, size_t length) const
+{
+    assert(blocking_ && destination.blocking_);
+    assert(
+        !deferOutput_
+        && destination.pendingOutput_.empty()
+        && "Queued output would be reordered by splicing"
+    );
+
+    if (-1 == pipeReadFD_)
+    {
+        int pipeFDs[2];
+        if (pipe(pipeFDs) < 0)
+        {
+            string error("Unable to create splice pipe: ");
+            error += strerror(errno);
+            throw SocketException(error);
+        }
+        pipeReadFD_ = pipeFDs[0];
+        pipeWriteFD_ = pipeFDs[1];
+
+        // Unlike send, splice has no way to ask for MSG_NOSIGNAL, so a client
+        // hanging up would raise SIGPIPE. Only the thread that reads from
+        // this socket ever splices from it, so block the signal for it.
+        sigset_t pipeSignal;
+        sigemptyset(&pipeSignal);
+        sigaddset(&pipeSignal, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipeSignal, nullptr);
+    }
+
+    while (length > 0)
+    {
+        countSyscall();
+        const ssize_t receivedBytes = splice(
+            socketFD_,
+            nullptr,
+            pipeWriteFD_,
+            nullptr,
+            length,
+            SPLICE_F_MOVE | SPLICE_F_MORE
+        );
+
+        // Same cases as receive
+        if (0 == receivedBytes)
+        {
+            throw ClosedException();
+        }
+        else if (receivedBytes < 0)
+        {
+            if (!open_)
+            {
+                throw ClosedException();
+            }
+            else if (ETIMEDOUT == errno || EAGAIN == errno || EINTR == errno)
+            {
+                continue;
+            }
+            string error("Failed to splice from socket: ");
+            error += strerror(errno);
+            throw SocketException(error);
+        }
+        length -= receivedBytes;
+
+        // Empty the pipe before reading more so that it never fills up
+        size_t inPipe = receivedBytes;
+        while (inPipe > 0)
+        {
+            countSyscall();
+            const ssize_t sentBytes = splice(
+                pipeReadFD_,
+                nullptr,
+                destination.socketFD_,
+                nullptr,
+                inPipe,
+                SPLICE_F_MOVE | (length > 0 ? SPLICE_F_MORE : 0)
+            );
+            if (sentBytes < 0)
+            {
+                if (!destination.open_)
+                {
+                    throw ClosedException();
+                }
+                else if (EINTR == errno || EAGAIN == errno)
+                {
+                    continue;
+                }
+                string error("Failed to splice to socket: ");
+                error += strerror(errno);
+                throw SocketException(error);
+            }
+            inPipe -= sentBytes;
+        }
+    }
 }
 
 
 bool Socket::getBlocking() const
 {
-    return O_NONBLOCK & fcntl(socketFD_, F_GETFD);
+    return 0 == (O_NONBLOCK & fcntl(socketFD_, F_GETFL));
+}
+
+
+void Socket::setBlocking(const bool blocking)
+{
+    const int flags = fcntl(socketFD_, F_GETFL);
+    if (flags < 0)
+    {
+        throw SocketException("Unable to read socket flags");
+    }
+    const int newFlags = (blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK);
+    if (fcntl(socketFD_, F_SETFL, newFlags) < 0)
+    {
+        throw SocketException("Unable to change socket blocking mode");
+    }
+    blocking_ = blocking;
+}
+
+
+void Socket::shutdown() const
+{
+    lock_guard<mutex> lg(closeMutex_);
+    if (open_)
+    {
+        // The descriptor stays open, so this can't hit a reused descriptor
+        ::shutdown(socketFD_, SHUT_RDWR);
+    }
 }
 
 
 void Socket::close()
 {
-    /// @TODO(bskari) Fix this race condition.
+    lock_guard<mutex> lg(closeMutex_);
     if (open_)
     {
         open_ = false;
+        // Don't silently drop output that was queued by a non-blocking or
+        // deferred send. This is best effort, because we can't wait here.
+        if (!pendingOutput_.empty())
+        {
+            countSyscall();
+            ::send(
+                socketFD_,
+                &pendingOutput_[0],
+                pendingOutput_.size(),
+                MSG_NOSIGNAL | MSG_DONTWAIT
+            );
+            pendingOutput_.clear();
+        }
+        {
+            lock_guard<mutex> batch(batchMutex_);
+            batch_.clear();
+        }
+        // Closing the descriptor doesn't wake up other threads that are
+        // blocked reading from it, but shutting it down does
+        ::shutdown(socketFD_, SHUT_RDWR);
         ::close(socketFD_);
+        if (-1 != pipeReadFD_)
+        {
+            ::close(pipeReadFD_);
+            ::close(pipeWriteFD_);
+        }
     }
 }
 
 
+bool Socket::connectWithTimeout(
+    const addrinfo* const address,
+    const int timeoutMilliseconds
+) const
+{
+    const int flags = fcntl(socketFD_, F_GETFL);
+    if (flags < 0 || fcntl(socketFD_, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        return false;
+    }
+
+    int status = connect(socketFD_, address->ai_addr, address->ai_addrlen);
+    if (status < 0 && EINPROGRESS == errno)
+    {
+        pollfd waiting;
+        waiting.fd = socketFD_;
+        waiting.events = POLLOUT;
+        waiting.revents = 0;
+        do
+        {
+            status = poll(&waiting, 1, timeoutMilliseconds);
+        } while (status < 0 && EINTR == errno);
+
+        if (0 == status)
+        {
+            errno = ETIMEDOUT;
+            status = -1;
+        }
+        else if (status > 0)
+        {
+            // The result of the connect is reported as a pending error
+            int error = 0;
+            socklen_t length = sizeof(error);
+            status = getsockopt(socketFD_, SOL_SOCKET, SO_ERROR, &error,
+                &length);
+            if (0 == status && 0 != error)
+            {
+                errno = error;
+                status = -1;
+            }
+        }
+    }
+
+    // Go back to whatever mode the caller asked for
+    const int savedErrno = errno;
+    fcntl(socketFD_, F_SETFL, flags);
+    errno = savedErrno;
+    return 0 == status;
+}
+
+
 void Socket::setPeerName()
 {
     sockaddr_storage address;
@@ -24,6 +24,10 @@
 #include <vector>
 #include <string>
 #include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <pthread.h>
+struct addrinfo;
+struct iovec;
 
 /**
  * Wrapper around Unix C sockets for TCP communication.
@@ -38,9 +42,12 @@ public:
      * Normal constructor to communicate to an address on a given port.
      * @param port The port to communicate on.
      * @param address The computer to connect to.
+     * @param connectTimeoutMilliseconds If positive, connect without
+     *  blocking and give up if the connection isn't made in this long.
+     * @throw SocketException Unable to connect.
      */
     Socket(const uint16_t port, const std::string& address,
-        bool blocking = true);
+        bool blocking = true, int connectTimeoutMilliseconds = 0);
 
     /**
      * Constructor to communicate on the localhost using Unix domain sockets.
@@ -68,26 +75,124 @@ public:
     void send(const std::vector<uint8_t>::const_iterator& begin,
         const std::vector<uint8_t>::const_iterator& end) const;
     void send(const char* message) const;
-    void send(const char* message, const uint16_t length) const;
-    void send(const uint8_t* message, const uint16_t length) const;
+    void send(const char* message, size_t length) const;
+    void send(const uint8_t* message, size_t length) const;
     ///@}
 
+    /**
+     * Sends several messages out on the socket with a single gather write,
+     * e.g. all of the packets of one MySQL message.
+     * @param messages The messages to send, in order.
+     */
+    void send(const std::vector<std::vector<uint8_t> >& messages) const;
+
+    /**
+     * Starts holding small sends back so that everything that's ready at
+     * once, e.g. all of the responses to one read, goes out in a single
+     * system call and, where possible, a single TCP segment. Large sends
+     * are written immediately along with whatever was held back. Only sends
+     * from the thread that started the batch are held back.
+     */
+    void beginBatch() const;
+
+    /**
+     * Writes out everything that was held back since beginBatch.
+     * @throw SocketException
+     */
+    void endBatch() const;
+
     /**
      * Blocks and receives a message from the socket.
      * @return The message received on the socket.
      */
     std::vector<uint8_t> receive() const;
 
+    /**
+     * Blocks and receives a message from the socket straight into a buffer,
+     * so that a buffer from PacketBufferPool can be reused without copying
+     * or allocating.
+     * @param message Filled with the message received on the socket.
+     */
+    void receive(std::vector<uint8_t>* message) const;
+
+    /**
+     * Receives whatever is available on the socket without waiting. Only
+     * meaningful for non-blocking sockets.
+     * @param message Filled with the received data.
+     * @return False if no data was available yet.
+     * @throw ClosedException The peer closed the connection.
+     */
+    bool receiveAvailable(std::vector<uint8_t>* const message) const;
+
+    /**
+     * Moves data straight from this socket to another one through a pipe,
+     * without copying it into user space. Both sockets must be blocking.
+     * @param destination The socket to write the data to.
+     * @param length The exact number of bytes to move.
+     * @throw ClosedException Either socket was closed.
+     * @throw SocketException Splicing failed.
+     */
+    void spliceTo(const Socket& destination, size_t length) const;
+
     /**
      * Returns true if the socket blocks for send and receive.
      */
     bool getBlocking() const;
 
     /**
-     * Close the Socket prior to destruction.
+     * Switches the socket between blocking and non-blocking mode. When
+     * non-blocking, any data that the kernel won't accept immediately is
+     * queued and must be written later by calling flushPendingOutput.
+     */
+    void setBlocking(bool blocking);
+
+    /**
+     * Returns true if a non-blocking send has queued data that hasn't been
+     * written to the kernel yet.
+     */
+    inline bool hasPendingOutput() const { return !pendingOutput_.empty(); }
+
+    /**
+     * Tries to write any queued output without blocking.
+     * @return True if all of the queued output has been written.
+     * @throw SocketException Writing failed.
+     */
+    bool flushPendingOutput() const;
+
+    /**
+     * When set, sends never write to the kernel themselves; everything is
+     * queued and it's up to the caller to write it out, e.g. by taking it
+     * with takePendingOutput.
+     */
+    inline void setDeferredOutput(bool defer) { deferOutput_ = defer; }
+
+    /**
+     * Removes queued output so that the caller can write it itself.
+     * @param destination Where to copy the output to.
+     * @param maxLength The most bytes to copy.
+     * @return The number of bytes copied.
+     */
+    size_t takePendingOutput(uint8_t* destination, size_t maxLength) const;
+
+    /**
+     * Returns the underlying Unix C file descriptor, e.g. for use with epoll.
+     */
+    inline int getFileDescriptor() const { return socketFD_; }
+
+    /**
+     * Close the Socket prior to destruction. Threads that are blocked
+     * receiving from it wake up with a ClosedException.
      */
     void close();
 
+    /**
+     * Shuts the connection down without closing the descriptor, so that
+     * threads that are blocked receiving from it wake up with a
+     * ClosedException. Unlike close, this is safe to call from any thread,
+     * e.g. from a timeout.
+     */
+    void shutdown() const;
+
     /**
      * Returns true if the Socket hasn't had any errors and hasn't been
      * explicitly closed by the user. Note that unexpected errors such as
@@ -105,18 +210,78 @@ public:
     inline const std::string& getPeerName() const { return peerName_; }
 
 protected:
-    static const ssize_t MAX_RECEIVE = 4096;
+    static const ssize_t MAX_RECEIVE = 65536;
     static const size_t TIMEOUT_SECONDS = 1;
     static const size_t TIMEOUT_MILLISECONDS = 0;
+    /// Sends in a batch that are smaller than this are copied
+    static const size_t MAX_BATCH_COPY = 8192;
 
     const int socketFD_;
     bool open_;
-    mutable std::vector<uint8_t> buffer_;
+    bool blocking_;
+    bool deferOutput_;
+    mutable std::vector<uint8_t> pendingOutput_;
+    /// Whether a batch has been started, and by which thread. The thread
+    /// forwarding in the other direction checks these, so they and batch_
+    /// are guarded by batchMutex_.
+    ///@{
+    mutable bool batching_;
+    mutable pthread_t batchOwner_;
+    mutable std::vector<uint8_t> batch_;
+    ///@}
+    mutable int pipeReadFD_;
+    mutable int pipeWriteFD_;
     std::string peerName_;
+    /// Keeps shutdown from racing with close
+    mutable boost::mutex closeMutex_;
+    /// Never held while sending, so that other threads don't wait on it
+    mutable boost::mutex batchMutex_;
 
 private:
     void setPeerName();
 
+    /**
+     * Connects without blocking for longer than a timeout.
+     * @return False if the connection failed or timed out; errno says why.
+     */
+    bool connectWithTimeout(const addrinfo* address,
+        int timeoutMilliseconds) const;
+
+    /**
+     * Sends the whole message, or queues what's left if the socket is
+     * non-blocking and the kernel buffer is full.
+     */
+    void sendAll(const char* message, size_t length) const;
+
+    /**
+     * Sends several buffers with as few system calls as possible, or queues
+     * what's left if the socket is non-blocking and the kernel buffer is
+     * full.
+     * @param parts The buffers to send. These are modified as they're sent.
+     * @param count The number of buffers.
+     */
+    void sendGather(struct iovec* parts, size_t count) const;
+
+    /**
+     * Returns true if sends from this thread should be held back.
+     */
+    bool isBatching() const;
+
+    /**
+     * Holds a send back if this thread started a batch.
+     * @return False if the message wasn't part of a batch and still needs
+     *  to be sent.
+     * @throw SocketException
+     */
+    bool addToBatch(const char* message, size_t length) const;
+
+    /**
+     * Sends everything that was held back, followed by a message.
+     * @param message More data to send after the batch. Can be empty.
+     * @throw SocketException
+     */
+    void sendBatch(const char* message, size_t length) const;
+
     // Hidden methods
     Socket& operator=(const Socket& rhs);
 };
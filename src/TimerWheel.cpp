@@ -0,0 +1,398 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TimerWheel.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <cassert>
+#include <limits>
+#include <vector>
+
+using boost::lock_guard;
+using boost::mutex;
+using boost::unique_lock;
+using std::numeric_limits;
+using std::vector;
+
+const int TimerWheel::DEFAULT_TICK_MILLISECONDS;
+const unsigned TimerWheel::SLOT_BITS;
+const size_t TimerWheel::SLOTS;
+const size_t TimerWheel::LEVELS;
+const uint32_t TimerWheel::NO_TIMER;
+
+
+TimerWheel::Timer::Timer() :
+    expiry(0),
+    callback(),
+    previous(NO_TIMER),
+    next(NO_TIMER),
+    generation(1),
+    scheduled(false),
+    level(0),
+    slot(0)
+{
+}
+
+
+TimerWheel::TimerWheel(const int tickMilliseconds) :
+    slots_(),
+    timers_(),
+    unused_(NO_TIMER),
+    size_(0),
+    now_(0),
+    tickMilliseconds_(tickMilliseconds),
+    running_(false),
+    lastTick_(),
+    wakeTick_(numeric_limits<uint64_t>::max()),
+    mutex_(),
+    runningMutex_(),
+    scheduled_(),
+    thread_()
+{
+    assert(tickMilliseconds > 0);
+    for (size_t level = 0; level < LEVELS; ++level)
+    {
+        for (size_t slot = 0; slot < SLOTS; ++slot)
+        {
+            slots_[level][slot] = NO_TIMER;
+        }
+    }
+}
+
+
+TimerWheel::~TimerWheel()
+{
+    if (thread_.joinable())
+    {
+        thread_.interrupt();
+        thread_.join();
+    }
+}
+
+
+void TimerWheel::start()
+{
+    {
+        lock_guard<mutex> lg(mutex_);
+        running_ = true;
+        lastTick_ = boost::get_system_time();
+    }
+    thread_ = boost::thread(boost::bind(&TimerWheel::run, this));
+}
+
+
+TimerWheel::TimerId TimerWheel::schedule(
+    const int milliseconds,
+    const Callback& callback
+)
+{
+    assert(milliseconds >= 0);
+    // The current tick has partly gone by already, so round up and add one
+    // more so that timers are never early
+    const uint64_t ticks =
+        (milliseconds + tickMilliseconds_ - 1) / tickMilliseconds_ + 1;
+
+    lock_guard<mutex> lg(mutex_);
+    // The thread only catches up when it wakes up, so count the ticks that
+    // have gone by since then
+    uint64_t currentTick = now_;
+    if (running_)
+    {
+        const uint64_t elapsed = getElapsedTicks();
+        if (0 == size_)
+        {
+            // Nothing can expire, so skip ahead instead of ticking through
+            // however long the wheel has been empty
+            now_ += elapsed;
+            lastTick_ += boost::posix_time::milliseconds(tickMilliseconds_)
+                * static_cast<int>(elapsed);
+        }
+        currentTick += elapsed;
+    }
+    const uint32_t index = allocate();
+    Timer& timer = timers_[index];
+    timer.expiry = currentTick + ticks;
+    timer.callback = callback;
+    timer.scheduled = true;
+    insert(index);
+    ++size_;
+    // Most timers are pushed back before they expire, so only wake the
+    // thread if it would sleep through this one
+    if (timer.expiry < wakeTick_)
+    {
+        scheduled_.notify_one();
+    }
+    // The generation is never 0, so neither is the ID
+    return (static_cast<TimerId>(timer.generation) << 32) | index;
+}
+
+
+bool TimerWheel::cancel(const TimerId id)
+{
+    if (0 == id)
+    {
+        return false;
+    }
+    {
+        lock_guard<mutex> lg(mutex_);
+        const uint32_t index = static_cast<uint32_t>(id);
+        const uint32_t generation = static_cast<uint32_t>(id >> 32);
+        if (
+            index < timers_.size()
+            && timers_[index].scheduled
+            && generation == timers_[index].generation
+        )
+        {
+            unlink(index);
+            release(index);
+            return true;
+        }
+    }
+    // It might be running right now, so wait for it to finish
+    lock_guard<mutex> running(runningMutex_);
+    return false;
+}
+
+
+size_t TimerWheel::size() const
+{
+    lock_guard<mutex> lg(mutex_);
+    return size_;
+}
+
+
+void TimerWheel::advance(const uint64_t ticks)
+{
+    unique_lock<mutex> lock(mutex_);
+    runTicks(ticks, &lock);
+}
+
+
+void TimerWheel::runTicks(const uint64_t ticks, unique_lock<mutex>* const lock)
+{
+    vector<Callback> expired;
+    for (uint64_t i = 0; i < ticks; ++i)
+    {
+        tick(&expired);
+    }
+    // Taken before letting go of the timers so that cancel can't miss a
+    // callback that's about to run
+    lock_guard<mutex> running(runningMutex_);
+    lock->unlock();
+    for (size_t i = 0; i < expired.size(); ++i)
+    {
+        expired[i]();
+    }
+}
+
+
+uint32_t TimerWheel::allocate()
+{
+    if (NO_TIMER == unused_)
+    {
+        assert(timers_.size() < NO_TIMER);
+        timers_.push_back(Timer());
+        return static_cast<uint32_t>(timers_.size() - 1);
+    }
+    const uint32_t index = unused_;
+    unused_ = timers_[index].next;
+    return index;
+}
+
+
+void TimerWheel::release(const uint32_t index)
+{
+    Timer& timer = timers_[index];
+    timer.scheduled = false;
+    // Let go of anything the callback holds on to
+    timer.callback.clear();
+    ++timer.generation;
+    if (0 == timer.generation)
+    {
+        timer.generation = 1;
+    }
+    timer.previous = NO_TIMER;
+    timer.next = unused_;
+    unused_ = index;
+    --size_;
+}
+
+
+void TimerWheel::unlink(const uint32_t index)
+{
+    const Timer& timer = timers_[index];
+    if (NO_TIMER == timer.previous)
+    {
+        slots_[timer.level][timer.slot] = timer.next;
+    }
+    else
+    {
+        timers_[timer.previous].next = timer.next;
+    }
+    if (NO_TIMER != timer.next)
+    {
+        timers_[timer.next].previous = timer.previous;
+    }
+}
+
+
+void TimerWheel::insert(const uint32_t index)
+{
+    Timer& timer = timers_[index];
+    const uint64_t delta = (timer.expiry > now_ ? timer.expiry - now_ : 1);
+    size_t level = 0;
+    while (
+        level + 1 < LEVELS
+        && delta >= (static_cast<uint64_t>(1) << (SLOT_BITS * (level + 1)))
+    )
+    {
+        ++level;
+    }
+    // Timers past the end of the top level wait in its furthest slot and
+    // are put back in when it comes around
+    uint64_t expiry = timer.expiry;
+    const uint64_t span = static_cast<uint64_t>(1) << (SLOT_BITS * LEVELS);
+    if (delta >= span)
+    {
+        expiry = now_ + span - 1;
+    }
+    const size_t slot = (expiry >> (SLOT_BITS * level)) & (SLOTS - 1);
+
+    timer.level = level;
+    timer.slot = slot;
+    timer.previous = NO_TIMER;
+    timer.next = slots_[level][slot];
+    if (NO_TIMER != timer.next)
+    {
+        timers_[timer.next].previous = index;
+    }
+    slots_[level][slot] = index;
+}
+
+
+void TimerWheel::tick(vector<Callback>* const expired)
+{
+    ++now_;
+
+    // Move timers down from the higher levels when their slot comes up,
+    // top level first so that they can keep moving down
+    for (size_t level = LEVELS - 1; level > 0; --level)
+    {
+        const uint64_t mask =
+            (static_cast<uint64_t>(1) << (SLOT_BITS * level)) - 1;
+        if (0 != (now_ & mask))
+        {
+            continue;
+        }
+        uint32_t& moving =
+            slots_[level][(now_ >> (SLOT_BITS * level)) & (SLOTS - 1)];
+        uint32_t index = moving;
+        moving = NO_TIMER;
+        while (NO_TIMER != index)
+        {
+            const uint32_t next = timers_[index].next;
+            insert(index);
+            index = next;
+        }
+    }
+
+    uint32_t& due = slots_[0][now_ & (SLOTS - 1)];
+    uint32_t index = due;
+    due = NO_TIMER;
+    while (NO_TIMER != index)
+    {
+        Timer& timer = timers_[index];
+        assert(timer.expiry == now_);
+        const uint32_t next = timer.next;
+        expired->push_back(Callback());
+        expired->back().swap(timer.callback);
+        release(index);
+        index = next;
+    }
+}
+
+
+uint64_t TimerWheel::getSleepTicks() const
+{
+    if (0 == size_)
+    {
+        return 0;
+    }
+    // Sleep until the next timer in the bottom level, or until timers need
+    // to be moved down into it
+    for (uint64_t i = 1; ; ++i)
+    {
+        const uint64_t tick = now_ + i;
+        if (
+            0 == (tick & (SLOTS - 1))
+            || NO_TIMER != slots_[0][tick & (SLOTS - 1)]
+        )
+        {
+            return i;
+        }
+    }
+}
+
+
+void TimerWheel::run()
+{
+    const boost::posix_time::milliseconds tickLength(tickMilliseconds_);
+    try
+    {
+        while (true)
+        {
+            unique_lock<mutex> lock(mutex_);
+            const uint64_t sleepTicks = getSleepTicks();
+            if (0 == sleepTicks)
+            {
+                // Nothing to do until something is scheduled
+                wakeTick_ = numeric_limits<uint64_t>::max();
+                scheduled_.wait(lock);
+                continue;
+            }
+            wakeTick_ = now_ + sleepTicks;
+            scheduled_.timed_wait(
+                lock,
+                lastTick_ + tickLength * static_cast<int>(sleepTicks)
+            );
+
+            const uint64_t elapsed = getElapsedTicks();
+            lastTick_ += tickLength * static_cast<int>(elapsed);
+            runTicks(elapsed, &lock);
+        }
+    }
+    catch (boost::thread_interrupted&)
+    {
+        // Shutting down
+    }
+}
+
+
+uint64_t TimerWheel::getElapsedTicks() const
+{
+    const int64_t milliseconds =
+        (boost::get_system_time() - lastTick_).total_milliseconds();
+    return (milliseconds > 0 ? milliseconds / tickMilliseconds_ : 0);
+}
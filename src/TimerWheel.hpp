@@ -0,0 +1,209 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_TIMERWHEEL_HPP_
+#define SRC_TIMERWHEEL_HPP_
+
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <vector>
+
+/**
+ * Runs lots of timeouts, e.g. one for every idle connection, from a single
+ * thread. Timers are kept in a hierarchical wheel, so scheduling, canceling
+ * and expiring a timer are constant time no matter how many there are, and
+ * the thread only wakes up when a timer is due or when timers that are far
+ * off need to be moved closer. Each slot of the wheel is a list that's
+ * linked through the timers themselves, which are kept in a pool that's
+ * reused, so a timer's ID tells where it is without looking it up.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+class TimerWheel
+{
+public:
+    typedef uint64_t TimerId;
+    typedef boost::function<void ()> Callback;
+
+    /**
+     * Constructor. The timers don't run until start is called.
+     * @param tickMilliseconds How precise the timers are. Timers expire up
+     *  to one tick late.
+     */
+    explicit TimerWheel(int tickMilliseconds = DEFAULT_TICK_MILLISECONDS);
+
+    /**
+     * Destructor. Stops the timer thread without running what's left.
+     */
+    ~TimerWheel();
+
+    /**
+     * Starts the thread that runs the timers.
+     */
+    void start();
+
+    /**
+     * Runs a callback after a delay. Callbacks are run from the timer thread
+     * and should be quick, e.g. shutting down a socket, and must not
+     * schedule or cancel timers themselves.
+     * @param milliseconds How long to wait.
+     * @param callback What to run.
+     * @return An ID that can be used to cancel the timer; never 0.
+     */
+    TimerId schedule(int milliseconds, const Callback& callback);
+
+    /**
+     * Stops a timer from running. Once this returns, the callback isn't
+     * running and won't be run, so anything that it uses can be destroyed.
+     * @param id The ID from schedule. 0 is ignored.
+     * @return False if the timer had already expired or been canceled.
+     */
+    bool cancel(TimerId id);
+
+    /**
+     * Returns the number of timers that haven't expired yet.
+     */
+    size_t size() const;
+
+    /**
+     * Moves time forward and runs any timers that expire. This is done by
+     * the timer thread, but tests can call it themselves instead of
+     * starting the thread.
+     * @param ticks How many ticks to move forward.
+     */
+    void advance(uint64_t ticks);
+
+    static const int DEFAULT_TICK_MILLISECONDS = 100;
+
+private:
+    /// Each level of the wheel has 64 slots, each covering 64 times as much
+    /// time as a slot in the level below it
+    static const unsigned SLOT_BITS = 6;
+    static const size_t SLOTS = 1 << SLOT_BITS;
+    static const size_t LEVELS = 4;
+
+    /// Marks the end of a slot's list and an empty slot
+    static const uint32_t NO_TIMER = 0xFFFFFFFF;
+
+    /**
+     * A timer, linked into the list for its slot, or into the list of
+     * unused timers once it's expired or been canceled.
+     */
+    struct Timer
+    {
+        uint64_t expiry;
+        Callback callback;
+        uint32_t previous;
+        uint32_t next;
+        /// How many times this timer has been reused, so that the IDs of
+        /// old timers don't match it
+        uint32_t generation;
+        bool scheduled;
+        size_t level;
+        size_t slot;
+        Timer();
+    };
+
+    /**
+     * Takes an unused timer, or adds one to the pool if there are none.
+     * The mutex must be held.
+     */
+    uint32_t allocate();
+
+    /**
+     * Takes a timer out of its slot and puts it back in the pool. The
+     * mutex must be held.
+     */
+    void release(uint32_t index);
+
+    /**
+     * Takes a timer out of its slot's list. The mutex must be held.
+     */
+    void unlink(uint32_t index);
+
+    /**
+     * Puts a timer in the slot for when it expires. The mutex must be held.
+     */
+    void insert(uint32_t index);
+
+    /**
+     * Moves forward one tick, moving timers down from the higher levels
+     * where they're due and collecting the ones that expire. The mutex must
+     * be held.
+     */
+    void tick(std::vector<Callback>* expired);
+
+    /**
+     * Returns how many ticks the thread can sleep for without missing a
+     * timer or a move down from a higher level. The mutex must be held.
+     */
+    uint64_t getSleepTicks() const;
+
+    /**
+     * Moves time forward and runs any timers that expire. The lock must be
+     * held, and is let go of before the callbacks are run.
+     */
+    void runTicks(uint64_t ticks, boost::unique_lock<boost::mutex>* lock);
+
+    /**
+     * Returns how many whole ticks have gone by since lastTick_. The mutex
+     * must be held.
+     */
+    uint64_t getElapsedTicks() const;
+
+    /**
+     * Runs the timers until the thread is interrupted.
+     */
+    void run();
+
+    /// The first timer in each slot's list
+    uint32_t slots_[LEVELS][SLOTS];
+    /// Every timer, scheduled or not; the lists refer to them by index
+    std::vector<Timer> timers_;
+    /// The first unused timer, linked through next
+    uint32_t unused_;
+    /// How many timers are scheduled
+    size_t size_;
+    uint64_t now_;
+    const int tickMilliseconds_;
+    /// Whether the thread has been started
+    bool running_;
+    /// When now_ started, if the thread is running
+    boost::system_time lastTick_;
+    /// The tick that the thread is sleeping until
+    uint64_t wakeTick_;
+    mutable boost::mutex mutex_;
+    /// Held while callbacks are running so that cancel can wait for them
+    boost::mutex runningMutex_;
+    boost::condition_variable scheduled_;
+    boost::thread thread_;
+
+    // ***** Hidden methods *****
+    TimerWheel(const TimerWheel&);
+    TimerWheel& operator=(const TimerWheel&);
+};
+
+#endif  // SRC_TIMERWHEEL_HPP_
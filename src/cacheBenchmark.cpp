@@ -0,0 +1,436 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Benchmarks the ConcurrentCache against a least recently used cache that
+ * is split into shards behind mutexes, which is how the query caches used
+ * to work, with more and more threads looking up keys at once. It prints
+ * how many lookups per second each does and their hit rates.
+ * @author Brandon Skari
+ * @date October 17 2026
+ */
+
+#include "ConcurrentCache.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/function.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/unordered_map.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <string>
+#include <utility>
+
+using boost::lock_guard;
+using boost::mutex;
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+using boost::shared_ptr;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+namespace options = boost::program_options;
+
+typedef ConcurrentCache<int, string> Cache;
+
+/**
+ * A least recently used cache whose shards each have a mutex, a list that
+ * every hit moves its entry to the front of, and an index into the list.
+ * Hits copy the value out while holding the lock.
+ */
+class LockedLruCache
+{
+public:
+    LockedLruCache(size_t capacity, int shardsCount);
+    ~LockedLruCache();
+
+    bool find(int key, string* value);
+    void insert(int key, const string& value);
+    size_t getMisses() const;
+
+private:
+    typedef std::list<std::pair<int, string> > EntryList;
+
+    struct Shard
+    {
+        mutex shardMutex;
+        // Most recently used first
+        EntryList entries;
+        boost::unordered_map<int, EntryList::iterator> index;
+        size_t misses;
+        Shard();
+    };
+
+    Shard& getShard(int key) const;
+
+    const size_t shardCapacity_;
+    const int shardsCount_;
+    Shard* const shards_;
+
+    // ***** Hidden methods *****
+    LockedLruCache(const LockedLruCache& rhs);
+    LockedLruCache& operator=(const LockedLruCache& rhs);
+};
+
+/**
+ * How the threads look keys up.
+ */
+struct Workload
+{
+    size_t lookups;
+    int keys;
+    size_t valueLength;
+};
+
+static options::options_description getOptions();
+static string makeValue(int key, size_t valueLength);
+static int nextKey(unsigned int* random, int keys);
+static void lookUpLru(
+    LockedLruCache* lru,
+    const Workload* workload,
+    unsigned int seed
+);
+static void lookUpConcurrent(
+    Cache* cache,
+    const Workload* workload,
+    unsigned int seed
+);
+static double timeThreads(
+    const boost::function<void(unsigned int)>& lookUp,
+    size_t threads
+);
+
+/**
+ * Keeps the compiler from throwing the results away.
+ */
+static volatile size_t sink;
+
+
+int main(int argc, char* argv[])
+{
+    options::variables_map vm;
+    const options::options_description visibleOptions(getOptions());
+    try
+    {
+        store(
+            options::command_line_parser(
+                argc,
+                argv
+            ).options(visibleOptions).run(),
+            vm
+        );
+        notify(vm);
+    }
+    catch (std::exception& e)
+    {
+        cerr << e.what() << '\n' << visibleOptions << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (vm.count("help"))
+    {
+        cout << visibleOptions << endl;
+        exit(EXIT_SUCCESS);
+    }
+
+    const size_t maxThreads = vm["threads"].as<size_t>();
+    const size_t capacity = vm["capacity"].as<size_t>();
+    Workload workload;
+    workload.lookups = vm["lookups"].as<size_t>();
+    workload.keys = vm["keys"].as<int>();
+    workload.valueLength = vm["value-length"].as<size_t>();
+    if (
+        0 == maxThreads
+        || 0 == capacity
+        || 0 == workload.lookups
+        || workload.keys <= 0
+    )
+    {
+        cerr << "Counts need to be positive\n" << visibleOptions << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    cout << "Threads\tLRU lookups/s\tLRU hits\t"
+        << "Concurrent lookups/s\tConcurrent hits\tSpeedup" << endl;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        const double totalLookups =
+            static_cast<double>(threads) * workload.lookups;
+
+        // Both caches hold the same number of values
+        LockedLruCache lru(capacity, Cache::DEFAULT_SHARDS_COUNT);
+        const double lruSeconds = timeThreads(
+            boost::bind(lookUpLru, &lru, &workload, _1),
+            threads
+        );
+
+        Cache cache(
+            capacity * Cache::getEntryBytes(workload.valueLength),
+            Cache::DEFAULT_SHARDS_COUNT
+        );
+        const double concurrentSeconds = timeThreads(
+            boost::bind(lookUpConcurrent, &cache, &workload, _1),
+            threads
+        );
+
+        cout << threads << '\t'
+            << totalLookups / lruSeconds << '\t'
+            << 1.0 - lru.getMisses() / totalLookups << '\t'
+            << totalLookups / concurrentSeconds << '\t'
+            << cache.getHits() / totalLookups << '\t'
+            << lruSeconds / concurrentSeconds << 'x' << endl;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Command line options.
+ */
+options::options_description getOptions()
+{
+    options::options_description cli("Options");
+    cli.add_options()
+        (
+            "help",
+            "Print help message"
+        )
+        (
+            "threads,t",
+            options::value<size_t>()->default_value(64),
+            "The most threads to look keys up with; the thread count is"
+                " doubled from 1 up to this."
+        )
+        (
+            "lookups,l",
+            options::value<size_t>()->default_value(200000),
+            "The number of keys that each thread looks up."
+        )
+        (
+            "keys,k",
+            options::value<int>()->default_value(20000),
+            "The number of different keys."
+        )
+        (
+            "capacity,c",
+            options::value<size_t>()->default_value(10000),
+            "The number of values that the caches hold."
+        )
+        (
+            "value-length,v",
+            options::value<size_t>()->default_value(64),
+            "The length of the cached strings."
+        );
+    return cli;
+}
+
+
+/**
+ * Makes a different value for each key, all of the same length.
+ */
+string makeValue(const int key, const size_t valueLength)
+{
+    string value(boost::lexical_cast<string>(key));
+    value.resize(valueLength, '.');
+    return value;
+}
+
+
+/**
+ * Picks the next key to look up. The lower keys are picked more often, like
+ * the queries that a web application runs most.
+ */
+int nextKey(unsigned int* const random, const int keys)
+{
+    *random = *random * 1103515245 + 12345;
+    const int first = (*random >> 8) % keys;
+    *random = *random * 1103515245 + 12345;
+    const int second = (*random >> 8) % keys;
+    return first < second ? first : second;
+}
+
+
+/**
+ * Looks keys up in the LockedLruCache, computing and inserting the missing
+ * values.
+ */
+void lookUpLru(
+    LockedLruCache* const lru,
+    const Workload* const workload,
+    unsigned int seed
+)
+{
+    size_t length = 0;
+    string value;
+    for (size_t i = 0; i < workload->lookups; ++i)
+    {
+        const int key = nextKey(&seed, workload->keys);
+        if (!lru->find(key, &value))
+        {
+            value = makeValue(key, workload->valueLength);
+            lru->insert(key, value);
+        }
+        length += value.size();
+    }
+    sink = length;
+}
+
+
+/**
+ * Looks keys up in the ConcurrentCache, computing and inserting the
+ * missing values.
+ */
+void lookUpConcurrent(
+    Cache* const cache,
+    const Workload* const workload,
+    unsigned int seed
+)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < workload->lookups; ++i)
+    {
+        const int key = nextKey(&seed, workload->keys);
+        shared_ptr<const string> value(cache->find(key));
+        if (!value)
+        {
+            value = cache->insert(
+                key,
+                makeValue(key, workload->valueLength),
+                workload->valueLength
+            );
+        }
+        length += value->size();
+    }
+    sink = length;
+}
+
+
+/**
+ * Runs the lookups in some threads at once and returns how long it took.
+ */
+double timeThreads(
+    const boost::function<void(unsigned int)>& lookUp,
+    const size_t threads
+)
+{
+    boost::thread_group group;
+    const ptime start(microsec_clock::universal_time());
+    for (size_t i = 0; i < threads; ++i)
+    {
+        group.create_thread(
+            boost::bind(lookUp, static_cast<unsigned int>(i + 1))
+        );
+    }
+    group.join_all();
+    const ptime end(microsec_clock::universal_time());
+    return (end - start).total_microseconds() / 1000000.0;
+}
+
+
+LockedLruCache::Shard::Shard() :
+    shardMutex(),
+    entries(),
+    index(),
+    misses(0)
+{
+}
+
+
+LockedLruCache::LockedLruCache(const size_t capacity, const int shardsCount) :
+    shardCapacity_((capacity + shardsCount - 1) / shardsCount),
+    shardsCount_(shardsCount),
+    shards_(new Shard[shardsCount])
+{
+}
+
+
+LockedLruCache::~LockedLruCache()
+{
+    delete [] shards_;
+}
+
+
+bool LockedLruCache::find(const int key, string* const value)
+{
+    Shard& shard = getShard(key);
+    lock_guard<mutex> lg(shard.shardMutex);
+    const boost::unordered_map<int, EntryList::iterator>::const_iterator
+        found(shard.index.find(key));
+    if (shard.index.end() == found)
+    {
+        ++shard.misses;
+        return false;
+    }
+    // Move it to the front so that it's evicted last
+    shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+    *value = found->second->second;
+    return true;
+}
+
+
+void LockedLruCache::insert(const int key, const string& value)
+{
+    Shard& shard = getShard(key);
+    lock_guard<mutex> lg(shard.shardMutex);
+    const boost::unordered_map<int, EntryList::iterator>::iterator
+        found(shard.index.find(key));
+    if (shard.index.end() != found)
+    {
+        shard.entries.erase(found->second);
+        shard.index.erase(found);
+    }
+    while (shard.entries.size() >= shardCapacity_)
+    {
+        shard.index.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+    }
+    shard.entries.push_front(std::make_pair(key, value));
+    shard.index[key] = shard.entries.begin();
+}
+
+
+size_t LockedLruCache::getMisses() const
+{
+    size_t misses = 0;
+    for (int i = 0; i < shardsCount_; ++i)
+    {
+        lock_guard<mutex> lg(shards_[i].shardMutex);
+        misses += shards_[i].misses;
+    }
+    return misses;
+}
+
+
+LockedLruCache::Shard& LockedLruCache::getShard(const int key) const
+{
+    // Mix the bits like ConcurrentCache does so that both spread the keys
+    // over their shards the same way
+    size_t hash = boost::hash<int>()(key);
+    hash ^= hash >> 17;
+    hash *= 0x9e3779b1u;
+    hash ^= hash >> 15;
+    return shards_[hash % shardsCount_];
+}
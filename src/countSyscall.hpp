@@ -0,0 +1,46 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_COUNTSYSCALL_HPP_
+#define SRC_COUNTSYSCALL_HPP_
+
+#include <boost/cstdint.hpp>
+
+/**
+ * Counts the system calls made on the proxy data path so that the proxy
+ * benchmark can compare the connection engines. This costs an atomic add per
+ * system call, so it's compiled out unless COUNT_SYSCALLS is defined.
+ */
+
+inline volatile uint64_t& syscallCount()
+{
+    static volatile uint64_t count = 0;
+    return count;
+}
+
+
+inline void countSyscall()
+{
+    #ifdef COUNT_SYSCALLS
+        __sync_fetch_and_add(&syscallCount(), 1);
+    #endif
+}
+
+#endif  // SRC_COUNTSYSCALL_HPP_
@@ -48,7 +48,7 @@ using std::string;
  * @date December 3 2011
  */
 
-const int NUM_PROBABILITIES = 6;
+const int NUM_PROBABILITIES = AttackScores::ATTACKS_COUNT;
 const int NUM_QUERY_TYPES = 10;
 
 enum RESPONSE_TYPES
@@ -71,91 +71,6 @@ enum ATTACK_TYPES
 
 const int FAILED_TO_PARSE = 100;
 
-void setProbabilities(
-    QueryRisk& qr,
-    AttackProbabilities* probs,
-    double probabilities[]
-)
-{
-    assert(nullptr != probs &&
-        "The probability calculator should not be null");
-    if (nullptr == probs)
-    {
-        return;
-    }
-    // Authentication bypass attack
-    if (QueryRisk::TYPE_SELECT == qr.queryType && qr.userTable)
-    {
-        probabilities[0] = probs->getProbabilityOfBypassAttack(qr);
-    }
-    else
-    {
-        probabilities[0] = 0.0;
-    }
-
-    // Data access attack
-    if (QueryRisk::TYPE_SELECT == qr.queryType)
-    {
-        probabilities[1] = probs->getProbabilityOfAccessAttack(qr);
-    }
-    else
-    {
-        probabilities[1] = 0.0;
-    }
-
-    // Data modification attack
-    if (QueryRisk::TYPE_UPDATE == qr.queryType ||
-        QueryRisk::TYPE_INSERT == qr.queryType ||
-        QueryRisk::TYPE_DELETE == qr.queryType)
-    {
-        probabilities[2] = probs->getProbabilityOfModificationAttack(qr);
-    }
-    else
-    {
-        probabilities[2] = 0.0;
-    }
-
-    // Fingerprinting attack
-    // Fingerprinting attacks can come from select or data mods!
-    if (QueryRisk::TYPE_SELECT == qr.queryType
-        || QueryRisk::TYPE_INSERT == qr.queryType
-        || QueryRisk::TYPE_UPDATE == qr.queryType
-        || QueryRisk::TYPE_DELETE == qr.queryType)
-    {
-        probabilities[3] =
-            probs->getProbabilityOfFingerprintingAttack(qr);
-    }
-    else
-    {
-        probabilities[3] = 0.0;
-    }
-
-    // Schema discovery attack
-    // Schema attacks can come from select or data mods!
-    if (QueryRisk::TYPE_SELECT == qr.queryType
-        || QueryRisk::TYPE_INSERT == qr.queryType
-        || QueryRisk::TYPE_UPDATE == qr.queryType
-        || QueryRisk::TYPE_DELETE == qr.queryType)
-    {
-        probabilities[4] = probs->getProbabilityOfSchemaAttack(qr);
-    }
-    else
-    {
-        probabilities[4] = 0.0;
-    }
-
-    // Denial of service attack
-    if (QueryRisk::TYPE_SELECT == qr.queryType)
-    {
-        probabilities[5] = probs->getProbabilityOfDenialAttack(qr);
-    }
-    else
-    {
-        probabilities[5] = 0.0;
-    }
-}
-
-
 int main(int argc, char* argv[])
 {
     initializeSingletons();
@@ -191,9 +106,9 @@ int main(int argc, char* argv[])
             && "in the QueryRisk::QueryType enum"
         );
 
-        double probabilities[NUM_PROBABILITIES];
-
-        setProbabilities(qr, &dp, probabilities);
+        AttackScores scores;
+        dp.scoreAll(qr, &scores);
+        const double* const probabilities = scores.probabilities;
 
         const double maxProb = *max_element(
             probabilities,
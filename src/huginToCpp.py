@@ -0,0 +1,706 @@
+#!/usr/bin/env python3
+license_header =\
+"""/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+"""
+
+# Compiles Hugin Bayesian network files into C++.
+#
+# Usage: huginToCpp.py <output name> <net file>...
+#
+# Writes <output name>.hpp and <output name>.cpp. Every network gets a struct
+# named after its file, so dataAccess.net becomes DataAccessNet, with an enum
+# of its nodes in file order, an enum of how many states each node has, and a
+# BayesNetDescription of its conditional probability tables. The networks are
+# checked here so that a bad file breaks the build instead of the startup.
+#
+# The probabilities that SQLassie looks up while it runs are worked out here
+# too, for every combination of evidence that a query can have, and each one
+# becomes a BayesTableDescription in its network's struct.
+
+import itertools
+import os
+import re
+import sys
+
+token_re = re.compile(r'\s*("[^"]*"|[A-Za-z_][A-Za-z0-9_]*|[-+0-9.][-+0-9.eE]*'
+    r'|[{}()=;|])')
+
+# Each row of a probability table should sum to 1 within this
+PROBABILITY_SUM_TOLERANCE = 0.0000001
+
+# The probabilities that DlibProbabilities looks up: the network, the name of
+# the member in its struct, the node and state that it's the probability of,
+# and the nodes that are evidence. The node has to be a root of its network.
+TABLES = [
+    ('dataAccess', 'table', 'DataAccess', 0, [
+        'GlobalVariables', 'IfStmts', 'StringManipulation', 'HexStrings',
+        'OrAlwaysTrue', 'CommentedConditionals', 'StringStmts', 'BruteForce',
+        'UnionStmts', 'BenchmarkStmts', 'CommentedQuotes',
+        'AlwaysTrueConditional', 'SensitiveTables', 'UnionAllStmts',
+        'OrStmts']),
+    ('bypassAuthentication', 'table', 'BypassAuthentication', 0, [
+        'HexStrings', 'BruteForce', 'CommentedQuotes', 'StringStmts',
+        'GlobalVariables', 'UnionStmts', 'AlwaysTrueConditional', 'OrStmts',
+        'StringManipulation', 'EmptyPassword', 'CommentedConditionals']),
+    # The password is only evidence for queries that compare one
+    ('bypassAuthentication', 'tableWithoutPassword', 'BypassAuthentication', 0,
+        ['HexStrings', 'BruteForce', 'CommentedQuotes', 'StringStmts',
+        'GlobalVariables', 'UnionStmts', 'AlwaysTrueConditional', 'OrStmts',
+        'StringManipulation', 'CommentedConditionals']),
+    ('dataModification', 'table', 'DataModification', 0, [
+        'HexStrings', 'StringStmts', 'Insert', 'GlobalVariables', 'BruteForce',
+        'OrStmts', 'AlwaysTrue', 'StringManipulation', 'CommentedConditionals',
+        'CommentedQuotes', 'SensitiveTables']),
+    ('fingerprinting', 'table', 'Fingerprinting', 0, [
+        'MySqlComments', 'MySqlStringConcat', 'GlobalVariables', 'Select',
+        'StringManipulation', 'OrStmts', 'IfStmts', 'CommentedQuotes',
+        'BruteForce', 'CommentedConditionals', 'HexStrings', 'UnionStmts',
+        'MySqlVersionComments', 'FingerprintingStmts', 'UserStmts',
+        'AlwaysTrueConditional', 'BenchmarkStmts', 'StringStmts',
+        'OrAlwaysTrue']),
+    ('schema', 'table', 'Schema', 0, [
+        'OrStmts', 'OrderByNumber', 'GlobalVariables', 'BruteForce',
+        'CommentedQuotes', 'IfStmts', 'StringStmts', 'InformationSchema',
+        'HexStrings', 'UnionStmts', 'CommentedConditionals', 'BenchmarkStmts',
+        'OrAlwaysTrue', 'AlwaysTrueConditional', 'StringManipulation',
+        'Select']),
+    ('denialOfService', 'table', 'DenialOfService', 0, [
+        'AlwaysTrue', 'SlowRegex', 'Benchmark', 'Joins', 'CrossJoin',
+        'RegexLength']),
+]
+
+# Evidence that DlibProbabilities works out from other evidence, so that not
+# every combination of states can happen: the node is found if any or all of
+# the other nodes are. Nodes that aren't evidence in a network could be
+# anything.
+DERIVED = [
+    ('StringStmts', 'any', ['UserStmts', 'FingerprintingStmts',
+        'GlobalVariables']),
+    ('OrAlwaysTrue', 'all', ['OrStmts', 'AlwaysTrue',
+        'AlwaysTrueConditional']),
+]
+
+# The state of two state evidence nodes that means that the risk was found
+FOUND = 0
+
+# Marks combinations of states in a lookup array that can't happen
+UNREACHABLE = 255
+
+
+class NetError(Exception):
+    pass
+
+
+class Node:
+    def __init__(self, name, states):
+        self.name = name
+        self.states = states
+        self.parents = None
+        self.probabilities = None
+
+
+class Net:
+    def __init__(self, file_name):
+        base = os.path.splitext(os.path.basename(file_name))[0]
+        self.file_name = file_name
+        self.variable = base
+        self.struct = base[0].upper() + base[1:] + 'Net'
+        self.nodes = []
+        self.numbers = {}
+        self.tables = []
+
+
+def tokenize(text):
+    tokens = []
+    position = 0
+    text = text.rstrip()
+    while position < len(text):
+        m = token_re.match(text, position)
+        if m == None:
+            raise NetError('unexpected character ' + repr(text[position]))
+        tokens.append(m.group(1))
+        position = m.end()
+    return tokens
+
+
+class Parser:
+    def __init__(self, tokens):
+        self.tokens = tokens
+        self.position = 0
+
+    def peek(self):
+        if self.position < len(self.tokens):
+            return self.tokens[self.position]
+        return None
+
+    def next(self):
+        token = self.peek()
+        if token == None:
+            raise NetError('unexpected end of file')
+        self.position += 1
+        return token
+
+    def expect(self, expected):
+        token = self.next()
+        if token != expected:
+            raise NetError('expected ' + expected + ' but found ' + token)
+
+    def skip_value(self):
+        """Skips the value of a parameter that isn't needed."""
+        if self.peek() == '(':
+            self.list_of(lambda token: token)
+        else:
+            self.next()
+
+    def list_of(self, convert):
+        """Reads a possibly nested parenthesized list into a flat list."""
+        values = []
+        self.expect('(')
+        while self.peek() != ')':
+            if self.peek() == '(':
+                values.extend(self.list_of(convert))
+            else:
+                values.append(convert(self.next()))
+        self.expect(')')
+        return values
+
+    def parameters(self, handle):
+        self.expect('{')
+        while self.peek() != '}':
+            name = self.next()
+            self.expect('=')
+            if not handle(name):
+                self.skip_value()
+            self.expect(';')
+        self.expect('}')
+
+
+def number(token):
+    try:
+        float(token)
+    except ValueError:
+        raise NetError('expected a number but found ' + token)
+    return token
+
+
+def parse_net(net, text):
+    parser = Parser(tokenize(text))
+    parser.expect('net')
+    parser.parameters(lambda name: False)
+
+    while parser.peek() == 'node':
+        parser.next()
+        name = parser.next()
+        if name in net.numbers:
+            raise NetError('node ' + name + ' is declared twice')
+        states = []
+
+        def handle(parameter):
+            if parameter != 'states':
+                return False
+            states.extend(parser.list_of(lambda token: token))
+            return True
+        parser.parameters(handle)
+
+        if len(states) == 0:
+            raise NetError('node ' + name + ' has no states')
+        net.numbers[name] = len(net.nodes)
+        net.nodes.append(Node(name, states))
+
+    while parser.peek() == 'potential':
+        parser.next()
+        parser.expect('(')
+        name = parser.next()
+        if name not in net.numbers:
+            raise NetError('potential for unknown node ' + name)
+        node = net.nodes[net.numbers[name]]
+        if node.parents != None:
+            raise NetError('node ' + name + ' has two potentials')
+        parser.expect('|')
+        node.parents = []
+        while parser.peek() != ')':
+            parent = parser.next()
+            if parent not in net.numbers:
+                raise NetError('unknown parent ' + parent + ' of ' + name)
+            node.parents.append(net.numbers[parent])
+        parser.expect(')')
+
+        def handle(parameter):
+            if parameter != 'data':
+                return False
+            node.probabilities = parser.list_of(number)
+            return True
+        parser.parameters(handle)
+
+    if parser.peek() != None:
+        raise NetError('unexpected ' + parser.peek())
+
+
+def check_net(net):
+    if len(net.nodes) == 0:
+        raise NetError('there are no nodes')
+    for node in net.nodes:
+        if node.parents == None or node.probabilities == None:
+            raise NetError('node ' + node.name + ' has no probabilities')
+        # The data is nested by the parents' states, with the node's own
+        # states innermost
+        expected = len(node.states)
+        for parent in node.parents:
+            expected *= len(net.nodes[parent].states)
+        if len(node.probabilities) != expected:
+            raise NetError(
+                'node ' + node.name + ' has ' + str(len(node.probabilities))
+                + ' probabilities instead of ' + str(expected))
+        columns = len(node.states)
+        for row in range(0, len(node.probabilities), columns):
+            row_probabilities = node.probabilities[row:row + columns]
+            total = sum(float(p) for p in row_probabilities)
+            if abs(total - 1.0) > PROBABILITY_SUM_TOLERANCE:
+                raise NetError(
+                    'probabilities of node ' + node.name + ' sum to '
+                    + str(total))
+
+
+class Table:
+    """The probability of a state of a root node for every combination of
+    evidence that can happen.
+
+    Given the root, the evidence splits into parts that are independent of
+    each other, so the probability is the prior times the likelihood of each
+    part, normalized. Each part has a table of likelihoods, indexed by the
+    states of its evidence like the digits of a number, with the root's
+    states innermost. Nodes whose combinations are limited by DERIVED are
+    one digit together, and a lookup array numbers the combinations that
+    can happen."""
+
+    def __init__(self, net, member, node, state, evidence):
+        self.net = net
+        self.member = member
+        self.prefix = net.variable + member[0].upper() + member[1:]
+        for name in [node] + evidence:
+            if name not in net.numbers:
+                raise NetError('unknown node ' + name + ' in ' + member)
+        self.node = net.numbers[node]
+        self.state = state
+        self.evidence = [net.numbers[name] for name in evidence]
+        self.probabilities = [[float(p) for p in n.probabilities]
+            for n in net.nodes]
+        if len(net.nodes[self.node].parents) != 0:
+            raise NetError(node + ' is not a root')
+        if state >= len(net.nodes[self.node].states):
+            raise NetError(node + ' has no state ' + str(state))
+        if self.node in self.evidence:
+            raise NetError(node + ' is evidence for itself')
+        self.parts = []
+        self.groups = []
+        for nodes in self.split():
+            digits = self.make_digits(nodes)
+            if len(digits) > 0:
+                self.parts.append((digits, self.likelihoods(nodes, digits)))
+
+    def states_count(self, node):
+        return len(self.net.nodes[node].states)
+
+    def split(self):
+        """Returns the nodes of each part, in file order."""
+        roots = list(range(len(self.net.nodes)))
+
+        def find(node):
+            while roots[node] != node:
+                node = roots[node]
+            return node
+        for number, node in enumerate(self.net.nodes):
+            joined = [n for n in [number] + node.parents if n != self.node]
+            for other in joined[1:]:
+                roots[find(other)] = find(joined[0])
+        parts = {}
+        for number in range(len(self.net.nodes)):
+            if number != self.node:
+                parts.setdefault(find(number), []).append(number)
+        return sorted(parts.values())
+
+    def reachable(self, rule, states):
+        """Returns whether the states of a rule's nodes that are evidence,
+        by node number, can happen together."""
+        derived, kind, inputs = rule
+        found = [states[self.net.numbers[name]] == FOUND for name in inputs
+            if self.net.numbers.get(name) in states]
+        unknown = len(found) < len(inputs)
+        derived_number = self.net.numbers.get(derived)
+        if derived_number not in states:
+            return True
+        if kind == 'any':
+            result = any(found)
+            if states[derived_number] == FOUND:
+                return result or unknown
+        else:
+            result = all(found)
+            if states[derived_number] != FOUND:
+                return not result or unknown
+        return result == (states[derived_number] == FOUND)
+
+    def make_digits(self, nodes):
+        """Returns the digits of a part's index, most significant first, as
+        (nodes, combinations of their states, group number or None)."""
+        evidence = [n for n in self.evidence if n in nodes]
+        digits = []
+        grouped = set()
+        for rule in DERIVED:
+            derived, kind, inputs = rule
+            names = [derived] + inputs
+            ruled = [n for n in self.evidence
+                if self.net.nodes[n].name in names]
+            here = [n for n in evidence if n in ruled]
+            if len(here) == 0:
+                continue
+            if any(n in grouped for n in here):
+                raise NetError(self.member + ' has overlapping rules')
+            combinations = set()
+            for states in itertools.product(
+                    *[range(self.states_count(n)) for n in ruled]):
+                if self.reachable(rule, dict(zip(ruled, states))):
+                    combinations.add(tuple(s for n, s in zip(ruled, states)
+                        if n in here))
+            everything = 1
+            for n in here:
+                everything *= self.states_count(n)
+            if len(combinations) == everything:
+                continue
+            grouped.update(here)
+            digits.append((here, sorted(combinations), len(self.groups)))
+            self.groups.append((here, sorted(combinations)))
+        for n in evidence:
+            if n not in grouped:
+                digits.append(
+                    ([n], [(s,) for s in range(self.states_count(n))], None))
+        digits.sort(key=lambda digit: evidence.index(digit[0][0]))
+        return digits
+
+    def factor(self, node, states):
+        """Returns the probability of a node's state given its parents'."""
+        index = 0
+        for parent in self.net.nodes[node].parents:
+            index = index * self.states_count(parent) + states[parent]
+        index = index * self.states_count(node) + states[node]
+        return self.probabilities[node][index]
+
+    def likelihoods(self, nodes, digits):
+        """Returns the likelihood of every combination of a part's
+        evidence for each state of the root, summing over the other nodes
+        in the part."""
+        evidence = [n for n in self.evidence if n in nodes]
+        hidden = [n for n in nodes if n not in evidence]
+        position = {}
+        for d, (digit_nodes, combinations, group) in enumerate(digits):
+            for n in digit_nodes:
+                position[n] = d
+        # Multiply each factor in as soon as the evidence that it needs has
+        # been counted through
+        attached = [[] for digit in digits]
+        constant = []
+        for n in nodes:
+            needed = [position[m] for m in [n] + self.net.nodes[n].parents
+                if m in position]
+            if len(needed) == 0:
+                constant.append(n)
+            else:
+                attached[max(needed)].append(n)
+
+        root_states = self.states_count(self.node)
+        size = 1
+        for digit_nodes, combinations, group in digits:
+            size *= len(combinations)
+        result = [0.0] * (size * root_states)
+        for root_state in range(root_states):
+            for hidden_states in itertools.product(
+                    *[range(self.states_count(n)) for n in hidden]):
+                states = dict(zip(hidden, hidden_states))
+                states[self.node] = root_state
+                probability = 1.0
+                for n in constant:
+                    probability *= self.factor(n, states)
+                partial = [(probability, states)]
+                for d, (digit_nodes, combinations, group) in enumerate(digits):
+                    extended = []
+                    for probability, states in partial:
+                        for combination in combinations:
+                            more = dict(states)
+                            more.update(zip(digit_nodes, combination))
+                            value = probability
+                            for n in attached[d]:
+                                value *= self.factor(n, more)
+                            extended.append((value, more))
+                    partial = extended
+                for i, (probability, states) in enumerate(partial):
+                    result[i * root_states + root_state] += probability
+        return result
+
+
+class PrintWrapper:
+    """Writes the values of an array initializer, wrapping at 80 columns."""
+
+    def __init__(self, out, indent='    ', wrap_length=80):
+        self.out = out
+        self.INDENT = indent
+        self.WRAP_LENGTH = wrap_length
+        self.column = 0
+
+    def write(self, values):
+        for i, value in enumerate(values):
+            if i + 1 < len(values):
+                value += ','
+            if self.column == 0:
+                self.out.write(self.INDENT + value)
+                self.column = len(self.INDENT) + len(value)
+            elif self.column + 1 + len(value) < self.WRAP_LENGTH:
+                self.out.write(' ' + value)
+                self.column += 1 + len(value)
+            else:
+                self.out.write('\n' + self.INDENT + value)
+                self.column = len(self.INDENT) + len(value)
+        self.out.write('\n')
+        self.column = 0
+
+
+def write_header(out, nets):
+    guard = 'SRC_' + os.path.basename(out.name).upper().replace('.', '_') + '_'
+    out.write(license_header)
+    out.write('// Generated by huginToCpp.py; edit the net files instead\n\n')
+    out.write('#ifndef ' + guard + '\n#define ' + guard + '\n\n')
+    out.write('#include "BayesNetDescription.hpp"\n')
+    for net in nets:
+        out.write('\n/**\n * The network from '
+            + os.path.basename(net.file_name) + '.\n */\n')
+        out.write('struct ' + net.struct + '\n{\n')
+        out.write('    enum NODE\n    {\n')
+        for node in net.nodes:
+            out.write('        ' + node.name + ',\n')
+        out.write('        NODES_COUNT\n    };\n\n')
+        out.write('    enum NODE_STATES\n    {\n')
+        for i, node in enumerate(net.nodes):
+            out.write('        ' + node.name + 'States = '
+                + str(len(node.states))
+                + (',' if i + 1 < len(net.nodes) else '') + '\n')
+        out.write('    };\n\n')
+        out.write('    static const BayesNetDescription description;\n')
+        for table in net.tables:
+            root = net.nodes[table.node]
+            out.write('    /// The probability of ' + root.name + ' being '
+                + root.states[table.state].strip('"') + '\n')
+            out.write('    static const BayesTableDescription '
+                + table.member + ';\n')
+        out.write('};\n')
+    out.write('\n#endif  // ' + guard + '\n')
+
+
+def write_table(out, table):
+    net = table.net
+    prefix = table.prefix
+    root_states = table.states_count(table.node)
+
+    def name(node):
+        return 'Net::' + net.nodes[node].name
+
+    out.write('\nstatic const int ' + prefix + 'Evidence[] = {\n')
+    PrintWrapper(out).write(
+        [net.struct + '::' + net.nodes[n].name for n in table.evidence])
+    out.write('};\n')
+    for group, (nodes, combinations) in enumerate(table.groups):
+        numbers = []
+        for states in itertools.product(
+                *[range(table.states_count(n)) for n in nodes]):
+            if states in combinations:
+                numbers.append(str(combinations.index(states)))
+            else:
+                numbers.append('UNREACHABLE')
+        out.write('\nstatic const unsigned char ' + prefix + 'Group'
+            + str(group) + '[] = {\n')
+        PrintWrapper(out).write(numbers)
+        out.write('};\n')
+    for part, (digits, likelihoods) in enumerate(table.parts):
+        out.write('\nstatic const double ' + prefix + 'Part' + str(part)
+            + '[] = {\n')
+        PrintWrapper(out).write([repr(l) for l in likelihoods])
+        out.write('};\n')
+
+    out.write('\nstatic double ' + prefix + 'Probability(\n'
+        + '    const int states[]\n)\n{\n')
+    out.write('    typedef ' + net.struct + ' Net;\n')
+    out.write('    double likelihoods[] = {\n')
+    PrintWrapper(out, indent='        ').write(
+        net.nodes[table.node].probabilities)
+    out.write('    };\n')
+    if len(table.groups) > 0:
+        out.write('    int combination;\n')
+    out.write('    int index;\n')
+    for part, (digits, likelihoods) in enumerate(table.parts):
+        out.write('\n')
+        for d, (nodes, combinations, group) in enumerate(digits):
+            if group == None:
+                value = 'states[' + name(nodes[0]) + ']'
+            else:
+                # The nodes' states are counted like the digits of a number
+                out.write('    combination = states[' + name(nodes[0])
+                    + '];\n')
+                for n in nodes[1:]:
+                    out.write('    combination = combination * '
+                        + str(table.states_count(n)) + ' + states['
+                        + name(n) + '];\n')
+                out.write('    combination = ' + prefix + 'Group' + str(group)
+                    + '[combination];\n')
+                out.write('    assert(UNREACHABLE != combination);\n')
+                value = 'combination'
+            if d == 0:
+                out.write('    index = ' + value + ';\n')
+            else:
+                out.write('    index = index * ' + str(len(combinations))
+                    + ' + ' + value + ';\n')
+        out.write('    multiply(\n        likelihoods,\n')
+        out.write('        &' + prefix + 'Part' + str(part) + '[index * '
+            + str(root_states) + '],\n')
+        out.write('        ' + str(root_states) + '\n    );\n')
+    out.write('\n    return normalize(likelihoods, ' + str(root_states) + ', '
+        + str(table.state) + ');\n}\n')
+
+    out.write('\nconst BayesTableDescription ' + net.struct + '::'
+        + table.member + ' = {\n')
+    out.write('    ' + net.struct + '::' + net.nodes[table.node].name + ',\n')
+    out.write('    ' + str(table.state) + ',\n')
+    out.write('    ' + str(len(table.evidence)) + ',\n')
+    out.write('    ' + prefix + 'Evidence,\n')
+    out.write('    ' + prefix + 'Probability\n};\n')
+
+
+def write_source(out, header, nets):
+    out.write(license_header)
+    out.write('// Generated by huginToCpp.py; edit the net files instead\n\n')
+    out.write('#include "' + header + '"\n')
+    if any(len(net.tables) > 0 for net in nets):
+        out.write("""
+#include <cassert>
+
+static const unsigned char UNREACHABLE = """ + str(UNREACHABLE) + """;
+
+/**
+ * Multiplies the likelihoods of the states of a root node by the ones from
+ * a part of its evidence.
+ */
+static void multiply(double likelihoods[], const double part[], int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        likelihoods[i] *= part[i];
+    }
+}
+
+/**
+ * Returns the probability of a state of a root node from the likelihoods of
+ * all of its states.
+ */
+static double normalize(const double likelihoods[], int count, int state)
+{
+    double total = 0.0;
+    for (int i = 0; i < count; ++i)
+    {
+        total += likelihoods[i];
+    }
+    assert(total > 0.0);
+    return likelihoods[state] / total;
+}
+""")
+    for net in nets:
+        prefix = net.variable
+        names = ['"' + node.name + '"' for node in net.nodes]
+        states = [str(len(node.states)) for node in net.nodes]
+        parents = []
+        parents_offsets = ['0']
+        probabilities = []
+        probabilities_offsets = ['0']
+        for node in net.nodes:
+            parents.extend(str(parent) for parent in node.parents)
+            parents_offsets.append(str(len(parents)))
+            probabilities.extend(node.probabilities)
+            probabilities_offsets.append(str(len(probabilities)))
+        # Arrays can't be empty, and a network might not have any edges
+        parents.append('-1')
+
+        arrays = [
+            ('const char* const', 'NodeNames', names),
+            ('const unsigned int', 'StatesCounts', states),
+            ('const int', 'ParentsOffsets', parents_offsets),
+            ('const int', 'Parents', parents),
+            ('const int', 'ProbabilitiesOffsets', probabilities_offsets),
+            ('const double', 'Probabilities', probabilities),
+        ]
+        for declaration, name, values in arrays:
+            out.write('\nstatic ' + declaration + ' ' + prefix + name
+                + '[] = {\n')
+            PrintWrapper(out).write(values)
+            out.write('};\n')
+
+        out.write('\nconst BayesNetDescription ' + net.struct
+            + '::description = {\n')
+        out.write('    "' + os.path.basename(net.file_name) + '",\n')
+        out.write('    ' + net.struct + '::NODES_COUNT,\n')
+        for i, (declaration, name, values) in enumerate(arrays):
+            out.write('    ' + prefix + name
+                + (',' if i + 1 < len(arrays) else '') + '\n')
+        out.write('};\n')
+
+        for table in net.tables:
+            write_table(out, table)
+
+
+def main(arguments):
+    if len(arguments) < 2:
+        sys.stderr.write(
+            'Usage: huginToCpp.py <output name> <net file>...\n')
+        return 1
+
+    output = arguments[0]
+    nets = []
+    for file_name in arguments[1:]:
+        net = Net(file_name)
+        try:
+            inf = open(file_name)
+            text = inf.read()
+            inf.close()
+            parse_net(net, text)
+            check_net(net)
+            net.tables = [Table(net, member, node, state, evidence)
+                for variable, member, node, state, evidence in TABLES
+                if variable == net.variable]
+        except (IOError, NetError) as e:
+            sys.stderr.write(file_name + ': ' + str(e) + '\n')
+            return 1
+        nets.append(net)
+
+    header = output + '.hpp'
+    out = open(header, 'w')
+    write_header(out, nets)
+    out.close()
+    out = open(output + '.cpp', 'w')
+    write_source(out, os.path.basename(header), nets)
+    out.close()
+    return 0
+
+sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,242 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Benchmarks the IdentifierClassifier that QueryRisk uses to check function,
+ * database and table names against the regular expressions that it used
+ * before, and prints how long each takes per identifier.
+ * @author Brandon Skari
+ * @date October 17 2026
+ */
+
+#include "IdentifierClassifier.hpp"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/program_options.hpp>
+#include <boost/regex.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+using boost::regex;
+using boost::regex_search;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+namespace options = boost::program_options;
+
+static options::options_description getOptions();
+static double timeRegexes(const vector<string>& names, size_t repeat);
+static double timeClassifier(const vector<string>& names, size_t repeat);
+
+/**
+ * Names from the queries in tests/queries, plus the keywords themselves.
+ */
+static const char* const NAMES[] = {
+    "page", "revision", "text", "user", "user_groups", "recentchanges",
+    "watchlist", "categorylinks", "wp_users", "customers", "orders",
+    "sessions", "count", "max", "concat", "substring", "if", "version",
+    "benchmark", "last_insert_id", "information_schema", "mysql", "lower",
+    "unix_timestamp", "ifnull"
+};
+
+/**
+ * Keeps the compiler from throwing the results away.
+ */
+static volatile unsigned int sink;
+
+
+int main(int argc, char* argv[])
+{
+    options::variables_map vm;
+    const options::options_description visibleOptions(getOptions());
+    try
+    {
+        store(
+            options::command_line_parser(
+                argc,
+                argv
+            ).options(visibleOptions).run(),
+            vm
+        );
+        notify(vm);
+    }
+    catch (std::exception& e)
+    {
+        cerr << e.what() << '\n' << visibleOptions << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (vm.count("help"))
+    {
+        cout << visibleOptions << endl;
+        exit(EXIT_SUCCESS);
+    }
+
+    const size_t repeat = vm["repeat"].as<size_t>();
+    if (0 == repeat)
+    {
+        cerr << "Counts need to be positive\n" << visibleOptions << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const vector<string> names(
+        NAMES,
+        NAMES + sizeof(NAMES) / sizeof(NAMES[0])
+    );
+
+    // Warm up the caches before timing anything
+    timeRegexes(names, 1);
+    timeClassifier(names, 1);
+
+    const double regexSeconds = timeRegexes(names, repeat);
+    const double classifierSeconds = timeClassifier(names, repeat);
+
+    // Each name is checked as a function, a database and a table
+    const size_t totalNames = 3 * names.size() * repeat;
+    cout << "Identifiers: " << totalNames << '\n'
+        << "Regex nanoseconds per identifier: "
+        << regexSeconds * 1000000000.0 / totalNames << '\n'
+        << "Classifier nanoseconds per identifier: "
+        << classifierSeconds * 1000000000.0 / totalNames << '\n'
+        << "Speedup: " << regexSeconds / classifierSeconds << 'x' << endl;
+
+    return 0;
+}
+
+
+/**
+ * Command line options.
+ */
+options::options_description getOptions()
+{
+    options::options_description cli("Options");
+    cli.add_options()
+        (
+            "help",
+            "Print help message"
+        )
+        (
+            "repeat,r",
+            options::value<size_t>()->default_value(100000),
+            "The number of times to go through the names."
+        );
+    return cli;
+}
+
+
+/**
+ * Checks the names the way that QueryRisk used to and returns how long it
+ * took.
+ */
+double timeRegexes(const vector<string>& names, const size_t repeat)
+{
+    const regex bruteForceCommandsRegex(
+        "^(mid|substr|substring|load_file|char)$",
+        regex::perl | regex::icase);
+    const regex stringManipulationRegex(
+        "^(concat|concatws|char|insert|hex|mid|replace|reverse|substr|"
+            "substring)$",
+        regex::perl | regex::icase);
+    const regex userStatementsRegex(
+        "^(current_user|session_user|system_user|user)$",
+        regex::perl | regex::icase);
+    const regex fingerprintingRegex(
+        "^(schema|database|version|connection_id|last_insert_id|row_count)$",
+        regex::perl | regex::icase);
+    const regex benchmarkRegex("^benchmark$", regex::perl | regex::icase);
+    const regex ifRegex("^if$", regex::perl | regex::icase);
+    const regex informationSchemaRegex(
+        "^(information_schema|mysql)$", regex::perl | regex::icase);
+    const regex sensitiveTablesRegex(
+        ".*(customer|member|order|admin|user|permission|session).*",
+        regex::perl | regex::icase);
+    const regex userTableRegex(
+        "(user|customer|member)", regex::perl | regex::icase);
+
+    unsigned int found = 0;
+    const ptime start(microsec_clock::universal_time());
+    for (size_t i = 0; i < repeat; ++i)
+    {
+        for (size_t j = 0; j < names.size(); ++j)
+        {
+            const string& name = names[j];
+            // The same checks, in the same order, as QueryRisk::checkFunction
+            if (regex_search(name, bruteForceCommandsRegex))
+                ++found;
+            if (regex_search(name, stringManipulationRegex))
+                ++found;
+            else if (regex_search(name, userStatementsRegex))
+                ++found;
+            else if (regex_search(name, fingerprintingRegex))
+                ++found;
+            else if (regex_search(name, benchmarkRegex))
+                ++found;
+            else if (regex_search(name, ifRegex))
+                ++found;
+            if (regex_search(name, informationSchemaRegex))
+                ++found;
+            if (regex_search(name, sensitiveTablesRegex))
+                ++found;
+            if (regex_search(name, userTableRegex))
+                ++found;
+        }
+    }
+    const ptime end(microsec_clock::universal_time());
+    sink = found;
+    return (end - start).total_microseconds() / 1000000.0;
+}
+
+
+/**
+ * Checks the names with the classifier and returns how long it took.
+ */
+double timeClassifier(const vector<string>& names, const size_t repeat)
+{
+    unsigned int found = 0;
+    const ptime start(microsec_clock::universal_time());
+    for (size_t i = 0; i < repeat; ++i)
+    {
+        for (size_t j = 0; j < names.size(); ++j)
+        {
+            const string& name = names[j];
+            // Functions and databases share the keyword table
+            found += IdentifierClassifier::classifyName(
+                name.data(),
+                name.size()
+            );
+            found += IdentifierClassifier::classifyName(
+                name.data(),
+                name.size()
+            );
+            found += IdentifierClassifier::classifyTable(
+                name.data(),
+                name.size()
+            );
+        }
+    }
+    const ptime end(microsec_clock::universal_time());
+    sink = found;
+    return (end - start).total_microseconds() / 1000000.0;
+}
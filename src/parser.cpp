@@ -19,11 +19,14 @@
  */
 
 #include "AstNode.hpp"
+#include "GlrStatistics.hpp"
 #include "Logger.hpp"
+#include "nullptr.hpp"
 #include "ParserInterface.hpp"
 #include "QueryRisk.hpp"
 #include "SensitiveNameChecker.hpp"
 
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -38,6 +41,11 @@ using std::string;
 
 /**
  * Parses MySQL queries. Testing code for parser.y
+ * Usage: parser [--statistics] [--fast-parser] [file]
+ * --statistics counts the GLR parser's stack splits and merges for each rule
+ * and prints them at the end; --fast-parser tries the deterministic fast
+ * parser on each query first and only hands the ones it rejects to the GLR
+ * parser.
  * @author Brandon Skari
  * @date November 29 2010
  */
@@ -50,17 +58,39 @@ int main(int argc, char* argv[])
     SensitiveNameChecker::get().setPasswordSubstring("password");
     SensitiveNameChecker::get().setUserSubstring("user");
     bool file = false;
+    bool statistics = false;
+    const char* fileName = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == strcmp(argv[i], "--statistics"))
+        {
+            statistics = true;
+        }
+        else if (0 == strcmp(argv[i], "--fast-parser"))
+        {
+            ParserInterface::setFastParser(true);
+        }
+        else
+        {
+            fileName = argv[i];
+        }
+    }
+    if (statistics)
+    {
+        GlrStatistics::enable();
+    }
 
     ifstream fin;
-    if (argc > 1)
+    if (nullptr != fileName)
     {
-        fin.open(argv[1]);
+        fin.open(fileName);
         file = true;
     }
     istream& stream = (fin.is_open() ? fin : cin);
-    if (argc > 1 && !fin)
+    if (nullptr != fileName && !fin)
     {
-        cerr << "Unable to open file '" << argv[1] << "', aborting" << endl;
+        cerr << "Unable to open file '" << fileName << "', aborting" << endl;
         return 0;
     }
 
@@ -105,5 +135,13 @@ int main(int argc, char* argv[])
             }
         }
     }
+
+    if (statistics)
+    {
+        cerr << "Fast parses: " << ParserInterface::getFastParseCount()
+            << "\nGLR parses: " << ParserInterface::getGlrParseCount()
+            << endl;
+        GlrStatistics::print(cerr);
+    }
     return 0;
 }
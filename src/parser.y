@@ -36,6 +36,9 @@
 %code requires
 {
     #include "AstNode.hpp"
+    // The LALR parser declares yyparse before the prologue
+    class ParserInterface;
+    class QueryRisk;
 }
 
 %union
@@ -182,6 +185,16 @@
 %left BITWISE_OR
 %left BITWISE_XOR
 %left UNARY
+/*
+ * The fast deterministic parser built from this grammar gives this token
+ * and the lookaheads of the grammar's shift/reduce conflicts one
+ * non-associative precedence, and the rules that are marked with it below
+ * are the reductions in those conflicts. That turns every conflict into a
+ * syntax error, so instead of the fast parser picking one reading of the
+ * query, the query is handed to the GLR parser. The token has no
+ * precedence here, so the GLR parser still tries both readings.
+ */
+%token FAST_PARSER_CONFLICT
 
 %{
 #include "AlwaysSomethingNode.hpp"
@@ -202,6 +215,21 @@ class ScannerContext;
 
 typedef void* const yyscan_t;
 
+// Keep the GLR stacks' memory between queries
+#define YYMALLOC ParserInterface::allocateStack
+#define YYREALLOC ParserInterface::reallocateStack
+#define YYFREE ParserInterface::freeStack
+// Ambiguous queries split the GLR stack, and every split stack takes items
+// from here, so this limits how much work they can make the parser do
+#define YYMAXDEPTH \
+    static_cast<std::ptrdiff_t>(ParserInterface::getBudget().maxStackItems)
+
+#ifdef GLR_STATISTICS
+    #include "GlrStatistics.hpp"
+    // Count the splits and merges in the trace instead of printing it
+    #define YYFPRINTF GlrStatistics::trace
+#endif
+
 /* These declarations are needed so the compiler doesn't barf */
 int yylex(
     YYSTYPE* lvalp,
@@ -213,17 +241,14 @@ void yyerror(
     yyscan_t scanner,
     const char* const s
 );
-void checkIdentifierComparison(
+static void checkIdentifierComparison(
     AstNode** const node,
     const AstNode* const expr,
     const int compareType,
     const AstNode* const field,
-    QueryRisk* const qr
+    QueryRisk* const qr,
+    ParserInterface* const pi
 );
-extern char* yytext;
-
-std::stack<AstNode*> valuesList;
-std::stack<bool> isValuesListStack;
 
 const int OTHER_COMPARISON = 0;
 const int LIKE_COMPARISON = 1;
@@ -381,18 +406,15 @@ selectItem:
             pi->scannerContext_.identifiers.pop();
         }
     | expression
-        {
-            delete $1;
-        }
+        {}
     | expression AS identifier
         {
             pi->scannerContext_.identifiers.pop();
-            delete $1;
         }
     | GLOBAL_VARIABLE DOT identifier
         {
             ++qr->globalVariables;
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
             identifiers.pop();
             identifiers.pop();
         }
@@ -403,12 +425,9 @@ selectItem:
             pi->scannerContext_.identifiers.pop();
         }
     | comparison
-        {
-            delete $1;
-        }
+        {}
     | comparison AS identifier
         {
-            delete $1;
             pi->scannerContext_.identifiers.pop();
         }
     ;
@@ -425,18 +444,13 @@ subSelect:
     ;
 
 subSelect2:
-    SELECT expression
-        {
-            delete $2;
-        }
+    SELECT expression %prec FAST_PARSER_CONFLICT
+        {}
     | SELECT expression FROM table
-        {
-            delete $2;
-        }
+        {}
     | SELECT expression AS identifier FROM tableList optionalWhere
         {
             pi->scannerContext_.identifiers.pop();
-            delete $2;
         }
     ;
 
@@ -454,7 +468,7 @@ tableOptionalWild:
         }
     | identifier DOT identifier optionalWild optionalTableAlias
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
             identifiers.pop();
             identifiers.pop();
         }
@@ -474,7 +488,7 @@ tableWild:
         }
     | identifier DOT identifier DOT ASTERISK
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
             identifiers.pop();
             identifiers.pop();
         }
@@ -483,17 +497,17 @@ tableWild:
 table:
     identifier
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
-            qr->checkTable(identifiers.top());
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
+            qr->checkTable(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
         }
     | identifier DOT identifier
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
             // It's a stack, so check in reverse order
-            qr->checkTable(identifiers.top());
+            qr->checkTable(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
-            qr->checkDatabase(identifiers.top());
+            qr->checkDatabase(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
         }
     | identifier DOT ASTERISK
@@ -507,9 +521,9 @@ table:
     | /* aliased */
         identifier identifier
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
             identifiers.pop();
-            qr->checkTable(identifiers.top());
+            qr->checkTable(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
         }
     ;
@@ -528,41 +542,44 @@ optionalTableAlias:
     ;
 
 simpleIdentifier:
-    identifier
+    identifier %prec FAST_PARSER_CONFLICT
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
-            $$ = new ExpressionNode(identifiers.top(), true);
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
+            $$ = pi->arena_.create<ExpressionNode>(
+                identifiers.top().str(), true);
             identifiers.pop();
         }
     | identifier DOT identifier
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
-            const std::string field(identifiers.top());
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
+            const std::string field(identifiers.top().str());
             identifiers.pop();
-            const std::string fullIdentifier(identifiers.top() + "." + field);
+            const std::string fullIdentifier(
+                identifiers.top().str() + "." + field);
             identifiers.pop();
-            $$ = new ExpressionNode(fullIdentifier, true);
+            $$ = pi->arena_.create<ExpressionNode>(fullIdentifier, true);
         }
     | DOT identifier DOT identifier
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
-            const std::string field(identifiers.top());
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
+            const std::string field(identifiers.top().str());
             identifiers.pop();
-            const std::string fullIdentifier(identifiers.top() + "." + field);
+            const std::string fullIdentifier(
+                identifiers.top().str() + "." + field);
             identifiers.pop();
-            $$ = new ExpressionNode(fullIdentifier, true);
+            $$ = pi->arena_.create<ExpressionNode>(fullIdentifier, true);
         }
     | identifier DOT identifier DOT identifier
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
-            const std::string field(identifiers.top());
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
+            const std::string field(identifiers.top().str());
             identifiers.pop();
-            const std::string table(identifiers.top());
+            const std::string table(identifiers.top().str());
             identifiers.pop();
             const std::string fullIdentifier(
-                identifiers.top() + "." + table + "." + field);
+                identifiers.top().str() + "." + table + "." + field);
             identifiers.pop();
-            $$ = new ExpressionNode(fullIdentifier, true);
+            $$ = pi->arena_.create<ExpressionNode>(fullIdentifier, true);
         }
     ;
 
@@ -574,15 +591,15 @@ identifier:
         }
     | LANGUAGE
         {
-            pi->scannerContext_.identifiers.push("language");
+            pi->scannerContext_.identifiers.push(Lexeme("language"));
         }
     | QUERY
         {
-            pi->scannerContext_.identifiers.push("query");
+            pi->scannerContext_.identifiers.push(Lexeme("query"));
         }
     | TABLES
         {
-            pi->scannerContext_.identifiers.push("tables");
+            pi->scannerContext_.identifiers.push(Lexeme("tables"));
         }
     ;
 
@@ -609,7 +626,10 @@ conditionalList:
                 qr->alwaysTrue = list->isAlwaysTrue();
                 qr->alwaysTrueConditional = list->anyIsAlwaysTrue();
                 qr->emptyPassword = list->emptyPassword();
-                delete list;
+                if (list->isLiteralSensitive())
+                {
+                    pi->literalSensitive_ = true;
+                }
             }
         }
     ;
@@ -621,20 +641,20 @@ conditionalList2:
         }
     | conditionalList2 AND conditionalList2
         {
-            $$ = new ConditionalListNode('&');
+            $$ = pi->arena_.create<ConditionalListNode>('&');
             $$->addChild($1);
             $$->addChild($3);
         }
     | conditionalList2 OR conditionalList2
         {
             ++qr->orStatements;
-            $$ = new ConditionalListNode('|');
+            $$ = pi->arena_.create<ConditionalListNode>('|');
             $$->addChild($1);
             $$->addChild($3);
         }
     | conditionalList2 XOR conditionalList2
         {
-            $$ = new ConditionalListNode('^');
+            $$ = pi->arena_.create<ConditionalListNode>('^');
             $$->addChild($1);
             $$->addChild($3);
         }
@@ -656,21 +676,21 @@ conditional:
             assert(NULL != expr);
             // The value from inValuesList is true if it was a regular list,
             // and false if it was a subselect
-            bool isValuesList = isValuesListStack.top();
-            isValuesListStack.pop();
+            bool isValuesList = pi->isValuesListStack_.top();
+            pi->isValuesListStack_.pop();
             if (isValuesList)
             {
-                $$ = new InValuesListNode(true, expr);
+                $$ = pi->arena_.create<InValuesListNode>(true, expr);
 
-                while (!valuesList.empty())
+                while (!pi->valuesList_.empty())
                 {
-                    $$->addChild(valuesList.top());
-                    valuesList.pop();
+                    $$->addChild(pi->valuesList_.top());
+                    pi->valuesList_.pop();
                 }
             }
             else // Subselect
             {
-                $$ = new InSubselectNode(expr);
+                $$ = pi->arena_.create<InSubselectNode>(expr);
             }
         }
     | expression NOT IN inValuesList
@@ -678,24 +698,26 @@ conditional:
             const ExpressionNode* const expr =
                 dynamic_cast<const ExpressionNode*>($1);
             assert(NULL != expr);
-            $$ = new InValuesListNode(false, expr);
-            while (!valuesList.empty())
+            $$ = pi->arena_.create<InValuesListNode>(false, expr);
+            while (!pi->valuesList_.empty())
             {
-                $$->addChild(valuesList.top());
-                valuesList.pop();
+                $$->addChild(pi->valuesList_.top());
+                pi->valuesList_.pop();
             }
         }
     | expression BETWEEN expression AND expression
         {
             // Between expects the lower expression to be first
             // If it's not, then MySQL just returns false
-            $$ = new ConditionalListNode('&');
+            $$ = pi->arena_.create<ConditionalListNode>('&');
 
-            ComparisonNode* const first = new ComparisonNode(">=");
+            ComparisonNode* const first =
+                pi->arena_.create<ComparisonNode>(">=");
             first->addChild($1);
             first->addChild($3);
 
-            ComparisonNode* const second = new ComparisonNode("<=");
+            ComparisonNode* const second =
+                pi->arena_.create<ComparisonNode>("<=");
             second->addChild($1);
             second->addChild($5);
 
@@ -706,15 +728,15 @@ conditional:
         {
             /// @TODO figure out if I need to do something here
             /// In the meantime, just simulate that it's not always true
-            $$ = new AlwaysSomethingNode(false, "=");
+            $$ = pi->arena_.create<AlwaysSomethingNode>(false, "=");
             $$->addChild($7);
             // Comparison Nodes are always required to have 2 children, so for
             // now, until I fix this to be something better, just simulate it
             // so it doesn't crash elsewhere
-            $$->addChild(new ExpressionNode("NULL", false));
+            $$->addChild(pi->arena_.create<ExpressionNode>("NULL", false));
         }
     | /* Because 'WHERE 1' is a valid conditional */
-        expression
+        expression %prec FAST_PARSER_CONFLICT
         {
             $$ = $1;
         }
@@ -722,13 +744,9 @@ conditional:
 
 expressionList:
     expression
-        {
-            delete $1;
-        }
+        {}
     | expression COMMA expressionList
-        {
-            delete $1;
-        }
+        {}
     ;
 
 expression:
@@ -744,84 +762,84 @@ expression:
         the precedence of all the operators */
     expression PLUS expression
         {
-            $$ = new ExpressionNode();
+            $$ = pi->arena_.create<ExpressionNode>();
             $$->addChild($1);
-            $$->addChild(new AstNode("+"));
+            $$->addChild(pi->arena_.create<AstNode>("+"));
             $$->addChild($3);
         }
     | expression MINUS expression
         {
-            $$ = new ExpressionNode();
+            $$ = pi->arena_.create<ExpressionNode>();
             $$->addChild($1);
-            $$->addChild(new AstNode("-"));
+            $$->addChild(pi->arena_.create<AstNode>("-"));
             $$->addChild($3);
         }
     | expression ASTERISK expression
         {
-            $$ = new ExpressionNode();
+            $$ = pi->arena_.create<ExpressionNode>();
             $$->addChild($1);
-            $$->addChild(new AstNode("*"));
+            $$->addChild(pi->arena_.create<AstNode>("*"));
             $$->addChild($3);
         }
     | expression DIVIDE expression
         {
-            $$ = new ExpressionNode();
+            $$ = pi->arena_.create<ExpressionNode>();
             $$->addChild($1);
-            $$->addChild(new AstNode("/"));
+            $$->addChild(pi->arena_.create<AstNode>("/"));
             $$->addChild($3);
         }
     | expression INTEGER_DIVIDE expression
         {
-            $$ = new ExpressionNode();
+            $$ = pi->arena_.create<ExpressionNode>();
             $$->addChild($1);
-            $$->addChild(new AstNode("DIV"));
+            $$->addChild(pi->arena_.create<AstNode>("DIV"));
             $$->addChild($3);
         }
     | expression MODULO expression
         {
-            $$ = new ExpressionNode();
+            $$ = pi->arena_.create<ExpressionNode>();
             $$->addChild($1);
-            $$->addChild(new AstNode("MOD"));
+            $$->addChild(pi->arena_.create<AstNode>("MOD"));
             $$->addChild($3);
         }
     | expression BITWISE_AND expression
         {
-            $$ = new ExpressionNode();
+            $$ = pi->arena_.create<ExpressionNode>();
             $$->addChild($1);
-            $$->addChild(new AstNode("&"));
+            $$->addChild(pi->arena_.create<AstNode>("&"));
             $$->addChild($3);
         }
     | expression BITWISE_OR expression
         {
-            $$ = new ExpressionNode();
+            $$ = pi->arena_.create<ExpressionNode>();
             $$->addChild($1);
-            $$->addChild(new AstNode("|"));
+            $$->addChild(pi->arena_.create<AstNode>("|"));
             $$->addChild($3);
         }
     | expression BITWISE_XOR expression
         {
-            $$ = new ExpressionNode();
+            $$ = pi->arena_.create<ExpressionNode>();
             $$->addChild($1);
-            $$->addChild(new AstNode("^"));
+            $$->addChild(pi->arena_.create<AstNode>("^"));
             $$->addChild($3);
         }
     | expression LEFT_BIT_SHIFT expression
         {
-            $$ = new ExpressionNode();
+            $$ = pi->arena_.create<ExpressionNode>();
             $$->addChild($1);
-            $$->addChild(new AstNode("<<"));
+            $$->addChild(pi->arena_.create<AstNode>("<<"));
             $$->addChild($3);
         }
     | expression RIGHT_BIT_SHIFT expression
         {
-            $$ = new ExpressionNode();
+            $$ = pi->arena_.create<ExpressionNode>();
             $$->addChild($1);
-            $$->addChild(new AstNode(">>"));
+            $$->addChild(pi->arena_.create<AstNode>(">>"));
             $$->addChild($3);
         }
     | NOT expression
         {
-            $$ = new NegationNode();
+            $$ = pi->arena_.create<NegationNode>();
             $$->addChild($2);
         }
     ;
@@ -838,52 +856,49 @@ simpleExpression:
     | /* function */
         identifier LEFT_PARENTHESE optionalDistinct expressionList RIGHT_PARENTHESE
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
             /// @TODO I should probably handle a bunch of possible functions here
             /// Like, IF (1, 1, 0) should always be true
-            $$ = new ExpressionNode(" ", false);
-            qr->checkFunction(identifiers.top());
+            $$ = pi->arena_.create<ExpressionNode>(" ", false);
+            qr->checkFunction(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
         }
     | /* function, such as VERSION() */
         identifier LEFT_PARENTHESE RIGHT_PARENTHESE
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
             /// @TODO I should probably handle a bunch of possible functions here
             /// Like, IF (1, 1, 0) should always be true
-            $$ = new ExpressionNode(" ", false);
-            qr->checkFunction(identifiers.top());
+            $$ = pi->arena_.create<ExpressionNode>(" ", false);
+            qr->checkFunction(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
         }
     | /* function, such as COUNT(*) */
         identifier LEFT_PARENTHESE ASTERISK RIGHT_PARENTHESE
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
             /// @TODO I should probably handle a bunch of possible functions here
             /// Like, IF (1, 1, 0) should always be true
-            $$ = new ExpressionNode(" ", false);
-            qr->checkFunction(identifiers.top());
+            $$ = pi->arena_.create<ExpressionNode>(" ", false);
+            qr->checkFunction(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
         }
     | /* there is an INSERT function for inserting into strings */
         INSERT LEFT_PARENTHESE expression COMMA number COMMA number COMMA expression RIGHT_PARENTHESE
         {
-            delete $3;
-            delete $5;
-            delete $9;
             $$ = NULL;
         }
     | GLOBAL_VARIABLE
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
             ++qr->globalVariables;
-            $$ = new ExpressionNode(identifiers.top(), false);
+            $$ = pi->arena_.create<ExpressionNode>(
+                identifiers.top().str(), false);
             identifiers.pop();
         }
     | /* MySQL has some weird date things, like "INTERVAL 30 DAY" or "INTERVAL 120 MINUTE" */
         INTERVAL number IDENTIFIER
         {
-            delete $2;
             $$ = NULL;
             pi->scannerContext_.identifiers.pop();
         }
@@ -903,26 +918,28 @@ optionalDistinct:
 number:
     NUMBER
         {
-            std::stack<std::string>& numbers = pi->scannerContext_.numbers;
-            $$ = new ExpressionNode(numbers.top(), false);
+            std::stack<Lexeme>& numbers = pi->scannerContext_.numbers;
+            $$ = pi->arena_.create<ExpressionNode>(numbers.top().str(), false);
             numbers.pop();
         }
     | PLUS %prec UNARY NUMBER
         {
-            std::stack<std::string>& numbers = pi->scannerContext_.numbers;
-            $$ = new ExpressionNode(numbers.top(), false);
+            std::stack<Lexeme>& numbers = pi->scannerContext_.numbers;
+            $$ = pi->arena_.create<ExpressionNode>(numbers.top().str(), false);
             numbers.pop();
         }
     | MINUS %prec UNARY NUMBER
         {
-            std::stack<std::string>& numbers = pi->scannerContext_.numbers;
-            $$ = new ExpressionNode("-" + numbers.top(), false);
+            std::stack<Lexeme>& numbers = pi->scannerContext_.numbers;
+            $$ = pi->arena_.create<ExpressionNode>(
+                "-" + numbers.top().str(), false);
             numbers.pop();
         }
     | BITWISE_NEGATION %prec UNARY NUMBER
         {
-            std::stack<std::string>& numbers = pi->scannerContext_.numbers;
-            $$ = new ExpressionNode("~" + numbers.top(), false);
+            std::stack<Lexeme>& numbers = pi->scannerContext_.numbers;
+            $$ = pi->arena_.create<ExpressionNode>(
+                "~" + numbers.top().str(), false);
             numbers.pop();
         }
     ;
@@ -930,43 +947,43 @@ number:
 comparison:
     expression LESS expression
         {
-            $$ = new ComparisonNode("<");
+            $$ = pi->arena_.create<ComparisonNode>("<");
             $$->addChild($1);
             $$->addChild($3);
         }
     | expression GREATER expression
         {
-            $$ = new ComparisonNode(">");
+            $$ = pi->arena_.create<ComparisonNode>(">");
             $$->addChild($1);
             $$->addChild($3);
         }
     | expression LESS_EQUAL expression
         {
-            $$ = new ComparisonNode("<=");
+            $$ = pi->arena_.create<ComparisonNode>("<=");
             $$->addChild($1);
             $$->addChild($3);
         }
     | expression GREATER_EQUAL expression
         {
-            $$ = new ComparisonNode(">=");
+            $$ = pi->arena_.create<ComparisonNode>(">=");
             $$->addChild($1);
             $$->addChild($3);
         }
     | expression EQUAL expression
         {
-            $$ = new ComparisonNode("=");
+            $$ = pi->arena_.create<ComparisonNode>("=");
             $$->addChild($1);
             $$->addChild($3);
         }
     | expression NOT_EQUAL expression
         {
-            $$ = new ComparisonNode("!=");
+            $$ = pi->arena_.create<ComparisonNode>("!=");
             $$->addChild($1);
             $$->addChild($3);
         }
     | expression LIKE expression
         {
-            $$ = new ComparisonNode("like");
+            $$ = pi->arena_.create<ComparisonNode>("like");
             $$->addChild($1);
             $$->addChild($3);
 
@@ -975,10 +992,11 @@ comparison:
             assert(NULL != expr &&
                 "Expected ExpressionNode in LIKE statement");
             qr->checkRegex(expr->getValue());
+            pi->literalSensitive_ = true;
         }
     | expression NOT LIKE expression
         {
-            $$ = new ComparisonNode("not like");
+            $$ = pi->arena_.create<ComparisonNode>("not like");
             $$->addChild($1);
             $$->addChild($4);
 
@@ -987,30 +1005,31 @@ comparison:
             assert(NULL != expr &&
                 "Expected ExpressionNode in LIKE statement");
             qr->checkRegex(expr->getValue());
+            pi->literalSensitive_ = true;
         }
     | expression SOUNDS LIKE expression
         {
-            $$ = new ComparisonNode("sounds like");
+            $$ = pi->arena_.create<ComparisonNode>("sounds like");
             $$->addChild($1);
             $$->addChild($4);
         }
     | expression IS NULL_TOKEN
         {
-            $$ = new AlwaysSomethingNode(false, "=");
+            $$ = pi->arena_.create<AlwaysSomethingNode>(false, "=");
             $$->addChild($1);
-            $$->addChild(new ExpressionNode("NULL", false));
+            $$->addChild(pi->arena_.create<ExpressionNode>("NULL", false));
         }
     | expression EQUAL NULL_TOKEN
         {
-            $$ = new AlwaysSomethingNode(false, "=");
+            $$ = pi->arena_.create<AlwaysSomethingNode>(false, "=");
             $$->addChild($1);
-            $$->addChild(new ExpressionNode("NULL", false));
+            $$->addChild(pi->arena_.create<ExpressionNode>("NULL", false));
         }
     | expression IS NOT NULL_TOKEN
         {
-            $$ = new AlwaysSomethingNode(false, "!=");
+            $$ = pi->arena_.create<AlwaysSomethingNode>(false, "!=");
             $$->addChild($1);
-            $$->addChild(new ExpressionNode("NULL", false));
+            $$->addChild(pi->arena_.create<ExpressionNode>("NULL", false));
         }
     ;
 
@@ -1054,9 +1073,9 @@ anyComparison:
     ;
 
 tableList:
-    table
+    table %prec FAST_PARSER_CONFLICT
         {}
-    | table AS identifier
+    | table AS identifier %prec FAST_PARSER_CONFLICT
         {
             pi->scannerContext_.identifiers.pop();
         }
@@ -1127,18 +1146,11 @@ joinConditional:
     | joinConditional XOR joinConditional
         {}
     | expression anyComparison expression
-        {
-            delete $1;
-            delete $3;
-        }
+        {}
     | expression IN inValuesList
-        {
-            delete $1;
-        }
+        {}
     | expression NOT IN inValuesList
-        {
-            delete $1;
-        }
+        {}
     | LEFT_PARENTHESE joinConditional RIGHT_PARENTHESE
         {}
     ;
@@ -1152,15 +1164,11 @@ insertFields:
 
 fields:
     simpleIdentifier
-        {
-            delete $1;
-        }
+        {}
     | tableWild
         {}
     | simpleIdentifier COMMA fields
-        {
-            delete $1;
-        }
+        {}
     | tableWild COMMA fields
         {}
     ;
@@ -1186,12 +1194,12 @@ inValuesList:
         {
             // Save true to tell the caller that it was a values list (The
             // list values are stored in a vector that the caller will handle).
-            isValuesListStack.push(true);
+            pi->isValuesListStack_.push(true);
         }
     | LEFT_PARENTHESE select RIGHT_PARENTHESE
         {
             // Save false to tell the caller that it was a subselect
-            isValuesListStack.push(false);
+            pi->isValuesListStack_.push(false);
         }
     ;
 
@@ -1211,17 +1219,13 @@ inOptionalValues:
 
 values:
     expression
-        {
-            delete $1;
-        }
+        {}
     | DEFAULT
         {}
     | NULL_TOKEN
         {}
     | expression COMMA values
-        {
-            delete $1;
-        }
+        {}
     | DEFAULT COMMA values
         {}
     | NULL_TOKEN COMMA values
@@ -1231,11 +1235,11 @@ values:
 inValues:
     expression
         {
-            valuesList.push($1);
+            pi->valuesList_.push($1);
         }
     | expression COMMA inValues
         {
-            valuesList.push($1);
+            pi->valuesList_.push($1);
         }
     ;
 
@@ -1252,7 +1256,7 @@ optionalWhere:
     ;
 
 optionalIndex:
-    /* empty */
+    /* empty */ %prec FAST_PARSER_CONFLICT
         {}
     | USE indexOrKey LEFT_PARENTHESE indexList
         {}
@@ -1300,7 +1304,7 @@ optionalLimit:
         }
     | LIMIT NUMBER COMMA NUMBER
         {
-            std::stack<std::string>& numbers = pi->scannerContext_.numbers;
+            std::stack<Lexeme>& numbers = pi->scannerContext_.numbers;
             numbers.pop();
             numbers.pop();
         }
@@ -1321,7 +1325,7 @@ optionalFrom:
     ;
 
 optionalForUpdate:
-    /* empty */
+    /* empty */ %prec FAST_PARSER_CONFLICT
         {}
     | FOR UPDATE
         {}
@@ -1329,13 +1333,9 @@ optionalForUpdate:
 
 groupList:
     expression ascendingOrDescending
-        {
-            delete $1;
-        }
+        {}
     | expression ascendingOrDescending COMMA groupList
-        {
-            delete $1;
-        }
+        {}
     ;
 
 ascendingOrDescending:
@@ -1362,24 +1362,26 @@ selectInto:
 string:
     QUOTED_STRING
         {
-            std::stack<std::string>& quotedStrings = pi->scannerContext_.quotedStrings;
-            $$ = new ExpressionNode(quotedStrings.top(), false);
+            std::stack<Lexeme>& quotedStrings = pi->scannerContext_.quotedStrings;
+            $$ = pi->arena_.create<ExpressionNode>(
+                quotedStrings.top().str(), false);
             quotedStrings.pop();
         }
     | /* MySQL lets you append strings without using any kind of operator */
       /* Seriously... so 'a string' is the same as 'a ' 'str' 'ing' */
         QUOTED_STRING string
         {
-            std::stack<std::string>& quotedStrings = pi->scannerContext_.quotedStrings;
+            std::stack<Lexeme>& quotedStrings = pi->scannerContext_.quotedStrings;
             const ExpressionNode* const expr =
                 dynamic_cast<const ExpressionNode*>($2);
             assert(NULL != expr);
-            $$ = new ExpressionNode(
-                quotedStrings.top() + expr->getValue(), false);
-            delete $2;
+            $$ = pi->arena_.create<ExpressionNode>(
+                quotedStrings.top().str() + expr->getValue(), false);
             quotedStrings.pop();
 
             ++qr->mySqlStringConcat;
+            // Whether the joined string is a number depends on its parts
+            pi->literalSensitive_ = true;
         }
     ;
 
@@ -1434,7 +1436,6 @@ orderByGroupList:
             assert(NULL != expr &&
                 "ExpressionNode expected in orderByGroupList");
             qr->orderByNumber = expr->isNumber();
-            delete expr;
         }
     | expression ascendingOrDescending COMMA groupList
         {
@@ -1443,40 +1444,38 @@ orderByGroupList:
             assert(NULL != expr &&
                 "ExpressionNode expected in orderByGroupList");
             qr->orderByNumber = expr->isNumber();
-            delete expr;
         }
     ;
 
 joinTables:
     identifier
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
-            qr->checkTable(identifiers.top());
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
+            qr->checkTable(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
         }
     | identifier ON expression
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
-            qr->checkTable(identifiers.top());
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
+            qr->checkTable(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
-            delete $3;
         }
     | identifier USING LEFT_PARENTHESE usingList RIGHT_PARENTHESE
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
-            qr->checkTable(identifiers.top());
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
+            qr->checkTable(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
         }
     | identifier COMMA joinTables
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
-            qr->checkTable(identifiers.top());
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
+            qr->checkTable(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
         }
     | identifier normalJoin joinTables
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
-            qr->checkTable(identifiers.top());
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
+            qr->checkTable(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
         }
     ;
@@ -1531,22 +1530,20 @@ optionalHaving:
     /* empty */
         {}
     | HAVING conditional
-        {
-            delete $2;
-        }
+        {}
     ;
 
 usingList:
     identifier
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
-            qr->checkTable(identifiers.top());
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
+            qr->checkTable(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
         }
     | identifier COMMA usingList
         {
-            std::stack<std::string>& identifiers = pi->scannerContext_.identifiers;
-            qr->checkTable(identifiers.top());
+            std::stack<Lexeme>& identifiers = pi->scannerContext_.identifiers;
+            qr->checkTable(identifiers.top().text, identifiers.top().length);
             identifiers.pop();
         }
     ;
@@ -1598,18 +1595,11 @@ updateList:
 
 updateElement:
     simpleIdentifier EQUAL expression
-        {
-            delete $1;
-            delete $3;
-        }
+        {}
     | simpleIdentifier EQUAL DEFAULT
-        {
-            delete $1;
-        }
+        {}
     | simpleIdentifier EQUAL NULL_TOKEN
-        {
-            delete $1;
-        }
+        {}
     ;
 
 transactionStuff:
@@ -1636,14 +1626,17 @@ transactionStuff:
     /**
      * Checks the identifier comparisons for bad things.
      */
-    void checkIdentifierComparison(
+    static void checkIdentifierComparison(
         AstNode** const node,
         const AstNode* const expr,
         const int compareType,
         const AstNode* const field,
-        QueryRisk* const qr
+        QueryRisk* const qr,
+        ParserInterface* const pi
     )
     {
+        AstArena& arena = pi->arena_;
+
         // Normally comparing things from a table to an expression
         // won't always be true - but, if they use "LIKE '%' " or
         // "LIKE '_%' or "NOT LIKE 23482493" then we have a problem
@@ -1680,11 +1673,11 @@ transactionStuff:
             {
                 if (!like)
                 {
-                    *node = new AlwaysSomethingNode(true, "not like");
+                    *node = arena.create<AlwaysSomethingNode>(true, "not like");
                 }
                 else
                 {
-                    *node = new AlwaysSomethingNode(false, "like");
+                    *node = arena.create<AlwaysSomethingNode>(false, "like");
                 }
             }
             // Like with only special characters is bad: LIKE '%'
@@ -1694,22 +1687,23 @@ transactionStuff:
             {
                 if (like)
                 {
-                    *node = new AlwaysSomethingNode(true, "like");
+                    *node = arena.create<AlwaysSomethingNode>(true, "like");
                 }
                 else
                 {
-                    *node = new AlwaysSomethingNode(true, "not like");
+                    *node = arena.create<AlwaysSomethingNode>(true, "not like");
                 }
             }
             else
             {
                 if (like)
                 {
-                    *node = new AlwaysSomethingNode(false, "like");
+                    *node = arena.create<AlwaysSomethingNode>(false, "like");
                 }
                 else
                 {
-                    *node = new AlwaysSomethingNode(false, "not like");
+                    *node =
+                        arena.create<AlwaysSomethingNode>(false, "not like");
                 }
             }
 
@@ -1719,7 +1713,7 @@ transactionStuff:
         // It's not a like statement, so it should be ok
         else
         {
-            *node = new AlwaysSomethingNode(false, "=");
+            *node = arena.create<AlwaysSomethingNode>(false, "=");
         }
 
         // Add the two expressions so we can check for empty passwords
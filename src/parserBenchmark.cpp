@@ -0,0 +1,252 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Benchmarks the parser by parsing a file of queries over and over. It
+ * times setting up and tearing down a ParserInterface on its own, and then
+ * with the parse, so that the per-query setup cost can be compared with the
+ * cost of the parse itself.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "Logger.hpp"
+#include "ParserInterface.hpp"
+#include "QueryRisk.hpp"
+#include "SensitiveNameChecker.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+using boost::scoped_ptr;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::string;
+using std::vector;
+namespace options = boost::program_options;
+
+static options::options_description getOptions();
+static void runQueries(
+    const vector<string>* queries,
+    size_t repeat,
+    bool parse,
+    bool fresh
+);
+static double timeQueries(
+    const vector<string>& queries,
+    size_t repeat,
+    size_t threads,
+    bool parse,
+    bool fresh
+);
+
+
+int main(int argc, char* argv[])
+{
+    Logger::initialize();
+    SensitiveNameChecker::initialize();
+    SensitiveNameChecker::get().setPasswordSubstring("password");
+    SensitiveNameChecker::get().setUserSubstring("user");
+
+    options::variables_map vm;
+    const options::options_description visibleOptions(getOptions());
+    try
+    {
+        store(
+            options::command_line_parser(
+                argc,
+                argv
+            ).options(visibleOptions).run(),
+            vm
+        );
+        notify(vm);
+    }
+    catch (std::exception& e)
+    {
+        cerr << e.what() << '\n' << visibleOptions << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (vm.count("help"))
+    {
+        cout << visibleOptions << endl;
+        exit(EXIT_SUCCESS);
+    }
+
+    const string fileName(vm["file"].as<string>());
+    const size_t repeat = vm["repeat"].as<size_t>();
+    const size_t threads = vm["threads"].as<size_t>();
+    const bool fresh = vm.count("fresh") > 0;
+    if (0 == repeat || 0 == threads)
+    {
+        cerr << "Counts need to be positive\n" << visibleOptions << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    ifstream fin(fileName.c_str());
+    if (!fin)
+    {
+        cerr << "Unable to open file '" << fileName << "', aborting" << endl;
+        exit(EXIT_FAILURE);
+    }
+    vector<string> queries;
+    string query;
+    while (getline(fin, query))
+    {
+        if (!query.empty())
+        {
+            queries.push_back(query);
+        }
+    }
+    if (queries.empty())
+    {
+        cerr << "No queries in '" << fileName << "'" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Warm up the contexts and the allocator before timing anything
+    runQueries(&queries, 1, true, fresh);
+
+    const double setupSeconds =
+        timeQueries(queries, repeat, threads, false, fresh);
+    const double parseSeconds =
+        timeQueries(queries, repeat, threads, true, fresh);
+
+    const size_t totalQueries = queries.size() * repeat * threads;
+    cout << "Contexts: " << (fresh ? "fresh" : "reused") << '\n'
+        << "Threads: " << threads << '\n'
+        << "Queries: " << totalQueries << '\n'
+        << "Setup microseconds per query: "
+        << setupSeconds * 1000000.0 / totalQueries << '\n'
+        << "Parse microseconds per query: "
+        << parseSeconds * 1000000.0 / totalQueries << '\n'
+        << "Setup share of parse: "
+        << 100.0 * setupSeconds / parseSeconds << '%' << endl;
+
+    return 0;
+}
+
+
+/**
+ * Command line options.
+ */
+options::options_description getOptions()
+{
+    options::options_description cli("Options");
+    cli.add_options()
+        (
+            "help",
+            "Print help message"
+        )
+        (
+            "file,f",
+            options::value<string>()->default_value(
+                "../src/tests/queries/wikidb.sql"
+            ),
+            "A file with one query per line."
+        )
+        (
+            "repeat,r",
+            options::value<size_t>()->default_value(100),
+            "The number of times each thread goes through the queries."
+        )
+        (
+            "threads,t",
+            options::value<size_t>()->default_value(1),
+            "The number of threads parsing queries."
+        )
+        (
+            "fresh",
+            "Set up a new scanner and parser context for every query instead"
+            " of reusing the thread's."
+        );
+    return cli;
+}
+
+
+/**
+ * Goes through the queries repeat times, either just setting up and tearing
+ * down a ParserInterface for each one or parsing them too.
+ */
+void runQueries(
+    const vector<string>* const queries,
+    const size_t repeat,
+    const bool parse,
+    const bool fresh
+)
+{
+    // The thread's context is taken while another ParserInterface is using
+    // it, so each query gets a context of its own
+    scoped_ptr<ParserInterface> holder;
+    if (fresh)
+    {
+        holder.reset(new ParserInterface(""));
+    }
+
+    for (size_t i = 0; i < repeat; ++i)
+    {
+        for (size_t j = 0; j < queries->size(); ++j)
+        {
+            string query(queries->at(j));
+            ParserInterface parser(&query);
+            if (parse)
+            {
+                QueryRisk qr;
+                parser.parse(&qr);
+            }
+        }
+    }
+}
+
+
+/**
+ * Runs the queries on threads threads and returns how long it took.
+ */
+double timeQueries(
+    const vector<string>& queries,
+    const size_t repeat,
+    const size_t threads,
+    const bool parse,
+    const bool fresh
+)
+{
+    const ptime start(microsec_clock::universal_time());
+    boost::thread_group workers;
+    for (size_t i = 0; i < threads; ++i)
+    {
+        workers.create_thread(
+            boost::bind(runQueries, &queries, repeat, parse, fresh)
+        );
+    }
+    workers.join_all();
+    const ptime end(microsec_clock::universal_time());
+    return (end - start).total_microseconds() / 1000000.0;
+}
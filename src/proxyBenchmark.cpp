@@ -0,0 +1,349 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Benchmarks the connection engines by pushing request/response round trips
+ * through proxied socket pairs, and reports how many system calls the proxy
+ * made per query. The proxy halves just forward data, so this measures only
+ * the I/O overhead, not query analysis.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "AutoPtrWithOperatorParens.hpp"
+#include "countSyscall.hpp"
+#include "EpollEventLoop.hpp"
+#include "EventLoop.hpp"
+#include "IoUringEventLoop.hpp"
+#include "Logger.hpp"
+#include "nullptr.hpp"
+#include "Proxy.hpp"
+#include "ProxyHalf.hpp"
+#include "Socket.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+using std::auto_ptr;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+namespace options = boost::program_options;
+
+#ifndef COUNT_SYSCALLS
+    #error "proxyBenchmark needs to be built with COUNT_SYSCALLS defined"
+#endif
+
+/**
+ * The benchmark's ends of one proxied connection.
+ */
+struct BenchmarkConnection
+{
+    int clientFD;
+    int serverFD;
+};
+
+static options::options_description getOptions();
+static void driveConnections(
+    const vector<BenchmarkConnection>* connections,
+    size_t first,
+    size_t step,
+    size_t queries,
+    size_t querySize
+);
+static bool writeAll(int fd, const vector<uint8_t>& data);
+static bool readAll(int fd, vector<uint8_t>* data);
+
+
+int main(int argc, char* argv[])
+{
+    Logger::initialize();
+
+    options::variables_map vm;
+    const options::options_description visibleOptions(getOptions());
+    try
+    {
+        store(
+            options::command_line_parser(
+                argc,
+                argv
+            ).options(visibleOptions).run(),
+            vm
+        );
+        notify(vm);
+    }
+    catch (std::exception& e)
+    {
+        cerr << e.what() << '\n' << visibleOptions << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (vm.count("help"))
+    {
+        cout << visibleOptions << endl;
+        exit(EXIT_SUCCESS);
+    }
+
+    const string engine(vm["engine"].as<string>());
+    const size_t connectionCount = vm["connections"].as<size_t>();
+    const size_t queries = vm["queries"].as<size_t>();
+    const size_t querySize = vm["size"].as<size_t>();
+    const size_t driverCount = std::min(
+        vm["drivers"].as<size_t>(),
+        connectionCount
+    );
+    if ("threads" != engine && "epoll" != engine && "io_uring" != engine)
+    {
+        cerr << "Unknown engine: " << engine << '\n'
+            << visibleOptions << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (0 == connectionCount || 0 == queries || 0 == querySize
+        || 0 == driverCount)
+    {
+        cerr << "Counts need to be positive\n" << visibleOptions << endl;
+        exit(EXIT_FAILURE);
+    }
+    if ("io_uring" == engine && !IoUringEventLoop::isSupported())
+    {
+        cerr << "io_uring is not supported by this kernel" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    auto_ptr<EventLoop> loop;
+    if ("epoll" == engine)
+    {
+        loop.reset(new EpollEventLoop);
+    }
+    else if ("io_uring" == engine)
+    {
+        loop.reset(new IoUringEventLoop);
+    }
+    boost::thread_group proxyThreads;
+
+    vector<BenchmarkConnection> connections(connectionCount);
+    for (size_t i = 0; i < connectionCount; ++i)
+    {
+        int client[2];
+        int server[2];
+        if (
+            0 != socketpair(AF_UNIX, SOCK_STREAM, 0, client)
+            || 0 != socketpair(AF_UNIX, SOCK_STREAM, 0, server)
+        )
+        {
+            cerr << "Unable to create socket pairs" << endl;
+            exit(EXIT_FAILURE);
+        }
+        connections[i].clientFD = client[0];
+        connections[i].serverFD = server[0];
+
+        auto_ptr<Socket> clientSocket(new Socket(client[1]));
+        auto_ptr<Socket> serverSocket(new Socket(server[1]));
+        AutoPtrWithOperatorParens<ProxyHalf> in(
+            new ProxyHalf(clientSocket.get(), serverSocket.get())
+        );
+        AutoPtrWithOperatorParens<ProxyHalf> out(
+            new ProxyHalf(serverSocket.get(), clientSocket.get())
+        );
+        if (nullptr != loop.get())
+        {
+            loop->addProxy(in, out, clientSocket, serverSocket);
+        }
+        else
+        {
+            Proxy proxy(in, out, clientSocket, serverSocket);
+            proxyThreads.create_thread(proxy);
+        }
+    }
+
+    // Let everything get registered before we start counting
+    usleep(100000);
+
+    const uint64_t startSyscalls = syscallCount();
+    const ptime start(microsec_clock::universal_time());
+
+    boost::thread_group drivers;
+    for (size_t i = 0; i < driverCount; ++i)
+    {
+        drivers.create_thread(
+            boost::bind(
+                driveConnections,
+                &connections,
+                i,
+                driverCount,
+                queries,
+                querySize
+            )
+        );
+    }
+    drivers.join_all();
+
+    const ptime end(microsec_clock::universal_time());
+    const uint64_t syscalls = syscallCount() - startSyscalls;
+
+    const size_t totalQueries = connectionCount * queries;
+    const double seconds = (end - start).total_microseconds() / 1000000.0;
+    cout << "Engine: " << engine << '\n'
+        << "Connections: " << connectionCount << '\n'
+        << "Queries: " << totalQueries << '\n'
+        << "Query and response size: " << querySize << " bytes\n"
+        << "Seconds: " << seconds << '\n'
+        << "Queries per second: " << totalQueries / seconds << '\n'
+        << "Proxy system calls: " << syscalls << '\n'
+        << "Proxy system calls per query: "
+        << static_cast<double>(syscalls) / totalQueries << endl;
+
+    for (size_t i = 0; i < connectionCount; ++i)
+    {
+        close(connections[i].clientFD);
+        close(connections[i].serverFD);
+    }
+    loop.reset();
+    proxyThreads.join_all();
+
+    return 0;
+}
+
+
+/**
+ * Command line options.
+ */
+options::options_description getOptions()
+{
+    options::options_description cli("Options");
+    cli.add_options()
+        (
+            "help",
+            "Print help message"
+        )
+        (
+            "engine,e",
+            options::value<string>()->default_value("epoll"),
+            "The engine to benchmark: threads, epoll or io_uring."
+        )
+        (
+            "connections,c",
+            options::value<size_t>()->default_value(100),
+            "The number of proxied connections."
+        )
+        (
+            "queries,q",
+            options::value<size_t>()->default_value(1000),
+            "The number of round trips per connection."
+        )
+        (
+            "size,s",
+            options::value<size_t>()->default_value(100),
+            "The size of each query and response."
+        )
+        (
+            "drivers,d",
+            options::value<size_t>()->default_value(4),
+            "The number of threads generating queries."
+        );
+    return cli;
+}
+
+
+/**
+ * Sends queries through every step'th connection starting at first, playing
+ * both the client and the server. Each round sends a query on every
+ * connection before waiting for any of them, so that there's a batch of
+ * connections for the proxy to handle at once.
+ */
+void driveConnections(
+    const vector<BenchmarkConnection>* const connections,
+    const size_t first,
+    const size_t step,
+    const size_t queries,
+    const size_t querySize
+)
+{
+    vector<uint8_t> query(querySize, 'q');
+    vector<uint8_t> response(querySize, 'r');
+    vector<uint8_t> buffer(querySize);
+    for (size_t i = 0; i < queries; ++i)
+    {
+        for (size_t j = first; j < connections->size(); j += step)
+        {
+            writeAll(connections->at(j).clientFD, query);
+        }
+        for (size_t j = first; j < connections->size(); j += step)
+        {
+            readAll(connections->at(j).serverFD, &buffer);
+            writeAll(connections->at(j).serverFD, response);
+        }
+        for (size_t j = first; j < connections->size(); j += step)
+        {
+            if (!readAll(connections->at(j).clientFD, &buffer))
+            {
+                cerr << "Connection closed early" << endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+}
+
+
+bool writeAll(const int fd, const vector<uint8_t>& data)
+{
+    size_t written = 0;
+    while (written < data.size())
+    {
+        const ssize_t bytes =
+            write(fd, &data[written], data.size() - written);
+        if (bytes <= 0)
+        {
+            return false;
+        }
+        written += bytes;
+    }
+    return true;
+}
+
+
+bool readAll(const int fd, vector<uint8_t>* const data)
+{
+    size_t bytesRead = 0;
+    while (bytesRead < data->size())
+    {
+        const ssize_t bytes =
+            read(fd, &data->at(bytesRead), data->size() - bytesRead);
+        if (bytes <= 0)
+        {
+            return false;
+        }
+        bytesRead += bytes;
+    }
+    return true;
+}
@@ -27,6 +27,7 @@
 #include "SensitiveNameChecker.hpp"
 
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -41,107 +42,17 @@ using std::string;
 
 /**
  * Parses MySQL queries and computes the probability of attack.
+ * Usage: riskAnalyzer [--verify-tables] [file]
+ * --verify-tables checks the probabilities of every query that was looked up
+ * in the generated tables against the Bayesian networks.
  * @author Brandon Skari
  * @date January 3 2011
  */
 
 const double CUTOFF = 0.5;
-const int NUM_PROBABILITIES = 6;
+const int NUM_PROBABILITIES = AttackScores::ATTACKS_COUNT;
 const int NUM_QUERY_TYPES = 10;
 
-void setProbabilities(
-    QueryRisk& qr,
-    AttackProbabilities* probs,
-    double probabilities[]
-)
-{
-    assert(
-        nullptr != probs &&
-        "The probability calculator should not be null"
-    );
-    if (nullptr == probs)
-    {
-        return;
-    }
-    // Authentication bypass attack
-    if (QueryRisk::TYPE_SELECT == qr.queryType && qr.userTable)
-    {
-        probabilities[0] = probs->getProbabilityOfBypassAttack(qr);
-    }
-    else
-    {
-        probabilities[0] = 0.0;
-    }
-
-    // Data access attack
-    if (QueryRisk::TYPE_SELECT == qr.queryType)
-    {
-        probabilities[1] = probs->getProbabilityOfAccessAttack(qr);
-    }
-    else
-    {
-        probabilities[1] = 0.0;
-    }
-
-    // Data modification attack
-    if (
-        QueryRisk::TYPE_UPDATE == qr.queryType ||
-        QueryRisk::TYPE_INSERT == qr.queryType ||
-        QueryRisk::TYPE_DELETE == qr.queryType
-    )
-    {
-        probabilities[2] = probs->getProbabilityOfModificationAttack(qr);
-    }
-    else
-    {
-        probabilities[2] = 0.0;
-    }
-
-    // Fingerprinting attack
-    // Fingerprinting attacks can come from select or data mods!
-    if (
-        QueryRisk::TYPE_SELECT == qr.queryType
-        || QueryRisk::TYPE_INSERT == qr.queryType
-        || QueryRisk::TYPE_UPDATE == qr.queryType
-        || QueryRisk::TYPE_DELETE == qr.queryType
-    )
-    {
-        probabilities[3] =
-            probs->getProbabilityOfFingerprintingAttack(qr);
-    }
-    else
-    {
-        probabilities[3] = 0.0;
-    }
-
-    // Schema discovery attack
-    // Schema attacks can come from select or data mods!
-    if (
-        QueryRisk::TYPE_SELECT == qr.queryType
-        || QueryRisk::TYPE_INSERT == qr.queryType
-        || QueryRisk::TYPE_UPDATE == qr.queryType
-        || QueryRisk::TYPE_DELETE == qr.queryType
-    )
-    {
-        probabilities[4] = probs->getProbabilityOfSchemaAttack(qr);
-    }
-    else
-    {
-        probabilities[4] = 0.0;
-    }
-
-    // Denial of service attack
-    if (QueryRisk::TYPE_SELECT == qr.queryType)
-    {
-        probabilities[5] = probs->getProbabilityOfDenialAttack(qr);
-    }
-    else
-    {
-        probabilities[5] = 0.0;
-    }
-}
-
-
 int main(int argc, char* argv[])
 {
     Logger::initialize();
@@ -149,23 +60,39 @@ int main(int argc, char* argv[])
     SensitiveNameChecker::get().setPasswordSubstring("password");
     SensitiveNameChecker::get().setUserSubstring("user");
     bool file = false;
+    bool verifyTables = false;
+    const char* fileName = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == strcmp(argv[i], "--verify-tables"))
+        {
+            verifyTables = true;
+        }
+        else
+        {
+            fileName = argv[i];
+        }
+    }
 
     ifstream fin;
-    if (argc > 1)
+    if (nullptr != fileName)
     {
-        fin.open(argv[1]);
+        fin.open(fileName);
         file = true;
     }
     istream& stream = (fin.is_open() ? fin : cin);
-    if (argc > 1 && !fin)
+    if (nullptr != fileName && !fin)
     {
-        cerr << "Unable to open file '" << argv[1] << "', aborting" << endl;
+        cerr << "Unable to open file '" << fileName << "', aborting" << endl;
         return 0;
     }
 
     string query;
     int queryCount = 0;
     int queryTypes[NUM_QUERY_TYPES] = {0};
+    size_t checked = 0;
+    size_t mismatched = 0;
 
     DlibProbabilities dp;
     while (!stream.eof() && queryCount < 500)
@@ -204,7 +131,7 @@ int main(int argc, char* argv[])
             }
             */
 
-            double dlibProbabilities[NUM_PROBABILITIES];
+            AttackScores scores;
             const char* const names[NUM_PROBABILITIES] = {
                 "Bypass authentication",
                 "Data access",
@@ -214,10 +141,18 @@ int main(int argc, char* argv[])
                 "Denial of service"
             };
 
-            setProbabilities(qr, &dp, dlibProbabilities);
+            dp.scoreAll(qr, &scores);
+            if (verifyTables)
+            {
+                size_t queryChecked;
+                size_t queryMismatched;
+                dp.verifyProbabilities(qr, &queryChecked, &queryMismatched);
+                checked += queryChecked;
+                mismatched += queryMismatched;
+            }
 
             double* probabilities[1] = {
-                dlibProbabilities
+                scores.probabilities
             };
             const char* listNames[1] = {
                 "Dlib"
@@ -287,5 +222,15 @@ int main(int argc, char* argv[])
     }
     */
 
+    if (verifyTables)
+    {
+        cout << "Verified " << checked << " probabilities, "
+            << mismatched << " did not match" << endl;
+        if (0 != mismatched)
+        {
+            return 1;
+        }
+    }
+
     return 0;
 }
@@ -57,6 +57,7 @@ extern int sql_lex(
 
 map<int, string> tokenCodes;
 void loadTokensFromFile(const char* fileName);
+void printTokens(ScannerContext* context);
 
 int main()
 {
@@ -89,33 +90,41 @@ int main()
         }
         while (lexCode > 255);
 
+        // The tokens point into the scanner's buffer, so print them before
+        // it's deleted
+        printTokens(&context);
+
         sql__delete_buffer(bufferState, scanner);
         sql_lex_destroy(scanner);
 
         cout << "Enter MySQL query: ";
     }
     cout << endl;
+}
 
+void printTokens(ScannerContext* const context)
+{
     cout << "Identifiers found:" << endl;
-    while (!context.identifiers.empty())
+    while (!context->identifiers.empty())
     {
-        cout << context.identifiers.top() << endl;
-        context.identifiers.pop();
+        cout << context->identifiers.top() << endl;
+        context->identifiers.pop();
     }
 
     cout << "Quoted strings found:" << endl;
-    while (!context.quotedStrings.empty())
+    while (!context->quotedStrings.empty())
     {
-        cout << context.quotedStrings.top() << endl;
-        context.quotedStrings.pop();
+        cout << context->quotedStrings.top() << endl;
+        context->quotedStrings.pop();
     }
 
     cout << "Numbers found:" << endl;
-    while (!context.numbers.empty())
+    while (!context->numbers.empty())
     {
-        cout << context.numbers.top() << endl;
-        context.numbers.pop();
+        cout << context->numbers.top() << endl;
+        context->numbers.pop();
     }
+    context->clear();
 }
 
 void loadTokensFromFile(const char* const fileName)
@@ -21,9 +21,14 @@
 #include "accumulator.hpp"
 #include "initializeSingletons.hpp"
 #include "Logger.hpp"
+#include "MySqlBackendPool.hpp"
+#include "MySqlCompression.hpp"
+#include "MySqlConnectionPool.hpp"
 #include "MySqlGuardListenSocket.hpp"
+#include "PacketBufferPool.hpp"
 #include "MySqlLoginCheck.hpp"
 #include "nullptr.hpp"
+#include "ParserInterface.hpp"
 #include "QueryWhitelist.hpp"
 #include "SensitiveNameChecker.hpp"
 #include "version.h"
@@ -32,6 +37,7 @@
 #include <boost/cstdint.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/program_options.hpp>
+#include <boost/thread.hpp>
 #include <exception>
 #include <fstream>
 #include <iostream>
@@ -39,10 +45,12 @@
 #include <string>
 #include <unistd.h>
 #include <utility>
+#include <vector>
 
 using boost::bind;
 using boost::lexical_cast;
 namespace options = boost::program_options;
+using std::auto_ptr;
 using std::cerr;
 using std::cout;
 using std::endl;
@@ -50,6 +58,7 @@ using std::exception;
 using std::ifstream;
 using std::string;
 using std::pair;
+using std::vector;
 
 static const int UNSPECIFIED_OPTION = -1;
 static const int DEFAULT_CONNECT_PORT = 3306;
@@ -62,6 +71,9 @@ static const char* PASSWORD_REGEX = "password-regex";
 static const char* PASSWORD_SUBSTRING = "password-substring";
 static const char* USER_REGEX = "user-regex";
 static const char* USER_SUBSTRING = "user-substring";
+static const char* THREADS_ENGINE = "threads";
+static const char* EPOLL_ENGINE = "epoll";
+static const char* IO_URING_ENGINE = "io_uring";
 
 static MySqlGuardListenSocket* mysqlGuard = nullptr;
 static int verbosityLevel = 0;
@@ -286,6 +298,150 @@ int main(int argc, char* argv[])
                 );
             }
         }
+
+        PacketBufferPool::setBufferSize(
+            getOption("packet-buffer-size", commandLineVm, fileVm).as<int>()
+        );
+
+        const string engine(
+            getOption("engine", commandLineVm, fileVm).as<string>()
+        );
+        if (EPOLL_ENGINE == engine || IO_URING_ENGINE == engine)
+        {
+            int loopCount = getOption(
+                "event-loop-threads",
+                commandLineVm,
+                fileVm
+            ).as<int>();
+            if (0 == loopCount)
+            {
+                loopCount = boost::thread::hardware_concurrency();
+                if (0 == loopCount)
+                {
+                    loopCount = 1;
+                }
+            }
+            mysqlGuard->useEventLoops(loopCount, IO_URING_ENGINE == engine);
+        }
+        mysqlGuard->setPassThroughResultSets(
+            getOption("splice-result-sets", commandLineVm, fileVm).as<bool>()
+        );
+        if (getOption("compression", commandLineVm, fileVm).as<bool>())
+        {
+            mysqlGuard->setCompression(
+                MySqlCompression(
+                    getOption(
+                        "compression-level",
+                        commandLineVm,
+                        fileVm
+                    ).as<int>(),
+                    getOption(
+                        "compression-threshold",
+                        commandLineVm,
+                        fileVm
+                    ).as<int>()
+                )
+            );
+        }
+
+        const vector<string>& replicas = getOption(
+            "replica",
+            commandLineVm,
+            fileVm
+        ).as<vector<string> >();
+        if (!replicas.empty())
+        {
+            if (THREADS_ENGINE != engine)
+            {
+                Logger::log(Logger::WARN)
+                    << "Replicas are only used with the threads engine";
+            }
+            auto_ptr<MySqlBackendPool> pool(
+                new MySqlBackendPool(
+                    getOption(
+                        "replica-connect-timeout",
+                        commandLineVm,
+                        fileVm
+                    ).as<int>()
+                )
+            );
+            for (size_t i = 0; i < replicas.size(); ++i)
+            {
+                string host;
+                uint16_t port;
+                unsigned weight;
+                // Already validated
+                MySqlBackendPool::parseBackend(
+                    replicas[i],
+                    &host,
+                    &port,
+                    &weight
+                );
+                pool->addBackend(host, port, weight);
+            }
+            pool->setHealthCheckLogin(
+                getOption("user", commandLineVm, fileVm).as<string>(),
+                getOption("password", commandLineVm, fileVm).as<string>()
+            );
+            pool->startHealthChecks(
+                getOption(
+                    "replica-health-check-interval",
+                    commandLineVm,
+                    fileVm
+                ).as<int>()
+            );
+            mysqlGuard->setReplicas(pool);
+        }
+
+        const int poolConnections = getOption(
+            "pool-connections",
+            commandLineVm,
+            fileVm
+        ).as<int>();
+        if (poolConnections > 0)
+        {
+            if (THREADS_ENGINE != engine)
+            {
+                Logger::log(Logger::WARN)
+                    << "Pooled connections are only used with the threads"
+                    << " engine";
+            }
+            mysqlGuard->usePooledConnections(
+                poolConnections,
+                getOption("pool-wait-timeout", commandLineVm, fileVm).as<int>()
+            );
+        }
+
+        mysqlGuard->setTimeouts(
+            1000 * getOption("login-timeout", commandLineVm, fileVm).as<int>(),
+            1000 * getOption("idle-timeout", commandLineVm, fileVm).as<int>(),
+            1000 * getOption("query-timeout", commandLineVm, fileVm).as<int>()
+        );
+
+        const int decisionCacheSize = getOption(
+            "decision-cache-size",
+            commandLineVm,
+            fileVm
+        ).as<int>();
+        if (decisionCacheSize > 0)
+        {
+            mysqlGuard->useDecisionCache(
+                static_cast<size_t>(decisionCacheSize) * 1024 * 1024
+            );
+        }
+
+        const int shapeCacheSize = getOption(
+            "shape-cache-size",
+            commandLineVm,
+            fileVm
+        ).as<int>();
+        if (shapeCacheSize > 0)
+        {
+            mysqlGuard->useShapeCache(
+                static_cast<size_t>(shapeCacheSize) * 1024 * 1024
+            );
+        }
+
         mysqlGuard->acceptClients();
     }
     #ifdef NDEBUG
@@ -320,6 +476,18 @@ void quit()
 {
     delete mysqlGuard;
 
+    Logger::log(Logger::INFO)
+        << "Packet buffers: "
+        << PacketBufferPool::getAllocationCount()
+        << " allocated, "
+        << PacketBufferPool::getReuseCount()
+        << " reused, "
+        << PacketBufferPool::getDiscardCount()
+        << " discarded";
+    Logger::log(Logger::INFO)
+        << "Queries over the parse budget: "
+        << ParserInterface::getBudgetExceededCount();
+
     // Give the socket time to close?
     // It didn't close one time before quitting... maybe this will fix it
     sleep(1);
@@ -416,6 +584,124 @@ options::options_description getConfigurationOptions()
             "password,p",
             options::value<string>()->default_value(""),
             "The password to use when reading MySQL user permissions."
+        )
+        (
+            "engine",
+            options::value<string>()->default_value(THREADS_ENGINE),
+            "How to run connections: 'threads' gives every connection its own threads, 'epoll' and 'io_uring' run all connections on a few event loop threads."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "event-loop-threads",
+            options::value<int>()->default_value(0),
+            "The number of event loop threads for the epoll and io_uring engines. Defaults to the number of processors."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "splice-result-sets",
+            options::value<bool>()->default_value(false),
+            "Check only the start of each large packet and splice the rest straight to the client. Only used with the threads engine."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "compression",
+            options::value<bool>()->default_value(false),
+            "Let clients use the MySQL compressed protocol."
+        )
+        (
+            "compression-level",
+            options::value<int>()->default_value(
+                MySqlCompression::DEFAULT_LEVEL
+            ),
+            "The zlib level, 1-9, to compress forwarded commands with."
+        )
+        (
+            "compression-threshold",
+            options::value<int>()->default_value(
+                MySqlCompression::DEFAULT_THRESHOLD
+            ),
+            "Forwarded commands smaller than this many bytes aren't compressed."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "packet-buffer-size",
+            options::value<int>()->default_value(65536),
+            "The size of the pooled buffers that messages are received into. Messages up to this size don't cause any memory allocations."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "replica",
+            options::value<vector<string> >()->composing()->default_value(
+                vector<string>(),
+                ""
+            ),
+            "A read replica to send SELECTs outside of transactions to, as host:port or host:port:weight. Can be given more than once. Requires user. Only used with the threads engine."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "replica-connect-timeout",
+            options::value<int>()->default_value(
+                MySqlBackendPool::DEFAULT_CONNECT_TIMEOUT
+            ),
+            "How many milliseconds to wait when connecting to a replica before giving up on it."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "replica-health-check-interval",
+            options::value<int>()->default_value(
+                MySqlBackendPool::DEFAULT_HEALTH_CHECK_INTERVAL
+            ),
+            "How many seconds to wait between checking whether the replicas are up."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "pool-connections",
+            options::value<int>()->default_value(0),
+            "Share up to this many MySQL connections for each user and database between clients, handing them out for one statement or transaction at a time. Requires user. Defaults to 0, which gives each client its own connection. Only used with the threads engine."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "pool-wait-timeout",
+            options::value<int>()->default_value(
+                MySqlConnectionPool::DEFAULT_WAIT
+            ),
+            "How many milliseconds a client waits for a pooled connection before getting a \"Too many connections\" error."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "login-timeout",
+            options::value<int>()->default_value(10),
+            "How many seconds clients have to log in before they're disconnected. 0 waits forever."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "idle-timeout",
+            options::value<int>()->default_value(28800),
+            "How many seconds clients can go without sending a command before they're disconnected. 0 waits forever."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "query-timeout",
+            options::value<int>()->default_value(0),
+            "How many seconds MySQL has to start answering a query before the client is disconnected. 0 waits forever."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "decision-cache-size",
+            options::value<int>()->default_value(16),
+            "How many megabytes to use for remembering the decisions about queries that have been seen before, so that they aren't analyzed again. 0 analyzes every query."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "shape-cache-size",
+            options::value<int>()->default_value(16),
+            "How many megabytes to use for remembering the parsed shapes of queries, so that queries that only differ in their literals aren't parsed again. 0 parses every query."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "parse-token-limit",
+            options::value<int>()->default_value(0),
+            "The most tokens the parser reads from a query before giving up on it. 0 reads every token."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "parse-stack-limit",
+            options::value<int>()->default_value(10000),
+            "The most items in the parser's stacks, shared by every way that an ambiguous query can be parsed, before the parser gives up on the query."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "parse-time-limit",
+            options::value<int>()->default_value(0),
+            "How many milliseconds the parser can spend on a query before giving up on it. 0 waits forever."  // NOLINT(whitespace/line_length)
+        )
+        (
+            "parse-budget-policy",
+            options::value<string>()->default_value("block"),
+            "What to do with queries that the parser gives up on: block, or scanner to only block the ones with comments or hex strings."  // NOLINT(whitespace/line_length)
         );
     return configuration;
 }
@@ -570,6 +856,263 @@ bool optionsAreValid(
         return false;
     }
 
+    // Make sure the connection engine is one we know about
+    const string engine(
+        getOption("engine", commandLineVm, fileVm).as<string>()
+    );
+    if (
+        THREADS_ENGINE != engine
+        && EPOLL_ENGINE != engine
+        && IO_URING_ENGINE != engine
+    )
+    {
+        *error = "Unknown engine (";
+        *error += engine;
+        *error += "); valid values are threads, epoll and io_uring";
+        return false;
+    }
+    const int loopCount = getOption(
+        "event-loop-threads",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    if (loopCount < 0 || loopCount > 256)
+    {
+        *error = "Event loop threads (";
+        *error += boost::lexical_cast<string>(loopCount);
+        *error += ") is out of range; valid values are 0-256";
+        return false;
+    }
+
+    // Buffers have to hold at least one whole read from a socket
+    const int bufferSize = getOption(
+        "packet-buffer-size",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    if (bufferSize < 65536 || bufferSize > 16 * 1024 * 1024)
+    {
+        *error = "Packet buffer size (";
+        *error += boost::lexical_cast<string>(bufferSize);
+        *error += ") is out of range; valid values are 65536-16777216";
+        return false;
+    }
+
+    const int compressionLevel = getOption(
+        "compression-level",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    if (compressionLevel < 1 || compressionLevel > 9)
+    {
+        *error = "Compression level (";
+        *error += boost::lexical_cast<string>(compressionLevel);
+        *error += ") is out of range; valid values are 1-9";
+        return false;
+    }
+    const int compressionThreshold = getOption(
+        "compression-threshold",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    if (compressionThreshold < 0)
+    {
+        *error = "Compression threshold (";
+        *error += boost::lexical_cast<string>(compressionThreshold);
+        *error += ") can't be negative";
+        return false;
+    }
+
+    // Replicas are logged in to with the client's credentials, which can
+    // only be checked with the password hashes that user can read
+    const vector<string>& replicas = getOption(
+        "replica",
+        commandLineVm,
+        fileVm
+    ).as<vector<string> >();
+    if (!replicas.empty() && !user)
+    {
+        *error = "Replicas can only be used if a username is specified";
+        return false;
+    }
+    for (size_t i = 0; i < replicas.size(); ++i)
+    {
+        string replicaHost;
+        uint16_t replicaPort;
+        unsigned weight;
+        if (
+            !MySqlBackendPool::parseBackend(
+                replicas[i],
+                &replicaHost,
+                &replicaPort,
+                &weight
+            )
+        )
+        {
+            *error = "Replica (";
+            *error += replicas[i];
+            *error += ") should be host:port or host:port:weight";
+            return false;
+        }
+    }
+    const int connectTimeout = getOption(
+        "replica-connect-timeout",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    if (connectTimeout < 1 || connectTimeout > 60000)
+    {
+        *error = "Replica connect timeout (";
+        *error += boost::lexical_cast<string>(connectTimeout);
+        *error += ") is out of range; valid values are 1-60000";
+        return false;
+    }
+    const int healthCheckInterval = getOption(
+        "replica-health-check-interval",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    if (healthCheckInterval < 1 || healthCheckInterval > 3600)
+    {
+        *error = "Replica health check interval (";
+        *error += boost::lexical_cast<string>(healthCheckInterval);
+        *error += ") is out of range; valid values are 1-3600";
+        return false;
+    }
+
+    // Pooled connections are logged in to the same way as replicas
+    const int poolConnections = getOption(
+        "pool-connections",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    if (poolConnections < 0 || poolConnections > 10000)
+    {
+        *error = "Pool connections (";
+        *error += boost::lexical_cast<string>(poolConnections);
+        *error += ") is out of range; valid values are 0-10000";
+        return false;
+    }
+    if (poolConnections > 0 && !user)
+    {
+        *error = "Pooled connections can only be used if a username is";
+        *error += " specified";
+        return false;
+    }
+    const int poolWaitTimeout = getOption(
+        "pool-wait-timeout",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    if (poolWaitTimeout < 1 || poolWaitTimeout > 60000)
+    {
+        *error = "Pool wait timeout (";
+        *error += boost::lexical_cast<string>(poolWaitTimeout);
+        *error += ") is out of range; valid values are 1-60000";
+        return false;
+    }
+
+    // In seconds, so these have to fit in milliseconds as an int
+    const char* const timeouts[] = {
+        "login-timeout",
+        "idle-timeout",
+        "query-timeout"
+    };
+    for (size_t i = 0; i < sizeof(timeouts) / sizeof(timeouts[0]); ++i)
+    {
+        const int timeout = getOption(
+            timeouts[i],
+            commandLineVm,
+            fileVm
+        ).as<int>();
+        if (timeout < 0 || timeout > 2147483)
+        {
+            *error = timeouts[i];
+            *error += " (";
+            *error += boost::lexical_cast<string>(timeout);
+            *error += ") is out of range; valid values are 0-2147483";
+            return false;
+        }
+    }
+
+    const int decisionCacheSize = getOption(
+        "decision-cache-size",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    if (decisionCacheSize < 0 || decisionCacheSize > 65536)
+    {
+        *error = "Decision cache size (";
+        *error += boost::lexical_cast<string>(decisionCacheSize);
+        *error += ") is out of range; valid values are 0-65536";
+        return false;
+    }
+
+    const int shapeCacheSize = getOption(
+        "shape-cache-size",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    if (shapeCacheSize < 0 || shapeCacheSize > 65536)
+    {
+        *error = "Shape cache size (";
+        *error += boost::lexical_cast<string>(shapeCacheSize);
+        *error += ") is out of range; valid values are 0-65536";
+        return false;
+    }
+
+    const int parseTokenLimit = getOption(
+        "parse-token-limit",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    if (parseTokenLimit < 0)
+    {
+        *error = "Parse token limit (";
+        *error += boost::lexical_cast<string>(parseTokenLimit);
+        *error += ") is out of range; it can't be negative";
+        return false;
+    }
+
+    const int parseStackLimit = getOption(
+        "parse-stack-limit",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    if (parseStackLimit < 1000 || parseStackLimit > 10000000)
+    {
+        *error = "Parse stack limit (";
+        *error += boost::lexical_cast<string>(parseStackLimit);
+        *error += ") is out of range; valid values are 1000-10000000";
+        return false;
+    }
+
+    const int parseTimeLimit = getOption(
+        "parse-time-limit",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    if (parseTimeLimit < 0)
+    {
+        *error = "Parse time limit (";
+        *error += boost::lexical_cast<string>(parseTimeLimit);
+        *error += ") is out of range; it can't be negative";
+        return false;
+    }
+
+    const string parseBudgetPolicy = getOption(
+        "parse-budget-policy",
+        commandLineVm,
+        fileVm
+    ).as<string>();
+    if ("block" != parseBudgetPolicy && "scanner" != parseBudgetPolicy)
+    {
+        *error = "Parse budget policy (";
+        *error += parseBudgetPolicy;
+        *error += ") is invalid; valid values are block and scanner";
+        return false;
+    }
+
     // Only specify one of password/user substring or regex
     const bool pwSubstr = !fileVm[PASSWORD_SUBSTRING].as<string>().empty();
     const bool pwRegex = !fileVm[PASSWORD_REGEX].as<string>().empty();
@@ -625,6 +1168,32 @@ void setupOptions(
         break;
     }
 
+    // Set the parse budget before anything is parsed
+    ParserInterface::Budget budget;
+    budget.maxTokens = getOption(
+        "parse-token-limit",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    budget.maxStackItems = getOption(
+        "parse-stack-limit",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    budget.maxMilliseconds = getOption(
+        "parse-time-limit",
+        commandLineVm,
+        fileVm
+    ).as<int>();
+    budget.blockOverBudget = (
+        "block" == getOption(
+            "parse-budget-policy",
+            commandLineVm,
+            fileVm
+        ).as<string>()
+    );
+    ParserInterface::setBudget(budget);
+
     // Set up whitelists
     const string* whitelistFilenames[] = {nullptr, nullptr};
     const char* const optionNames[] = {
@@ -742,16 +1311,35 @@ void setupOptions(
     const string socket(
         getOption("connect-socket", commandLineVm, fileVm).as<string>()
     );
+    // Needed to log clients in to replicas and pooled connections
+    const bool loadPasswordHashes =
+        !getOption(
+            "replica",
+            commandLineVm,
+            fileVm
+        ).as<vector<string> >().empty()
+        || getOption("pool-connections", commandLineVm, fileVm).as<int>() > 0;
     if (!host.empty())
     {
         const uint16_t port(
             getOption("connect-port", commandLineVm, fileVm).as<uint16_t>()
         );
-        MySqlLoginCheck::initialize(user, password, host, port);
+        MySqlLoginCheck::initialize(
+            user,
+            password,
+            host,
+            port,
+            loadPasswordHashes
+        );
     }
     else
     {
-        MySqlLoginCheck::initialize(user, password, socket);
+        MySqlLoginCheck::initialize(
+            user,
+            password,
+            socket,
+            loadPasswordHashes
+        );
     }
 }
 
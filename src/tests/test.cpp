@@ -23,10 +23,28 @@
 #include "../nullptr.hpp"
 #include "../QueryWhitelist.hpp"
 
+#include "testAstArena.hpp"
+#include "testConcurrentCache.hpp"
+#include "testDlibProbabilities.hpp"
+#include "testEventLoop.hpp"
+#include "testIdentifierClassifier.hpp"
+#include "testMySqlAuthentication.hpp"
+#include "testMySqlBackendPool.hpp"
+#include "testMySqlCompression.hpp"
+#include "testMySqlConnectionPool.hpp"
 #include "testMySqlConstants.hpp"
+#include "testMySqlErrorMessageBlocker.hpp"
+#include "testMySqlPacketReader.hpp"
+#include "testMySqlSessionState.hpp"
 #include "testNode.hpp"
+#include "testPacketBufferPool.hpp"
 #include "testParser.hpp"
+#include "testQueryDecisionCache.hpp"
+#include "testQueryShapeCache.hpp"
 #include "testQueryWhitelist.hpp"
+#include "testSha1.hpp"
+#include "testSocket.hpp"
+#include "testTimerWheel.hpp"
 
 #include <boost/test/included/unit_test.hpp>
 #include <string>
@@ -69,6 +87,18 @@ test::test_suite* init_unit_test_suite(int, char*[])
     test::framework::master_test_suite().add(
         BOOST_TEST_CASE(testSelectItems)
     );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testParseConcurrently)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testParseInPlace)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testParseBudget)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testFastParser)
+    );
 
     // Tests from nodeTest.cpp
     test::framework::master_test_suite().add(BOOST_TEST_CASE(testAstNode));
@@ -93,5 +123,161 @@ test::test_suite* init_unit_test_suite(int, char*[])
         BOOST_TEST_CASE(testRiskWhitelist)
     );
 
+    // Tests from testEventLoop.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testEventLoopForwarding)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testEventLoopClose)
+    );
+
+    // Tests from testMySqlErrorMessageBlocker.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testErrorMessageBlockerPassThrough)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testErrorMessageBlockerCompression)
+    );
+
+    // Tests from testPacketBufferPool.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testPacketBufferPoolReuse)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testPacketBufferPoolSteadyState)
+    );
+
+    // Tests from testMySqlPacketReader.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlPacketReaderFraming)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlPacketReaderContinuation)
+    );
+
+    // Tests from testSocket.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testSocketGatherWrite)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testSocketBatchOwner)
+    );
+
+    // Tests from testSha1.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testSha1KnownHashes)
+    );
+
+    // Tests from testTimerWheel.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testTimerWheelExpiry)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testTimerWheelSocketShutdown)
+    );
+
+    // Tests from testMySqlCompression.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlCompressionFrames)
+    );
+
+    // Tests from testMySqlAuthentication.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlAuthenticationRecover)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlAuthenticationScramble)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlAuthenticationPrepareHandshake)
+    );
+
+    // Tests from testMySqlBackendPool.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlBackendPoolBalancing)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlBackendPoolParse)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlBackendPoolHealthCheck)
+    );
+
+    // Tests from testMySqlSessionState.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlSessionStateTracking)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlSessionStateReplicaSafe)
+    );
+
+    // Tests from testMySqlConnectionPool.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlConnectionPoolUnreachable)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlConnectionPoolSessions)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlConnectionPoolTransaction)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testMySqlConnectionPoolLastInsertId)
+    );
+
+    // Tests from testQueryDecisionCache.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testQueryDecisionCacheFind)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testQueryDecisionCacheEviction)
+    );
+
+    // Tests from testQueryShapeCache.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testQueryShapeCacheParse)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testQueryShapeCacheEviction)
+    );
+
+    // Tests from testAstArena.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testAstArenaNodes)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testAstArenaReset)
+    );
+
+    // Tests from testIdentifierClassifier.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testIdentifierClassifierNames)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testIdentifierClassifierTables)
+    );
+
+    // Tests from testDlibProbabilities.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testDlibProbabilitiesConcurrently)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testDlibProbabilitiesScoreAll)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testDlibProbabilitiesNetFiles)
+    );
+
+    // Tests from testConcurrentCache.cpp
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testConcurrentCacheFind)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testConcurrentCacheEviction)
+    );
+    test::framework::master_test_suite().add(
+        BOOST_TEST_CASE(testConcurrentCacheConcurrently)
+    );
+
     return 0;
 }
@@ -0,0 +1,149 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Tests the AstArena.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testAstArena.hpp"
+#include "../AstArena.hpp"
+#include "../AstNode.hpp"
+#include "../ComparisonNode.hpp"
+#include "../ExpressionNode.hpp"
+#include "../ParserInterface.hpp"
+#include "../QueryRisk.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/test/unit_test.hpp>
+#include <string>
+
+using std::string;
+
+/**
+ * Node that counts how many of its instances have been destroyed.
+ */
+class CountedNode : public AstNode
+{
+public:
+    explicit CountedNode(int* destroyed) :
+        AstNode("counted"),
+        destroyed_(destroyed)
+    {
+    }
+
+    ~CountedNode()
+    {
+        ++*destroyed_;
+    }
+
+private:
+    int* const destroyed_;
+
+    // Hidden methods
+    CountedNode(const CountedNode& rhs);
+    CountedNode& operator=(const CountedNode& rhs);
+};
+
+
+void testAstArenaNodes()
+{
+    AstArena arena;
+
+    // ((((1 + 1) + 1) + 1) + 1) = 5
+    ExpressionNode* sum = arena.create<ExpressionNode>("1", false);
+    for (int i = 0; i < 4; ++i)
+    {
+        ExpressionNode* const add = arena.create<ExpressionNode>();
+        add->addChild(sum);
+        add->addChild(arena.create<AstNode>("+"));
+        add->addChild(arena.create<ExpressionNode>("1", false));
+        sum = add;
+    }
+    ComparisonNode* const equal = arena.create<ComparisonNode>("=");
+    equal->addChild(sum);
+    equal->addChild(arena.create<ExpressionNode>("5", false));
+    BOOST_CHECK(equal->isAlwaysTrue());
+
+    ComparisonNode* const notEqual = arena.create<ComparisonNode>("!=");
+    notEqual->addChild(sum);
+    notEqual->addChild(arena.create<ExpressionNode>("5", false));
+    BOOST_CHECK(!notEqual->isAlwaysTrue());
+
+    // BETWEEN adds its first expression to two comparisons, which is only
+    // safe because the nodes are in the arena
+    ParserInterface parser("SELECT * FROM foo WHERE 2 BETWEEN 1 AND 3");
+    QueryRisk qr;
+    BOOST_CHECK(0 == parser.parse(&qr));
+    BOOST_CHECK(qr.valid);
+    BOOST_CHECK(qr.alwaysTrue);
+    BOOST_CHECK(0 == parser.arena_.getBytesUsed());
+}
+
+
+void testAstArenaReset()
+{
+    const size_t BLOCK_SIZE = 4096;
+    AstArena arena(BLOCK_SIZE);
+    int destroyed = 0;
+
+    for (int round = 0; round < 3; ++round)
+    {
+        AstNode* const parent = arena.create<CountedNode>(&destroyed);
+        for (int i = 0; i < 10; ++i)
+        {
+            parent->addChild(arena.create<CountedNode>(&destroyed));
+        }
+        BOOST_CHECK(0 < arena.getBytesUsed());
+        BOOST_CHECK(0 == destroyed);
+
+        arena.reset();
+        BOOST_CHECK(11 == destroyed);
+        BOOST_CHECK(0 == arena.getBytesUsed());
+        // Everything fits in the first block, which is kept
+        BOOST_CHECK(1 == arena.getBlocksAllocated());
+        destroyed = 0;
+    }
+
+    // Allocations are aligned for anything
+    for (size_t bytes = 1; bytes < 40; bytes += 3)
+    {
+        const void* const memory = arena.allocate(bytes);
+        BOOST_CHECK(
+            0 == reinterpret_cast<size_t>(memory) % (2 * sizeof(void*))
+        );
+    }
+
+    // Allocations that don't fit in a block get their own
+    const uint64_t blocks = arena.getBlocksAllocated();
+    char* const large = static_cast<char*>(arena.allocate(BLOCK_SIZE * 4));
+    large[BLOCK_SIZE * 4 - 1] = '\0';
+    BOOST_CHECK(blocks + 1 == arena.getBlocksAllocated());
+    arena.reset();
+
+    // Running out of room starts a new block
+    const uint64_t blocksBefore = arena.getBlocksAllocated();
+    for (size_t i = 0; i < BLOCK_SIZE / 16; ++i)
+    {
+        arena.create<AstNode>("filler");
+    }
+    BOOST_CHECK(blocksBefore < arena.getBlocksAllocated());
+    arena.reset();
+}
@@ -0,0 +1,36 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SRC_TESTS_TESTASTARENA_HPP_
+#define SRC_TESTS_TESTASTARENA_HPP_
+
+/**
+ * Tests that nodes created in the arena keep their children in the arena,
+ * and that parsing queries with nodes in the arena gives the same results.
+ */
+void testAstArenaNodes();
+
+/**
+ * Tests that resetting the arena destroys everything that was created in it
+ * and reuses the first block, and that large allocations are aligned and get
+ * a block of their own.
+ */
+void testAstArenaReset();
+
+#endif  // SRC_TESTS_TESTASTARENA_HPP_
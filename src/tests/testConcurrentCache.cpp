@@ -0,0 +1,203 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Tests the ConcurrentCache.
+ * @author Brandon Skari
+ * @date October 17 2026
+ */
+
+#include "testConcurrentCache.hpp"
+#include "../ConcurrentCache.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include <string>
+
+using boost::shared_ptr;
+using std::string;
+
+typedef ConcurrentCache<int, string> Cache;
+
+static const size_t VALUE_LENGTH = 32;
+
+/**
+ * Makes a different value for each key, all of the same length.
+ */
+static string makeValue(int key);
+
+/**
+ * Finds values and inserts the ones that are missing, checking that every
+ * value that is found belongs to its key.
+ */
+static void findAndInsert(Cache* cache, int thread, int* mismatched);
+
+
+void testConcurrentCacheFind()
+{
+    Cache cache(1024 * 1024);
+
+    BOOST_CHECK(!cache.find(1));
+    const shared_ptr<const string> inserted(cache.insert(1, makeValue(1)));
+    BOOST_REQUIRE(inserted);
+    BOOST_CHECK(makeValue(1) == *inserted);
+    BOOST_CHECK(1 == cache.size());
+
+    shared_ptr<const string> found(cache.find(1));
+    BOOST_REQUIRE(found);
+    BOOST_CHECK(makeValue(1) == *found);
+    BOOST_CHECK(!cache.find(2));
+
+    // Replacing a value doesn't change what was already found
+    cache.insert(1, makeValue(100));
+    BOOST_CHECK(1 == cache.size());
+    BOOST_CHECK(makeValue(1) == *found);
+    found = cache.find(1);
+    BOOST_REQUIRE(found);
+    BOOST_CHECK(makeValue(100) == *found);
+
+    BOOST_CHECK(2 == cache.getHits());
+    BOOST_CHECK(2 == cache.getMisses());
+    BOOST_CHECK(0 == cache.getEvictions());
+
+    BOOST_CHECK(cache.erase(1));
+    BOOST_CHECK(!cache.erase(1));
+    BOOST_CHECK(!cache.find(1));
+    BOOST_CHECK(0 == cache.size());
+    BOOST_CHECK(0 == cache.getBytes());
+
+    cache.insert(1, makeValue(1));
+    cache.insert(2, makeValue(2));
+    cache.clear();
+    BOOST_CHECK(0 == cache.size());
+    BOOST_CHECK(0 == cache.getBytes());
+    BOOST_CHECK(!cache.find(1));
+}
+
+
+void testConcurrentCacheEviction()
+{
+    const int CAPACITY = 10;
+    const size_t ENTRY_BYTES = Cache::getEntryBytes(VALUE_LENGTH);
+    const size_t MAX_BYTES = CAPACITY * ENTRY_BYTES;
+    // One shard, so that which entry is evicted is predictable
+    Cache cache(MAX_BYTES, 1);
+
+    for (int i = 0; i < CAPACITY; ++i)
+    {
+        cache.insert(i, makeValue(i), VALUE_LENGTH);
+    }
+    BOOST_CHECK(static_cast<size_t>(CAPACITY) == cache.size());
+    BOOST_CHECK(MAX_BYTES == cache.getBytes());
+    BOOST_CHECK(0 == cache.getEvictions());
+
+    BOOST_CHECK(cache.find(0));
+    BOOST_CHECK(cache.find(5));
+
+    // The hand passes over 0 and 5 once, clearing their bits, and evicts
+    // the others in order
+    for (int i = CAPACITY; i < CAPACITY + 5; ++i)
+    {
+        cache.insert(i, makeValue(i), VALUE_LENGTH);
+        BOOST_CHECK(cache.getBytes() <= MAX_BYTES);
+    }
+    BOOST_CHECK(5 == cache.getEvictions());
+    BOOST_CHECK(static_cast<size_t>(CAPACITY) == cache.size());
+    BOOST_CHECK(cache.find(0));
+    BOOST_CHECK(cache.find(5));
+    BOOST_CHECK(!cache.find(1));
+    BOOST_CHECK(!cache.find(4));
+    BOOST_CHECK(!cache.find(6));
+    BOOST_CHECK(cache.find(7));
+    BOOST_CHECK(cache.find(CAPACITY + 4));
+
+    // Something that doesn't fit at all isn't saved, and doesn't leave the
+    // old value behind either
+    const shared_ptr<const string> huge(
+        cache.insert(0, string(MAX_BYTES, 'x'), MAX_BYTES)
+    );
+    BOOST_REQUIRE(huge);
+    BOOST_CHECK(MAX_BYTES == huge->size());
+    BOOST_CHECK(!cache.find(0));
+    BOOST_CHECK(cache.getBytes() <= MAX_BYTES);
+}
+
+
+void testConcurrentCacheConcurrently()
+{
+    // Small enough that there are lots of evictions
+    Cache cache(500 * Cache::getEntryBytes(VALUE_LENGTH), 4);
+
+    const int THREADS_COUNT = 8;
+    int mismatched[THREADS_COUNT] = {0};
+    boost::thread_group threads;
+    for (int i = 0; i < THREADS_COUNT; ++i)
+    {
+        threads.create_thread(
+            boost::bind(findAndInsert, &cache, i, &mismatched[i])
+        );
+    }
+    threads.join_all();
+
+    for (int i = 0; i < THREADS_COUNT; ++i)
+    {
+        BOOST_CHECK_EQUAL(0, mismatched[i]);
+    }
+    BOOST_CHECK(cache.getHits() > 0);
+    BOOST_CHECK(cache.getEvictions() > 0);
+    BOOST_CHECK(THREADS_COUNT * 20000u == cache.getHits() + cache.getMisses());
+    BOOST_CHECK(
+        cache.size() * Cache::getEntryBytes(VALUE_LENGTH) == cache.getBytes()
+    );
+    BOOST_CHECK(cache.getBytes() <= 500 * Cache::getEntryBytes(VALUE_LENGTH));
+}
+
+
+string makeValue(const int key)
+{
+    const string value("value " + boost::lexical_cast<string>(key));
+    return value + string(VALUE_LENGTH - value.size(), '.');
+}
+
+
+void findAndInsert(
+    Cache* const cache,
+    const int thread,
+    int* const mismatched
+)
+{
+    unsigned int random = thread + 1;
+    for (int i = 0; i < 20000; ++i)
+    {
+        random = random * 1103515245 + 12345;
+        const int key = (random >> 8) % 2000;
+        const shared_ptr<const string> found(cache->find(key));
+        if (!found)
+        {
+            cache->insert(key, makeValue(key), VALUE_LENGTH);
+        }
+        else if (makeValue(key) != *found)
+        {
+            ++*mismatched;
+        }
+    }
+}
@@ -0,0 +1,346 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Tests the DlibProbabilities.
+ * @author Brandon Skari
+ * @date October 17 2026
+ */
+
+#include "testDlibProbabilities.hpp"
+#include "../AttackProbabilities.hpp"
+#include "../DlibProbabilities.hpp"
+#include "../QueryRisk.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+static const int RISKS_COUNT = 96;
+
+/**
+ * How far apart probabilities can be and still be the same, as a percentage
+ * for BOOST_CHECK_CLOSE and as a difference for probabilities near 0.
+ */
+///@{
+static const double TOLERANCE_PERCENT = 1e-9;
+static const double TOLERANCE = 1e-12;
+///@}
+
+/**
+ * The probabilities that the networks gave when they were still loaded from
+ * the net files by the Hugin parser, in the order of AttackScores. Each risk
+ * was computed with a new instance, because the old networks kept the
+ * evidence from earlier queries.
+ */
+struct NetFileProbabilities
+{
+    int risk;
+    double probabilities[AttackScores::ATTACKS_COUNT];
+};
+
+static const NetFileProbabilities NET_FILE_PROBABILITIES[] = {
+    {0, {
+        0.0410802231449169, 0.00357577810588742,
+        0.000353504556100354, 0.000929074215459769,
+        0.00342441304881129, 0.00139667299607831
+    }},
+    {11, {
+        0.854961775175566, 0.916983527791535,
+        0.486283710192304, 0.99999328490348,
+        0.716828120130477, 0.998982407759689
+    }},
+    {22, {
+        0.999989368011105, 0.999962418283012,
+        0.999892963276325, 0.999856374010226,
+        0.999399388391359, 0.445596597496095
+    }},
+    {37, {
+        0.999932502839427, 0.999898191137975,
+        0.136853740907225, 0.99896884410405,
+        0.999567803916818, 0.00145250502464299
+    }},
+    {45, {
+        0.999994379347029, 0.999995210208862,
+        0.487722718854349, 0.999999959769482,
+        0.99996718711087, 0.0795015508656342
+    }},
+    {58, {
+        0.99999758765207, 0.999999982598331,
+        0.999981993322248, 0.999999998338081,
+        0.999999554366188, 0.787133563959368
+    }},
+    {79, {
+        0.686827037130769, 0.999961227664337,
+        0.487719310219752, 0.999999999995509,
+        0.928032465085968, 0.998147189279899
+    }},
+    {95, {
+        0.999997164780856, 0.99999969496886,
+        0.999413923932924, 0.999999999995517,
+        0.998445495183161, 0.999999975250001
+    }}
+};
+
+/**
+ * Makes a different QueryRisk for each number, so that the threads look up
+ * different probabilities.
+ */
+static QueryRisk makeRisk(int number);
+
+/**
+ * Computes every type of attack probability for every risk.
+ */
+static void computeAll(
+    DlibProbabilities* probabilities,
+    vector<double>* results
+);
+
+
+void testDlibProbabilitiesConcurrently()
+{
+    DlibProbabilities probabilities;
+
+    const int THREADS_COUNT = 4;
+    vector<vector<double> > results(THREADS_COUNT);
+    boost::thread_group threads;
+    for (int i = 0; i < THREADS_COUNT; ++i)
+    {
+        threads.create_thread(
+            boost::bind(computeAll, &probabilities, &results[i])
+        );
+    }
+    threads.join_all();
+
+    for (int i = 1; i < THREADS_COUNT; ++i)
+    {
+        BOOST_REQUIRE(results[0].size() == results[i].size());
+        for (size_t j = 0; j < results[0].size(); ++j)
+        {
+            BOOST_CHECK_MESSAGE(
+                std::fabs(results[0][j] - results[i][j]) <= TOLERANCE,
+                "Probability " << j << " was " << results[0][j]
+                    << " in thread 0 but " << results[i][j]
+                    << " in thread " << i
+            );
+        }
+    }
+
+    // Each risk looks up one probability of each type of attack
+    for (int i = 0; i < RISKS_COUNT; ++i)
+    {
+        size_t checked;
+        size_t mismatched;
+        probabilities.verifyProbabilities(
+            makeRisk(i),
+            &checked,
+            &mismatched
+        );
+        BOOST_CHECK_EQUAL(
+            static_cast<size_t>(AttackScores::ATTACKS_COUNT),
+            checked
+        );
+        BOOST_CHECK_EQUAL(0u, mismatched);
+    }
+}
+
+
+void testDlibProbabilitiesScoreAll()
+{
+    DlibProbabilities probabilities;
+
+    const QueryRisk::QueryType types[] = {
+        QueryRisk::TYPE_SELECT,
+        QueryRisk::TYPE_INSERT,
+        QueryRisk::TYPE_UPDATE,
+        QueryRisk::TYPE_DELETE,
+        QueryRisk::TYPE_SHOW
+    };
+    const int TYPES_COUNT = sizeof(types) / sizeof(types[0]);
+
+    for (int i = 0; i < RISKS_COUNT; ++i)
+    {
+        QueryRisk qr(makeRisk(i));
+        qr.queryType = types[i % TYPES_COUNT];
+        qr.userTable = (i >> 1) & 1;
+
+        AttackScores scores;
+        probabilities.scoreAll(qr, &scores);
+
+        const bool select = (QueryRisk::TYPE_SELECT == qr.queryType);
+        const bool modification = (
+            QueryRisk::TYPE_INSERT == qr.queryType
+            || QueryRisk::TYPE_UPDATE == qr.queryType
+            || QueryRisk::TYPE_DELETE == qr.queryType
+        );
+        BOOST_CHECK_EQUAL(
+            select && qr.userTable,
+            scores.applicable[AttackScores::BYPASS_AUTHENTICATION]
+        );
+        BOOST_CHECK_EQUAL(
+            select,
+            scores.applicable[AttackScores::DATA_ACCESS]
+        );
+        BOOST_CHECK_EQUAL(
+            modification,
+            scores.applicable[AttackScores::DATA_MODIFICATION]
+        );
+        BOOST_CHECK_EQUAL(
+            select || modification,
+            scores.applicable[AttackScores::FINGERPRINTING]
+        );
+        BOOST_CHECK_EQUAL(
+            select || modification,
+            scores.applicable[AttackScores::SCHEMA]
+        );
+        BOOST_CHECK_EQUAL(
+            select,
+            scores.applicable[AttackScores::DENIAL_OF_SERVICE]
+        );
+
+        const double expected[AttackScores::ATTACKS_COUNT] = {
+            probabilities.getProbabilityOfBypassAttack(qr),
+            probabilities.getProbabilityOfAccessAttack(qr),
+            probabilities.getProbabilityOfModificationAttack(qr),
+            probabilities.getProbabilityOfFingerprintingAttack(qr),
+            probabilities.getProbabilityOfSchemaAttack(qr),
+            probabilities.getProbabilityOfDenialAttack(qr)
+        };
+        for (int j = 0; j < AttackScores::ATTACKS_COUNT; ++j)
+        {
+            if (scores.applicable[j])
+            {
+                BOOST_CHECK_CLOSE(
+                    expected[j],
+                    scores.probabilities[j],
+                    TOLERANCE_PERCENT
+                );
+            }
+            else
+            {
+                BOOST_CHECK_SMALL(scores.probabilities[j], TOLERANCE);
+            }
+        }
+    }
+}
+
+
+void testDlibProbabilitiesNetFiles()
+{
+    DlibProbabilities probabilities;
+
+    const int PROBABILITIES_COUNT =
+        sizeof(NET_FILE_PROBABILITIES) / sizeof(NET_FILE_PROBABILITIES[0]);
+    for (int i = 0; i < PROBABILITIES_COUNT; ++i)
+    {
+        const NetFileProbabilities& expected = NET_FILE_PROBABILITIES[i];
+        const QueryRisk qr(makeRisk(expected.risk));
+        const double computed[AttackScores::ATTACKS_COUNT] = {
+            probabilities.getProbabilityOfBypassAttack(qr),
+            probabilities.getProbabilityOfAccessAttack(qr),
+            probabilities.getProbabilityOfModificationAttack(qr),
+            probabilities.getProbabilityOfFingerprintingAttack(qr),
+            probabilities.getProbabilityOfSchemaAttack(qr),
+            probabilities.getProbabilityOfDenialAttack(qr)
+        };
+        for (int j = 0; j < AttackScores::ATTACKS_COUNT; ++j)
+        {
+            BOOST_TEST_CHECKPOINT("Risk " << expected.risk << ", attack " << j);
+            BOOST_CHECK_CLOSE(
+                expected.probabilities[j],
+                computed[j],
+                TOLERANCE_PERCENT
+            );
+        }
+    }
+}
+
+
+QueryRisk makeRisk(const int number)
+{
+    QueryRisk qr;
+    qr.queryType = (number % 2 == 0)
+        ? QueryRisk::TYPE_SELECT
+        : QueryRisk::TYPE_INSERT;
+    qr.mySqlComments = (number >> 1) & 1;
+    qr.mySqlVersionedComments = (number >> 2) & 1;
+    qr.sensitiveTables = (number >> 3) & 1;
+    qr.orStatements = (number >> 1) & 1;
+    qr.unionStatements = (number >> 4) & 1;
+    qr.unionAllStatements = (number >> 5) & 1;
+    qr.bruteForceCommands = (number >> 2) & 1;
+    qr.ifStatements = (number >> 3) & 1;
+    qr.hexStrings = (number >> 4) & 1;
+    qr.benchmarkStatements = (number >> 6) & 1;
+    qr.userStatements = (number >> 5) & 1;
+    qr.fingerprintingStatements = (number >> 6) & 1;
+    qr.mySqlStringConcat = (number >> 3) & 1;
+    qr.stringManipulationStatements = number % 6;
+    qr.alwaysTrueConditional = (number >> 2) & 1;
+    qr.commentedConditionals = (number >> 5) & 1;
+    qr.commentedQuotes = (number >> 4) & 1;
+    qr.globalVariables = (number >> 1) & 1;
+    qr.joinStatements = number % 7;
+    qr.regexLength = (number * 3) % 32;
+    qr.slowRegexes = (number >> 3) & 1;
+    switch (number % 3)
+    {
+    case 0:
+        qr.emptyPassword = QueryRisk::PASSWORD_EMPTY;
+        break;
+    case 1:
+        qr.emptyPassword = QueryRisk::PASSWORD_NOT_EMPTY;
+        break;
+    default:
+        qr.emptyPassword = QueryRisk::PASSWORD_NOT_USED;
+    }
+    qr.orderByNumber = (number >> 4) & 1;
+    qr.alwaysTrue = (number >> 2) & 1;
+    qr.informationSchema = (number >> 5) & 1;
+    return qr;
+}
+
+
+void computeAll(
+    DlibProbabilities* const probabilities,
+    vector<double>* const results
+)
+{
+    for (int i = 0; i < RISKS_COUNT; ++i)
+    {
+        const QueryRisk qr(makeRisk(i));
+        results->push_back(probabilities->getProbabilityOfAccessAttack(qr));
+        results->push_back(probabilities->getProbabilityOfBypassAttack(qr));
+        results->push_back(
+            probabilities->getProbabilityOfModificationAttack(qr)
+        );
+        results->push_back(
+            probabilities->getProbabilityOfFingerprintingAttack(qr)
+        );
+        results->push_back(probabilities->getProbabilityOfSchemaAttack(qr));
+        results->push_back(probabilities->getProbabilityOfDenialAttack(qr));
+    }
+}
@@ -0,0 +1,44 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SRC_TESTS_TESTDLIBPROBABILITIES_HPP_
+#define SRC_TESTS_TESTDLIBPROBABILITIES_HPP_
+
+/**
+ * Tests that one DlibProbabilities can be used from several threads at
+ * once, and that the probabilities that they compute are the same in every
+ * thread and match the networks.
+ */
+void testDlibProbabilitiesConcurrently();
+
+/**
+ * Tests that scoring every type of attack at once gives the same
+ * probabilities as computing them one at a time, for the types of attack that
+ * apply to the query.
+ */
+void testDlibProbabilitiesScoreAll();
+
+/**
+ * Tests that every network gives the same probabilities as it did when it
+ * was loaded from its net file by the Hugin parser, so that a mistake in
+ * generating the networks at build time can't change them.
+ */
+void testDlibProbabilitiesNetFiles();
+
+#endif  // SRC_TESTS_TESTDLIBPROBABILITIES_HPP_
@@ -0,0 +1,206 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Tests the epoll based EventLoop.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testEventLoop.hpp"
+#include "../AutoPtrWithOperatorParens.hpp"
+#include "../EpollEventLoop.hpp"
+#include "../EventLoop.hpp"
+#include "../IoUringEventLoop.hpp"
+#include "../ProxyHalf.hpp"
+#include "../Socket.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include <memory>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using std::auto_ptr;
+using std::vector;
+
+// Large enough to fill up the kernel buffers so that sends are only partially
+// completed and have to be queued
+static const size_t TRANSFER_SIZE = 8 * 1024 * 1024;
+
+static uint8_t byteAt(size_t i);
+static void writeAll(int fd, size_t size);
+static vector<uint8_t> readAll(int fd, size_t size);
+static void addConnection(EventLoop* loop, int clientFD, int serverFD);
+static void checkForwarding(EventLoop* loop);
+static void checkClose(EventLoop* loop);
+
+
+void testEventLoopForwarding()
+{
+    EpollEventLoop epollLoop;
+    checkForwarding(&epollLoop);
+
+    if (IoUringEventLoop::isSupported())
+    {
+        IoUringEventLoop ioUringLoop;
+        checkForwarding(&ioUringLoop);
+    }
+}
+
+
+void testEventLoopClose()
+{
+    EpollEventLoop epollLoop;
+    checkClose(&epollLoop);
+
+    if (IoUringEventLoop::isSupported())
+    {
+        IoUringEventLoop ioUringLoop;
+        checkClose(&ioUringLoop);
+    }
+}
+
+
+void checkForwarding(EventLoop* const loop)
+{
+    int client[2];
+    int server[2];
+    BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, client));
+    BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, server));
+
+    addConnection(loop, client[1], server[1]);
+    BOOST_CHECK(1 == loop->getConnectionCount());
+
+    // Client to server
+    boost::thread clientWriter(boost::bind(writeAll, client[0], TRANSFER_SIZE));
+    // Give the loop time to fill up the server's buffer
+    usleep(100000);
+    const vector<uint8_t> toServer(readAll(server[0], TRANSFER_SIZE));
+    clientWriter.join();
+    BOOST_REQUIRE(TRANSFER_SIZE == toServer.size());
+    bool same = true;
+    for (size_t i = 0; i < toServer.size() && same; ++i)
+    {
+        same = (byteAt(i) == toServer[i]);
+    }
+    BOOST_CHECK(same);
+
+    // Server to client
+    boost::thread serverWriter(boost::bind(writeAll, server[0], TRANSFER_SIZE));
+    usleep(100000);
+    const vector<uint8_t> toClient(readAll(client[0], TRANSFER_SIZE));
+    serverWriter.join();
+    BOOST_REQUIRE(TRANSFER_SIZE == toClient.size());
+    same = true;
+    for (size_t i = 0; i < toClient.size() && same; ++i)
+    {
+        same = (byteAt(i) == toClient[i]);
+    }
+    BOOST_CHECK(same);
+
+    close(client[0]);
+    close(server[0]);
+}
+
+
+void checkClose(EventLoop* const loop)
+{
+    int client[2];
+    int server[2];
+    BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, client));
+    BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, server));
+
+    addConnection(loop, client[1], server[1]);
+    BOOST_CHECK(1 == loop->getConnectionCount());
+
+    close(client[0]);
+    // The loop should close the server side for us
+    char buffer[16];
+    BOOST_CHECK(0 == read(server[0], buffer, sizeof(buffer)));
+    for (int i = 0; i < 100 && 0 != loop->getConnectionCount(); ++i)
+    {
+        usleep(10000);
+    }
+    BOOST_CHECK(0 == loop->getConnectionCount());
+
+    close(server[0]);
+}
+
+
+uint8_t byteAt(const size_t i)
+{
+    return static_cast<uint8_t>(i * 7 + i / 4096);
+}
+
+
+void writeAll(const int fd, const size_t size)
+{
+    vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        data[i] = byteAt(i);
+    }
+    size_t written = 0;
+    while (written < size)
+    {
+        const ssize_t bytes = write(fd, &data[written], size - written);
+        if (bytes <= 0)
+        {
+            return;
+        }
+        written += bytes;
+    }
+}
+
+
+vector<uint8_t> readAll(const int fd, const size_t size)
+{
+    vector<uint8_t> data;
+    data.reserve(size);
+    uint8_t buffer[65536];
+    while (data.size() < size)
+    {
+        const ssize_t bytes = read(fd, buffer, sizeof(buffer));
+        if (bytes <= 0)
+        {
+            break;
+        }
+        data.insert(data.end(), buffer, buffer + bytes);
+    }
+    return data;
+}
+
+
+void addConnection(EventLoop* const loop, const int clientFD, const int serverFD)
+{
+    auto_ptr<Socket> clientSocket(new Socket(clientFD));
+    auto_ptr<Socket> serverSocket(new Socket(serverFD));
+    AutoPtrWithOperatorParens<ProxyHalf> in(
+        new ProxyHalf(clientSocket.get(), serverSocket.get())
+    );
+    AutoPtrWithOperatorParens<ProxyHalf> out(
+        new ProxyHalf(serverSocket.get(), clientSocket.get())
+    );
+    loop->addProxy(in, out, clientSocket, serverSocket);
+}
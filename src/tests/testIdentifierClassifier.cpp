@@ -0,0 +1,180 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Tests the IdentifierClassifier.
+ * @author Brandon Skari
+ * @date October 17 2026
+ */
+
+#include "testIdentifierClassifier.hpp"
+#include "../IdentifierClassifier.hpp"
+#include "../QueryRisk.hpp"
+
+#include <boost/regex.hpp>
+#include <boost/test/unit_test.hpp>
+#include <string>
+
+using boost::regex;
+using boost::regex_search;
+using std::string;
+
+/**
+ * The regular expressions that QueryRisk used before, to check against.
+ */
+///@{
+static const regex bruteForceCommandsRegex(
+    "^(mid|substr|substring|load_file|char)$",
+    regex::perl | regex::icase);
+static const regex stringManipulationRegex(
+    "^(concat|concatws|char|insert|hex|mid|replace|reverse|substr|substring)$",
+    regex::perl | regex::icase);
+static const regex userStatementsRegex(
+    "^(current_user|session_user|system_user|user)$",
+    regex::perl | regex::icase);
+static const regex fingerprintingRegex(
+    "^(schema|database|version|connection_id|last_insert_id|row_count)$",
+    regex::perl | regex::icase);
+static const regex benchmarkRegex("^benchmark$", regex::perl | regex::icase);
+static const regex ifRegex("^if$", regex::perl | regex::icase);
+static const regex informationSchemaRegex(
+    "^(information_schema|mysql)$", regex::perl | regex::icase);
+static const regex sensitiveTablesRegex(
+    ".*(customer|member|order|admin|user|permission|session).*",
+    regex::perl | regex::icase);
+static const regex userTableRegex(
+    "(user|customer|member)", regex::perl | regex::icase);
+///@}
+
+/**
+ * Checks that the classifier puts a name in the same categories as the
+ * regular expressions.
+ */
+static void checkName(const string& name);
+
+/**
+ * Checks that the classifier finds the same fragments in a table name as the
+ * regular expressions.
+ */
+static void checkTable(const string& table);
+
+
+void testIdentifierClassifierNames()
+{
+    const char* const names[] = {
+        "mid", "MID", "substr", "Substring", "load_file", "LOAD_FILE", "char",
+        "concat", "concatws", "concat_ws", "insert", "hex", "replace",
+        "reverse", "current_user", "session_user", "system_user", "user",
+        "USER", "schema", "database", "version", "connection_id",
+        "last_insert_id", "row_count", "benchmark", "BENCHMARK", "if", "IF",
+        "information_schema", "INFORMATION_SCHEMA", "mysql", "MySql",
+        // Near misses
+        "", "i", "ifnull", "mids", "amid", "substrin", "substrings",
+        "users", "_user", "mysql_", "information-schema", "count", "lower",
+        "load_fil", "hex2", "char_length", "curren_user", "`mysql`"
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+    {
+        checkName(names[i]);
+    }
+
+    // The whole length is used, not just up to a null
+    const char withNull[] = {'i', 'f', '\0', 'x'};
+    BOOST_CHECK_EQUAL(
+        static_cast<unsigned int>(IdentifierClassifier::NONE),
+        IdentifierClassifier::classifyName(withNull, sizeof(withNull))
+    );
+    BOOST_CHECK_EQUAL(
+        static_cast<unsigned int>(IdentifierClassifier::IF_FUNCTION),
+        IdentifierClassifier::classifyName("ifx", 2)
+    );
+
+    QueryRisk qr;
+    qr.checkFunction("CHAR");
+    qr.checkFunction("version");
+    qr.checkDatabase("information_schema");
+    BOOST_CHECK_EQUAL(1u, qr.bruteForceCommands);
+    BOOST_CHECK_EQUAL(1u, qr.stringManipulationStatements);
+    BOOST_CHECK_EQUAL(1u, qr.fingerprintingStatements);
+    BOOST_CHECK(qr.informationSchema);
+}
+
+
+void testIdentifierClassifierTables()
+{
+    const char* const tables[] = {
+        "customer", "customers", "wp_members", "ORDER_ITEMS", "sysadmin",
+        "Users", "user_permissions", "php_session", "page", "revision",
+        "text", "", "u", "use", "usr", "memberuser", "custome",
+        // Partial fragments that run into a whole one
+        "ususer", "mememberx", "ordeorder", "sessiosession",
+        "permissiopermission", "cuscustomer", "admiadmin", "customember",
+        "user-name", "`user`", "order_", "x_perm_session"
+    };
+    for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); ++i)
+    {
+        checkTable(tables[i]);
+    }
+
+    QueryRisk qr;
+    qr.checkTable("members");
+    qr.checkTable("orders");
+    qr.checkTable("page");
+    BOOST_CHECK_EQUAL(2u, qr.sensitiveTables);
+    BOOST_CHECK(qr.userTable);
+}
+
+
+void checkName(const string& name)
+{
+    const unsigned int categories =
+        IdentifierClassifier::classifyName(name.data(), name.size());
+    BOOST_CHECK_MESSAGE(
+        regex_search(name, bruteForceCommandsRegex)
+            == (0 != (categories & IdentifierClassifier::BRUTE_FORCE))
+        && regex_search(name, stringManipulationRegex)
+            == (0 != (categories & IdentifierClassifier::STRING_MANIPULATION))
+        && regex_search(name, userStatementsRegex)
+            == (0 != (categories & IdentifierClassifier::USER_STATEMENT))
+        && regex_search(name, fingerprintingRegex)
+            == (0 != (categories & IdentifierClassifier::FINGERPRINTING))
+        && regex_search(name, benchmarkRegex)
+            == (0 != (categories & IdentifierClassifier::BENCHMARK))
+        && regex_search(name, ifRegex)
+            == (0 != (categories & IdentifierClassifier::IF_FUNCTION))
+        && regex_search(name, informationSchemaRegex)
+            == (0 != (categories & IdentifierClassifier::INFORMATION_SCHEMA)),
+        "Classified '" << name << "' differently"
+    );
+}
+
+
+void checkTable(const string& table)
+{
+    const unsigned int categories =
+        IdentifierClassifier::classifyTable(table.data(), table.size());
+    BOOST_CHECK_MESSAGE(
+        regex_search(table, sensitiveTablesRegex)
+            == (0 != (categories & IdentifierClassifier::SENSITIVE_TABLE))
+        && regex_search(table, userTableRegex)
+            == (0 != (categories & IdentifierClassifier::USER_TABLE)),
+        "Classified table '" << table << "' differently"
+    );
+}
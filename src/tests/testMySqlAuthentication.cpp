@@ -0,0 +1,250 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Tests the MySqlAuthentication.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testMySqlAuthentication.hpp"
+#include "../MySqlAuthentication.hpp"
+#include "../MySqlConstants.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+static vector<uint8_t> hash(const string& data);
+
+
+void testMySqlAuthenticationRecover()
+{
+    // From SELECT PASSWORD('password')
+    vector<uint8_t> storedHash;
+    BOOST_REQUIRE(
+        MySqlAuthentication::parseStoredHash(
+            "*2470C0C06DEE42FD1618BB99005ADCA2EC9D1E19",
+            &storedHash
+        )
+    );
+    const vector<uint8_t> passwordHash(hash("password"));
+    vector<uint8_t> check;
+    MySqlAuthentication::sha1(&passwordHash[0], passwordHash.size(), &check);
+    BOOST_CHECK(storedHash == check);
+
+    vector<uint8_t> scramble;
+    for (uint8_t i = 0; i < MySqlAuthentication::SCRAMBLE_LENGTH; ++i)
+    {
+        scramble.push_back('A' + i);
+    }
+    vector<uint8_t> token;
+    MySqlAuthentication::scramblePassword(passwordHash, scramble, &token);
+    BOOST_REQUIRE(MySqlAuthentication::HASH_LENGTH == token.size());
+
+    vector<uint8_t> recovered;
+    BOOST_CHECK(
+        MySqlAuthentication::recoverPasswordHash(
+            token,
+            scramble,
+            storedHash,
+            &recovered
+        )
+    );
+    BOOST_CHECK(passwordHash == recovered);
+
+    // The wrong password doesn't give anything back
+    MySqlAuthentication::scramblePassword(hash("wrong"), scramble, &token);
+    BOOST_CHECK(
+        !MySqlAuthentication::recoverPasswordHash(
+            token,
+            scramble,
+            storedHash,
+            &recovered
+        )
+    );
+    BOOST_CHECK(recovered.empty());
+
+    // Users without passwords send an empty answer
+    vector<uint8_t> noPassword;
+    BOOST_CHECK(MySqlAuthentication::parseStoredHash("", &noPassword));
+    BOOST_CHECK(noPassword.empty());
+    MySqlAuthentication::scramblePassword(noPassword, scramble, &token);
+    BOOST_CHECK(token.empty());
+    BOOST_CHECK(
+        MySqlAuthentication::recoverPasswordHash(
+            token,
+            scramble,
+            noPassword,
+            &recovered
+        )
+    );
+
+    // Old style hashes aren't supported
+    BOOST_CHECK(
+        !MySqlAuthentication::parseStoredHash("5d2e19393cc5ef67", &storedHash)
+    );
+}
+
+
+void testMySqlAuthenticationScramble()
+{
+    vector<uint8_t> handshake(4, 0);
+    handshake.push_back(MySqlAuthentication::PROTOCOL_VERSION);
+    const char version[] = "5.5.62";
+    handshake.insert(handshake.end(), version, version + sizeof(version));
+    // Thread id
+    handshake.insert(handshake.end(), 4, 1);
+    const char scramble[] = "abcdefghijklmnopqrst";
+    handshake.insert(handshake.end(), scramble, scramble + 8);
+    // Filler, capabilities, character set, status, filler
+    handshake.insert(handshake.end(), 1 + 2 + 1 + 2 + 13, 0);
+    handshake.insert(handshake.end(), scramble + 8, scramble + 20);
+    handshake.push_back('\0');
+
+    vector<uint8_t> parsed;
+    BOOST_CHECK(
+        MySqlAuthentication::getScramble(
+            &handshake[0],
+            handshake.size(),
+            &parsed
+        )
+    );
+    BOOST_CHECK(vector<uint8_t>(scramble, scramble + 20) == parsed);
+
+    // Cut off before the end of the scramble
+    BOOST_CHECK(
+        !MySqlAuthentication::getScramble(
+            &handshake[0],
+            handshake.size() - 5,
+            &parsed
+        )
+    );
+
+    // Not a protocol 10 handshake
+    handshake[4] = 9;
+    BOOST_CHECK(
+        !MySqlAuthentication::getScramble(
+            &handshake[0],
+            handshake.size(),
+            &parsed
+        )
+    );
+}
+
+
+void testMySqlAuthenticationPrepareHandshake()
+{
+    vector<uint8_t> handshake(4, 0);
+    handshake.push_back(MySqlAuthentication::PROTOCOL_VERSION);
+    const char version[] = "5.7.44";
+    handshake.insert(handshake.end(), version, version + sizeof(version));
+    // Thread id
+    handshake.insert(handshake.end(), 4, 1);
+    const char scramble[] = "abcdefghijklmnopqrst";
+    handshake.insert(handshake.end(), scramble, scramble + 8);
+    // Filler, then capabilities with SSL
+    handshake.push_back(0);
+    handshake.push_back(0xFF);
+    handshake.push_back(0xFF);
+    // Character set, status, then upper capabilities with OK packets
+    // instead of EOF packets, then filler
+    handshake.insert(handshake.end(), 1 + 2, 0);
+    handshake.push_back(0xFF);
+    handshake.push_back(0xFF);
+    handshake.insert(handshake.end(), 13 - 2, 0);
+    handshake.insert(handshake.end(), scramble + 8, scramble + 20);
+    handshake.push_back('\0');
+    const char plugin[] = "caching_sha2_password";
+    handshake.insert(handshake.end(), plugin, plugin + sizeof(plugin));
+
+    vector<uint8_t> newScramble;
+    MySqlAuthentication::makeScramble(&newScramble);
+    BOOST_REQUIRE(MySqlAuthentication::SCRAMBLE_LENGTH == newScramble.size());
+    for (size_t i = 0; i < newScramble.size(); ++i)
+    {
+        BOOST_CHECK(newScramble[i] >= '!' && newScramble[i] <= '~');
+    }
+
+    BOOST_REQUIRE(
+        MySqlAuthentication::prepareHandshake(&handshake, newScramble)
+    );
+    vector<uint8_t> parsed;
+    BOOST_REQUIRE(
+        MySqlAuthentication::getScramble(
+            &handshake[0],
+            handshake.size(),
+            &parsed
+        )
+    );
+    BOOST_CHECK(newScramble == parsed);
+
+    // Clients can't ask for SSL, because SQLassie would have to answer it
+    const size_t BEGIN_CAPABILITIES = 4 + 1 + sizeof(version) + 4 + 8 + 1;
+    BOOST_CHECK(
+        0 == (
+            handshake[BEGIN_CAPABILITIES + 1]
+            & (MySqlConstants::CLIENT_SSL >> 8)
+        )
+    );
+    // The pooled connections get EOF packets, so the clients have to too
+    const size_t BEGIN_UPPER_CAPABILITIES = BEGIN_CAPABILITIES + 2 + 1 + 2;
+    BOOST_CHECK(
+        0 == (
+            handshake[BEGIN_UPPER_CAPABILITIES + 1]
+            & (MySqlConstants::CLIENT_DEPRECATE_EOF >> 24)
+        )
+    );
+    BOOST_CHECK(0xFF == handshake[BEGIN_UPPER_CAPABILITIES]);
+
+    const char native[] = "mysql_native_password";
+    BOOST_CHECK(
+        0 == memcmp(
+            &handshake[handshake.size() - sizeof(native)],
+            native,
+            sizeof(native)
+        )
+    );
+    const size_t length =
+        handshake[0] | (handshake[1] << 8) | (handshake[2] << 16);
+    BOOST_CHECK(handshake.size() - 4 == length);
+
+    // Not a handshake
+    vector<uint8_t> notHandshake(handshake.begin(), handshake.begin() + 10);
+    BOOST_CHECK(
+        !MySqlAuthentication::prepareHandshake(&notHandshake, newScramble)
+    );
+}
+
+
+vector<uint8_t> hash(const string& data)
+{
+    vector<uint8_t> result;
+    MySqlAuthentication::sha1(
+        reinterpret_cast<const uint8_t*>(data.c_str()),
+        data.size(),
+        &result
+    );
+    return result;
+}
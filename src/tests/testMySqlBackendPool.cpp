@@ -0,0 +1,130 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Tests the MySqlBackendPool.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testMySqlBackendPool.hpp"
+#include "../MySqlBackendPool.hpp"
+#include "../nullptr.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/test/unit_test.hpp>
+#include <string>
+
+using std::string;
+
+
+void testMySqlBackendPoolBalancing()
+{
+    MySqlBackendPool pool;
+    BOOST_CHECK(-1 == pool.acquire());
+
+    pool.addBackend("127.0.0.1", 3307, 1);
+    pool.addBackend("127.0.0.1", 3308, 2);
+    BOOST_REQUIRE(2 == pool.size());
+
+    // The second server should get twice as many connections
+    for (int i = 0; i < 6; ++i)
+    {
+        BOOST_CHECK(-1 != pool.acquire());
+    }
+    BOOST_CHECK(2 == pool.getConnectionCount(0));
+    BOOST_CHECK(4 == pool.getConnectionCount(1));
+
+    // Closing connections makes room on that server again
+    pool.release(1);
+    pool.release(1);
+    BOOST_CHECK(1 == pool.acquire());
+    BOOST_CHECK(3 == pool.getConnectionCount(1));
+
+    // Servers that are down don't get any connections
+    pool.markDown(1);
+    BOOST_CHECK(!pool.isHealthy(1));
+    for (int i = 0; i < 4; ++i)
+    {
+        BOOST_CHECK(0 == pool.acquire());
+    }
+    pool.markDown(0);
+    BOOST_CHECK(-1 == pool.acquire());
+}
+
+
+void testMySqlBackendPoolParse()
+{
+    string host;
+    uint16_t port;
+    unsigned weight;
+
+    BOOST_CHECK(
+        MySqlBackendPool::parseBackend("db1:3306", &host, &port, &weight)
+    );
+    BOOST_CHECK("db1" == host);
+    BOOST_CHECK(3306 == port);
+    BOOST_CHECK(1 == weight);
+
+    BOOST_CHECK(
+        MySqlBackendPool::parseBackend(
+            "10.0.0.2:3307:5",
+            &host,
+            &port,
+            &weight
+        )
+    );
+    BOOST_CHECK("10.0.0.2" == host);
+    BOOST_CHECK(3307 == port);
+    BOOST_CHECK(5 == weight);
+
+    const char* const invalid[] = {
+        "",
+        "db1",
+        "db1:",
+        ":3306",
+        "db1:port",
+        "db1:70000",
+        "db1:3306:0",
+        "db1:3306:heavy",
+        "db1:3306:1:1"
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i)
+    {
+        BOOST_CHECK_MESSAGE(
+            !MySqlBackendPool::parseBackend(invalid[i], &host, &port, &weight),
+            invalid[i]
+        );
+    }
+}
+
+
+void testMySqlBackendPoolHealthCheck()
+{
+    MySqlBackendPool pool(100);
+    // Nothing should be listening on the TCP port multiplexer port
+    pool.addBackend("127.0.0.1", 1, 1);
+    BOOST_CHECK(pool.isHealthy(0));
+    BOOST_CHECK(nullptr == pool.connect(0));
+    BOOST_CHECK(!pool.isHealthy(0));
+
+    pool.checkHealth();
+    BOOST_CHECK(!pool.isHealthy(0));
+    BOOST_CHECK(-1 == pool.acquire());
+}
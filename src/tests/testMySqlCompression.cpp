@@ -0,0 +1,114 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Tests the MySqlCompression.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testMySqlCompression.hpp"
+#include "../MySqlCompression.hpp"
+#include "../nullptr.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <vector>
+
+using std::vector;
+
+static vector<uint8_t> readFrames(const vector<uint8_t>& frames);
+
+
+void testMySqlCompressionFrames()
+{
+    const MySqlCompression compression(MySqlCompression::DEFAULT_LEVEL, 50);
+    const size_t HEADER_LENGTH = MySqlCompression::HEADER_LENGTH;
+
+    // Repetitive data gets compressed
+    const vector<uint8_t> repetitive(10000, 'a');
+    vector<uint8_t> frames;
+    BOOST_CHECK(7 == compression.appendFrames(
+        &repetitive[0],
+        repetitive.size(),
+        7,
+        &frames
+    ));
+    BOOST_CHECK(frames.size() < repetitive.size());
+    BOOST_CHECK(7 == frames.at(3));
+    BOOST_CHECK(frames.size() == MySqlCompression::frameLength(frames, 0));
+    BOOST_CHECK(readFrames(frames) == repetitive);
+
+    // A frame isn't ready until all of it is here
+    vector<uint8_t> partial(frames.begin(), frames.end() - 1);
+    BOOST_CHECK(0 == MySqlCompression::frameLength(partial, 0));
+
+    // Small data is stored as is
+    const vector<uint8_t> small(10, 'b');
+    frames.clear();
+    compression.appendFrames(&small[0], small.size(), 0, &frames);
+    BOOST_REQUIRE(HEADER_LENGTH + small.size() == frames.size());
+    BOOST_CHECK(0 == frames.at(4) && 0 == frames.at(5) && 0 == frames.at(6));
+    BOOST_CHECK(readFrames(frames) == small);
+
+    // So is data that doesn't get any smaller
+    vector<uint8_t> random(1000);
+    srand(1);
+    for (size_t i = 0; i < random.size(); ++i)
+    {
+        random[i] = rand() & 0xFF;
+    }
+    frames.clear();
+    compression.appendFrames(&random[0], random.size(), 0, &frames);
+    BOOST_CHECK(HEADER_LENGTH + random.size() == frames.size());
+    BOOST_CHECK(readFrames(frames) == random);
+
+    // Nothing still takes a frame
+    frames.clear();
+    compression.appendFrames(nullptr, 0, 3, &frames);
+    BOOST_CHECK(HEADER_LENGTH == frames.size());
+    BOOST_CHECK(readFrames(frames).empty());
+
+    // Frames can only hold so much, so big data takes several
+    const vector<uint8_t> huge(MySqlCompression::MAX_FRAME_LENGTH + 100, 'c');
+    frames.clear();
+    BOOST_CHECK(1 == compression.appendFrames(
+        &huge[0],
+        huge.size(),
+        0,
+        &frames
+    ));
+    BOOST_CHECK(readFrames(frames) == huge);
+}
+
+
+vector<uint8_t> readFrames(const vector<uint8_t>& frames)
+{
+    vector<uint8_t> data;
+    size_t offset = 0;
+    size_t length;
+    while (0 != (length = MySqlCompression::frameLength(frames, offset)))
+    {
+        MySqlCompression::decompressFrame(&frames[offset], length, &data);
+        offset += length;
+    }
+    BOOST_CHECK(offset == frames.size());
+    return data;
+}
@@ -0,0 +1,638 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Tests the MySqlConnectionPool.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testMySqlConnectionPool.hpp"
+#include "../MySqlBackendConnection.hpp"
+#include "../MySqlConnectionPool.hpp"
+#include "../MySqlConstants.hpp"
+#include "../MySqlPacketReader.hpp"
+#include "../MySqlSessionState.hpp"
+#include "../nullptr.hpp"
+#include "../PacketBufferPool.hpp"
+#include "../QueryRisk.hpp"
+#include "../SocketException.hpp"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+using boost::algorithm::istarts_with;
+using boost::lock_guard;
+using boost::mutex;
+using std::ostringstream;
+using std::string;
+using std::vector;
+
+/**
+ * Just enough of a MySQL server on a Unix domain socket to log pooled
+ * connections in and answer their queries. Each connection remembers its
+ * own LAST_INSERT_ID() and whether it's in a transaction, like a real one.
+ */
+class FakeMySqlServer
+{
+public:
+    FakeMySqlServer();
+    ~FakeMySqlServer();
+
+    inline const string& getPath() const { return path_; }
+
+    /**
+     * Returns the number of connections that have been opened.
+     */
+    size_t getConnectionCount() const;
+
+    /**
+     * Returns the queries that a connection has run, in order.
+     * @param connection The connection's number, counting from 0.
+     */
+    vector<string> getQueries(size_t connection) const;
+
+private:
+    void acceptConnections();
+    void serveConnection(int fd, size_t connection);
+
+    const string path_;
+    const int listener_;
+    vector<int> connections_;
+    vector<vector<string> > queries_;
+    uint8_t nextInsertId_;
+    mutable mutex mutex_;
+    boost::thread acceptor_;
+    boost::thread_group servers_;
+
+    // ***** Hidden methods *****
+    FakeMySqlServer(const FakeMySqlServer&);
+    FakeMySqlServer& operator=(const FakeMySqlServer&);
+};
+
+static vector<vector<uint8_t> > runPooled(
+    MySqlConnectionPool* pool,
+    MySqlSessionState* session,
+    MySqlBackendConnection** backend,
+    const string& query,
+    QueryRisk::QueryType type
+);
+static string makeSocketPath();
+static string getSingleValue(const vector<vector<uint8_t> >& response);
+static void appendPacket(
+    vector<uint8_t>* stream,
+    uint8_t packetNumber,
+    const vector<uint8_t>& payload
+);
+static void appendOk(
+    vector<uint8_t>* stream,
+    uint8_t packetNumber,
+    uint8_t insertId,
+    uint16_t status
+);
+static bool readPacket(int fd, vector<uint8_t>* payload);
+static void writeAll(int fd, const vector<uint8_t>& data);
+
+
+void testMySqlConnectionPoolUnreachable()
+{
+    // Nothing should be listening on the TCP port multiplexer port
+    MySqlConnectionPool pool(1, "127.0.0.1", 1, 100);
+    MySqlSessionState session;
+    session.setDatabase("test");
+    const vector<uint8_t> passwordHash;
+
+    MySqlConnectionPool::ACQUIRE_ERROR error =
+        MySqlConnectionPool::ACQUIRE_TIMED_OUT;
+    BOOST_CHECK(
+        nullptr == pool.acquire("user", passwordHash, 8, session, &error)
+    );
+    BOOST_CHECK(MySqlConnectionPool::ACQUIRE_UNREACHABLE == error);
+    BOOST_CHECK(0 == pool.getConnectionCount("user", "test"));
+    BOOST_CHECK(0 == pool.getIdleCount());
+
+    // The failed connection doesn't take up the only slot
+    BOOST_CHECK(nullptr == pool.acquire("user", passwordHash, 8, session));
+    BOOST_CHECK(0 == pool.getConnectionCount("user", "test"));
+
+    vector<uint8_t> handshake;
+    BOOST_CHECK_THROW(pool.makeHandshake(&handshake), SocketException);
+}
+
+
+void testMySqlConnectionPoolSessions()
+{
+    FakeMySqlServer server;
+    MySqlConnectionPool pool(server.getPath(), 2, 1000);
+    const vector<uint8_t> passwordHash;
+    MySqlSessionState plain;
+    plain.setDatabase("test");
+    MySqlSessionState utf8(plain);
+    utf8.observeQuery("SET NAMES utf8", QueryRisk::TYPE_SET);
+
+    MySqlBackendConnection* const first =
+        pool.acquire("user", passwordHash, 8, plain);
+    BOOST_REQUIRE(nullptr != first);
+    pool.release(first, plain);
+    BOOST_CHECK(1 == pool.getIdleCount());
+
+    // The same settings get the same connection back
+    MySqlBackendConnection* const again =
+        pool.acquire("user", passwordHash, 8, plain);
+    BOOST_CHECK(first == again);
+    pool.release(again, plain);
+
+    // Other settings need a connection of their own, which gets them set
+    MySqlBackendConnection* const second =
+        pool.acquire("user", passwordHash, 8, utf8);
+    BOOST_REQUIRE(nullptr != second);
+    BOOST_CHECK(first != second);
+    BOOST_REQUIRE(2 == server.getConnectionCount());
+    BOOST_CHECK(server.getQueries(0).empty());
+    const vector<string> setUp(server.getQueries(1));
+    BOOST_REQUIRE(1 == setUp.size());
+    BOOST_CHECK("SET NAMES utf8" == setUp.at(0));
+    pool.release(second, utf8);
+
+    // Each session finds its own connection again
+    MySqlBackendConnection* const plainAgain =
+        pool.acquire("user", passwordHash, 8, plain);
+    MySqlBackendConnection* const utf8Again =
+        pool.acquire("user", passwordHash, 8, utf8);
+    BOOST_CHECK(first == plainAgain);
+    BOOST_CHECK(second == utf8Again);
+    BOOST_CHECK(2 == server.getConnectionCount());
+    BOOST_CHECK(1 == server.getQueries(1).size());
+    pool.release(plainAgain, plain);
+    pool.release(utf8Again, utf8);
+    BOOST_CHECK(2 == pool.getIdleCount());
+}
+
+
+void testMySqlConnectionPoolTransaction()
+{
+    FakeMySqlServer server;
+    MySqlConnectionPool pool(server.getPath(), 2, 1000);
+    MySqlSessionState client;
+    client.setDatabase("test");
+    MySqlSessionState other(client);
+    MySqlBackendConnection* backend = nullptr;
+    MySqlBackendConnection* otherBackend = nullptr;
+
+    runPooled(&pool, &client, &backend, "BEGIN", QueryRisk::TYPE_TRANSACTION);
+    BOOST_REQUIRE(nullptr != backend);
+    BOOST_CHECK(client.isPinned());
+    MySqlBackendConnection* const pinned = backend;
+
+    // Nobody else gets the connection in the middle of the transaction
+    runPooled(&pool, &other, &otherBackend, "SELECT 1", QueryRisk::TYPE_SELECT);
+    BOOST_CHECK(nullptr == otherBackend);
+    BOOST_CHECK(2 == server.getConnectionCount());
+
+    runPooled(
+        &pool,
+        &client,
+        &backend,
+        "UPDATE t SET a = 1",
+        QueryRisk::TYPE_UPDATE
+    );
+    BOOST_CHECK(pinned == backend);
+    runPooled(&pool, &client, &backend, "COMMIT", QueryRisk::TYPE_TRANSACTION);
+    BOOST_CHECK(nullptr == backend);
+    BOOST_CHECK(!client.isPinned());
+
+    const vector<string> transaction(server.getQueries(0));
+    BOOST_REQUIRE(3 == transaction.size());
+    BOOST_CHECK("BEGIN" == transaction.at(0));
+    BOOST_CHECK("UPDATE t SET a = 1" == transaction.at(1));
+    BOOST_CHECK("COMMIT" == transaction.at(2));
+    const vector<string> otherQueries(server.getQueries(1));
+    BOOST_REQUIRE(1 == otherQueries.size());
+    BOOST_CHECK("SELECT 1" == otherQueries.at(0));
+}
+
+
+void testMySqlConnectionPoolLastInsertId()
+{
+    FakeMySqlServer server;
+    MySqlConnectionPool pool(server.getPath(), 2, 1000);
+    MySqlSessionState first;
+    first.setDatabase("test");
+    MySqlSessionState second(first);
+    MySqlBackendConnection* firstBackend = nullptr;
+    MySqlBackendConnection* secondBackend = nullptr;
+
+    // Both inserts are done before either client asks for its ID, so they
+    // have to be on different connections
+    runPooled(
+        &pool,
+        &first,
+        &firstBackend,
+        "INSERT INTO t VALUES (1)",
+        QueryRisk::TYPE_INSERT
+    );
+    BOOST_REQUIRE(nullptr != firstBackend);
+    runPooled(
+        &pool,
+        &second,
+        &secondBackend,
+        "INSERT INTO t VALUES (2)",
+        QueryRisk::TYPE_INSERT
+    );
+    BOOST_REQUIRE(nullptr != secondBackend);
+    BOOST_CHECK(firstBackend != secondBackend);
+
+    BOOST_CHECK(
+        "1" == getSingleValue(
+            runPooled(
+                &pool,
+                &first,
+                &firstBackend,
+                "SELECT LAST_INSERT_ID()",
+                QueryRisk::TYPE_SELECT
+            )
+        )
+    );
+    BOOST_CHECK(
+        "2" == getSingleValue(
+            runPooled(
+                &pool,
+                &second,
+                &secondBackend,
+                "SELECT LAST_INSERT_ID()",
+                QueryRisk::TYPE_SELECT
+            )
+        )
+    );
+
+    // The ID can be read again later, so the sessions stay where they are
+    BOOST_CHECK(!first.isPortable());
+    BOOST_CHECK(!second.isPortable());
+    BOOST_REQUIRE(nullptr != firstBackend);
+    BOOST_REQUIRE(nullptr != secondBackend);
+    pool.discard(firstBackend);
+    pool.discard(secondBackend);
+}
+
+
+FakeMySqlServer::FakeMySqlServer() :
+    path_(makeSocketPath()),
+    listener_(socket(AF_UNIX, SOCK_STREAM, 0)),
+    connections_(),
+    queries_(),
+    nextInsertId_(1),
+    mutex_(),
+    acceptor_(),
+    servers_()
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path_.c_str(), sizeof(address.sun_path) - 1);
+    unlink(path_.c_str());
+    BOOST_REQUIRE(
+        0 == bind(
+            listener_,
+            reinterpret_cast<sockaddr*>(&address),
+            sizeof(address)
+        )
+    );
+    BOOST_REQUIRE(0 == listen(listener_, 8));
+    acceptor_ = boost::thread(
+        boost::bind(&FakeMySqlServer::acceptConnections, this)
+    );
+}
+
+
+FakeMySqlServer::~FakeMySqlServer()
+{
+    // Shutting the sockets down wakes up the threads that are reading them
+    shutdown(listener_, SHUT_RDWR);
+    acceptor_.join();
+    {
+        lock_guard<mutex> lg(mutex_);
+        for (size_t i = 0; i < connections_.size(); ++i)
+        {
+            shutdown(connections_[i], SHUT_RDWR);
+        }
+    }
+    servers_.join_all();
+    for (size_t i = 0; i < connections_.size(); ++i)
+    {
+        close(connections_[i]);
+    }
+    close(listener_);
+    unlink(path_.c_str());
+}
+
+
+size_t FakeMySqlServer::getConnectionCount() const
+{
+    lock_guard<mutex> lg(mutex_);
+    return connections_.size();
+}
+
+
+vector<string> FakeMySqlServer::getQueries(const size_t connection) const
+{
+    lock_guard<mutex> lg(mutex_);
+    return queries_.at(connection);
+}
+
+
+void FakeMySqlServer::acceptConnections()
+{
+    while (true)
+    {
+        const int fd = accept(listener_, nullptr, nullptr);
+        if (fd < 0)
+        {
+            return;
+        }
+        lock_guard<mutex> lg(mutex_);
+        connections_.push_back(fd);
+        queries_.push_back(vector<string>());
+        servers_.create_thread(
+            boost::bind(
+                &FakeMySqlServer::serveConnection,
+                this,
+                fd,
+                connections_.size() - 1
+            )
+        );
+    }
+}
+
+
+void FakeMySqlServer::serveConnection(const int fd, const size_t connection)
+{
+    // 1: protocol version, n: server version, 4: thread id, 8: scramble,
+    // 1: filler, 2: capabilities, 1: character set, 2: status, 13: filler,
+    // 12: rest of the scramble, then a 0
+    const string version("\x0A" "5.5.0");
+    vector<uint8_t> handshakePayload(version.begin(), version.end());
+    handshakePayload.push_back('\0');
+    handshakePayload.resize(handshakePayload.size() + 4, 0);
+    handshakePayload.resize(handshakePayload.size() + 8, 'a');
+    handshakePayload.resize(handshakePayload.size() + 1 + 2 + 1 + 2 + 13, 0);
+    handshakePayload.resize(handshakePayload.size() + 12, 'b');
+    handshakePayload.push_back('\0');
+    vector<uint8_t> output;
+    appendPacket(&output, 0, handshakePayload);
+    writeAll(fd, output);
+
+    // Every login works
+    vector<uint8_t> payload;
+    if (!readPacket(fd, &payload))
+    {
+        return;
+    }
+    output.clear();
+    appendOk(&output, 2, 0, MySqlConstants::STATUS_AUTO_COMMIT);
+    writeAll(fd, output);
+
+    uint8_t lastInsertId = 0;
+    bool inTransaction = false;
+    while (readPacket(fd, &payload) && !payload.empty())
+    {
+        if (MySqlConstants::COM_QUIT == payload[0])
+        {
+            return;
+        }
+        output.clear();
+        if (MySqlConstants::COM_QUERY != payload[0])
+        {
+            appendOk(&output, 1, 0, MySqlConstants::STATUS_AUTO_COMMIT);
+            writeAll(fd, output);
+            continue;
+        }
+
+        const string query(payload.begin() + 1, payload.end());
+        uint8_t insertId = 0;
+        {
+            lock_guard<mutex> lg(mutex_);
+            queries_.at(connection).push_back(query);
+            if (istarts_with(query, "INSERT"))
+            {
+                insertId = nextInsertId_++;
+                lastInsertId = insertId;
+            }
+        }
+        if (istarts_with(query, "BEGIN"))
+        {
+            inTransaction = true;
+        }
+        else if (
+            istarts_with(query, "COMMIT")
+            || istarts_with(query, "ROLLBACK")
+        )
+        {
+            inTransaction = false;
+        }
+        const uint16_t status =
+            MySqlConstants::STATUS_AUTO_COMMIT
+            | (inTransaction ? MySqlConstants::STATUS_IN_TRANSACTION : 0);
+
+        if ("SELECT LAST_INSERT_ID()" == query)
+        {
+            // One column and one row
+            appendPacket(&output, 1, vector<uint8_t>(1, 1));
+            const string column("\x03" "def\x04test\x01t\x01t\x01" "c\x01" "c");
+            appendPacket(
+                &output,
+                2,
+                vector<uint8_t>(column.begin(), column.end())
+            );
+            const uint8_t eof[] = {
+                0xFE,
+                0, 0,
+                static_cast<uint8_t>(status & 0xFF),
+                static_cast<uint8_t>(status >> 8)
+            };
+            appendPacket(&output, 3, vector<uint8_t>(eof, eof + sizeof(eof)));
+            ostringstream value;
+            value << static_cast<int>(lastInsertId);
+            const string text(value.str());
+            vector<uint8_t> row(1, static_cast<uint8_t>(text.size()));
+            row.insert(row.end(), text.begin(), text.end());
+            appendPacket(&output, 4, row);
+            appendPacket(&output, 5, vector<uint8_t>(eof, eof + sizeof(eof)));
+        }
+        else
+        {
+            appendOk(&output, 1, insertId, status);
+        }
+        writeAll(fd, output);
+    }
+}
+
+
+vector<vector<uint8_t> > runPooled(
+    MySqlConnectionPool* const pool,
+    MySqlSessionState* const session,
+    MySqlBackendConnection** const backend,
+    const string& query,
+    const QueryRisk::QueryType type
+)
+{
+    vector<vector<uint8_t> > response;
+    // This is what MySqlGuard does for each query when it has a pool
+    if (nullptr == *backend)
+    {
+        *backend = pool->acquire("user", vector<uint8_t>(), 8, *session);
+        if (nullptr == *backend)
+        {
+            return response;
+        }
+    }
+    session->observeQuery(query, type);
+    vector<vector<uint8_t> > packets;
+    BOOST_CHECK(
+        (*backend)->runCommand(MySqlConstants::COM_QUERY, query, &packets)
+    );
+    for (size_t i = 0; i < packets.size(); ++i)
+    {
+        response.push_back(packets[i]);
+        PacketBufferPool::release(&packets[i]);
+    }
+    session->setServerStatus((*backend)->getServerStatus());
+    if (!session->isPinned())
+    {
+        pool->release(*backend, *session);
+        *backend = nullptr;
+    }
+    return response;
+}
+
+
+string makeSocketPath()
+{
+    ostringstream path;
+    path << "/tmp/sqlassieTestPool" << getpid();
+    return path.str();
+}
+
+
+string getSingleValue(const vector<vector<uint8_t> >& response)
+{
+    // Column count, column, EOF, row, EOF
+    if (5 != response.size())
+    {
+        return string();
+    }
+    const vector<uint8_t>& row = response[3];
+    // The value is a length coded string
+    const size_t BEGIN_VALUE = MySqlPacketReader::HEADER_LENGTH + 1;
+    if (row.size() < BEGIN_VALUE)
+    {
+        return string();
+    }
+    return string(row.begin() + BEGIN_VALUE, row.end());
+}
+
+
+void appendPacket(
+    vector<uint8_t>* const stream,
+    const uint8_t packetNumber,
+    const vector<uint8_t>& payload
+)
+{
+    stream->push_back(payload.size() & 0xFF);
+    stream->push_back((payload.size() >> 8) & 0xFF);
+    stream->push_back((payload.size() >> 16) & 0xFF);
+    stream->push_back(packetNumber);
+    stream->insert(stream->end(), payload.begin(), payload.end());
+}
+
+
+void appendOk(
+    vector<uint8_t>* const stream,
+    const uint8_t packetNumber,
+    const uint8_t insertId,
+    const uint16_t status
+)
+{
+    // 1: OK marker, 1: affected rows, 1: insert ID, 2: status, 2: warnings
+    const uint8_t ok[] = {
+        0x00,
+        0,
+        insertId,
+        static_cast<uint8_t>(status & 0xFF),
+        static_cast<uint8_t>(status >> 8),
+        0, 0
+    };
+    appendPacket(stream, packetNumber, vector<uint8_t>(ok, ok + sizeof(ok)));
+}
+
+
+bool readPacket(const int fd, vector<uint8_t>* const payload)
+{
+    uint8_t header[MySqlPacketReader::HEADER_LENGTH];
+    size_t bytesRead = 0;
+    while (bytesRead < sizeof(header))
+    {
+        const ssize_t bytes =
+            read(fd, header + bytesRead, sizeof(header) - bytesRead);
+        if (bytes <= 0)
+        {
+            return false;
+        }
+        bytesRead += bytes;
+    }
+    const size_t length = header[0] | (header[1] << 8) | (header[2] << 16);
+    payload->resize(length);
+    bytesRead = 0;
+    while (bytesRead < length)
+    {
+        const ssize_t bytes =
+            read(fd, &(*payload)[bytesRead], length - bytesRead);
+        if (bytes <= 0)
+        {
+            return false;
+        }
+        bytesRead += bytes;
+    }
+    return true;
+}
+
+
+void writeAll(const int fd, const vector<uint8_t>& data)
+{
+    size_t written = 0;
+    while (written < data.size())
+    {
+        const ssize_t bytes =
+            write(fd, &data[written], data.size() - written);
+        if (bytes <= 0)
+        {
+            return;
+        }
+        written += bytes;
+    }
+}
@@ -0,0 +1,46 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SRC_TESTS_TESTMYSQLCONNECTIONPOOL_HPP_
+#define SRC_TESTS_TESTMYSQLCONNECTIONPOOL_HPP_
+
+/**
+ * Tests that clients get an error instead of waiting forever when the
+ * server can't be reached, and that the failed connections aren't counted.
+ */
+void testMySqlConnectionPoolUnreachable();
+
+/**
+ * Tests that idle connections are only lent out to sessions with the same
+ * settings, and that new connections are set up for the session.
+ */
+void testMySqlConnectionPoolSessions();
+
+/**
+ * Tests that a session keeps its connection until its transaction ends.
+ */
+void testMySqlConnectionPoolTransaction();
+
+/**
+ * Tests that LAST_INSERT_ID() runs on the connection that did the INSERT,
+ * even when other clients insert in between.
+ */
+void testMySqlConnectionPoolLastInsertId();
+
+#endif  // SRC_TESTS_TESTMYSQLCONNECTIONPOOL_HPP_
@@ -0,0 +1,377 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Tests the MySqlErrorMessageBlocker.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testMySqlErrorMessageBlocker.hpp"
+#include "../MySqlCompression.hpp"
+#include "../MySqlConstants.hpp"
+#include "../MySqlErrorMessageBlocker.hpp"
+#include "../MySqlSocket.hpp"
+#include "../ProxyHalf.hpp"
+#include "../QueryRisk.hpp"
+
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using std::search;
+using std::string;
+using std::vector;
+
+static void appendPacket(
+    vector<uint8_t>* stream,
+    uint8_t packetNumber,
+    const vector<uint8_t>& payload
+);
+static void appendResultSetStart(vector<uint8_t>* stream);
+static void sendHandshake(int server, int client, bool compressionEnabled);
+static vector<uint8_t> readFrame(int fd);
+static void writeAll(int fd, const vector<uint8_t>& data);
+static vector<uint8_t> readAll(int fd, size_t size);
+
+
+void testErrorMessageBlockerPassThrough()
+{
+    int client[2];
+    int server[2];
+    BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, client));
+    BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, server));
+
+    MySqlSocket clientSocket(client[1]);
+    MySqlSocket serverSocket(server[1]);
+    MySqlErrorMessageBlocker blocker(&serverSocket, &clientSocket, true);
+    boost::thread blockerThread(boost::bind(&ProxyHalf::operator(), &blocker));
+
+    sendHandshake(server[0], client[0], false);
+
+    // A result set with rows that are big enough to be spliced
+    vector<uint8_t> resultSet;
+    appendResultSetStart(&resultSet);
+    appendPacket(&resultSet, 4, vector<uint8_t>(10, 'a'));
+    appendPacket(&resultSet, 5, vector<uint8_t>(100000, 'b'));
+    appendPacket(&resultSet, 6, vector<uint8_t>(20000, 'c'));
+    appendPacket(&resultSet, 7, vector<uint8_t>(3, 'd'));
+    const uint8_t eof[] = {0xFE, 0, 0, 2, 0};
+    appendPacket(&resultSet, 8, vector<uint8_t>(eof, eof + sizeof(eof)));
+
+    blocker.setQueryType(QueryRisk::TYPE_SELECT);
+    boost::thread writer(boost::bind(writeAll, server[0], resultSet));
+    const vector<uint8_t> received(readAll(client[0], resultSet.size()));
+    writer.join();
+    BOOST_CHECK(received == resultSet);
+
+    // A result set that fails partway through the rows
+    vector<uint8_t> failedResultSet;
+    appendResultSetStart(&failedResultSet);
+    appendPacket(&failedResultSet, 4, vector<uint8_t>(50000, 'e'));
+    const size_t beforeError = failedResultSet.size();
+    const string error("\xFF\x28\x04#42S02Table 'secret' doesn't exist");
+    appendPacket(
+        &failedResultSet,
+        5,
+        vector<uint8_t>(error.begin(), error.end())
+    );
+
+    blocker.setQueryType(QueryRisk::TYPE_SELECT);
+    writer = boost::thread(boost::bind(writeAll, server[0], failedResultSet));
+    vector<uint8_t> blocked(readAll(client[0], beforeError + 4));
+    writer.join();
+    BOOST_REQUIRE(blocked.size() == beforeError + 4);
+    BOOST_CHECK(
+        vector<uint8_t>(blocked.begin(), blocked.begin() + beforeError)
+        == vector<uint8_t>(
+            failedResultSet.begin(),
+            failedResultSet.begin() + beforeError
+        )
+    );
+    // The replacement error keeps the packet number
+    BOOST_CHECK(5 == blocked.at(beforeError + 3));
+    const size_t errorLength =
+        blocked.at(beforeError)
+        | (blocked.at(beforeError + 1) << 8)
+        | (blocked.at(beforeError + 2) << 16);
+    const vector<uint8_t> errorPayload(readAll(client[0], errorLength));
+    BOOST_REQUIRE(errorPayload.size() == errorLength && errorLength > 0);
+    BOOST_CHECK(0xFF == errorPayload.at(0));
+    const string secret("secret");
+    BOOST_CHECK(
+        errorPayload.end() == search(
+            errorPayload.begin(),
+            errorPayload.end(),
+            secret.begin(),
+            secret.end()
+        )
+    );
+
+    // An error that arrives split across reads is still caught
+    vector<uint8_t> insertError;
+    appendPacket(
+        &insertError,
+        1,
+        vector<uint8_t>(error.begin(), error.end())
+    );
+    blocker.setQueryType(QueryRisk::TYPE_INSERT);
+    writeAll(
+        server[0],
+        vector<uint8_t>(insertError.begin(), insertError.begin() + 2)
+    );
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+    writeAll(
+        server[0],
+        vector<uint8_t>(insertError.begin() + 2, insertError.end())
+    );
+    const vector<uint8_t> okHeader(readAll(client[0], 5));
+    BOOST_REQUIRE(5 == okHeader.size());
+    BOOST_CHECK(1 == okHeader.at(3));
+    BOOST_CHECK(0x00 == okHeader.at(4));
+    const size_t okLength =
+        okHeader.at(0) | (okHeader.at(1) << 8) | (okHeader.at(2) << 16);
+    BOOST_CHECK(okLength - 1 == readAll(client[0], okLength - 1).size());
+
+    // The blocker closes both sides when MySQL hangs up
+    close(server[0]);
+    blockerThread.join();
+    close(client[0]);
+}
+
+
+void testErrorMessageBlockerCompression()
+{
+    int client[2];
+    int server[2];
+    BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, client));
+    BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, server));
+
+    const MySqlCompression compression(MySqlCompression::DEFAULT_LEVEL, 50);
+    MySqlSocket clientSocket(client[1]);
+    MySqlSocket serverSocket(server[1]);
+    MySqlErrorMessageBlocker blocker(
+        &serverSocket,
+        &clientSocket,
+        false,
+        compression
+    );
+    boost::thread blockerThread(boost::bind(&ProxyHalf::operator(), &blocker));
+
+    sendHandshake(server[0], client[0], true);
+
+    // The client asked for compression, so the OK after authentication is
+    // the last uncompressed packet, and the frames right behind it in the
+    // same read are already compressed
+    blocker.startCompression();
+    vector<uint8_t> resultSet;
+    appendResultSetStart(&resultSet);
+    appendPacket(&resultSet, 4, vector<uint8_t>(1000, 'a'));
+    const uint8_t eof[] = {0xFE, 0, 0, 2, 0};
+    appendPacket(&resultSet, 5, vector<uint8_t>(eof, eof + sizeof(eof)));
+    vector<uint8_t> resultSetFrame;
+    compression.appendFrames(
+        &resultSet[0],
+        resultSet.size(),
+        0,
+        &resultSetFrame
+    );
+
+    vector<uint8_t> okAndFrame;
+    const uint8_t ok[] = {0x00, 0, 0, 2, 0, 0, 0};
+    appendPacket(&okAndFrame, 2, vector<uint8_t>(ok, ok + sizeof(ok)));
+    const size_t okLength = okAndFrame.size();
+    okAndFrame.insert(
+        okAndFrame.end(),
+        resultSetFrame.begin(),
+        resultSetFrame.end()
+    );
+    blocker.setQueryType(QueryRisk::TYPE_SELECT);
+    writeAll(server[0], okAndFrame);
+    BOOST_CHECK(okLength == readAll(client[0], okLength).size());
+    BOOST_CHECK(readFrame(client[0]) == resultSetFrame);
+
+    // Frames with errors are rebuilt with a fake response instead
+    vector<uint8_t> errorPacket;
+    const string error("\xFF\x28\x04#42S02Table 'secret' doesn't exist");
+    appendPacket(&errorPacket, 1, vector<uint8_t>(error.begin(), error.end()));
+    vector<uint8_t> errorFrame;
+    compression.appendFrames(
+        &errorPacket[0],
+        errorPacket.size(),
+        0,
+        &errorFrame
+    );
+    blocker.setQueryType(QueryRisk::TYPE_INSERT);
+    blocker.setCompressedSequenceOffset(2);
+    writeAll(server[0], errorFrame);
+    const vector<uint8_t> replacedFrame(readFrame(client[0]));
+    BOOST_REQUIRE(replacedFrame.size() > MySqlCompression::HEADER_LENGTH);
+    BOOST_CHECK(2 == replacedFrame.at(3));
+    vector<uint8_t> replaced;
+    MySqlCompression::decompressFrame(
+        &replacedFrame[0],
+        replacedFrame.size(),
+        &replaced
+    );
+    BOOST_REQUIRE(replaced.size() > 4);
+    BOOST_CHECK(1 == replaced.at(3));
+    BOOST_CHECK(0x00 == replaced.at(4));
+    const string secret("secret");
+    BOOST_CHECK(
+        replaced.end() == search(
+            replaced.begin(),
+            replaced.end(),
+            secret.begin(),
+            secret.end()
+        )
+    );
+
+    close(server[0]);
+    blockerThread.join();
+    close(client[0]);
+}
+
+
+void appendPacket(
+    vector<uint8_t>* const stream,
+    const uint8_t packetNumber,
+    const vector<uint8_t>& payload
+)
+{
+    stream->push_back(payload.size() & 0xFF);
+    stream->push_back((payload.size() >> 8) & 0xFF);
+    stream->push_back((payload.size() >> 16) & 0xFF);
+    stream->push_back(packetNumber);
+    stream->insert(stream->end(), payload.begin(), payload.end());
+}
+
+
+void appendResultSetStart(vector<uint8_t>* const stream)
+{
+    // One column
+    appendPacket(stream, 1, vector<uint8_t>(1, 1));
+    const string column("\x03" "def\x04test\x01t\x01t\x01" "c\x01" "c");
+    appendPacket(stream, 2, vector<uint8_t>(column.begin(), column.end()));
+    const uint8_t eof[] = {0xFE, 0, 0, 2, 0};
+    appendPacket(stream, 3, vector<uint8_t>(eof, eof + sizeof(eof)));
+}
+
+
+void sendHandshake(
+    const int server,
+    const int client,
+    const bool compressionEnabled
+)
+{
+    // The first packet is always treated as the handshake. It offers every
+    // capability, in both halves of the flags.
+    const string version("\x0A" "5.1.0");
+    vector<uint8_t> handshakePayload(version.begin(), version.end());
+    handshakePayload.push_back('\0');
+    // Thread id, first part of the scramble, filler
+    handshakePayload.resize(handshakePayload.size() + 4 + 8 + 1, 'x');
+    const size_t BEGIN_CAPABILITIES = handshakePayload.size();
+    handshakePayload.push_back(0xFF);
+    handshakePayload.push_back(0xFF);
+    // Character set, status
+    handshakePayload.resize(handshakePayload.size() + 1 + 2, 0);
+    const size_t BEGIN_UPPER_CAPABILITIES = handshakePayload.size();
+    handshakePayload.push_back(0xFF);
+    handshakePayload.push_back(0xFF);
+    // Scramble length, filler, rest of the scramble
+    handshakePayload.push_back(21);
+    handshakePayload.resize(handshakePayload.size() + 10, 0);
+    handshakePayload.resize(handshakePayload.size() + 12, 'y');
+    handshakePayload.push_back('\0');
+    vector<uint8_t> handshake;
+    appendPacket(&handshake, 0, handshakePayload);
+    writeAll(server, handshake);
+
+    const vector<uint8_t> received(readAll(client, handshake.size()));
+    BOOST_REQUIRE(received.size() == handshake.size());
+    // 3: packet length, 1: packet number
+    const uint32_t capabilities =
+        received[4 + BEGIN_CAPABILITIES]
+        | (received[4 + BEGIN_CAPABILITIES + 1] << 8)
+        | (received[4 + BEGIN_UPPER_CAPABILITIES] << 16)
+        | (received[4 + BEGIN_UPPER_CAPABILITIES + 1] << 24);
+    // Result sets are followed by their EOF packets
+    BOOST_CHECK(0 == (capabilities & MySqlConstants::CLIENT_DEPRECATE_EOF));
+    BOOST_CHECK_EQUAL(
+        compressionEnabled,
+        0 != (capabilities & MySqlConstants::CLIENT_COMPRESS)
+    );
+    BOOST_CHECK(0 != (capabilities & MySqlConstants::CLIENT_PROTOCOL_41));
+}
+
+
+vector<uint8_t> readFrame(const int fd)
+{
+    vector<uint8_t> frame(readAll(fd, MySqlCompression::HEADER_LENGTH));
+    if (frame.size() < MySqlCompression::HEADER_LENGTH)
+    {
+        return frame;
+    }
+    const size_t length = frame[0] | (frame[1] << 8) | (frame[2] << 16);
+    const vector<uint8_t> payload(readAll(fd, length));
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    return frame;
+}
+
+
+void writeAll(const int fd, const vector<uint8_t>& data)
+{
+    size_t written = 0;
+    while (written < data.size())
+    {
+        const ssize_t bytes =
+            write(fd, &data[written], data.size() - written);
+        if (bytes <= 0)
+        {
+            return;
+        }
+        written += bytes;
+    }
+}
+
+
+vector<uint8_t> readAll(const int fd, const size_t size)
+{
+    vector<uint8_t> data(size);
+    size_t bytesRead = 0;
+    while (bytesRead < size)
+    {
+        const ssize_t bytes = read(fd, &data[bytesRead], size - bytesRead);
+        if (bytes <= 0)
+        {
+            break;
+        }
+        bytesRead += bytes;
+    }
+    data.resize(bytesRead);
+    return data;
+}
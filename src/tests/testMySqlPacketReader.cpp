@@ -0,0 +1,149 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Tests the MySqlPacketReader.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testMySqlPacketReader.hpp"
+#include "../MySqlPacketReader.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+using std::vector;
+
+static void appendPacket(
+    vector<uint8_t>* stream,
+    uint8_t packetNumber,
+    size_t length,
+    uint8_t fill
+);
+
+
+void testMySqlPacketReaderFraming()
+{
+    vector<uint8_t> stream;
+    appendPacket(&stream, 0, 20, 'a');
+    appendPacket(&stream, 0, 1, 'b');
+    appendPacket(&stream, 0, 10000, 'c');
+    appendPacket(&stream, 0, 0, 0);
+    appendPacket(&stream, 0, 30, 'd');
+    const size_t lengths[] = {20, 1, 10000, 0, 30};
+    const size_t packetCount = sizeof(lengths) / sizeof(lengths[0]);
+
+    // Feed the stream in every chunk size from one byte to all of it at once
+    const size_t chunkSizes[] = {1, 2, 3, 5, 7, 4096, 9999, stream.size()};
+    for (size_t c = 0; c < sizeof(chunkSizes) / sizeof(chunkSizes[0]); ++c)
+    {
+        MySqlPacketReader reader;
+        vector<vector<uint8_t> > packets;
+        vector<uint8_t> received;
+        size_t found = 0;
+        for (size_t i = 0; i < stream.size(); i += chunkSizes[c])
+        {
+            const size_t end =
+                (i + chunkSizes[c] < stream.size()
+                    ? i + chunkSizes[c]
+                    : stream.size());
+            vector<uint8_t> chunk(stream.begin() + i, stream.begin() + end);
+            reader.append(&chunk);
+            while (reader.nextMessage(&packets))
+            {
+                BOOST_REQUIRE(1 == packets.size());
+                BOOST_REQUIRE(found < packetCount);
+                BOOST_CHECK(
+                    MySqlPacketReader::HEADER_LENGTH + lengths[found]
+                    == packets.at(0).size()
+                );
+                received.insert(
+                    received.end(),
+                    packets.at(0).begin(),
+                    packets.at(0).end()
+                );
+                ++found;
+            }
+        }
+        BOOST_CHECK(packetCount == found);
+        BOOST_CHECK(received == stream);
+        BOOST_CHECK(reader.empty());
+    }
+}
+
+
+void testMySqlPacketReaderContinuation()
+{
+    vector<uint8_t> stream;
+    appendPacket(&stream, 0, MySqlPacketReader::MAX_PAYLOAD_LENGTH, 'a');
+    appendPacket(&stream, 1, 5, 'b');
+    appendPacket(&stream, 0, 3, 'c');
+
+    MySqlPacketReader reader;
+    vector<vector<uint8_t> > packets;
+    const size_t CHUNK_SIZE = 65536;
+    size_t messages = 0;
+    for (size_t i = 0; i < stream.size(); i += CHUNK_SIZE)
+    {
+        const size_t end =
+            (i + CHUNK_SIZE < stream.size() ? i + CHUNK_SIZE : stream.size());
+        vector<uint8_t> chunk(stream.begin() + i, stream.begin() + end);
+        reader.append(&chunk);
+        while (reader.nextMessage(&packets))
+        {
+            if (0 == messages)
+            {
+                // The continued packet and the one that ends it
+                BOOST_REQUIRE(2 == packets.size());
+                BOOST_CHECK(
+                    MySqlPacketReader::HEADER_LENGTH
+                        + MySqlPacketReader::MAX_PAYLOAD_LENGTH
+                    == packets.at(0).size()
+                );
+                BOOST_CHECK(1 == packets.at(1).at(3));
+                BOOST_CHECK('b' == packets.at(1).back());
+            }
+            else
+            {
+                BOOST_REQUIRE(1 == packets.size());
+                BOOST_CHECK('c' == packets.at(0).back());
+            }
+            ++messages;
+        }
+    }
+    BOOST_CHECK(2 == messages);
+    BOOST_CHECK(reader.empty());
+}
+
+
+void appendPacket(
+    vector<uint8_t>* const stream,
+    const uint8_t packetNumber,
+    const size_t length,
+    const uint8_t fill
+)
+{
+    stream->push_back(length & 0xFF);
+    stream->push_back((length >> 8) & 0xFF);
+    stream->push_back((length >> 16) & 0xFF);
+    stream->push_back(packetNumber);
+    stream->insert(stream->end(), length, fill);
+}
@@ -0,0 +1,146 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Tests the MySqlSessionState.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testMySqlSessionState.hpp"
+#include "../MySqlConstants.hpp"
+#include "../MySqlSessionState.hpp"
+#include "../QueryRisk.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+
+void testMySqlSessionStateTracking()
+{
+    MySqlSessionState session;
+    BOOST_CHECK(session.isPortable());
+    BOOST_CHECK(!session.inTransaction());
+    const size_t start = session.getVersion();
+
+    session.observeQuery("USE `shop`;", QueryRisk::TYPE_UNKNOWN);
+    BOOST_CHECK("shop" == session.getDatabase());
+    BOOST_CHECK(start != session.getVersion());
+
+    // Selects don't change anything
+    size_t version = session.getVersion();
+    session.observeQuery("SELECT * FROM orders", QueryRisk::TYPE_SELECT);
+    BOOST_CHECK(version == session.getVersion());
+
+    session.observeQuery("SET NAMES utf8", QueryRisk::TYPE_SET);
+    session.observeQuery("SET sql_mode = ''", QueryRisk::TYPE_SET);
+    session.observeQuery(
+        "SET GLOBAL max_connections = 1",
+        QueryRisk::TYPE_SET
+    );
+    BOOST_REQUIRE(2 == session.getStatements().size());
+
+    // Setting something again moves it to the end
+    version = session.getVersion();
+    session.observeQuery("SET NAMES utf8", QueryRisk::TYPE_SET);
+    const vector<string>& statements = session.getStatements();
+    BOOST_REQUIRE(2 == statements.size());
+    BOOST_CHECK("SET sql_mode = ''" == statements.at(0));
+    BOOST_CHECK("SET NAMES utf8" == statements.at(1));
+    BOOST_CHECK(version != session.getVersion());
+
+    session.setServerStatus(
+        MySqlConstants::STATUS_AUTO_COMMIT
+        | MySqlConstants::STATUS_IN_TRANSACTION
+    );
+    BOOST_CHECK(session.inTransaction());
+    session.setServerStatus(0);
+    BOOST_CHECK(session.inTransaction());
+    session.setServerStatus(MySqlConstants::STATUS_AUTO_COMMIT);
+    BOOST_CHECK(!session.inTransaction());
+
+    // The next statement might ask about the last one's changes
+    BOOST_CHECK(!session.isPinned());
+    session.observeQuery(
+        "INSERT INTO orders VALUES (1)",
+        QueryRisk::TYPE_INSERT
+    );
+    BOOST_CHECK(session.isPinned());
+    BOOST_CHECK(session.isPortable());
+    session.observeQuery("SELECT * FROM orders", QueryRisk::TYPE_SELECT);
+    BOOST_CHECK(!session.isPinned());
+
+    session.observeQuery(
+        "CREATE TEMPORARY TABLE t (id INT)",
+        QueryRisk::TYPE_UNKNOWN
+    );
+    BOOST_CHECK(!session.isPortable());
+    BOOST_CHECK(session.isPinned());
+
+    // Statements that leave something behind on the connection
+    const char* const unportable[] = {
+        "SELECT LAST_INSERT_ID()",
+        "SELECT FOUND_ROWS()",
+        "SELECT ROW_COUNT()",
+        "SELECT GET_LOCK('a', 1)",
+        "SELECT id INTO @id FROM orders",
+        "SET @id = LAST_INSERT_ID()"
+    };
+    for (size_t i = 0; i < sizeof(unportable) / sizeof(unportable[0]); ++i)
+    {
+        MySqlSessionState other;
+        other.observeQuery(unportable[i], QueryRisk::TYPE_SELECT);
+        BOOST_CHECK_MESSAGE(!other.isPortable(), unportable[i]);
+    }
+    MySqlSessionState outfile;
+    outfile.observeQuery(
+        "SELECT * INTO OUTFILE '/tmp/orders' FROM orders",
+        QueryRisk::TYPE_SELECT
+    );
+    BOOST_CHECK(outfile.isPortable());
+}
+
+
+void testMySqlSessionStateReplicaSafe()
+{
+    BOOST_CHECK(MySqlSessionState::isReplicaSafe("SELECT * FROM orders"));
+    BOOST_CHECK(MySqlSessionState::isReplicaSafe("SELECT 1;"));
+
+    const char* const unsafe[] = {
+        "SELECT * FROM orders FOR UPDATE",
+        "SELECT * FROM orders LOCK IN SHARE MODE",
+        "SELECT id INTO @id FROM orders",
+        "SELECT @a := 1",
+        "SELECT LAST_INSERT_ID()",
+        "SELECT FOUND_ROWS()",
+        "SELECT GET_LOCK('a', 1)",
+        "SELECT 1; DELETE FROM orders"
+    };
+    for (size_t i = 0; i < sizeof(unsafe) / sizeof(unsafe[0]); ++i)
+    {
+        BOOST_CHECK_MESSAGE(
+            !MySqlSessionState::isReplicaSafe(unsafe[i]),
+            unsafe[i]
+        );
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Tests the PacketBufferPool.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testPacketBufferPool.hpp"
+#include "../PacketBufferPool.hpp"
+#include "../ProxyHalf.hpp"
+#include "../Socket.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using std::vector;
+
+static const size_t MESSAGE_SIZE = 100;
+
+
+void testPacketBufferPoolReuse()
+{
+    vector<uint8_t> buffer;
+    PacketBufferPool::acquire(&buffer);
+    BOOST_CHECK(buffer.empty());
+    BOOST_CHECK(buffer.capacity() >= PacketBufferPool::getBufferSize());
+    const uint8_t* const storage = &buffer.front();
+
+    // Released storage is handed out again
+    PacketBufferPool::release(&buffer);
+    BOOST_CHECK(0 == buffer.capacity());
+    const uint64_t allocations = PacketBufferPool::getAllocationCount();
+    PacketBufferPool::acquire(&buffer);
+    BOOST_CHECK(storage == &buffer.front());
+    BOOST_CHECK(allocations == PacketBufferPool::getAllocationCount());
+
+    // Buffers that grew are freed
+    buffer.resize(PacketBufferPool::getBufferSize() + 1);
+    const uint64_t discards = PacketBufferPool::getDiscardCount();
+    PacketBufferPool::release(&buffer);
+    BOOST_CHECK(discards + 1 == PacketBufferPool::getDiscardCount());
+}
+
+
+void testPacketBufferPoolSteadyState()
+{
+    int client[2];
+    int server[2];
+    BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, client));
+    BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, server));
+
+    Socket clientSocket(client[1]);
+    Socket serverSocket(server[1]);
+    ProxyHalf half(&clientSocket, &serverSocket);
+    boost::thread halfThread(boost::bind(&ProxyHalf::operator(), &half));
+
+    const vector<uint8_t> message(MESSAGE_SIZE, 'a');
+    vector<uint8_t> received(MESSAGE_SIZE);
+    uint64_t allocations = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        // Let the first few messages warm the pool up
+        if (10 == i)
+        {
+            allocations = PacketBufferPool::getAllocationCount();
+        }
+        BOOST_REQUIRE(
+            static_cast<ssize_t>(MESSAGE_SIZE)
+            == write(client[0], &message[0], MESSAGE_SIZE)
+        );
+        size_t bytesRead = 0;
+        while (bytesRead < MESSAGE_SIZE)
+        {
+            const ssize_t bytes = read(
+                server[0],
+                &received[bytesRead],
+                MESSAGE_SIZE - bytesRead
+            );
+            BOOST_REQUIRE(bytes > 0);
+            bytesRead += bytes;
+        }
+    }
+    BOOST_CHECK(allocations == PacketBufferPool::getAllocationCount());
+
+    close(client[0]);
+    halfThread.join();
+    close(server[0]);
+}
@@ -32,16 +32,23 @@
 #include "../QueryRisk.hpp"
 
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 // Newer versions of the Boost filesystem (1.44+) changed the interface; to
 // keep compatibility, default to the old version
 #define BOOST_FILESYSTEM_VERSION 2
 #include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
 #include <fstream>
 #include <string>
+#include <vector>
 
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
 using std::ifstream;
 using std::string;
+using std::vector;
 
 /**
  * Parses a query and sets the provided QueryRisk to the risks found.
@@ -51,6 +58,26 @@ using std::string;
  */
 static QueryRisk parseQuery(const string& query);
 
+/**
+ * The outcome of parsing a single query.
+ */
+struct ParseResult
+{
+    int status;
+    bool valid;
+    ParserInterface::QueryHash hash;
+};
+
+/**
+ * Parses every query and saves each query's status and hash.
+ * @param queries The queries to parse.
+ * @param results Will be filled with the status and hash of each query.
+ */
+static void parseAll(
+    const vector<string>* const queries,
+    vector<ParseResult>* const results
+);
+
 
 void testParseKnownGoodQueries()
 {
@@ -471,6 +498,236 @@ void testSelectItems()
 }
 
 
+void testParseConcurrently()
+{
+    ifstream fin("../src/tests/queries/wikidb.sql");
+    BOOST_REQUIRE(fin.is_open());
+    vector<string> queries;
+    string line;
+    while (getline(fin, line))
+    {
+        queries.push_back(line);
+    }
+    fin.close();
+    BOOST_REQUIRE(!queries.empty());
+
+    vector<ParseResult> expected;
+    const ptime serialStart(microsec_clock::universal_time());
+    parseAll(&queries, &expected);
+    const double serialSeconds =
+        (microsec_clock::universal_time() - serialStart).total_microseconds()
+        / 1000000.0;
+
+    const int THREADS_COUNT = 4;
+    vector<vector<ParseResult> > results(THREADS_COUNT);
+    boost::thread_group threads;
+    const ptime parallelStart(microsec_clock::universal_time());
+    for (int i = 0; i < THREADS_COUNT; ++i)
+    {
+        threads.create_thread(boost::bind(parseAll, &queries, &results[i]));
+    }
+    threads.join_all();
+    const double parallelSeconds =
+        (microsec_clock::universal_time() - parallelStart).total_microseconds()
+        / 1000000.0;
+
+    for (int i = 0; i < THREADS_COUNT; ++i)
+    {
+        BOOST_REQUIRE(expected.size() == results[i].size());
+        for (size_t j = 0; j < expected.size(); ++j)
+        {
+            BOOST_CHECK_MESSAGE(
+                expected[j].status == results[i][j].status
+                    && expected[j].valid == results[i][j].valid
+                    && expected[j].hash == results[i][j].hash,
+                "Parsed differently in thread " << i << ": " << queries[j]
+            );
+        }
+    }
+
+    // Throughput depends on the machine, so only report it
+    if (serialSeconds > 0.0 && parallelSeconds > 0.0)
+    {
+        const double serialRate = queries.size() / serialSeconds;
+        const double parallelRate =
+            THREADS_COUNT * queries.size() / parallelSeconds;
+        BOOST_MESSAGE(
+            "Parsed " << serialRate << " queries/s with 1 thread, "
+            << parallelRate << " queries/s with " << THREADS_COUNT
+            << " threads (" << parallelRate / serialRate << "x)"
+        );
+    }
+}
+
+
+void testParseInPlace()
+{
+    const char* const queries[] = {
+        "SELECT * FROM foo WHERE name = 'admin'",
+        "SELECT * FROM foo WHERE name = 'O\\'Brien'",
+        "SELECT * FROM foo WHERE name = 'it''s' OR 1 = '1'",
+        "SELECT * FROM foo WHERE name = 'back\\\\slash' AND 1 = 1",
+        "SELECT * FROM foo WHERE name = \"double\" OR 'a' = 'a'",
+        "SELECT * FROM `foo` WHERE 0x41 = 'A' OR '' = ''",
+        "SELECT * FROM foo WHERE name = 'unterminated"
+    };
+    const size_t QUERIES_COUNT = sizeof(queries) / sizeof(queries[0]);
+
+    for (size_t i = 0; i < QUERIES_COUNT; ++i)
+    {
+        const string query(queries[i]);
+
+        QueryRisk copiedQr;
+        ParserInterface copied(query);
+        const int copiedStatus = copied.parse(&copiedQr);
+
+        string buffer;
+        buffer.reserve(query.size() + ParserInterface::SCAN_PADDING);
+        buffer = query;
+        const char* const data = buffer.data();
+        QueryRisk inPlaceQr;
+        int inPlaceStatus;
+        ParserInterface::QueryHash inPlaceHash;
+        {
+            ParserInterface inPlace(&buffer);
+            inPlaceStatus = inPlace.parse(&inPlaceQr);
+            inPlaceHash = inPlace.getHash();
+        }
+
+        BOOST_CHECK_MESSAGE(
+            copiedStatus == inPlaceStatus
+                && copiedQr == inPlaceQr
+                && copied.getHash() == inPlaceHash,
+            "Parsed differently in place: " << query
+        );
+        BOOST_CHECK_MESSAGE(
+            query == buffer,
+            "Query was changed by scanning in place: " << query
+        );
+        // The padding fit in the room that was reserved
+        BOOST_CHECK(data == buffer.data());
+    }
+}
+
+
+void testParseBudget()
+{
+    const string query(
+        "SELECT * FROM foo WHERE a = 1 AND b = 2 AND c = 3 /* comment */"
+    );
+
+    QueryRisk unlimitedQr;
+    ParserInterface unlimited(query);
+    BOOST_REQUIRE(0 == unlimited.parse(&unlimitedQr));
+
+    const ParserInterface::Budget defaultBudget(ParserInterface::getBudget());
+    ParserInterface::Budget budget(defaultBudget);
+    budget.maxTokens = 5;
+    ParserInterface::setBudget(budget);
+    const uint64_t exceeded = ParserInterface::getBudgetExceededCount();
+
+    QueryRisk limitedQr;
+    ParserInterface limited(query);
+    const int status = limited.parse(&limitedQr);
+    ParserInterface::setBudget(defaultBudget);
+
+    BOOST_CHECK(ParserInterface::BUDGET_EXCEEDED == status);
+    BOOST_CHECK(!limitedQr.valid);
+    BOOST_CHECK(exceeded + 1 == ParserInterface::getBudgetExceededCount());
+    // The scanner still sees the whole query
+    BOOST_CHECK(unlimited.getHash() == limited.getHash());
+    BOOST_CHECK_EQUAL(1u, limitedQr.multiLineComments);
+
+    // Queries that fit in the budget are parsed like before
+    budget.maxTokens = 100;
+    ParserInterface::setBudget(budget);
+    QueryRisk fitsQr;
+    ParserInterface fits(query);
+    const int fitsStatus = fits.parse(&fitsQr);
+    ParserInterface::setBudget(defaultBudget);
+    BOOST_CHECK_EQUAL(0, fitsStatus);
+    BOOST_CHECK(unlimitedQr == fitsQr);
+}
+
+
+void testFastParser()
+{
+    ifstream fin("../src/tests/queries/wikidb.sql");
+    BOOST_REQUIRE(fin.is_open());
+    vector<string> queries;
+    string line;
+    while (getline(fin, line))
+    {
+        queries.push_back(line);
+    }
+    fin.close();
+    BOOST_REQUIRE(!queries.empty());
+
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+        QueryRisk glrQr;
+        ParserInterface::setFastParser(false);
+        ParserInterface glr(queries[i]);
+        const int glrStatus = glr.parse(&glrQr);
+        ParserInterface::setFastParser(true);
+
+        QueryRisk fastQr;
+        ParserInterface fast(queries[i]);
+        const int fastStatus = fast.parse(&fastQr);
+
+        BOOST_CHECK_MESSAGE(
+            glrStatus == fastStatus
+                && glrQr == fastQr
+                && glr.getHash() == fast.getHash(),
+            "Fast parser disagrees with the GLR parser: " << queries[i]
+        );
+    }
+
+    // Common queries never reach the GLR parser
+    const uint64_t fastCount = ParserInterface::getFastParseCount();
+    const uint64_t glrCount = ParserInterface::getGlrParseCount();
+    parseQuery("SELECT * FROM foo WHERE bar = 1");
+    BOOST_CHECK(fastCount + 1 == ParserInterface::getFastParseCount());
+    BOOST_CHECK(glrCount == ParserInterface::getGlrParseCount());
+
+    // Queries that the fast parser rejects are tried again with GLR
+    QueryRisk badQr;
+    ParserInterface bad("SELECT * FROM WHERE");
+    BOOST_CHECK(0 != bad.parse(&badQr));
+    BOOST_CHECK(glrCount + 1 == ParserInterface::getGlrParseCount());
+
+    // Queries that go through one of the grammar's conflicts are left to the
+    // GLR parser instead of the fast parser picking one reading
+    QueryRisk ambiguousQr;
+    ParserInterface ambiguous("SELECT SELECT bar FROM foo");
+    ambiguous.parse(&ambiguousQr);
+    BOOST_CHECK(fastCount + 1 == ParserInterface::getFastParseCount());
+    BOOST_CHECK(glrCount + 2 == ParserInterface::getGlrParseCount());
+
+    ParserInterface::setFastParser(false);
+}
+
+
+void parseAll(
+    const vector<string>* const queries,
+    vector<ParseResult>* const results
+)
+{
+    results->reserve(queries->size());
+    const vector<string>::const_iterator end(queries->end());
+    for (vector<string>::const_iterator i(queries->begin()); i != end; ++i)
+    {
+        ParserInterface parser(*i);
+        QueryRisk qr;
+        ParseResult result;
+        result.status = parser.parse(&qr);
+        result.valid = qr.valid;
+        result.hash = parser.getHash();
+        results->push_back(result);
+    }
+}
+
+
 QueryRisk parseQuery(const string& query)
 {
     QueryRisk qr;
@@ -47,4 +47,29 @@ void testQueryRiskAlwaysTrue();
  */
 void testSelectItems();
 
+/**
+ * Tests that queries parse the same from several threads at once as they do
+ * from one thread, and reports how the throughput scales.
+ */
+void testParseConcurrently();
+
+/**
+ * Tests that queries that are scanned in place parse the same as copied
+ * ones, including strings with escapes in them, and that the query is put
+ * back afterward.
+ */
+void testParseInPlace();
+
+/**
+ * Tests that parsing stops when a query goes over the parse budget, and that
+ * the scanner still sees the whole query.
+ */
+void testParseBudget();
+
+/**
+ * Tests that the fast parser parses the known queries the same as the
+ * GLR parser, and that the queries it rejects are handed to the GLR parser.
+ */
+void testFastParser();
+
 #endif  // SRC_TESTS_TESTPARSER_HPP_
@@ -0,0 +1,140 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Tests the QueryDecisionCache.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testQueryDecisionCache.hpp"
+#include "../QueryDecisionCache.hpp"
+#include "../QueryRisk.hpp"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+#include <boost/test/unit_test.hpp>
+#include <string>
+
+using std::string;
+
+static const double BLOCK_LEVEL = 0.75;
+static const double LOG_LEVEL = 0.5;
+
+/**
+ * Makes a different query for each ID, all of the same length.
+ */
+static string makeQuery(int id);
+
+
+void testQueryDecisionCacheFind()
+{
+    QueryDecisionCache cache(1024 * 1024);
+    const string query("SELECT * FROM user WHERE name = 'admin' OR 1 = 1");
+
+    QueryDecisionCache::Decision decision;
+    decision.dangerous = true;
+    decision.queryType = QueryRisk::TYPE_SELECT;
+    QueryDecisionCache::Report report;
+    report.attackType = "bypass";
+    report.probability = 0.9;
+    decision.reports.push_back(report);
+
+    QueryDecisionCache::Decision found;
+    BOOST_CHECK(!cache.find(query, "wiki", BLOCK_LEVEL, LOG_LEVEL, &found));
+    cache.insert(query, "wiki", BLOCK_LEVEL, LOG_LEVEL, decision);
+    BOOST_CHECK(1 == cache.size());
+
+    BOOST_REQUIRE(cache.find(query, "wiki", BLOCK_LEVEL, LOG_LEVEL, &found));
+    BOOST_CHECK(found.dangerous);
+    BOOST_CHECK(QueryRisk::TYPE_SELECT == found.queryType);
+    BOOST_CHECK(!found.invalid);
+    BOOST_REQUIRE(1 == found.reports.size());
+    BOOST_CHECK(string("bypass") == found.reports[0].attackType);
+    // The tolerance is a percentage
+    BOOST_CHECK_CLOSE(0.9, found.reports[0].probability, 0.0001);
+
+    // Anything different is a different decision
+    const string changed(query + " ");
+    BOOST_CHECK(!cache.find(changed, "wiki", BLOCK_LEVEL, LOG_LEVEL, &found));
+    BOOST_CHECK(!cache.find(query, "forum", BLOCK_LEVEL, LOG_LEVEL, &found));
+    BOOST_CHECK(!cache.find(query, "wiki", 0.9, LOG_LEVEL, &found));
+    BOOST_CHECK(!cache.find(query, "wiki", BLOCK_LEVEL, 0.6, &found));
+
+    BOOST_CHECK(1 == cache.getHits());
+    BOOST_CHECK(5 == cache.getMisses());
+    BOOST_CHECK(0 == cache.getEvictions());
+}
+
+
+void testQueryDecisionCacheEviction()
+{
+    const size_t MAX_BYTES = 4096;
+    // One shard, so that which entry is evicted is predictable
+    QueryDecisionCache cache(MAX_BYTES, 1);
+    const QueryDecisionCache::Decision decision;
+    QueryDecisionCache::Decision found;
+
+    // The queries are all the same length, so they all use the same memory
+    const string first(makeQuery(0));
+    cache.insert(first, "wiki", BLOCK_LEVEL, LOG_LEVEL, decision);
+    int inserted = 1;
+    while (0 == cache.getEvictions())
+    {
+        // Keep the first query used
+        BOOST_REQUIRE(
+            cache.find(first, "wiki", BLOCK_LEVEL, LOG_LEVEL, &found)
+        );
+        cache.insert(
+            makeQuery(inserted),
+            "wiki",
+            BLOCK_LEVEL,
+            LOG_LEVEL,
+            decision
+        );
+        ++inserted;
+        BOOST_REQUIRE(inserted < 1000);
+    }
+
+    BOOST_CHECK(1 == cache.getEvictions());
+    BOOST_CHECK(cache.getBytes() <= MAX_BYTES);
+    BOOST_CHECK(static_cast<size_t>(inserted) - 1 == cache.size());
+    BOOST_CHECK(cache.find(first, "wiki", BLOCK_LEVEL, LOG_LEVEL, &found));
+    // The oldest one that wasn't used again is the one that's gone, because
+    // the clock's hand starts at the oldest entry
+    BOOST_CHECK(
+        !cache.find(makeQuery(1), "wiki", BLOCK_LEVEL, LOG_LEVEL, &found)
+    );
+    BOOST_CHECK(
+        cache.find(makeQuery(2), "wiki", BLOCK_LEVEL, LOG_LEVEL, &found)
+    );
+
+    // Something that doesn't fit at all isn't saved
+    const string huge(MAX_BYTES, 'x');
+    cache.insert(huge, "wiki", BLOCK_LEVEL, LOG_LEVEL, decision);
+    BOOST_CHECK(!cache.find(huge, "wiki", BLOCK_LEVEL, LOG_LEVEL, &found));
+    BOOST_CHECK(cache.getBytes() <= MAX_BYTES);
+}
+
+
+string makeQuery(const int id)
+{
+    return "SELECT * FROM page WHERE page_id = "
+        + boost::lexical_cast<string>(1000 + id);
+}
@@ -0,0 +1,161 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Tests the QueryShapeCache.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testQueryShapeCache.hpp"
+#include "../ParserInterface.hpp"
+#include "../QueryRisk.hpp"
+#include "../QueryShapeCache.hpp"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+#include <string>
+
+using std::string;
+
+/**
+ * Parses a query with and without the cache and checks that the results
+ * are the same.
+ * @return The QueryRisk attributes from parsing with the cache.
+ */
+static QueryRisk parseWithCache(const string& query, QueryShapeCache* cache);
+
+/**
+ * Makes a different shape for each ID, all of the same length.
+ */
+static string makeShape(int id);
+
+
+void testQueryShapeCacheParse()
+{
+    QueryShapeCache cache(1024 * 1024);
+
+    parseWithCache("SELECT * FROM page WHERE page_id = 1323", &cache);
+    BOOST_CHECK(0 == cache.getHits());
+    BOOST_CHECK(1 == cache.size());
+
+    // Different literals and comments are the same shape
+    QueryRisk qr(parseWithCache(
+        "SELECT * FROM page WHERE page_id = 7 -- latest",
+        &cache
+    ));
+    BOOST_CHECK(1 == cache.getHits());
+    BOOST_CHECK(1 == cache.size());
+    BOOST_CHECK(1 == qr.dashDashComments);
+
+    // Tables are checked by name, so they're part of the shape
+    parseWithCache("SELECT * FROM revision WHERE page_id = 7", &cache);
+    BOOST_CHECK(1 == cache.getHits());
+    BOOST_CHECK(2 == cache.size());
+
+    // Comparing two literals depends on their values, so it's never saved
+    qr = parseWithCache("SELECT * FROM page WHERE 1 = 1", &cache);
+    BOOST_CHECK(qr.alwaysTrue);
+    qr = parseWithCache("SELECT * FROM page WHERE 1 = 2", &cache);
+    BOOST_CHECK(!qr.alwaysTrue);
+    BOOST_CHECK(1 == cache.getHits());
+    BOOST_CHECK(2 == cache.size());
+
+    // Empty strings are a different shape than other strings
+    parseWithCache("SELECT * FROM page WHERE page_title = ''", &cache);
+    parseWithCache("SELECT * FROM page WHERE page_title = 'Main'", &cache);
+    parseWithCache("SELECT * FROM page WHERE page_title = 'Talk'", &cache);
+    BOOST_CHECK(2 == cache.getHits());
+    BOOST_CHECK(4 == cache.size());
+
+    // Queries that don't parse aren't saved
+    parseWithCache("SELECT * FROM page WHERE", &cache);
+    parseWithCache("SELECT * FROM page WHERE", &cache);
+    BOOST_CHECK(2 == cache.getHits());
+    BOOST_CHECK(4 == cache.size());
+}
+
+
+void testQueryShapeCacheEviction()
+{
+    const size_t MAX_BYTES = 4096;
+    // One shard, so that which entry is evicted is predictable
+    QueryShapeCache cache(MAX_BYTES, 1);
+    QueryRisk qr;
+    qr.queryType = QueryRisk::TYPE_SELECT;
+    QueryRisk found;
+
+    // The shapes are all the same length, so they all use the same memory
+    const string first(makeShape(0));
+    cache.insert(first, qr);
+    int inserted = 1;
+    while (0 == cache.getEvictions())
+    {
+        // Keep the first shape used
+        BOOST_REQUIRE(cache.find(first, &found));
+        cache.insert(makeShape(inserted), qr);
+        ++inserted;
+        BOOST_REQUIRE(inserted < 1000);
+    }
+
+    BOOST_CHECK(1 == cache.getEvictions());
+    BOOST_CHECK(cache.getBytes() <= MAX_BYTES);
+    BOOST_CHECK(static_cast<size_t>(inserted) - 1 == cache.size());
+    BOOST_REQUIRE(cache.find(first, &found));
+    BOOST_CHECK(QueryRisk::TYPE_SELECT == found.queryType);
+    // The oldest one that wasn't used again is the one that's gone, because
+    // the clock's hand starts at the oldest entry
+    BOOST_CHECK(!cache.find(makeShape(1), &found));
+    BOOST_CHECK(cache.find(makeShape(2), &found));
+
+    // Something that doesn't fit at all isn't saved
+    const string huge(MAX_BYTES, 'x');
+    cache.insert(huge, qr);
+    BOOST_CHECK(!cache.find(huge, &found));
+    BOOST_CHECK(cache.getBytes() <= MAX_BYTES);
+
+    cache.clear();
+    BOOST_CHECK(0 == cache.size());
+    BOOST_CHECK(0 == cache.getBytes());
+}
+
+
+QueryRisk parseWithCache(const string& query, QueryShapeCache* const cache)
+{
+    QueryRisk expected;
+    ParserInterface parser(query);
+    const int expectedStatus = parser.parse(&expected);
+
+    QueryRisk qr;
+    ParserInterface cachedParser(query, cache);
+    const int status = cachedParser.parse(&qr);
+
+    BOOST_CHECK_MESSAGE(
+        expectedStatus == status && expected == qr,
+        "Cached parse differs for: " << query
+    );
+    BOOST_CHECK(parser.getHash() == cachedParser.getHash());
+    return qr;
+}
+
+
+string makeShape(const int id)
+{
+    return "shape " + boost::lexical_cast<string>(1000 + id);
+}
@@ -170,6 +170,19 @@ void checkParseWhitelisted(const string& query)
         QueryWhitelist::isParseWhitelisted(pi.getHash()),
         '"' << query << "\" should be parse whitelisted"
     );
+
+    // The whitelist is checked before parsing too
+    ParserInterface scanned(query);
+    const ParserInterface::QueryHash hash(scanned.scanHash());
+    BOOST_CHECK_MESSAGE(
+        QueryWhitelist::isParseWhitelisted(hash),
+        '"' << query << "\" should be parse whitelisted before parsing"
+    );
+    const int status = scanned.parse(&qr);
+    BOOST_CHECK_MESSAGE(
+        hash == scanned.getHash(),
+        '"' << query << "\" should hash the same before and after parsing"
+    );
 }
 
 
@@ -196,6 +209,10 @@ void checkRiskWhitelisted(const string &query)
         QueryWhitelist::isBlockWhitelisted(pi.getHash(), qr),
         '"' << query << "\" should be risk whitelisted"
     );
+    BOOST_CHECK_MESSAGE(
+        QueryWhitelist::isHashBlockWhitelisted(pi.getHash()),
+        '"' << query << "\" should be hash whitelisted"
+    );
 }
 
 
@@ -0,0 +1,96 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Tests the SHA1 hashes.
+ * @author Brandon Skari
+ * @date October 17 2026
+ */
+
+#include "testSha1.hpp"
+#include "../Sha1.hpp"
+
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <string>
+
+using std::string;
+
+static string hash(const string& data, size_t pieceLength);
+
+
+void testSha1KnownHashes()
+{
+    // Test vectors from FIPS 180-2
+    BOOST_CHECK(
+        "da39a3ee5e6b4b0d3255bfef95601890afd80709" == hash("", 1)
+    );
+    BOOST_CHECK(
+        "a9993e364706816aba3e25717850c26c9cd0d89d" == hash("abc", 1)
+    );
+    const string twoBlocks(
+        "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
+    );
+    BOOST_CHECK(
+        "84983e441c3bd26ebaae4aa1f95129e5e54670f1" == hash(twoBlocks, 56)
+    );
+    const string million(1000000, 'a');
+    BOOST_CHECK(
+        "34aa973cd4c4daa4f61eeb2bdbad27316534016f" == hash(million, 1000)
+    );
+
+    // Where the data is split doesn't matter, including right at the end
+    // of a block or where the padding needs another block
+    for (size_t length = 1; length <= twoBlocks.size(); ++length)
+    {
+        BOOST_CHECK(hash(twoBlocks, length) == hash(twoBlocks, 56));
+    }
+    const string padding(119, 'x');
+    for (size_t length = 50; length < padding.size(); ++length)
+    {
+        const string data(padding.substr(0, length));
+        BOOST_CHECK(hash(data, 1) == hash(data, length));
+    }
+}
+
+
+string hash(const string& data, const size_t pieceLength)
+{
+    Sha1 hasher;
+    for (size_t i = 0; i < data.size(); i += pieceLength)
+    {
+        hasher.update(
+            data.data() + i,
+            std::min(pieceLength, data.size() - i)
+        );
+    }
+    uint8_t digest[Sha1::DIGEST_LENGTH];
+    hasher.finish(digest);
+
+    string hex;
+    for (size_t i = 0; i < Sha1::DIGEST_LENGTH; ++i)
+    {
+        char byte[3];
+        snprintf(byte, sizeof(byte), "%02x", digest[i]);
+        hex += byte;
+    }
+    return hex;
+}
@@ -0,0 +1,123 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Tests the Socket.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testSocket.hpp"
+#include "../Socket.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using std::vector;
+
+static vector<uint8_t> readAvailable(int fd);
+static void sendFromThread(const Socket* socket, const vector<uint8_t>* data);
+
+
+void testSocketGatherWrite()
+{
+    int fds[2];
+    BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    Socket socket(fds[1]);
+
+    // More parts than a single sendmsg can take
+    vector<vector<uint8_t> > messages;
+    vector<uint8_t> expected;
+    for (int i = 0; i < 2000; ++i)
+    {
+        messages.push_back(vector<uint8_t>(i % 7, static_cast<uint8_t>(i)));
+        expected.insert(
+            expected.end(),
+            messages.back().begin(),
+            messages.back().end()
+        );
+    }
+    socket.send(messages);
+    BOOST_CHECK(readAvailable(fds[0]) == expected);
+
+    // Small sends are held back until the batch ends, big ones take
+    // everything that was held back with them
+    const vector<uint8_t> small1(10, 'a');
+    const vector<uint8_t> small2(20, 'b');
+    const vector<uint8_t> big(20000, 'c');
+    socket.beginBatch();
+    socket.send(small1);
+    socket.send(small2);
+    BOOST_CHECK(readAvailable(fds[0]).empty());
+    socket.send(big);
+    socket.send(small1);
+    expected = small1;
+    expected.insert(expected.end(), small2.begin(), small2.end());
+    expected.insert(expected.end(), big.begin(), big.end());
+    BOOST_CHECK(readAvailable(fds[0]) == expected);
+    socket.endBatch();
+    BOOST_CHECK(readAvailable(fds[0]) == small1);
+
+    close(fds[0]);
+}
+
+
+void testSocketBatchOwner()
+{
+    int fds[2];
+    BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    Socket socket(fds[1]);
+
+    const vector<uint8_t> held(10, 'a');
+    const vector<uint8_t> other(15, 'b');
+    socket.beginBatch();
+    socket.send(held);
+    boost::thread sender(boost::bind(sendFromThread, &socket, &other));
+    sender.join();
+    BOOST_CHECK(readAvailable(fds[0]) == other);
+    socket.endBatch();
+    BOOST_CHECK(readAvailable(fds[0]) == held);
+
+    close(fds[0]);
+}
+
+
+vector<uint8_t> readAvailable(const int fd)
+{
+    vector<uint8_t> data;
+    uint8_t buffer[4096];
+    ssize_t bytes;
+    while ((bytes = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0)
+    {
+        data.insert(data.end(), buffer, buffer + bytes);
+    }
+    return data;
+}
+
+
+void sendFromThread(const Socket* const socket, const vector<uint8_t>* data)
+{
+    socket->send(*data);
+}
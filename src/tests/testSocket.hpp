@@ -0,0 +1,34 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SRC_TESTS_TESTSOCKET_HPP_
+#define SRC_TESTS_TESTSOCKET_HPP_
+
+/**
+ * Tests that gather writes and batched sends arrive whole and in order.
+ */
+void testSocketGatherWrite();
+
+
+/**
+ * Tests that a batch only holds back sends from the thread that started it.
+ */
+void testSocketBatchOwner();
+
+#endif  // SRC_TESTS_TESTSOCKET_HPP_
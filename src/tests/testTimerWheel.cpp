@@ -0,0 +1,123 @@
+/*
+ * SQLassie - database firewall
+ * Copyright (C) 2011 Brandon Skari <brandon.skari@gmail.com>
+ *
+ * This file is part of SQLassie.
+ *
+ * SQLassie is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SQLassie is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SQLassie. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Tests the TimerWheel.
+ * @author Brandon Skari
+ * @date October 16 2026
+ */
+
+#include "testTimerWheel.hpp"
+#include "../Socket.hpp"
+#include "../SocketException.hpp"
+#include "../TimerWheel.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using std::vector;
+
+static void record(vector<int>* const fired, const int which);
+
+
+void testTimerWheelExpiry()
+{
+    TimerWheel timers(10);
+    vector<int> fired;
+    // Level 0, level 1, level 2 and level 3 of the wheel
+    const int delays[] = {25, 1000, 100000, 3000000};
+    TimerWheel::TimerId ids[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        ids[i] = timers.schedule(delays[i], boost::bind(record, &fired, i));
+        BOOST_CHECK(0 != ids[i]);
+    }
+    const TimerWheel::TimerId canceled =
+        timers.schedule(50, boost::bind(record, &fired, 4));
+    BOOST_CHECK(5 == timers.size());
+    BOOST_CHECK(timers.cancel(canceled));
+    BOOST_CHECK(!timers.cancel(canceled));
+    BOOST_CHECK(4 == timers.size());
+
+    // Each timer expires in the tick after its delay has gone by
+    uint64_t now = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        const uint64_t expiry = (delays[i] + 9) / 10 + 1;
+        timers.advance(expiry - 1 - now);
+        BOOST_CHECK(static_cast<size_t>(i) == fired.size());
+        timers.advance(1);
+        now = expiry;
+        BOOST_REQUIRE(static_cast<size_t>(i + 1) == fired.size());
+        BOOST_CHECK(i == fired.back());
+        BOOST_CHECK(!timers.cancel(ids[i]));
+    }
+    BOOST_CHECK(0 == timers.size());
+
+    // Canceling 0 is harmless
+    BOOST_CHECK(!timers.cancel(0));
+
+    // New timers reuse the old ones, but the old IDs don't cancel them
+    const TimerWheel::TimerId reused =
+        timers.schedule(50, boost::bind(record, &fired, 5));
+    for (int i = 0; i < 4; ++i)
+    {
+        BOOST_CHECK(reused != ids[i]);
+        BOOST_CHECK(!timers.cancel(ids[i]));
+    }
+    BOOST_CHECK(!timers.cancel(canceled));
+    BOOST_CHECK(1 == timers.size());
+    BOOST_CHECK(timers.cancel(reused));
+    BOOST_CHECK(0 == timers.size());
+    timers.advance(10);
+    BOOST_CHECK(4 == fired.size());
+}
+
+
+void testTimerWheelSocketShutdown()
+{
+    int fds[2];
+    BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    Socket socket(fds[1]);
+
+    TimerWheel timers(10);
+    timers.start();
+    const boost::system_time start = boost::get_system_time();
+    timers.schedule(50, boost::bind(&Socket::shutdown, &socket));
+    vector<uint8_t> message;
+    BOOST_CHECK_THROW(socket.receive(&message), ClosedException);
+    BOOST_CHECK(
+        boost::get_system_time() - start
+            >= boost::posix_time::milliseconds(50)
+    );
+    BOOST_CHECK(0 == timers.size());
+
+    close(fds[0]);
+}
+
+
+void record(vector<int>* const fired, const int which)
+{
+    fired->push_back(which);
+}